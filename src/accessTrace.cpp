@@ -0,0 +1,229 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "accessTrace.h"
+#include "managedMemory.h"
+#include "managedDummySwap.h"
+#include "statsSnapshot.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace rambrain
+{
+
+std::atomic<bool> accessTrace::active ( false );
+
+namespace
+{
+
+const char traceMagic[4] = {'R', 'B', 'A', 'T'};
+///Records buffered before they are written to file
+const size_t traceBufferRecords = 4096;
+
+struct traceFile {
+    std::mutex mutex;
+    FILE *file = NULL;
+    std::vector<accessRecord> buffer;
+    bool failed = false;
+
+    void flush() {
+        if ( !buffer.empty() && fwrite ( buffer.data(), sizeof ( accessRecord ), buffer.size(), file ) != buffer.size() ) {
+            failed = true;
+        }
+        buffer.clear();
+    }
+};
+
+traceFile &recording()
+{
+    static traceFile file;
+    return file;
+}
+
+///Number of the calling thread, threads are numbered on their first record
+uint32_t threadNumber()
+{
+    static std::atomic<uint32_t> threadsSeen ( 0 );
+    static thread_local uint32_t number = threadsSeen.fetch_add ( 1, std::memory_order_relaxed );
+    return number;
+}
+
+}
+
+void accessTrace::append ( accessOp op, const managedMemoryChunk &chunk, bool write )
+{
+    accessRecord record;
+    record.id = chunk.id;
+    record.size = chunk.size;
+    record.thread = threadNumber();
+    record.op = op;
+    record.write = write ? 1 : 0;
+    record.reserved = 0;
+
+    traceFile &trace = recording();
+    std::lock_guard<std::mutex> lock ( trace.mutex );
+    //We may have been stopped in the meantime:
+    if ( !trace.file ) {
+        return;
+    }
+    trace.buffer.push_back ( record );
+    if ( trace.buffer.size() >= traceBufferRecords ) {
+        trace.flush();
+    }
+}
+
+bool accessTrace::start ( const char *path )
+{
+    traceFile &trace = recording();
+    std::lock_guard<std::mutex> lock ( trace.mutex );
+    if ( trace.file ) {
+        return false;
+    }
+    trace.file = fopen ( path, "wb" );
+    if ( !trace.file ) {
+        return false;
+    }
+    trace.failed = fwrite ( traceMagic, 1, 4, trace.file ) != 4 || fwrite ( &version, sizeof ( version ), 1, trace.file ) != 1;
+    trace.buffer.reserve ( traceBufferRecords );
+    active.store ( true, std::memory_order_release );
+    return true;
+}
+
+bool accessTrace::stop()
+{
+    active.store ( false, std::memory_order_release );
+    traceFile &trace = recording();
+    std::lock_guard<std::mutex> lock ( trace.mutex );
+    if ( !trace.file ) {
+        return false;
+    }
+    trace.flush();
+    bool success = !trace.failed;
+    success = fclose ( trace.file ) == 0 && success;
+    trace.file = NULL;
+    return success;
+}
+
+bool accessTrace::read ( const char *path, std::vector<accessRecord> &records )
+{
+    FILE *file = fopen ( path, "rb" );
+    if ( !file ) {
+        return false;
+    }
+    char magic[4];
+    uint32_t fileVersion;
+    if ( fread ( magic, 1, 4, file ) != 4 || memcmp ( magic, traceMagic, 4 ) != 0
+            || fread ( &fileVersion, sizeof ( fileVersion ), 1, file ) != 1 || fileVersion != version ) {
+        fclose ( file );
+        return false;
+    }
+    records.clear();
+    std::vector<accessRecord> block ( traceBufferRecords );
+    size_t got;
+    while ( ( got = fread ( block.data(), sizeof ( accessRecord ), traceBufferRecords, file ) ) > 0 ) {
+        records.insert ( records.end(), block.begin(), block.begin() + got );
+    }
+    const bool success = !ferror ( file );
+    fclose ( file );
+    return success;
+}
+
+accessReplayResult replayAccessTrace ( const std::vector<accessRecord> &records, managedMemory *manager, double bandwidth, double latency )
+{
+    accessReplayResult result;
+    //Recorded ids to the chunks standing in for them:
+    std::unordered_map<memoryID, managedMemoryChunk *> chunks;
+    const auto allocate = [&] ( const accessRecord & record ) {
+        managedMemoryChunk *chunk = manager->mmalloc ( record.size );
+        chunks[record.id] = chunk;
+        ++result.allocations;
+        return chunk;
+    };
+    const auto release = [&] ( managedMemoryChunk * chunk ) {
+        if ( chunk->useCnt > 0 ) {
+            manager->unsetUse ( *chunk, chunk->useCnt );
+        }
+        manager->mfree ( chunk->id );
+    };
+
+    const rambrainStats before = statsSnapshot ( manager );
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( const accessRecord &record : records ) {
+        ++result.records;
+        auto found = chunks.find ( record.id );
+        switch ( record.op ) {
+        case ACCESS_ALLOC:
+            if ( found == chunks.end() ) {
+                allocate ( record );
+            }
+            break;
+        case ACCESS_FREE:
+            if ( found != chunks.end() ) {
+                release ( found->second );
+                chunks.erase ( found );
+            }
+            break;
+        case ACCESS_USE: {
+            managedMemoryChunk *chunk = found == chunks.end() ? allocate ( record ) : found->second;
+            ++result.uses;
+            const bool miss = chunk->status == MEM_SWAPPED || chunk->status == MEM_SWAPOUT;
+            bool used = false;
+            try {
+                used = manager->setUse ( *chunk, record.write != 0 );
+            } catch ( memoryException & ) {
+                //Threads recorded together may have used more at once than the replay's memory holds
+            }
+            if ( !used ) {
+                ++result.failed;
+            } else if ( miss ) {
+                ++result.misses;
+            } else {
+                ++result.hits;
+            }
+            break;
+        }
+        case ACCESS_UNUSE:
+            if ( found != chunks.end() && found->second->useCnt > 0 ) {
+                manager->unsetUse ( *found->second );
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    for ( auto &chunk : chunks ) {
+        release ( chunk.second );
+    }
+    result.seconds = std::chrono::duration<double> ( std::chrono::steady_clock::now() - start ).count();
+
+    const rambrainStats after = statsSnapshot ( manager );
+    result.swapout_bytes = after.counters.swapout_bytes - before.counters.swapout_bytes;
+    result.swapin_bytes = after.counters.swapin_bytes - before.counters.swapin_bytes;
+    result.simulated_seconds = result.seconds;
+    //A real swap spent its transfer time within the replay already:
+    if ( dynamic_cast<managedDummySwap *> ( manager->swap ) ) {
+        result.simulated_seconds += ( result.swapout_bytes + result.swapin_bytes ) / bandwidth + result.misses * latency;
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,134 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACCESSTRACE_H
+#define ACCESSTRACE_H
+
+#include "common.h"
+#include "managedMemoryChunk.h"
+#include <atomic>
+#include <vector>
+
+namespace rambrain
+{
+
+class managedMemory;
+
+///@brief what an accessRecord records
+enum accessOp {
+    ACCESS_ALLOC,
+    ACCESS_FREE,
+    ACCESS_USE,
+    ACCESS_UNUSE
+};
+
+/** @brief one entry of an access trace, written to file as is
+ *
+ *  A trace file starts with the magic "RBAT" and the version as uint32_t, followed by accessRecords in the byte order of the recording machine.
+ **/
+struct accessRecord {
+    memoryID id;
+    ///Size of the chunk, in every record so that chunks allocated before recording started can be replayed
+    global_bytesize size;
+    ///Number of the recording thread, in order of the first record of each thread
+    uint32_t thread;
+    uint8_t op;
+    ///Whether a use asked for write access
+    uint8_t write;
+    uint16_t reserved;
+};
+
+/** @brief Records chunk allocations, frees and uses of all managers to a binary trace file
+ *
+ *  Recording is compiled in, but only active between start() and stop(). While inactive, record() costs a single, well predicted branch.
+ *  Records are taken while managedMemory holds stateChangeMutex, thus their order is the order in which the manager saw them.
+ *  @see replayAccessTrace()
+ **/
+class RAMBRAINAPI accessTrace
+{
+public:
+    ///@brief records an access if recording is active
+    static inline void record ( accessOp op, const managedMemoryChunk &chunk, bool write = false ) {
+        if ( active.load ( std::memory_order_relaxed ) ) {
+            append ( op, chunk, write );
+        }
+    }
+    ///@brief returns whether accesses are recorded
+    static inline bool isActive() {
+        return active.load ( std::memory_order_relaxed );
+    }
+
+    /** @brief starts recording to path, replacing the file
+     *  @return false if the file could not be opened or recording is already active
+     **/
+    static bool start ( const char *path );
+    /** @brief stops recording and closes the file
+     *  @return false if writing the trace failed at some point
+     **/
+    static bool stop();
+
+    /** @brief reads the trace at path
+     *  @return false if the file can not be read or is no access trace of this version
+     **/
+    static bool read ( const char *path, std::vector<accessRecord> &records );
+
+    static constexpr uint32_t version = 1;
+
+private:
+    static void append ( accessOp op, const managedMemoryChunk &chunk, bool write );
+
+    static std::atomic<bool> active;
+};
+
+///@brief outcome of replayAccessTrace()
+struct accessReplayResult {
+    global_bytesize records = 0;
+    global_bytesize allocations = 0;
+    global_bytesize uses = 0;
+    ///Uses of resident chunks
+    global_bytesize hits = 0;
+    ///Uses that had to wait for the chunk to come back from swap
+    global_bytesize misses = 0;
+    ///Uses the manager refused, e.g. as threads of the trace used more at once than fits into the replay's memory
+    global_bytesize failed = 0;
+    ///Bytes written to and read from swap, zero if the library was built without SWAPSTATS
+    global_bytesize swapout_bytes = 0;
+    global_bytesize swapin_bytes = 0;
+    ///Wall clock seconds of the replay
+    double seconds = 0.;
+    ///seconds plus the time the moved bytes and misses would have taken on the modelled device, if the manager swaps to a managedDummySwap
+    double simulated_seconds = 0.;
+};
+
+/** @brief replays records against manager, one record after another
+ *
+ *  Chunks are allocated with their recorded sizes and used as recorded, their contents are not touched. Chunks used before being
+ *  allocated in the trace are allocated on first use, chunks left allocated at the end are freed.
+ *  Uses the manager refuses or throws on are counted as failed, the replay goes on.
+ *  @param bandwidth bytes per second of the modelled swap device
+ *  @param latency seconds every miss costs on the modelled swap device
+ *  @note the modelled device is only accounted for if the manager swaps to a managedDummySwap. Other swaps move their bytes for real,
+ *        the time it took is part of the measured seconds already.
+ *  @note manager should be fresh, counters are taken as differences nevertheless
+ **/
+RAMBRAINAPI accessReplayResult replayAccessTrace ( const std::vector<accessRecord> &records, managedMemory *manager, double bandwidth = 500. * mib, double latency = 1e-4 );
+
+}
+
+#endif
@@ -1,7 +1,9 @@
 #include "c_interface.h"
 
 #include <assert.h>
+#include <vector>
 #include "managedMemory.h"
+#include "common.h"
 
 #define CANARY 0xED0A8D0
 
@@ -24,6 +26,11 @@ namespace rambrain {
             return managedMemory::defaultManager->mfree(id, inCleanup);
         }
 
+        static bool mrealloc(rambrain::memoryID id, size_t s_size)
+        {
+            return managedMemory::defaultManager->mrealloc(id, s_size);
+        }
+
         static bool setUse(managedMemoryChunk* chunk, bool writeAccess) {
             return managedMemory::defaultManager->setUse(*chunk, writeAccess);
         }
@@ -32,7 +39,190 @@ namespace rambrain {
         {
             return managedMemory::defaultManager->unsetUse(*chunk, no_unsets);
         }
+
+        static bool setUse(managedMemoryChunk** chunks, unsigned int nchunks, bool writeAccess)
+        {
+            return managedMemory::defaultManager->setUse(chunks, nchunks, writeAccess);
+        }
+
+        static bool unsetUse(managedMemoryChunk** chunks, unsigned int nchunks)
+        {
+            return managedMemory::defaultManager->unsetUse(chunks, nchunks);
+        }
+
+        static void prepareUse(managedMemoryChunk** chunks, unsigned int nchunks)
+        {
+            managedMemory::lockStateChangeMutex();
+            //Prefetching is a hint, a chunk that can not be swapped in now is left for its use:
+            try
+            {
+                for (unsigned int n = 0; n < nchunks; ++n)
+                {
+                    managedMemory::defaultManager->prepareUse(*chunks[n], false);
+                }
+            }
+            catch (memoryException&)
+            {
+            }
+            rambrain_pthread_mutex_unlock(&managedMemory::stateChangeMutex);
+        }
     };
+
+    /** @brief Maps rambrain_handles to chunks
+     *  A handle holds the slot index + 1 in its lower and the slot's generation in its upper 32 bits.
+     *  The generation is counted up when a slot is freed, so that stale handles do not resolve to a later allocation.
+     *  Resolved handles are held until released, a handle freed meanwhile is left to its last holder, which frees the chunk once it gave back its use.
+     **/
+    class handleTable
+    {
+    public:
+        rambrain_handle insert(managedMemoryChunk* chunk)
+        {
+            rambrain_pthread_mutex_lock(&lock);
+            uint32_t index;
+            if (freeSlots.empty())
+            {
+                index = slots.size();
+                slots.push_back(slot{ chunk, 0, 0, false });
+            }
+            else
+            {
+                index = freeSlots.back();
+                freeSlots.pop_back();
+                slots[index].chunk = chunk;
+            }
+            rambrain_handle handle = ((rambrain_handle)slots[index].generation << 32) | (index + 1);
+            rambrain_pthread_mutex_unlock(&lock);
+            return handle;
+        }
+
+        /// @brief resolves and holds n handles, chunks[i] is NULL for invalid ones. Returns the number of valid ones.
+        /// @param all if set, nothing is held unless all handles are valid
+        size_t acquire(const rambrain_handle* handles, size_t n, managedMemoryChunk** chunks, bool all = false)
+        {
+            size_t valid = 0;
+            rambrain_pthread_mutex_lock(&lock);
+            for (size_t i = 0; i < n; ++i)
+            {
+                chunks[i] = find(handles[i]);
+                valid += chunks[i] ? 1 : 0;
+            }
+            if (all && valid != n)
+            {
+                valid = 0;
+            }
+            for (size_t i = 0; i < n && valid > 0; ++i)
+            {
+                if (chunks[i])
+                {
+                    ++slots[(uint32_t)handles[i] - 1].holders;
+                }
+            }
+            rambrain_pthread_mutex_unlock(&lock);
+            return valid;
+        }
+
+        /// @brief gives back what acquire() held. Returns the number of handles freed in the meantime whose positions were written to orphans,
+        /// the caller has to give back its uses of their chunks and dispose() them.
+        size_t release(const rambrain_handle* handles, size_t n, managedMemoryChunk* const* chunks, size_t* orphans)
+        {
+            size_t norphans = 0;
+            rambrain_pthread_mutex_lock(&lock);
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (!chunks[i])
+                {
+                    continue;
+                }
+                uint32_t index = (uint32_t)handles[i] - 1;
+                if (--slots[index].holders == 0 && slots[index].freed)
+                {
+                    orphans[norphans++] = i;
+                }
+            }
+            rambrain_pthread_mutex_unlock(&lock);
+            return norphans;
+        }
+
+        /// @brief invalidates a handle. Returns its chunk to be dispose()d, or NULL if the handle is invalid or the last holder disposes it.
+        managedMemoryChunk* remove(rambrain_handle handle)
+        {
+            rambrain_pthread_mutex_lock(&lock);
+            managedMemoryChunk* chunk = find(handle);
+            if (chunk)
+            {
+                uint32_t index = (uint32_t)handle - 1;
+                ++slots[index].generation;
+                if (slots[index].holders > 0)
+                {
+                    //The last holder frees it:
+                    slots[index].freed = true;
+                    chunk = NULL;
+                }
+            }
+            rambrain_pthread_mutex_unlock(&lock);
+            return chunk;
+        }
+
+        /// @brief frees the chunk of a handle taken out by remove() or release(). The slot is only recycled if that works, otherwise the handle is valid again.
+        bool dispose(rambrain_handle handle, managedMemoryChunk* chunk)
+        {
+            bool freed = true;
+            try
+            {
+                AllocatorAccessor::mfree(chunk->id);
+            }
+            catch (memoryException&)
+            {
+                freed = false;
+            }
+            uint32_t index = (uint32_t)handle - 1;
+            rambrain_pthread_mutex_lock(&lock);
+            if (freed)
+            {
+                recycle(index);
+            }
+            else
+            {
+                slots[index].generation = (uint32_t)(handle >> 32);
+                slots[index].freed = false;
+            }
+            rambrain_pthread_mutex_unlock(&lock);
+            return freed;
+        }
+
+    private:
+        managedMemoryChunk* find(rambrain_handle handle) const
+        {
+            uint32_t index = (uint32_t)handle;
+            if (index == 0 || index > slots.size())
+            {
+                return NULL;
+            }
+            const slot& s = slots[index - 1];
+            return s.generation == (uint32_t)(handle >> 32) && !s.freed ? s.chunk : NULL;
+        }
+
+        void recycle(uint32_t index)
+        {
+            slots[index].chunk = NULL;
+            slots[index].freed = false;
+            freeSlots.push_back(index);
+        }
+
+        struct slot
+        {
+            managedMemoryChunk* chunk;
+            uint32_t generation;
+            uint32_t holders;
+            bool freed;
+        };
+        std::vector<slot> slots;
+        std::vector<uint32_t> freeSlots;
+        pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    };
+
+    static handleTable table;
 }
 
 rambrain_ptr rambrain_allocate(size_t s_size)
@@ -44,7 +234,9 @@ rambrain_ptr rambrain_allocate(size_t s_size)
         rambrain_ptr* ptr = (rambrain_ptr*)chunk->locPtr;
         ptr->canary = CANARY;
         ptr->chunk = chunk;
-        return *ptr;
+        result = *ptr;
+        //Left in use, the chunk could never be swapped out:
+        AllocatorAccessor::unsetUse(chunk);
     }
     return result;
 }
@@ -55,6 +247,24 @@ void rambrain_free(rambrain_ptr ptr)
     AllocatorAccessor::mfree(static_cast<managedMemoryChunk*>(ptr.chunk)->id);
 }
 
+rambrain_ptr rambrain_reallocate(rambrain_ptr ptr, size_t s_size)
+{
+    assert(ptr.canary == CANARY);
+    //mrealloc throws for referenced chunks or when it can not make room, exceptions must not cross into C:
+    try
+    {
+        if (!AllocatorAccessor::mrealloc(static_cast<managedMemoryChunk*>(ptr.chunk)->id, s_size + sizeof(rambrain_ptr)))
+        {
+            return rambrain_null_ptr;
+        }
+    }
+    catch (memoryException&)
+    {
+        return rambrain_null_ptr;
+    }
+    return ptr;
+}
+
 void* rambrain_reference(rambrain_ptr ptr)
 {
     assert(ptr.canary == CANARY);
@@ -62,6 +272,13 @@ void* rambrain_reference(rambrain_ptr ptr)
     return static_cast<managedMemoryChunk*>(ptr.chunk)->locPtr;
 }
 
+const void* rambrain_reference_const(rambrain_ptr ptr)
+{
+    assert(ptr.canary == CANARY);
+    AllocatorAccessor::setUse(static_cast<managedMemoryChunk*>(ptr.chunk), false);
+    return static_cast<managedMemoryChunk*>(ptr.chunk)->locPtr;
+}
+
 rambrain_ptr rambrain_dereference(rambrain_ptr ptr)
 {
     assert(ptr.canary == CANARY);
@@ -85,3 +302,189 @@ void* rambrain_ptr_to_data(rambrain_ptr ptr)
     return (char*)ptr_on_chunk + sizeof(rambrain_ptr);
 }
 
+
+rambrain_handle rambrain_handle_allocate(size_t s_size)
+{
+    managedMemoryChunk* chunk = NULL;
+    try
+    {
+        chunk = AllocatorAccessor::mmalloc(s_size);
+    }
+    catch (memoryException&)
+    {
+    }
+    return chunk ? table.insert(chunk) : RAMBRAIN_NULL_HANDLE;
+}
+
+void rambrain_handle_free(rambrain_handle handle)
+{
+    rambrain_free_many(&handle, 1);
+}
+
+namespace rambrain {
+
+    /// @brief gives back the uses taken on chunks whose handles were freed during the call and frees them
+    static void disposeOrphans(const rambrain_handle* handles, managedMemoryChunk** chunks, const size_t* orphans, size_t norphans, bool used)
+    {
+        for (size_t o = 0; o < norphans; ++o)
+        {
+            size_t i = orphans[o];
+            if (used)
+            {
+                try
+                {
+                    AllocatorAccessor::unsetUse(chunks[i]);
+                }
+                catch (memoryException&)
+                {
+                }
+            }
+            table.dispose(handles[i], chunks[i]);
+        }
+    }
+
+    /// @brief references a single handle, see rambrain_handle_reference
+    static void* referenceHandle(rambrain_handle handle, bool writable)
+    {
+        managedMemoryChunk* chunk;
+        if (table.acquire(&handle, 1, &chunk) != 1)
+        {
+            return NULL;
+        }
+        bool used = false;
+        try
+        {
+            used = AllocatorAccessor::setUse(chunk, writable);
+        }
+        catch (memoryException&)
+        {
+        }
+        size_t orphan;
+        if (table.release(&handle, 1, &chunk, &orphan) == 1)
+        {
+            //Freed while we were setting the use, the use has to be given back before the chunk can be freed:
+            disposeOrphans(&handle, &chunk, &orphan, 1, used);
+            return NULL;
+        }
+        return used ? chunk->locPtr : NULL;
+    }
+}
+
+void* rambrain_handle_reference(rambrain_handle handle)
+{
+    return referenceHandle(handle, true);
+}
+
+const void* rambrain_handle_reference_const(rambrain_handle handle)
+{
+    return referenceHandle(handle, false);
+}
+
+void rambrain_handle_dereference(rambrain_handle handle)
+{
+    managedMemoryChunk* chunk;
+    size_t valid = table.acquire(&handle, 1, &chunk);
+    assert(valid == 1);
+    if (valid == 1)
+    {
+        try
+        {
+            AllocatorAccessor::unsetUse(chunk);
+        }
+        catch (memoryException&)
+        {
+        }
+        size_t orphan;
+        size_t norphans = table.release(&handle, 1, &chunk, &orphan);
+        disposeOrphans(&handle, &chunk, &orphan, norphans, false);
+    }
+}
+
+int rambrain_reference_many(const rambrain_handle* handles, size_t n, int writable, void** data)
+{
+    std::vector<managedMemoryChunk*> chunks(n);
+    if (table.acquire(handles, n, chunks.data(), true) != n)
+    {
+        return 0;
+    }
+    int result = 0;
+    //Chunks that do not fit into memory at once make setUse throw, which must not reach C:
+    try
+    {
+        result = AllocatorAccessor::setUse(chunks.data(), n, writable != 0) ? 1 : 0;
+    }
+    catch (memoryException&)
+    {
+    }
+    std::vector<size_t> orphans(n);
+    size_t norphans = table.release(handles, n, chunks.data(), orphans.data());
+    if (norphans > 0 && result)
+    {
+        //A handle was freed meanwhile, the batch is refused as a whole:
+        try
+        {
+            AllocatorAccessor::unsetUse(chunks.data(), n);
+        }
+        catch (memoryException&)
+        {
+        }
+        result = 0;
+    }
+    disposeOrphans(handles, chunks.data(), orphans.data(), norphans, false);
+    for (size_t i = 0; i < n && result; ++i)
+    {
+        data[i] = chunks[i]->locPtr;
+    }
+    return result;
+}
+
+int rambrain_dereference_many(const rambrain_handle* handles, size_t n)
+{
+    std::vector<managedMemoryChunk*> chunks(n);
+    if (table.acquire(handles, n, chunks.data(), true) != n)
+    {
+        return 0;
+    }
+    int result = 0;
+    try
+    {
+        result = AllocatorAccessor::unsetUse(chunks.data(), n) ? 1 : 0;
+    }
+    catch (memoryException&)
+    {
+    }
+    std::vector<size_t> orphans(n);
+    size_t norphans = table.release(handles, n, chunks.data(), orphans.data());
+    disposeOrphans(handles, chunks.data(), orphans.data(), norphans, false);
+    return result;
+}
+
+void rambrain_prefetch_many(const rambrain_handle* handles, size_t n)
+{
+    std::vector<managedMemoryChunk*> chunks(n), valid;
+    table.acquire(handles, n, chunks.data());
+    for (managedMemoryChunk* chunk : chunks)
+    {
+        if (chunk)
+        {
+            valid.push_back(chunk);
+        }
+    }
+    AllocatorAccessor::prepareUse(valid.data(), valid.size());
+    std::vector<size_t> orphans(n);
+    size_t norphans = table.release(handles, n, chunks.data(), orphans.data());
+    disposeOrphans(handles, chunks.data(), orphans.data(), norphans, false);
+}
+
+void rambrain_free_many(const rambrain_handle* handles, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        //Chunks still in use are not freed and keep their handle valid:
+        managedMemoryChunk* chunk = table.remove(handles[i]);
+        if (chunk)
+        {
+            table.dispose(handles[i], chunk);
+        }
+    }
+}
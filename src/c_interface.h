@@ -1,8 +1,10 @@
 #pragma once
 
 #include "export.h"
+#include <stddef.h>
+#include <stdint.h>
 
-#ifdef _cplusplus
+#ifdef __cplusplus
 extern "C" {
 #endif
 
@@ -23,13 +25,46 @@ static_assert (sizeof(rambrain_ptr) == 16, "rambrain_ptr size is not correct");
 
 extern rambrain_ptr rambrain_null_ptr;
 
+// Allocates s_size bytes. The data is not referenced, call rambrain_reference before accessing it, also through rambrain_ptr_to_data.
 RAMBRAINAPI rambrain_ptr rambrain_allocate(size_t s_size);
 RAMBRAINAPI void		 rambrain_free(rambrain_ptr ptr);
+// Resizes the allocation keeping its contents, ptr must not be referenced. Returns rambrain_null_ptr and leaves ptr intact on failure.
+RAMBRAINAPI rambrain_ptr rambrain_reallocate(rambrain_ptr ptr, size_t s_size);
 RAMBRAINAPI void*		 rambrain_reference(rambrain_ptr ptr);
+// Like rambrain_reference, but the data must not be written. A clean copy in swap stays valid and the data is not written out again.
+RAMBRAINAPI const void*	 rambrain_reference_const(rambrain_ptr ptr);
 RAMBRAINAPI rambrain_ptr rambrain_dereference(rambrain_ptr ptr);
 RAMBRAINAPI rambrain_ptr rambrain_ptr_from_data(void* chunk);
 RAMBRAINAPI void*		 rambrain_ptr_to_data(rambrain_ptr ptr);
 
-#ifdef _cplusplus
+// Opaque handle to an allocation. Handles index a table instead of carrying chunk pointers,
+// the data holds no header and a freed handle is detected instead of being dereferenced.
+typedef uint64_t rambrain_handle;
+#define RAMBRAIN_NULL_HANDLE ((rambrain_handle)0)
+
+// Allocates s_size bytes which are not referenced yet. Returns RAMBRAIN_NULL_HANDLE on failure.
+RAMBRAINAPI rambrain_handle rambrain_handle_allocate(size_t s_size);
+RAMBRAINAPI void			rambrain_handle_free(rambrain_handle handle);
+// Returns the data, resident until dereferenced. Returns NULL for invalid handles.
+RAMBRAINAPI void*			rambrain_handle_reference(rambrain_handle handle);
+// Like rambrain_handle_reference, but the data must not be written. A clean copy in swap stays valid and the data is not written out again.
+RAMBRAINAPI const void*		rambrain_handle_reference_const(rambrain_handle handle);
+RAMBRAINAPI void			rambrain_handle_dereference(rambrain_handle handle);
+
+// Batch calls resolve all handles under one lock of the handle table. Referencing, dereferencing and prefetching lock the memory manager once per call,
+// freeing frees handle by handle. A handle may be listed more than once.
+// A handle freed while another thread is inside a call on it is freed when that call is done, the call then fails as for an invalid handle.
+// Data that is still referenced is not freed, its handle stays valid.
+// References all n handles at once, their data is written to data. The data of all of them has to fit into memory at once.
+// Returns 0 and references nothing if a handle is invalid.
+RAMBRAINAPI int				rambrain_reference_many(const rambrain_handle* handles, size_t n, int writable, void** data);
+// Gives back one reference per entry. Returns 0 and dereferences nothing if a handle is invalid.
+RAMBRAINAPI int				rambrain_dereference_many(const rambrain_handle* handles, size_t n);
+// Starts reading the handles' data from swap without referencing it, invalid handles are skipped.
+RAMBRAINAPI void			rambrain_prefetch_many(const rambrain_handle* handles, size_t n);
+// Frees all n handles, invalid handles are skipped.
+RAMBRAINAPI void			rambrain_free_many(const rambrain_handle* handles, size_t n);
+
+#ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -32,6 +32,7 @@
 #include <cstring>
 #include <algorithm>
 #include <functional>
+#include <sstream>
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -79,6 +80,12 @@ void configLine<global_bytesize>::setValue ( const string &str )
     }
 }
 
+template<>
+void configLine<double>::setValue ( const string &str )
+{
+    value = atof ( str.c_str() );
+}
+
 template<>
 void configLine<bool>::setValue ( const string &str )
 {
@@ -98,6 +105,24 @@ void configLine<swapPolicy>::setValue ( const string &str )
         value = swapPolicy::autoextendable;
     }
 }
+
+template<>
+void configLine<vector<labelPolicyConfig> >::setValue ( const string &str )
+{
+    value.clear();
+    stringstream policies ( str );
+    string policy;
+    while ( getline ( policies, policy, ',' ) ) {
+        size_t first = policy.find ( ':' ), last = policy.rfind ( ':' );
+        if ( first == string::npos || first == last ) {
+            continue;
+        }
+        configLine<global_bytesize> budget ( "budget", 0, regexMatcher::floating | regexMatcher::units );
+        budget.setValue ( policy.substr ( first + 1, last - first - 1 ) );
+        size_t begin = policy.find_first_not_of ( " \t" );
+        value.push_back ( {policy.substr ( begin, first - begin ), budget.value, atoi ( policy.c_str() + last + 1 ) } );
+    }
+}
 #ifdef _WIN32
 unsigned long long getTotalSystemMemory()
 {
@@ -128,7 +153,21 @@ configuration::configuration() : memoryManager ( "memoryManager", "cyclicManaged
     memory ( "memory", 0, regexMatcher::floating | regexMatcher::units ),
     swapMemory ( "swapMemory", 0, regexMatcher::floating | regexMatcher::units ),
     enableDMA ( "enableDMA", true, regexMatcher::integer | regexMatcher::boolean ),
-    policy ( "policy", swapPolicy::autoextendable, regexMatcher::text )
+    dirtyTracking ( "dirtyTracking", false, regexMatcher::integer | regexMatcher::boolean ),
+    policy ( "policy", swapPolicy::autoextendable, regexMatcher::text ),
+    adaptivePreemption ( "adaptivePreemption", false, regexMatcher::integer | regexMatcher::boolean ),
+    swapInFracMin ( "swapInFracMin", .85, regexMatcher::floating ),
+    swapInFracMax ( "swapInFracMax", .95, regexMatcher::floating ),
+    swapOutFracMin ( "swapOutFracMin", .6, regexMatcher::floating ),
+    swapOutFracMax ( "swapOutFracMax", .9, regexMatcher::floating ),
+    preemptiveTurnoffFraction ( "preemptiveTurnoffFraction", .01, regexMatcher::floating ),
+    backgroundReclaim ( "backgroundReclaim", false, regexMatcher::integer | regexMatcher::boolean ),
+    reclaimLowWatermark ( "reclaimLowWatermark", .85, regexMatcher::floating ),
+    reclaimHighWatermark ( "reclaimHighWatermark", .95, regexMatcher::floating ),
+    writeBackRate ( "writeBackRate", 0, regexMatcher::floating | regexMatcher::units ),
+    segmentSize ( "segmentSize", 0, regexMatcher::floating | regexMatcher::units ),
+    labelPolicies ( "labelPolicies", {}, regexMatcher::labelpolicies ),
+    pinFraction ( "pinFraction", .5, regexMatcher::floating )
 {
     // Fill configOptions
     configOptions.push_back ( &memoryManager );
@@ -137,7 +176,21 @@ configuration::configuration() : memoryManager ( "memoryManager", "cyclicManaged
     configOptions.push_back ( &memory );
     configOptions.push_back ( &swapMemory );
     configOptions.push_back ( &enableDMA );
+    configOptions.push_back ( &dirtyTracking );
     configOptions.push_back ( &policy );
+    configOptions.push_back ( &adaptivePreemption );
+    configOptions.push_back ( &swapInFracMin );
+    configOptions.push_back ( &swapInFracMax );
+    configOptions.push_back ( &swapOutFracMin );
+    configOptions.push_back ( &swapOutFracMax );
+    configOptions.push_back ( &preemptiveTurnoffFraction );
+    configOptions.push_back ( &backgroundReclaim );
+    configOptions.push_back ( &reclaimLowWatermark );
+    configOptions.push_back ( &reclaimHighWatermark );
+    configOptions.push_back ( &writeBackRate );
+    configOptions.push_back ( &segmentSize );
+    configOptions.push_back ( &labelPolicies );
+    configOptions.push_back ( &pinFraction );
 
 #ifdef _WIN32
     memory.value = getTotalSystemMemory() * 0.5;
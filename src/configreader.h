@@ -51,6 +51,17 @@ enum class swapPolicy {
 };
 
 
+/**
+ * @brief Ram budget and eviction priority of an allocation label as given in a config file
+ * @see managedMemory::setLabelPolicy
+ */
+struct labelPolicyConfig {
+    string label;
+    global_bytesize budget;
+    int priority;
+};
+
+
 /**
  * @brief Base class for config lines
  */
@@ -114,6 +125,10 @@ public:
 template<>
 void configLine<global_bytesize>::setValue ( const string &str );
 
+/// @copydoc configLine<T>::setValue
+template<>
+void configLine<double>::setValue ( const string &str );
+
 /// @copydoc configLine<T>::setValue
 template<>
 void configLine<bool>::setValue ( const string &str );
@@ -122,6 +137,10 @@ void configLine<bool>::setValue ( const string &str );
 template<>
 void configLine<swapPolicy>::setValue ( const string &str );
 
+/// @copydoc configLine<T>::setValue
+template<>
+void configLine<vector<labelPolicyConfig> >::setValue ( const string &str );
+
 
 /**
  * @brief Main struct to save configuration variables
@@ -138,7 +157,24 @@ struct configuration {
     configLine<string> memoryManager, swap, swapfiles;
     configLine<global_bytesize> memory, swapMemory;
     configLine<bool> enableDMA;
+    /// Whether managedFileSwap tracks writes page by page and rewrites only modified pages of chunks having a copy on disk
+    configLine<bool> dirtyTracking;
     configLine<swapPolicy> policy;
+    /// Whether cyclicManagedMemory adapts swapInFrac / swapOutFrac from the measured preemptive hit rate
+    configLine<bool> adaptivePreemption;
+    /// Bounds for the adaptive controller and the fraction of free swap below which preemptive loading is turned off
+    configLine<double> swapInFracMin, swapInFracMax, swapOutFracMin, swapOutFracMax, preemptiveTurnoffFraction;
+    /// Whether a background thread swaps out cold chunks once ram usage exceeds reclaimHighWatermark, down to reclaimLowWatermark
+    configLine<bool> backgroundReclaim;
+    configLine<double> reclaimLowWatermark, reclaimHighWatermark;
+    /// Bytes per second the background reclaimer may write back to give cold chunks a clean copy on disk, 0 to switch off
+    configLine<global_bytesize> writeBackRate;
+    /// Size of the swappable segments large managedPtr arrays are split into, 0 to not split arrays at all
+    configLine<global_bytesize> segmentSize;
+    /// Budgets and priorities of allocation labels as comma separated label:budget:priority, e.g. mesh:64MB:2, scratch:0:-1
+    configLine<vector<labelPolicyConfig> > labelPolicies;
+    /// Fraction of memory that pinned managedPtrs may take at most
+    configLine<double> pinFraction;
 
     vector<configLineBase *> configOptions;
 };
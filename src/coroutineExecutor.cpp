@@ -0,0 +1,138 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "coroutineExecutor.h"
+#include "common.h"
+#include <vector>
+
+namespace rambrain
+{
+
+task::promise_type::~promise_type()
+{
+    if ( executor ) {
+        executor->taskFinished ( error );
+    }
+}
+
+coroutineExecutor::coroutineExecutor ( global_bytesize bytesInFlight ) : bytesInFlight ( bytesInFlight == 0 ? managedMemory::defaultManager->getMemoryLimit() / 2 : bytesInFlight )
+{
+}
+
+coroutineExecutor::~coroutineExecutor()
+{
+    if ( alive > 0 ) {
+        warnmsgf ( "%u tasks have not finished before their executor, they will never be resumed", alive );
+    }
+    pthread_cond_destroy ( &readyCond );
+}
+
+void coroutineExecutor::spawn ( task &&t )
+{
+    std::coroutine_handle<task::promise_type> handle = t.handle;
+    t.handle = NULL;
+    handle.promise().executor = this;
+    rambrain_pthread_mutex_lock ( &lock );
+    ++alive;
+    rambrain_pthread_mutex_unlock ( &lock );
+    schedule ( handle );
+}
+
+void coroutineExecutor::run()
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    while ( alive > 0 ) {
+        if ( ready.empty() ) { //Tasks are waiting for swap, arrivals schedule them
+            pthread_cond_wait ( &readyCond, &lock );
+            continue;
+        }
+        std::coroutine_handle<> handle = ready.front();
+        ready.pop_front();
+        rambrain_pthread_mutex_unlock ( &lock );
+        handle.resume();
+        rambrain_pthread_mutex_lock ( &lock );
+    }
+    std::exception_ptr error = firstError;
+    firstError = NULL;
+    rambrain_pthread_mutex_unlock ( &lock );
+    if ( error ) {
+        std::rethrow_exception ( error );
+    }
+}
+
+unsigned int coroutineExecutor::tasksAlive() const
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    unsigned int n = alive;
+    rambrain_pthread_mutex_unlock ( &lock );
+    return n;
+}
+
+void coroutineExecutor::schedule ( std::coroutine_handle<> handle )
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    ready.push_back ( handle );
+    pthread_cond_signal ( &readyCond );
+    rambrain_pthread_mutex_unlock ( &lock );
+}
+
+bool coroutineExecutor::acquireBytes ( pendingRequest *request )
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    //Requests are served in order, a large one may only pass if nothing else is in flight:
+    bool granted = waiting.empty() && ( bytesUsed + request->bytes <= bytesInFlight || bytesUsed == 0 );
+    if ( granted ) {
+        bytesUsed += request->bytes;
+    } else {
+        waiting.push_back ( request );
+    }
+    rambrain_pthread_mutex_unlock ( &lock );
+    return granted;
+}
+
+void coroutineExecutor::releaseBytes ( global_bytesize bytes )
+{
+    std::vector<pendingRequest *> issue;
+    rambrain_pthread_mutex_lock ( &lock );
+    bytesUsed -= bytes;
+    while ( !waiting.empty() && ( bytesUsed + waiting.front()->bytes <= bytesInFlight || bytesUsed == 0 ) ) {
+        bytesUsed += waiting.front()->bytes;
+        issue.push_back ( waiting.front() );
+        waiting.pop_front();
+    }
+    rambrain_pthread_mutex_unlock ( &lock );
+    //Issuing may wait for rambrain, thus we do not hold our lock:
+    for ( pendingRequest *request : issue ) {
+        request->issue();
+    }
+}
+
+void coroutineExecutor::taskFinished ( std::exception_ptr error )
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    if ( error && !firstError ) {
+        firstError = error;
+    }
+    if ( --alive == 0 ) {
+        pthread_cond_broadcast ( &readyCond );
+    }
+    rambrain_pthread_mutex_unlock ( &lock );
+}
+
+}
@@ -0,0 +1,303 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COROUTINEEXECUTOR_H
+#define COROUTINEEXECUTOR_H
+
+#include "managedPtr.h"
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <pthread.h>
+
+namespace rambrain
+{
+
+class coroutineExecutor;
+
+/** @brief Coroutine type of tasks run by a coroutineExecutor
+ *
+ *  A task is started by handing it to coroutineExecutor::spawn(). Inside, managedPtrs are awaited by co_await use ( ptr ).
+ *  The task's frame is freed when it finishes.
+ **/
+class task
+{
+public:
+    struct promise_type {
+        coroutineExecutor *executor = NULL;
+
+        task get_return_object() {
+            return task ( std::coroutine_handle<promise_type>::from_promise ( *this ) );
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+        ///Tells the executor that the task finished, as the frame is destroyed after this
+        ~promise_type();
+
+        std::exception_ptr error;
+    };
+
+    task ( task &&ref ) : handle ( ref.handle ) {
+        ref.handle = NULL;
+    }
+    task ( const task &ref ) = delete;
+    task &operator= ( const task &ref ) = delete;
+    ///@brief destroys the task if it was never spawned
+    ~task() {
+        if ( handle ) {
+            handle.destroy();
+        }
+    }
+
+private:
+    explicit task ( std::coroutine_handle<promise_type> handle ) : handle ( handle ) {}
+
+    std::coroutine_handle<promise_type> handle;
+
+    friend class coroutineExecutor;
+};
+
+/** @brief Runs many tasks waiting for managedPtrs on few threads
+ *
+ *  A task waiting for a chunk to arrive from swap is suspended instead of blocking its thread. It is resumed by a thread calling run()
+ *  as soon as the swap reports the chunk's arrival. The bytes requested by tasks of the executor at a time are limited, so that
+ *  waiting tasks never take all memory and new requests are only issued when previous uses ended.
+ *  @note _thread-safety_: run() may be called by several threads, spawn() may be called by running tasks.
+ **/
+class RAMBRAINAPI coroutineExecutor
+{
+public:
+    /** @param bytesInFlight bytes that tasks of this executor may request or use at a time, 0 chooses half of the memory limit
+     *  @note a single request larger than this is issued when no other request is pending
+     **/
+    coroutineExecutor ( global_bytesize bytesInFlight = 0 );
+    ~coroutineExecutor();
+
+    coroutineExecutor ( const coroutineExecutor &ref ) = delete;
+    coroutineExecutor &operator= ( const coroutineExecutor &ref ) = delete;
+
+    ///@brief takes over t and schedules it
+    void spawn ( task &&t );
+    /** @brief resumes tasks in the calling thread until all spawned tasks finished
+     *  @note rethrows the first exception that escaped a task, after all tasks finished
+     **/
+    void run();
+    ///@brief returns the number of spawned tasks that did not finish yet
+    unsigned int tasksAlive() const;
+
+    ///@brief queues a suspended coroutine for resumption, may be called from rambrain's completion callbacks
+    void schedule ( std::coroutine_handle<> handle );
+
+    ///@brief a request waiting for bytes in flight to become available
+    struct pendingRequest {
+        global_bytesize bytes;
+        ///issues the request, called once the bytes were granted
+        virtual void issue() = 0;
+    };
+
+    /** @brief reserves bytes for a request to be issued
+     *  @return true if granted right away, otherwise request->issue() is called once they are
+     **/
+    bool acquireBytes ( pendingRequest *request );
+    ///@brief gives back bytes of a finished use, issuing waiting requests that fit now
+    void releaseBytes ( global_bytesize bytes );
+
+private:
+    void taskFinished ( std::exception_ptr error );
+
+    const global_bytesize bytesInFlight;
+    global_bytesize bytesUsed = 0;
+    unsigned int alive = 0;
+    std::deque<std::coroutine_handle<> > ready;
+    std::deque<pendingRequest *> waiting;
+    std::exception_ptr firstError;
+
+    mutable pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t readyCond = PTHREAD_COND_INITIALIZER;
+
+    friend struct task::promise_type;
+};
+
+/** @brief Use of a managedPtr's data, obtained by co_await use ( ptr ) inside a task
+ *
+ *  The data stays resident until this object is destroyed or release() is called.
+ **/
+template <class T>
+class inUse
+{
+public:
+    inUse ( const managedPtr<T> *data, bool writable, coroutineExecutor *executor, global_bytesize bytes ) : data ( data ), writable ( writable ), executor ( executor ), bytes ( bytes ) {}
+    inUse ( inUse<T> &&ref ) : data ( ref.data ), writable ( ref.writable ), executor ( ref.executor ), bytes ( ref.bytes ) {
+        ref.data = NULL;
+    }
+    inUse ( const inUse<T> &ref ) = delete;
+    inUse<T> &operator= ( const inUse<T> &ref ) = delete;
+
+    ~inUse() {
+        release();
+    }
+
+    ///@brief gives back the use early
+    void release() {
+        if ( !data ) {
+            return;
+        }
+        if ( data->size() != 0 ) {
+            data->unsetUse ( 1 );
+        }
+        executor->releaseBytes ( bytes );
+        data = NULL;
+    }
+
+    ///@brief This operator can be used to pull the data to a const pointer.
+    operator const T *() { //This one is needed as c++ refuses to pick operator const T *() const as a default in this case
+        return * ( ( const inUse<T> * ) this );
+    }
+    ///@brief This operator can be used to pull the data to a const pointer.
+    operator const T *() const {
+        return !data || data->size() == 0 ? NULL : ( const T * ) data->chunk->locPtr;
+    }
+    ///@brief This operator can be used to pull the data to a non-const pointer. Throws if used read-only
+    operator T *() {
+        if ( !writable ) {
+            throw memoryException ( "Can not pull writable pointer from read-only use" );
+        }
+        return !data || data->size() == 0 ? NULL : ( T * ) data->chunk->locPtr;
+    }
+
+private:
+    const managedPtr<T> *data;
+    bool writable;
+    coroutineExecutor *executor;
+    global_bytesize bytes;
+};
+
+/** @brief Awaitable returned by use(), suspends the awaiting task until the managedPtr's data is resident
+ *  @note only awaitable inside a task
+ **/
+template <class T>
+class useAwaiter : private coroutineExecutor::pendingRequest
+{
+public:
+    useAwaiter ( const managedPtr<T> &data, bool writable ) : data ( &data ), writable ( writable ) {
+        if ( data.isSegmented() ) {
+            throw memoryException ( "Segmented managedPtr can not be awaited" );
+        }
+        bytes = data.size() * sizeof ( T );
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    bool await_suspend ( std::coroutine_handle<task::promise_type> handle ) {
+        this->handle = handle;
+        executor = handle.promise().executor;
+        if ( !executor->acquireBytes ( this ) ) {
+            return true;//We are issued when bytes are released
+        }
+        if ( data->size() == 0 ) {
+            return false;
+        }
+        request.emplace ( *data->chunk, writable, [this]() {
+            signalled();
+        } );
+        if ( !managedMemory::defaultManager->setUseAsync ( *request ) ) {
+            executor->releaseBytes ( bytes );
+            throw memoryException ( "Could not request managedPtr" );
+        }
+        //If the chunk arrived already, we go on right away:
+        return !suspended.exchange ( true );
+    }
+
+    inUse<T> await_resume() {
+        if ( error ) {
+            //No use was taken, the task gets the failure instead:
+            executor->releaseBytes ( bytes );
+            std::rethrow_exception ( error );
+        }
+        return inUse<T> ( data, writable, executor, bytes );
+    }
+
+private:
+    /** @brief Called once the bytes were granted while we are suspended
+     *  @note runs inside releaseBytes(), possibly from the destructor of another task's inUse, thus must not throw.
+     *        A failure is handed to the task by resuming it, await_resume() rethrows it.
+     **/
+    virtual void issue() {
+        suspended = true;
+        if ( data->size() == 0 ) {
+            executor->schedule ( handle );
+            return;
+        }
+        request.emplace ( *data->chunk, writable, [this]() {
+            signalled();
+        } );
+        try {
+            if ( !managedMemory::defaultManager->setUseAsync ( *request ) ) {
+                throw memoryException ( "Could not request managedPtr" );
+            }
+        } catch ( ... ) {
+            error = std::current_exception();
+            executor->schedule ( handle );
+        }
+    }
+
+    ///Called when the chunk arrived, resumes the task unless it did not suspend yet
+    void signalled() {
+        if ( suspended.exchange ( true ) ) {
+            executor->schedule ( handle );
+        }
+    }
+
+    const managedPtr<T> *data;
+    const bool writable;
+    coroutineExecutor *executor = NULL;
+    std::coroutine_handle<> handle;
+    std::optional<asyncUse> request;
+    ///Failure of issuing the request, rethrown when the task resumes
+    std::exception_ptr error;
+    ///Whether the task is suspended, decides whether the arrival resumes it or await_suspend goes on right away
+    std::atomic<bool> suspended{false};
+};
+
+/** @brief returns an awaitable that suspends the awaiting task until data is resident
+ *  @code
+ *  auto glue = co_await use ( ptr );
+ *  double *loc = glue;
+ *  @endcode
+ **/
+template <class T>
+useAwaiter<T> use ( const managedPtr<T> &data, bool writable = true )
+{
+    return useAwaiter<T> ( data, writable );
+}
+
+}
+
+#endif
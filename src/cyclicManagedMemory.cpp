@@ -22,6 +22,8 @@
 #include "exceptions.h"
 #include "rambrain_atomics.h"
 #include "managedSwap.h"
+#include "statsSnapshot.h"
+#include "eventTrace.h"
 #include <pthread.h>
 #include <cmath>
 //#define VERYVERBOSE
@@ -52,6 +54,7 @@ cyclicManagedMemory::cyclicManagedMemory ( managedSwap *swap, global_bytesize si
 void cyclicManagedMemory::schedulerRegister ( managedMemoryChunk &chunk )
 {
     BACKLOG_ADD_ID ( REGISTER, chunk.id )
+    eventTrace::record ( TRACE_REGISTER, chunk.id, chunk.size );
     cyclicAtime *neu = new cyclicAtime;
 
     //Couple chunk to atime and vice versa:
@@ -129,9 +132,13 @@ bool cyclicManagedMemory::touch ( managedMemoryChunk &chunk )
 {
     rambrain_pthread_mutex_lock ( &cyclicTopoLock );
     BACKLOG_ADD_ID ( TOUCH, chunk.id )
+    eventTrace::record ( TRACE_TOUCH, chunk.id );
+    ++epochTouches;
     if ( chunk.preemptiveLoaded ) { //This chunk was preemptively loaded
         ++consecutivePreemptiveTransactions;
         preemptiveBytes -= chunk.size;
+        epochPreemptiveHits += chunk.size;
+        preemptiveHitBytes += chunk.size;
 
         chunk.preemptiveLoaded = false;
     } else {
@@ -204,11 +211,166 @@ bool cyclicManagedMemory::setPreemptiveUnloading ( bool preemptive )
     return old;
 }
 
+bool cyclicManagedMemory::setAdaptivePreemption ( bool adaptive )
+{
+    bool old = adaptivePreemption;
+    adaptivePreemption = adaptive;
+    epochPreemptiveHits = epochPreemptiveWaste = 0;
+    epochTouches = epochMisses = 0;
+    epochMissLatency = 0.;
+    lastStallPerTouch = -1.;
+    return old;
+}
+
+bool cyclicManagedMemory::setSwapFractionBounds ( float swapInMin, float swapInMax, float swapOutMin, float swapOutMax )
+{
+    if ( swapInMin > swapInMax || swapOutMin > swapOutMax || swapOutMin > swapInMax || swapInMax > 1. || swapOutMin < 0. ) {
+        warnmsg ( "Inconsistent bounds for swapInFrac / swapOutFrac, keeping old ones" );
+        return false;
+    }
+    lockStateChangeMutex();
+    swapInFracMin = swapInMin;
+    swapInFracMax = swapInMax;
+    swapOutFracMin = swapOutMin;
+    swapOutFracMax = swapOutMax;
+    swapInFrac = max ( swapInFracMin, min ( swapInFracMax, swapInFrac ) );
+    swapOutFrac = max ( swapOutFracMin, min ( swapOutFracMax, min ( swapOutFrac, swapInFrac ) ) );
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return true;
+}
+
+double cyclicManagedMemory::setPreemptiveTurnoffFraction ( double fraction )
+{
+    double old = preemptiveTurnoffFraction;
+    preemptiveTurnoffFraction = fraction;
+    return old;
+}
+
+double cyclicManagedMemory::getPreemptiveHitRate() const
+{
+    global_bytesize all = preemptiveHitBytes + preemptiveWasteBytes;
+    return all == 0 ? 0. : ( ( double ) preemptiveHitBytes ) / all;
+}
+
+void cyclicManagedMemory::schedulerMissed ( managedMemoryChunk &, double seconds, bool miss )
+{
+    missLatencyTotal += seconds;
+    epochMissLatency += seconds;
+    if ( !miss ) {
+        return;
+    }
+    ++n_misses;
+    if ( adaptivePreemption && ++epochMisses >= adaptEpochMisses ) {
+        adaptPreemptiveFractions();
+    }
+}
+
+void cyclicManagedMemory::reportSchedulerStats ( rambrainStats &stats ) const
+{
+    stats.scheduler.preemptive_bytes = preemptiveBytes;
+    stats.scheduler.preemptive_hit_bytes = preemptiveHitBytes;
+    stats.scheduler.preemptive_waste_bytes = preemptiveWasteBytes;
+    stats.scheduler.misses = n_misses;
+    stats.scheduler.miss_latency = missLatencyTotal;
+    stats.scheduler.swapin_frac = swapInFrac;
+    stats.scheduler.swapout_frac = swapOutFrac;
+    stats.scheduler.adaptations = n_adaptations;
+}
+
+void cyclicManagedMemory::adaptPreemptiveFractions()
+{
+    //We try to minimize the time users are stalled per access. The preemptive hit rate tells us directly whether
+    //guesses pay off, in between we hill-climb on the measured stall time, as hits are useless if the working set starves.
+    double stallPerTouch = epochMissLatency / ( epochTouches == 0 ? 1 : epochTouches );
+    global_bytesize judged = epochPreemptiveHits + epochPreemptiveWaste;
+    double hitRate = judged == 0 ? -1. : ( ( double ) epochPreemptiveHits ) / judged;
+
+    if ( hitRate < 0. ) {
+        adaptDirection = 1; // We did not guess anything, so we can not tell. Open the window to find out.
+    } else if ( hitRate < adaptHitRateLow ) {
+        adaptDirection = -1;
+    } else if ( hitRate > adaptHitRateHigh ) {
+        adaptDirection = 1;
+    } else if ( lastStallPerTouch >= 0. && stallPerTouch > lastStallPerTouch ) {
+        adaptDirection = -adaptDirection;
+    }
+
+    //Move swapOutFrac first, this gives memory to / takes memory from the working set.
+    //If swapOutFrac hits its bounds, swapInFrac has to move the rest, reducing / increasing free space kept for the user.
+    float step = adaptStep;
+    if ( adaptDirection > 0 ) {
+        float out = max ( swapOutFracMin, swapOutFrac - step );
+        step -= swapOutFrac - out;
+        swapOutFrac = out;
+        swapInFrac = min ( swapInFracMax, swapInFrac + step );
+    } else {
+        float out = min ( swapOutFracMax, min ( swapInFrac, swapOutFrac + step ) );
+        step -= out - swapOutFrac;
+        swapOutFrac = out;
+        swapInFrac = max ( max ( swapInFracMin, swapOutFrac ), swapInFrac - step );
+    }
+
+    //A smaller window may leave us with more preemptive bytes than allowed, give them back to the working set:
+    global_bytesize max_preemptive = ( swapInFrac - swapOutFrac ) * memory_max;
+    if ( preemptiveBytes > max_preemptive ) {
+        decay ( preemptiveBytes - max_preemptive );
+    }
+
+    lastStallPerTouch = stallPerTouch;
+    epochPreemptiveHits = epochPreemptiveWaste = 0;
+    epochTouches = epochMisses = 0;
+    epochMissLatency = 0.;
+    ++n_adaptations;
+}
+
+bool cyclicManagedMemory::swapOutPossible ( const managedMemoryChunk &chunk ) const
+{
+    //Only chunks with a location in swap may have a writeBack in flight:
+    return !chunk.swapBuf || !swap->writeBackOutdated ( chunk );
+}
+
+global_bytesize cyclicManagedMemory::writeBackCold ( global_bytesize bytes )
+{
+    rambrain_pthread_mutex_lock ( &cyclicTopoLock );
+    if ( !counterActive ) {
+        rambrain_pthread_mutex_unlock ( &cyclicTopoLock );
+        return 0;
+    }
+    //swapOut walks backwards from counterActive, down to swapOutFrac. Only these chunks profit from a clean copy.
+    global_bytesize horizon = ( 1. - swapOutFrac ) * memory_max;
+    global_bytesize passed = 0;
+    global_bytesize written = 0;
+    cyclicAtime *cur = counterActive;
+    do {
+        managedMemoryChunk *chunk = cur->chunk;
+        if ( chunk->status == MEM_ALLOCATED ) {
+            passed += chunk->size;
+            if ( !chunk->swapBuf ) {
+                written += swap->writeBack ( chunk );
+            }
+        }
+        cur = cur->prev;
+    } while ( written < bytes && passed < horizon && cur != counterActive );
+    rambrain_pthread_mutex_unlock ( &cyclicTopoLock );
+    return written;
+}
+
 void cyclicManagedMemory::printMemUsage() const
 {
     global_bytesize claimed_use = swap->getUsedSwap();
-    fprintf ( stderr, "%lu\t%lu=%lu\t%lu\n", memory_used, claimed_use, memory_swapped, preemptiveBytes );
+    fprintf ( stderr, "%lu\t%lu=%lu\t%lu\t%.3f\t%.3f\n", memory_used, claimed_use, memory_swapped, preemptiveBytes, swapOutFrac, swapInFrac );
+}
+
+#ifdef SWAPSTATS
+void cyclicManagedMemory::printSchedulerStats() const
+{
+    infomsgf ( "%lu bytes were loaded preemptively and used, %lu bytes were thrown away again (hit rate %.3f)\
+          \n\t%lu misses blocked the user for %.3e s (%.3e s/avg)\
+          \n\tswapOutFrac = %.3f, swapInFrac = %.3f (%s, %u adaptations)", preemptiveHitBytes, preemptiveWasteBytes, getPreemptiveHitRate(), \
+               n_misses, missLatencyTotal, missLatencyTotal / ( n_misses == 0 ? 1 : n_misses ), \
+               swapOutFrac, swapInFrac, adaptivePreemption ? "adaptive" : "fixed", n_adaptations );
 }
+#endif
 void cyclicManagedMemory::insertBefore ( cyclicAtime *pos, cyclicManagedMemory::chain separated )
 {
     if ( !separated.from ) {
@@ -309,6 +471,7 @@ afterchecks:
 void cyclicManagedMemory::decay ( global_bytesize bytes )
 {
     BACKLOG_ADD_SIZE ( DECAY, bytes )
+    eventTrace::record ( TRACE_DECAY, bytes );
     if ( preemptiveStart == NULL ) {
         return;
     }
@@ -321,7 +484,7 @@ void cyclicManagedMemory::decay ( global_bytesize bytes )
     unsigned int chunks = 0;
     bool consecutive = true;
     while ( cur != active && bytesselected < bytes ) {
-        if ( cur->chunk->size + bytesselected < swapleft && cur->chunk->status == MEM_ALLOCATED && cur->chunk->useCnt == 0 ) {
+        if ( cur->chunk->size + bytesselected < swapleft && cur->chunk->status == MEM_ALLOCATED && cur->chunk->useCnt == 0 && cur->chunk->pinCnt == 0 && swapOutPossible ( *cur->chunk ) ) {
             bytesselected += cur->chunk->size;
             ++chunks;
             cur->chunk->preemptiveLoaded = false;
@@ -338,7 +501,7 @@ void cyclicManagedMemory::decay ( global_bytesize bytes )
     managedMemoryChunk **cursw = chunklist;
     bytesselected = 0;
     while ( cur2 != cur && bytesselected < bytes ) {
-        if ( cur2->chunk->size + bytesselected < swapleft && cur2->chunk->status == MEM_ALLOCATED && cur2->chunk->useCnt == 0 ) {
+        if ( cur2->chunk->size + bytesselected < swapleft && cur2->chunk->status == MEM_ALLOCATED && cur2->chunk->useCnt == 0 && cur2->chunk->pinCnt == 0 && swapOutPossible ( *cur2->chunk ) ) {
             *cursw = cur2->chunk;
             ++cursw;
             bytesselected += cur2->chunk->size;
@@ -349,6 +512,8 @@ void cyclicManagedMemory::decay ( global_bytesize bytes )
         Throw ( rambrain::memoryException ( "Could not swap out bytes even though swap claimed to be able to swap out this." ) );
     }
     preemptiveBytes -= bytesselected;
+    epochPreemptiveWaste += bytesselected;
+    preemptiveWasteBytes += bytesselected;
 #ifdef SWAPSTATS
     ++n_swap_out;
     swap_out_scheduled_bytes += bytesselected;
@@ -396,15 +561,12 @@ bool cyclicManagedMemory::swapIn ( managedMemoryChunk &chunk )
     double prob_random_preempt = pow ( swapInFrac - swapOutFrac, consecutivePreemptiveTransactions );
 
     if ( 0.01 > prob_random_preempt || pow ( swapInFrac - swapOutFrac, preemptiveSinceLast ) > .01 ) {
-        global_bytesize preemptiveReduction = 2.* ( max_preemptive - preemptiveBytes ) + 1;
+        //Adapted fractions may have shrunk the preemptive window below what is loaded already:
+        global_bytesize preemptiveReduction = 2.* ( max_preemptive > preemptiveBytes ? max_preemptive - preemptiveBytes : 0 ) + 1;
         decay ( preemptiveReduction );
     }
     consecutivePreemptiveTransactions = 0;
 
-    // We use the old border to ensure that sth is not swapped in again that was just swapped out.
-    cyclicAtime *oldBorder = counterActive;
-
-
     global_bytesize actual_obj_size = chunk.size;
     //We want to read in what the user requested plus fill up the preemptive area with opportune guesses
 
@@ -417,7 +579,7 @@ bool cyclicManagedMemory::swapIn ( managedMemoryChunk &chunk )
         }
 #endif
 
-        global_bytesize targetReadinVol = actual_obj_size + ( swapInFrac - swapOutFrac ) * memory_max - preemptiveBytes;
+        global_bytesize targetReadinVol = actual_obj_size + ( max_preemptive > preemptiveBytes ? max_preemptive - preemptiveBytes : 0 );
 #ifdef VERYVERBOSE
         printf ( "Preemptive swapin (premptiveBytes = %lu) (targetReadinVol = %lu)\n", preemptiveBytes, targetReadinVol );
 #endif
@@ -428,7 +590,8 @@ bool cyclicManagedMemory::swapIn ( managedMemoryChunk &chunk )
 #ifdef VERYVERBOSE
             printf ( "We do not have space to get fully preemptive, lets try swap something out\n" );
 #endif
-            global_bytesize targetSwapoutVol = actual_obj_size + ( 1. - swapOutFrac ) * memory_max - preemptiveBytes;
+            global_bytesize swapoutWindow = ( 1. - swapOutFrac ) * memory_max;
+            global_bytesize targetSwapoutVol = actual_obj_size + ( swapoutWindow > preemptiveBytes ? swapoutWindow - preemptiveBytes : 0 );
             targetReadinVol = targetSwapoutVol;
             swapErrorCode err = swapOut ( targetReadinVol ); // A simple call to ensureEnoughSpace is not enough, we want to control what happens on error.
             if ( err != ERR_SUCCESS ) {
@@ -463,12 +626,15 @@ bool cyclicManagedMemory::swapIn ( managedMemoryChunk &chunk )
         global_bytesize preemtivelySelected = 0;
         unsigned int numberSelected = 0;
         rambrain_pthread_mutex_lock ( &cyclicTopoLock );
+        // We use the old border to ensure that sth is not swapped in again that was just swapped out.
+        // It is taken only now, as making space above may have waited for other threads reordering the cycle.
+        cyclicAtime *oldBorder = counterActive;
 
 #ifdef VERYVERBOSE
         printf ( "Starting swapin selection" );
 #endif
 
-        max_preemptive -= preemptiveBytes; //Our limit for this transaction.
+        max_preemptive = max_preemptive > preemptiveBytes ? max_preemptive - preemptiveBytes : 0; //Our limit for this transaction.
 
         //Why do we not have to check for chunk's status?
         // Because, as we should load in a swapped element, we're in the swapped section,
@@ -540,6 +706,9 @@ bool cyclicManagedMemory::swapIn ( managedMemoryChunk &chunk )
 
         VERBOSEPRINT ( "Before reordering" );
         preemptiveBytes += selectedReadinVol - actual_obj_size;
+        if ( numberSelected > 1 ) {
+            eventTrace::record ( TRACE_PREEMPTIVE_LOAD, chunk.id, selectedReadinVol - actual_obj_size );
+        }
 
         if ( readEl == oldBorder ) { // Correct for boundary too long when hitting counterActive.
             readEl = readEl->next;
@@ -636,13 +805,28 @@ bool cyclicManagedMemory::swapIn ( managedMemoryChunk &chunk )
 }
 
 
+bool cyclicManagedMemory::swapIn ( managedMemoryChunk **chunklist, unsigned int nchunks )
+{
+    //The base class touches the chunks it requested, moving them out of the swapped section:
+    if ( !managedMemory::swapIn ( chunklist, nchunks ) ) {
+        return false;
+    }
+    rambrain_pthread_mutex_lock ( &cyclicTopoLock );
+    if ( counterActive && counterActive->chunk->status == MEM_SWAPPED ) {
+        counterActive = active;
+    }
+    rambrain_pthread_mutex_unlock ( &cyclicTopoLock );
+    return true;
+}
+
 void cyclicManagedMemory::untouch ( managedMemoryChunk &chunk )
 {
     if ( !preemtiveSwapOut ) {
         return;
     }
     global_bytesize keep_free_for_user = ( 1. - swapInFrac ) * ( memory_max );
-    global_bytesize total_preemptive_needed = preemtiveSwapIn ? ( swapInFrac - swapOutFrac ) * ( memory_max ) - preemptiveBytes : 0;
+    global_bytesize max_preemptive = ( swapInFrac - swapOutFrac ) * ( memory_max );
+    global_bytesize total_preemptive_needed = preemtiveSwapIn && max_preemptive > preemptiveBytes ? max_preemptive - preemptiveBytes : 0;
     //We also account for memory that is in the process of becoming free:
     global_bytesize currently_free = memory_max - memory_used + memory_tobefreed;
     global_bytesize desired_free = total_preemptive_needed + keep_free_for_user;
@@ -655,7 +839,7 @@ void cyclicManagedMemory::untouch ( managedMemoryChunk &chunk )
 
 bool cyclicManagedMemory::checkCycle()
 {
-    rambrain_pthread_mutex_lock ( &stateChangeMutex );
+    lockStateChangeMutex();
     rambrain_pthread_mutex_lock ( &cyclicTopoLock );
     BACKLOG_ADD_SIZE ( CHECK, 0 )
 #ifdef PARENTAL_CONTROL
@@ -933,38 +1117,55 @@ cyclicManagedMemory::swapErrorCode cyclicManagedMemory::swapOut ( rambrain::glob
     mem_swap = mem_swap > swap_free ? min_size : mem_swap;//But do not swap more than swap can take (Or try with only min_size)
 
     cyclicAtime *fromPos = counterActive;
-    cyclicAtime *countPos = counterActive;
     global_bytesize unload_size = 0;
-    global_bytesize unload_size2 = 0;
-    unsigned int passed = 0, unload = 0;
 #ifdef PARENTAL_CONTROL
     unsigned int allelements = memChunks.size() - 1 ;
 #else
     unsigned int allelements = memChunks.size();
 #endif
 
-
-    //First round: Calculate number of objects to swap out.
-    while ( unload_size < mem_swap ) {
-        ++passed;
-        if ( countPos->chunk->status == MEM_ALLOCATED && ( unload_size + countPos->chunk->size <= swap_free )  && ( countPos->chunk->useCnt == 0 ) ) {
-            if ( countPos->chunk->size + unload_size <= swap_free ) {
-                unload_size += countPos->chunk->size;
-                ++unload;
+    //Select from the least recently used backwards. If labels have budgets, the first round around the cycle only takes chunks of labels
+    //over budget, until all of them are back within budget. Each further round admits the next higher priority until enough is selected:
+    const bool prioritized = evictionLevels.size() > 1 || labelBudgets;
+    unloadlist.clear();
+    if ( prioritized ) {
+        selected.clear();
+    }
+    for ( labelPolicy *policy : labelPolicies ) {
+        policy->selected = 0;
+    }
+    unsigned int furthest = 0;
+    const unsigned int budgetRounds = labelBudgets ? 1 : 0;
+    for ( unsigned int round = 0; round < budgetRounds + evictionLevels.size() && ( round < budgetRounds || unload_size < mem_swap ); ++round ) {
+        const bool budgetRound = round < budgetRounds;
+        const int level = budgetRound ? std::numeric_limits<int>::min() : evictionLevels[round - budgetRounds];
+        cyclicAtime *countPos = counterActive;
+        unsigned int passed = 0;
+        while ( ( budgetRound || unload_size < mem_swap ) && passed < allelements ) {
+            ++passed;
+            managedMemoryChunk *chunk = countPos->chunk;
+            if ( chunk->status == MEM_ALLOCATED && ( unload_size + chunk->size <= swap_free ) && ( chunk->useCnt == 0 ) && ( chunk->pinCnt == 0 ) && swapOutPossible ( *chunk )
+                    && ( !prioritized || ( evictionPriority ( *chunk ) <= level && selected.insert ( chunk ).second ) ) ) {
+                unload_size += chunk->size;
+                unloadlist.push_back ( chunk );
+                if ( chunk->policy ) {
+                    chunk->policy->selected += chunk->size;
+                }
+                if ( passed > furthest ) { //The chunks moved around below range from counterActive to the furthest selected one
+                    furthest = passed;
+                    fromPos = countPos;
+                }
 #ifdef VERYVERBOSE
-                printf ( "U(%d)\t", countPos->chunk->id );
+                printf ( "U(%d)\t", chunk->id );
 #endif
             }
+            countPos = countPos->prev;
         }
-
-        if ( passed == allelements ) {
 #ifdef VERYVERBOSE
+        if ( passed == allelements ) {
             printf ( "emergency, once round!\n" );
-#endif
-            break;
         }
-
-        countPos = countPos->prev;
+#endif
     }
     if ( unload_size == 0 ) {
 #ifdef VERYVERBOSE
@@ -974,41 +1175,31 @@ cyclicManagedMemory::swapErrorCode cyclicManagedMemory::swapOut ( rambrain::glob
         return ERR_NOTENOUGHCANDIDATES;
     }
 
-    managedMemoryChunk **unloadlist = new managedMemoryChunk*[unload];
-    managedMemoryChunk **unloadElem = unloadlist;
 #ifdef VERYVERBOSE
     printf ( "active = %d\n", active->chunk->id );
 #endif
-    passed = 0;
     bool resetPreemptiveStart = false;
-    while ( unload_size2 < unload_size && passed != allelements ) {
-        ++passed;
-        if ( fromPos->chunk->status == MEM_ALLOCATED && ( unload_size2 + fromPos->chunk->size <= swap_free ) && ( fromPos->chunk->useCnt == 0 ) ) {
-            if ( fromPos->chunk->size + unload_size2 <= swap_free ) {
-                unload_size2 += fromPos->chunk->size;
-                *unloadElem = fromPos->chunk;
-                ++unloadElem;
+    for ( managedMemoryChunk *chunk : unloadlist ) {
 #ifdef VERYVERBOSE
-                printf ( "swapout %d\n", fromPos->chunk->id );
+        printf ( "swapout %d\n", chunk->id );
 #endif
-                if ( fromPos->chunk->preemptiveLoaded ) { //We had this chunk preemptive, but now have to swap out.
-                    //This is a bit evil, as we will reload preemptive bytes when we've swapped them out.
-                    ///@todo investigate if subtracting swapped out preemptive bytes is affecting performance ( too much preemptive action possible ). Naively testing, this is not the case.
-                    fromPos->chunk->preemptiveLoaded = false;
-                    preemptiveBytes -= fromPos->chunk->size;
-                }
-                if ( preemptiveStart && ( fromPos->chunk == preemptiveStart->chunk ) ) {
-                    resetPreemptiveStart = true;
-                }
-                if ( active->chunk == fromPos->chunk )  {
-                    active = active->prev;
-                }
-            }
+        if ( chunk->preemptiveLoaded ) { //We had this chunk preemptive, but now have to swap out.
+            //This is a bit evil, as we will reload preemptive bytes when we've swapped them out.
+            ///@todo investigate if subtracting swapped out preemptive bytes is affecting performance ( too much preemptive action possible ). Naively testing, this is not the case.
+            chunk->preemptiveLoaded = false;
+            preemptiveBytes -= chunk->size;
+            epochPreemptiveWaste += chunk->size;
+            preemptiveWasteBytes += chunk->size;
+        }
+        if ( preemptiveStart && ( chunk == preemptiveStart->chunk ) ) {
+            resetPreemptiveStart = true;
+        }
+        if ( active->chunk == chunk )  {
+            active = active->prev;
         }
-        fromPos = fromPos->prev;
     }
-    global_bytesize real_unloaded = swap->swapOut ( unloadlist, unload );
-    delete[] unloadlist;
+    global_bytesize real_unloaded = swap->swapOut ( unloadlist.data(), unloadlist.size() );
+    eventTrace::record ( TRACE_SWAPOUT_SELECT, min_size, real_unloaded );
     bool swapSuccess = ( real_unloaded >= mem_swap ) ; // Do not compare with unload size (false positives!)
     if ( !swapSuccess ) {
         if ( real_unloaded == 0 ) {
@@ -1022,7 +1213,6 @@ cyclicManagedMemory::swapErrorCode cyclicManagedMemory::swapOut ( rambrain::glob
 #ifdef VERYVERBOSE
     printf ( "active = %d\n", active->chunk->id );
 #endif
-    fromPos = fromPos->next;
     chain possiblyContaminated = {fromPos, counterActive};
     cyclicAtime *after = counterActive->next;
     if ( after == fromPos ) { // We're cyclic
@@ -1097,6 +1287,7 @@ cyclicManagedMemory::swapErrorCode cyclicManagedMemory::swapOut ( rambrain::glob
 
 cyclicManagedMemory::~cyclicManagedMemory()
 {
+    setBackgroundReclaim ( false ); //The reclaimer calls our swapOut, so stop it before we're gone.
     auto it = memChunks.begin();
     while ( it != memChunks.end() ) {
         cyclicAtime *element = ( cyclicAtime * ) it->second->schedBuf;
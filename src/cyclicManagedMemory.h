@@ -21,6 +21,7 @@
 #define CYCLICMANAGEDMEMORY_H
 
 #include "managedMemory.h"
+#include <unordered_set>
 
 #ifdef _WIN32
 #undef DELETE
@@ -79,6 +80,37 @@ public:
      * @return previous value
      */
     bool setPreemptiveUnloading ( bool preemptive );
+    /**
+     * @brief sets whether the scheduler adapts swapInFrac and swapOutFrac online
+     * @param adaptive iff set to true, the fractions follow the measured preemptive hit rate and miss latency
+     * @return previous value
+     */
+    bool setAdaptivePreemption ( bool adaptive );
+    /**
+     * @brief sets the bounds within which the adaptive controller may move the fractions
+     * @note current fractions are clamped into the new bounds
+     * @return false if the bounds are inconsistent and have not been applied
+     */
+    bool setSwapFractionBounds ( float swapInMin, float swapInMax, float swapOutMin, float swapOutMax );
+    /**
+     * @brief sets the fraction of free swap below which preemptive loading is switched off
+     * @return previous value
+     */
+    double setPreemptiveTurnoffFraction ( double fraction );
+    ///@brief simple getter
+    inline float getSwapInFrac() const {
+        return swapInFrac;
+    }
+    ///@brief simple getter
+    inline float getSwapOutFrac() const {
+        return swapOutFrac;
+    }
+    ///@brief returns fraction of preemptively loaded bytes that were used before being decayed or evicted
+    double getPreemptiveHitRate() const;
+#ifdef SWAPSTATS
+    ///@brief prints preemptive hit rate, miss latency and the current fractions
+    virtual void printSchedulerStats() const;
+#endif
 
     struct chain {
         cyclicAtime *from, *to;
@@ -92,11 +124,16 @@ private:
      * @note protect call to swapIn by topologicalMutex
      */
     virtual bool swapIn ( managedMemoryChunk &chunk );
+    ///@brief batch swapIn, reorders the cycle like a non-preemptive swapIn of each chunk @see managedMemory::swapIn ( managedMemoryChunk **chunklist, unsigned int nchunks )
+    virtual bool swapIn ( managedMemoryChunk **chunklist, unsigned int nchunks );
     /**
      * @brief cyclic implementation of swapOut, see paper
      * @note protect call to swapIn by topologicalMutex
      */
     virtual swapErrorCode swapOut ( global_bytesize min_size );
+    virtual bool hasSwapOutCandidates() const {
+        return counterActive != 0;
+    }
     virtual bool touch ( managedMemoryChunk &chunk );
     ///@brief tries to regulate immediately usable free memory in ram to a level optimal for preemptive loading
     virtual void untouch ( managedMemoryChunk &chunk );
@@ -104,6 +141,14 @@ private:
     virtual void schedulerDelete ( managedMemoryChunk &chunk );
     ///@brief: Tries to unload around bytes bytes of preemptive elements
     void decay ( global_bytesize bytes );
+    ///@brief: tells whether swap can take the chunk now, it can not while an outdated copy of it is still being written back
+    bool swapOutPossible ( const managedMemoryChunk &chunk ) const;
+    virtual void schedulerMissed ( managedMemoryChunk &chunk, double seconds, bool miss );
+    virtual void reportSchedulerStats ( rambrainStats &stats ) const;
+    ///@brief: moves the preemptive window ( swapInFrac - swapOutFrac ) according to the statistics of the last epoch
+    void adaptPreemptiveFractions();
+    ///@brief: writes back the coldest chunks that the next swapOut would choose
+    virtual global_bytesize writeBackCold ( global_bytesize bytes );
 
 
     //loop pointers:
@@ -122,8 +167,42 @@ private:
 
     static pthread_mutex_t cyclicTopoLock;
 
+    ///Selection buffers of swapOut, kept over calls so that evicting does not allocate. Guarded by cyclicTopoLock
+    std::vector<managedMemoryChunk *> unloadlist;
+    ///Chunks selected in earlier rounds of a prioritized swapOut
+    std::unordered_set<managedMemoryChunk *> selected;
+
     double preemptiveTurnoffFraction = .01;
 
+    //Adaptive preemption controller:
+    bool adaptivePreemption = false;
+    float swapInFracMin = .85;
+    float swapInFracMax = .95;
+    float swapOutFracMin = .6;
+    float swapOutFracMax = .9;
+    ///Bytes of preemptively loaded chunks that have been touched / thrown away again in the current epoch
+    global_bytesize epochPreemptiveHits = 0;
+    global_bytesize epochPreemptiveWaste = 0;
+    unsigned int epochTouches = 0;
+    unsigned int epochMisses = 0;
+    double epochMissLatency = 0.;
+    ///Mean stall per touch of the last epoch
+    double lastStallPerTouch = -1.;
+    int adaptDirection = 1;
+    ///Number of blocking misses after which the controller reconsiders the fractions
+    static const unsigned int adaptEpochMisses = 32;
+    ///Fraction of memory_max the preemptive window is moved per epoch
+    static constexpr float adaptStep = .02;
+    ///Below / above these hit rates the window is shrunk / grown regardless of miss latency
+    static constexpr double adaptHitRateLow = .25;
+    static constexpr double adaptHitRateHigh = .75;
+
+    global_bytesize preemptiveHitBytes = 0;
+    global_bytesize preemptiveWasteBytes = 0;
+    global_bytesize n_misses = 0;
+    double missLatencyTotal = 0.;
+    unsigned int n_adaptations = 0;
+
 
     ///@brief: separates all chunks matching state in list separateStatus  or preeemptiveLoaded from the ring
     struct cyclicManagedMemory::chain filterChain ( chain &toFilter, const memoryStatus *separateStatus, bool *preemptiveLoaded = NULL );
@@ -0,0 +1,268 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dirtyPageTracker.h"
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace rambrain
+{
+
+dirtyPageTracker::trackedSlot dirtyPageTracker::slots[dirtyPageTracker::maxTrackedRanges];
+std::atomic<unsigned int> dirtyPageTracker::usedSlots ( 0 );
+pthread_mutex_t dirtyPageTracker::rangesLock = PTHREAD_MUTEX_INITIALIZER;
+#ifndef _WIN32
+global_bytesize dirtyPageTracker::faultPageSize = 0;
+bool dirtyPageTracker::handlerInstalled = false;
+struct sigaction dirtyPageTracker::previousHandler;
+#endif
+
+#ifndef _WIN32
+dirtyPageTracker::dirtyPageTracker() : pageSize ( sysconf ( _SC_PAGE_SIZE ) )
+#else
+dirtyPageTracker::dirtyPageTracker() : pageSize ( 4096 )
+#endif
+{
+#ifndef _WIN32
+    rambrain_pthread_mutex_lock ( &rangesLock );
+    //The handler stays installed when the last tracker is gone, as we can not know whether someone chained to it in the meantime.
+    //Without tracked ranges it just hands every fault on.
+    if ( !handlerInstalled ) {
+        faultPageSize = pageSize;
+        struct sigaction action;
+        memset ( &action, 0, sizeof ( action ) );
+        action.sa_sigaction = &dirtyPageTracker::writeFault;
+        action.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+        sigemptyset ( &action.sa_mask );
+        sigaction ( SIGSEGV, &action, &previousHandler );
+        handlerInstalled = true;
+    }
+    rambrain_pthread_mutex_unlock ( &rangesLock );
+#endif
+}
+
+dirtyPageTracker::~dirtyPageTracker()
+{
+    for ( managedMemoryChunk *chunk : trackedChunks() ) {
+        release ( *chunk );
+    }
+}
+
+bool dirtyPageTracker::isSupported()
+{
+#ifndef _WIN32
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool dirtyPageTracker::track ( managedMemoryChunk &chunk )
+{
+#ifndef _WIN32
+    if ( !chunk.locPtr ) {
+        return false;
+    }
+    //We may only protect pages nobody else has data in:
+    uintptr_t base = ( uintptr_t ) chunk.locPtr;
+    char *first = ( char * ) ( ( base + pageSize - 1 ) / pageSize * pageSize );
+    char *end = ( char * ) ( ( base + chunk.size ) / pageSize * pageSize );
+    if ( first >= end ) {
+        return false;
+    }
+
+    rambrain_pthread_mutex_lock ( &rangesLock );
+    if ( ownRanges.find ( &chunk ) != ownRanges.end() ) {
+        rambrain_pthread_mutex_unlock ( &rangesLock );
+        return true;
+    }
+    //Find a dead slot that no handler is looking at anymore:
+    unsigned int used = usedSlots.load();
+    unsigned int n = 0;
+    while ( n < used && ( slots[n].generation.load() % 2 == 1 || slots[n].users.load() != 0 ) ) {
+        ++n;
+    }
+    if ( n == maxTrackedRanges ) { //Table is full, the chunk will be treated as modified completely
+        rambrain_pthread_mutex_unlock ( &rangesLock );
+        return false;
+    }
+    trackedSlot &slot = slots[n];
+    slot.chunk = &chunk;
+    slot.first.store ( first );
+    slot.end.store ( end );
+    slot.dirty.store ( new std::atomic<unsigned char>[ ( end - first ) / pageSize ]() );
+    if ( n == used ) {
+        usedSlots.store ( used + 1 );
+    }
+    //Publish before protecting, so that no write can fault on a range the handler does not know:
+    slot.generation.fetch_add ( 1 );
+    if ( 0 != mprotect ( first, end - first, PROT_READ ) ) {
+        slot.generation.fetch_add ( 1 );
+        while ( slot.users.load() != 0 ) {
+            sched_yield();
+        }
+        delete[] slot.dirty.exchange ( NULL );
+        rambrain_pthread_mutex_unlock ( &rangesLock );
+        warnmsgf ( "Could not write protect chunk %lu for dirty tracking", chunk.id );
+        return false;
+    }
+    ownRanges[&chunk] = n;
+    rambrain_pthread_mutex_unlock ( &rangesLock );
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool dirtyPageTracker::isTracked ( const managedMemoryChunk &chunk ) const
+{
+    rambrain_pthread_mutex_lock ( &rangesLock );
+    bool tracked = ownRanges.find ( &chunk ) != ownRanges.end();
+    rambrain_pthread_mutex_unlock ( &rangesLock );
+    return tracked;
+}
+
+bool dirtyPageTracker::release ( managedMemoryChunk &chunk, std::vector<dirtyRange> *dirtyRanges )
+{
+    rambrain_pthread_mutex_lock ( &rangesLock );
+    auto own = ownRanges.find ( &chunk );
+    if ( own == ownRanges.end() ) {
+        rambrain_pthread_mutex_unlock ( &rangesLock );
+        return false;
+    }
+    trackedSlot &slot = slots[own->second];
+    char *first = slot.first.load();
+    char *end = slot.end.load();
+#ifndef _WIN32
+    //Lift the protection before ending the generation: a handler missing the range then finds the write succeeding when retried.
+    mprotect ( first, end - first, PROT_READ | PROT_WRITE );
+#endif
+    slot.generation.fetch_add ( 1 );
+    while ( slot.users.load() != 0 ) {
+        sched_yield();
+    }
+    std::atomic<unsigned char> *dirty = slot.dirty.exchange ( NULL );
+
+    if ( dirtyRanges ) {
+        dirtyRanges->clear();
+        char *base = ( char * ) chunk.locPtr;
+        global_bytesize head = first - base;
+        global_bytesize tail = end - base;
+        //The partial head page is never protected, thus counts as dirty:
+        bool inRange = head > 0;
+        global_bytesize start = 0;
+        for ( size_t n = 0; n < ( size_t ) ( end - first ) / pageSize; ++n ) {
+            global_bytesize pageStart = head + n * pageSize;
+            if ( dirty[n].load() && !inRange ) {
+                start = pageStart;
+                inRange = true;
+            } else if ( !dirty[n].load() && inRange ) {
+                dirtyRanges->push_back ( dirtyRange ( start, pageStart - start ) );
+                inRange = false;
+            }
+        }
+        //As is the partial tail page:
+        if ( tail < chunk.size && !inRange ) {
+            start = tail;
+            inRange = true;
+        }
+        if ( inRange ) {
+            dirtyRanges->push_back ( dirtyRange ( start, ( tail < chunk.size ? chunk.size : tail ) - start ) );
+        }
+    }
+
+    delete[] dirty;
+    ownRanges.erase ( own );
+    rambrain_pthread_mutex_unlock ( &rangesLock );
+    return true;
+}
+
+std::vector<managedMemoryChunk *> dirtyPageTracker::trackedChunks() const
+{
+    std::vector<managedMemoryChunk *> chunks;
+    rambrain_pthread_mutex_lock ( &rangesLock );
+    for ( auto it = ownRanges.begin(); it != ownRanges.end(); ++it ) {
+        chunks.push_back ( slots[it->second].chunk );
+    }
+    rambrain_pthread_mutex_unlock ( &rangesLock );
+    return chunks;
+}
+
+#ifndef _WIN32
+void dirtyPageTracker::writeFault ( int signum, siginfo_t *info, void *context )
+{
+    //Faults at the same address twice in a row are not caused by a release race, see below.
+    //Initial exec TLS is set up with the thread, so accessing it can not allocate here.
+    static thread_local char *unresolvedFault __attribute__ ( ( tls_model ( "initial-exec" ) ) ) = NULL;
+    char *addr = ( char * ) info->si_addr;
+    int savedErrno = errno;
+
+    //Only atomics and mprotect from here on, we may have interrupted anybody holding any lock.
+    unsigned int used = usedSlots.load();
+    for ( unsigned int n = 0; n < used; ++n ) {
+        trackedSlot &slot = slots[n];
+        unsigned int generation = slot.generation.load();
+        if ( generation % 2 == 0 || addr < slot.first.load() || addr >= slot.end.load() ) {
+            continue;
+        }
+        slot.users.fetch_add ( 1 );
+        char *first = slot.first.load();
+        //The range may have been released or replaced since we looked at it:
+        if ( slot.generation.load() == generation && addr >= first && addr < slot.end.load() ) {
+            size_t page = ( addr - first ) / faultPageSize;
+            slot.dirty.load() [page].store ( 1 );
+            mprotect ( first + page * faultPageSize, faultPageSize, PROT_READ | PROT_WRITE );
+            slot.users.fetch_sub ( 1 );
+            unresolvedFault = NULL;
+            errno = savedErrno;
+            return;
+        }
+        slot.users.fetch_sub ( 1 );
+    }
+    errno = savedErrno;
+
+    //The range may have been released after the fault, in which case the write will succeed when retried.
+    if ( unresolvedFault != addr ) {
+        unresolvedFault = addr;
+        return;
+    }
+    unresolvedFault = NULL;
+
+    //Not ours:
+    if ( previousHandler.sa_flags & SA_SIGINFO ) {
+        previousHandler.sa_sigaction ( signum, info, context );
+    } else if ( previousHandler.sa_handler != SIG_DFL && previousHandler.sa_handler != SIG_IGN ) {
+        previousHandler.sa_handler ( signum );
+    } else { //Let the fault happen again without us.
+        struct sigaction fallback;
+        memset ( &fallback, 0, sizeof ( fallback ) );
+        fallback.sa_handler = SIG_DFL;
+        sigemptyset ( &fallback.sa_mask );
+        sigaction ( SIGSEGV, &fallback, NULL );
+    }
+}
+#endif
+
+}
@@ -0,0 +1,112 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIRTYPAGETRACKER_H
+#define DIRTYPAGETRACKER_H
+
+#include "managedMemoryChunk.h"
+#include <pthread.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+namespace rambrain
+{
+
+///@brief a modified part of a chunk as ( offset into chunk, length )
+typedef std::pair<global_bytesize, global_bytesize> dirtyRange;
+
+/** @brief Tracks which pages of resident chunks the user has written to
+ *
+ *  Tracked chunks are write protected page by page. The first write to a page raises SIGSEGV, which is caught here,
+ *  marks the page dirty and lifts the protection, so every page faults at most once.
+ *  Only pages completely owned by the chunk can be protected, partial pages at head and tail of a chunk are always reported dirty.
+ *  @note all tracker instances share one SIGSEGV handler, installed with the first tracker and kept for the lifetime of the process.
+ *        Faults not belonging to tracked memory are handed on to the handler installed before. Handlers installed later have to chain to ours.
+ *  @note the handler neither locks nor allocates, it only reads a fixed table of at most maxTrackedRanges ranges. Chunks not fitting the table are not tracked.
+ *  @note not available on windows, isSupported() returns false there and nothing will be tracked.
+ **/
+class RAMBRAINAPI dirtyPageTracker
+{
+public:
+    dirtyPageTracker();
+    ~dirtyPageTracker();
+
+    /** @brief write protects the chunk's memory and starts tracking
+     *  @return false if the chunk has no page completely of its own or protection failed
+     *  @note the chunk's memory must not be touched by kernel IO while tracked, as the kernel reports protected pages as errors instead of faulting
+     **/
+    bool track ( managedMemoryChunk &chunk );
+    ///@brief returns whether the chunk is tracked
+    bool isTracked ( const managedMemoryChunk &chunk ) const;
+    /** @brief stops tracking and lifts the write protection
+     *  @param dirtyRanges if not NULL, receives the sorted and merged ranges that may have been changed since track()
+     *  @return false if the chunk was not tracked
+     *  @note call this before the chunk's memory is freed
+     **/
+    bool release ( managedMemoryChunk &chunk, std::vector<dirtyRange> *dirtyRanges = NULL );
+    ///@brief returns all chunks tracked by this instance
+    std::vector<managedMemoryChunk *> trackedChunks() const;
+
+    ///@brief returns whether tracking is available on this platform
+    static bool isSupported();
+
+    const global_bytesize pageSize;
+
+    ///Number of ranges that can be tracked at once by all instances together
+    static const unsigned int maxTrackedRanges = 16384;
+
+private:
+    /** @brief a slot of the range table read by the signal handler
+     *  An odd generation marks the slot as live. The handler registers as user and checks that the generation did not change meanwhile,
+     *  before touching dirty. release() ends the generation and waits for all users to leave before it frees dirty.
+     **/
+    struct trackedSlot {
+        std::atomic<unsigned int> generation;
+        std::atomic<unsigned int> users;
+        std::atomic<char *> first;
+        std::atomic<char *> end;
+        std::atomic<std::atomic<unsigned char> *> dirty;
+        //Only used outside of the handler, under rangesLock:
+        managedMemoryChunk *chunk;
+    };
+
+    static trackedSlot slots[maxTrackedRanges];
+    ///Slots beyond this index have never been used, the handler does not need to look at them
+    static std::atomic<unsigned int> usedSlots;
+    static pthread_mutex_t rangesLock;
+
+    std::unordered_map<const managedMemoryChunk *, unsigned int> ownRanges;
+
+#ifndef _WIN32
+    static global_bytesize faultPageSize;
+    static bool handlerInstalled;
+    static struct sigaction previousHandler;
+    ///@brief SIGSEGV handler unprotecting and marking the page if it is tracked
+    static void writeFault ( int signum, siginfo_t *info, void *context );
+#endif
+};
+
+}
+
+#endif
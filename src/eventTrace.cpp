@@ -0,0 +1,289 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "eventTrace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+namespace rambrain
+{
+
+std::atomic<bool> eventTrace::active ( false );
+
+namespace
+{
+
+///Ring of events written by one thread at a time, only written counts up
+struct traceBuffer {
+    traceBuffer ( unsigned int capacity, uint32_t thread ) : ring ( capacity ), written ( 0 ), thread ( thread ) {}
+
+    std::vector<tracedEvent> ring;
+    std::atomic<uint64_t> written;
+    uint32_t thread;
+    ///Whether a thread may append to the buffer, only changed under the mutex of traceBuffers
+    bool inUse = true;
+};
+
+///Buffers of all threads, handed out and collected under mutex
+struct traceBuffers {
+    ~traceBuffers() {
+        for ( traceBuffer *buffer : buffers ) {
+            delete buffer;
+        }
+        for ( traceBuffer *buffer : retired ) {
+            delete buffer;
+        }
+    }
+
+    std::mutex mutex;
+    std::vector<traceBuffer *> buffers;
+    ///Buffers of a different capacity, threads may still append to them until they notice the new generation
+    std::vector<traceBuffer *> retired;
+    unsigned int capacity = eventTrace::defaultEventsPerThread;
+    std::atomic<unsigned int> generation { 0 };
+
+    ///@brief frees retired buffers whose threads moved on, mutex has to be held
+    void reapRetired() {
+        auto kept = std::remove_if ( retired.begin(), retired.end(), [] ( traceBuffer * buffer ) {
+            if ( buffer->inUse ) {
+                return false;
+            }
+            delete buffer;
+            return true;
+        } );
+        retired.erase ( kept, retired.end() );
+    }
+
+    ///@brief returns a buffer of the current capacity no thread appends to, or NULL, mutex has to be held
+    traceBuffer *reuse() {
+        for ( traceBuffer *candidate : buffers ) {
+            if ( !candidate->inUse ) {
+                return candidate;
+            }
+        }
+        //A retired buffer of the right size, when switching back and forth between capacities:
+        for ( auto it = retired.begin(); it != retired.end(); ++it ) {
+            traceBuffer *candidate = *it;
+            if ( !candidate->inUse && candidate->ring.size() == capacity ) {
+                retired.erase ( it );
+                candidate->written.store ( 0, std::memory_order_relaxed );
+                candidate->thread = buffers.size();
+                buffers.push_back ( candidate );
+                return candidate;
+            }
+        }
+        return NULL;
+    }
+};
+
+traceBuffers &allBuffers()
+{
+    static traceBuffers buffers;
+    return buffers;
+}
+
+///Buffer of the calling thread, given back for reuse when the thread ends
+struct traceBufferOwner {
+    ~traceBufferOwner() {
+        if ( buffer ) {
+            traceBuffers &all = allBuffers();
+            std::lock_guard<std::mutex> lock ( all.mutex );
+            buffer->inUse = false;
+        }
+    }
+
+    traceBuffer *acquire() {
+        traceBuffers &all = allBuffers();
+        std::lock_guard<std::mutex> lock ( all.mutex );
+        if ( buffer ) {
+            buffer->inUse = false;
+        }
+        buffer = all.reuse();
+        if ( buffer ) {
+            buffer->inUse = true;
+        } else {
+            buffer = new traceBuffer ( all.capacity, all.buffers.size() );
+            all.buffers.push_back ( buffer );
+        }
+        all.reapRetired();
+        generation = all.generation.load ( std::memory_order_relaxed );
+        return buffer;
+    }
+
+    traceBuffer *buffer = NULL;
+    unsigned int generation = 0;
+};
+
+thread_local traceBufferOwner owner;
+
+}
+
+void eventTrace::append ( traceEventType type, uint64_t value, uint64_t arg, uint32_t flags )
+{
+    traceBuffer *buffer = owner.buffer;
+    if ( !buffer || owner.generation != allBuffers().generation.load ( std::memory_order_relaxed ) ) {
+        buffer = owner.acquire();
+    }
+    const uint64_t n = buffer->written.load ( std::memory_order_relaxed );
+    tracedEvent &event = buffer->ring[n % buffer->ring.size()];
+    event.time = std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    event.value = value;
+    event.arg = arg;
+    event.type = type;
+    event.flags = flags;
+    event.thread = buffer->thread;
+    //Publishes the event to collect():
+    buffer->written.store ( n + 1, std::memory_order_release );
+}
+
+bool eventTrace::start ( unsigned int eventsPerThread )
+{
+    if ( eventsPerThread == 0 ) {
+        eventsPerThread = 1;
+    }
+    traceBuffers &all = allBuffers();
+    std::lock_guard<std::mutex> lock ( all.mutex );
+    if ( active.load ( std::memory_order_relaxed ) ) {
+        return false;
+    }
+    if ( eventsPerThread != all.capacity ) {
+        //Threads still appending after a stop() keep their pointer, so buffers of the old size are retired until their threads
+        //move on to the new generation or end. Buffers nobody appends to can go right away:
+        all.retired.insert ( all.retired.end(), all.buffers.begin(), all.buffers.end() );
+        all.buffers.clear();
+        all.reapRetired();
+        all.capacity = eventsPerThread;
+        all.generation.fetch_add ( 1, std::memory_order_relaxed );
+    } else {
+        for ( traceBuffer *buffer : all.buffers ) {
+            buffer->written.store ( 0, std::memory_order_relaxed );
+        }
+    }
+    active.store ( true, std::memory_order_release );
+    return true;
+}
+
+void eventTrace::stop()
+{
+    active.store ( false, std::memory_order_release );
+}
+
+std::vector<tracedEvent> eventTrace::collect()
+{
+    std::vector<tracedEvent> events;
+    traceBuffers &all = allBuffers();
+    std::lock_guard<std::mutex> lock ( all.mutex );
+    for ( traceBuffer *buffer : all.buffers ) {
+        const uint64_t capacity = buffer->ring.size();
+        const uint64_t written = buffer->written.load ( std::memory_order_acquire );
+        const uint64_t first = written > capacity ? written - capacity : 0;
+        const size_t offset = events.size();
+        for ( uint64_t n = first; n < written; ++n ) {
+            events.push_back ( buffer->ring[n % capacity] );
+        }
+        //Drops what the owning thread overwrote while we copied, including the slot it may be writing right now if still tracing:
+        const uint64_t after = buffer->written.load ( std::memory_order_acquire ) + ( isActive() ? 1 : 0 );
+        if ( after > capacity && after - capacity > first ) {
+            const uint64_t lost = std::min ( after - capacity, written ) - first;
+            events.erase ( events.begin() + offset, events.begin() + offset + lost );
+        }
+    }
+    return events;
+}
+
+std::string eventTrace::chromeTrace()
+{
+    const std::vector<tracedEvent> events = collect();
+    uint64_t origin = UINT64_MAX;
+    uint32_t threads = 0;
+    for ( const tracedEvent &event : events ) {
+        origin = std::min ( origin, event.time );
+        threads = std::max ( threads, event.thread + 1 );
+    }
+    static const char *waitNames[] = {"wait swapin", "wait swapout", "wait space"};
+
+    std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char line[320];
+    bool first = true;
+    const auto emit = [&] () {
+        if ( !first ) {
+            out += ",\n";
+        }
+        first = false;
+        out += line;
+    };
+    for ( uint32_t t = 0; t < threads; ++t ) {
+        snprintf ( line, 320, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"rambrain trace %u\"}}", t, t );
+        emit();
+    }
+    for ( const tracedEvent &event : events ) {
+        char head[96];
+        snprintf ( head, 96, "\"ts\":%.3f,\"pid\":1,\"tid\":%u", ( event.time - origin ) / 1000., event.thread );
+        const unsigned long long value = event.value, arg = event.arg;
+        switch ( event.type ) {
+        case TRACE_REGISTER:
+            snprintf ( line, 320, "{\"name\":\"register\",\"cat\":\"scheduler\",\"ph\":\"i\",\"s\":\"t\",%s,\"args\":{\"chunk\":%llu,\"bytes\":%llu}}", head, value, arg );
+            break;
+        case TRACE_TOUCH:
+            snprintf ( line, 320, "{\"name\":\"touch\",\"cat\":\"scheduler\",\"ph\":\"i\",\"s\":\"t\",%s,\"args\":{\"chunk\":%llu}}", head, value );
+            break;
+        case TRACE_SWAPOUT_SELECT:
+            snprintf ( line, 320, "{\"name\":\"swapout\",\"cat\":\"scheduler\",\"ph\":\"i\",\"s\":\"t\",%s,\"args\":{\"requested\":%llu,\"selected\":%llu}}", head, value, arg );
+            break;
+        case TRACE_PREEMPTIVE_LOAD:
+            snprintf ( line, 320, "{\"name\":\"preemptive load\",\"cat\":\"scheduler\",\"ph\":\"i\",\"s\":\"t\",%s,\"args\":{\"chunk\":%llu,\"bytes\":%llu}}", head, value, arg );
+            break;
+        case TRACE_DECAY:
+            snprintf ( line, 320, "{\"name\":\"decay\",\"cat\":\"scheduler\",\"ph\":\"i\",\"s\":\"t\",%s,\"args\":{\"bytes\":%llu}}", head, value );
+            break;
+        case TRACE_AIO_SUBMIT:
+        case TRACE_AIO_COMPLETE:
+            //Async events, so that transfers overlapping each other show as such:
+            snprintf ( line, 320, "{\"name\":\"%s\",\"cat\":\"aio\",\"ph\":\"%s\",\"id\":\"0x%llx\",%s,\"args\":{\"bytes\":%llu}}",
+                       event.flags ? "aio read" : "aio write", event.type == TRACE_AIO_SUBMIT ? "b" : "e", value, head, arg );
+            break;
+        case TRACE_WAIT_BEGIN:
+            snprintf ( line, 320, "{\"name\":\"%s\",\"cat\":\"wait\",\"ph\":\"B\",%s,\"args\":{\"for\":%llu}}", waitNames[event.flags % 3], head, value );
+            break;
+        case TRACE_WAIT_END:
+            snprintf ( line, 320, "{\"name\":\"%s\",\"cat\":\"wait\",\"ph\":\"E\",%s}", waitNames[event.flags % 3], head );
+            break;
+        default:
+            continue;
+        }
+        emit();
+    }
+    out += "]}\n";
+    return out;
+}
+
+bool eventTrace::writeChromeTrace ( const char *path )
+{
+    const std::string trace = chromeTrace();
+    FILE *file = fopen ( path, "w" );
+    if ( !file ) {
+        return false;
+    }
+    const bool written = fwrite ( trace.data(), 1, trace.size(), file ) == trace.size();
+    return fclose ( file ) == 0 && written;
+}
+
+}
@@ -0,0 +1,143 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVENTTRACE_H
+#define EVENTTRACE_H
+
+#include "common.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace rambrain
+{
+
+///@brief kinds of events recorded by eventTrace, value and arg of an event depend on its kind
+enum traceEventType {
+    ///A chunk was registered with the scheduler, value: chunk id, arg: bytes
+    TRACE_REGISTER,
+    ///A chunk was touched, value: chunk id
+    TRACE_TOUCH,
+    ///The scheduler selected chunks for swapout, value: bytes requested, arg: bytes selected
+    TRACE_SWAPOUT_SELECT,
+    ///A transfer was submitted to the swap, value: identifies the transfer, arg: bytes, flags: 1 for reading
+    TRACE_AIO_SUBMIT,
+    ///A transfer arrived, value and flags as for its submission
+    TRACE_AIO_COMPLETE,
+    ///A swapin brought other chunks along, value: chunk id requested, arg: bytes loaded besides it
+    TRACE_PREEMPTIVE_LOAD,
+    ///The scheduler gave back preemptively loaded chunks, value: bytes requested
+    TRACE_DECAY,
+    ///A thread started to wait, value: chunk id or bytes needed, flags: traceWaitKind
+    TRACE_WAIT_BEGIN,
+    ///The thread ended waiting, flags: traceWaitKind
+    TRACE_WAIT_END
+};
+
+///@brief what a thread waits for in TRACE_WAIT_BEGIN / TRACE_WAIT_END
+enum traceWaitKind {
+    TRACE_WAIT_SWAPIN,
+    TRACE_WAIT_SWAPOUT,
+    TRACE_WAIT_SPACE
+};
+
+///@brief a recorded event, time in nanoseconds of a steady clock
+struct tracedEvent {
+    uint64_t time;
+    uint64_t value;
+    uint64_t arg;
+    uint32_t type;
+    uint32_t flags;
+    ///Number of the buffer recorded to, each thread records to a buffer of its own
+    uint32_t thread;
+};
+
+/** @brief Records timestamped scheduler, swap and wait events into a ring buffer per thread
+ *
+ *  Tracing is compiled in, but only active between start() and stop(). While inactive, record() costs a single, well predicted branch.
+ *  Each thread appends to a buffer of its own without locking; when it is full, the oldest events are overwritten.
+ *  Buffers of finished threads are kept for dumping and handed to the next thread starting to record.
+ *  @note _thread-safety_: record() may be called by any thread at any time. Collecting while threads record is safe, but the
+ *        oldest events of a buffer may be overwritten while they are copied. Stop tracing first for an exact dump.
+ **/
+class RAMBRAINAPI eventTrace
+{
+public:
+    ///@brief records an event if tracing is active
+    static inline void record ( traceEventType type, uint64_t value, uint64_t arg = 0, uint32_t flags = 0 ) {
+        if ( active.load ( std::memory_order_relaxed ) ) {
+            append ( type, value, arg, flags );
+        }
+    }
+    ///@brief returns whether events are recorded
+    static inline bool isActive() {
+        return active.load ( std::memory_order_relaxed );
+    }
+
+    /** @brief starts recording, dropping events recorded before
+     *  @param eventsPerThread events kept per thread, older ones are overwritten
+     *  @return false if tracing is already active
+     **/
+    static bool start ( unsigned int eventsPerThread = defaultEventsPerThread );
+    ///@brief stops recording, recorded events are kept until the next start()
+    static void stop();
+
+    ///@brief returns the recorded events of all threads, each thread's in order
+    static std::vector<tracedEvent> collect();
+    ///@brief returns the recorded events in the Chrome trace event format, to be loaded by chrome://tracing or Perfetto
+    static std::string chromeTrace();
+    /** @brief writes chromeTrace() to path
+     *  @return success
+     **/
+    static bool writeChromeTrace ( const char *path );
+
+    static const unsigned int defaultEventsPerThread = 1 << 16;
+
+private:
+    static void append ( traceEventType type, uint64_t value, uint64_t arg, uint32_t flags );
+
+    static std::atomic<bool> active;
+};
+
+///@brief records TRACE_WAIT_BEGIN on construction and TRACE_WAIT_END on destruction, if armed
+class traceWait
+{
+public:
+    traceWait ( traceWaitKind kind, uint64_t value, bool armed = true ) : kind ( kind ), armed ( armed && eventTrace::isActive() ) {
+        if ( this->armed ) {
+            eventTrace::record ( TRACE_WAIT_BEGIN, value, 0, kind );
+        }
+    }
+    ~traceWait() {
+        if ( armed ) {
+            eventTrace::record ( TRACE_WAIT_END, 0, 0, kind );
+        }
+    }
+
+    traceWait ( const traceWait &ref ) = delete;
+    traceWait &operator= ( const traceWait &ref ) = delete;
+
+private:
+    const traceWaitKind kind;
+    const bool armed;
+};
+
+}
+
+#endif
@@ -82,6 +82,20 @@ genericManagedPtr::~genericManagedPtr() {
     }
 }
 
+bool genericManagedPtr::mrealloc(unsigned int n_elem) {
+    if (this->n_elem * s_size == 0 || n_elem * s_size == 0) {
+        throw memoryException("Can only resize non-empty objects to a non-zero size");
+    }
+    if (*tracker != 1) {
+        throw memoryException("Can not resize an object shared with other genericManagedPtrs");
+    }
+    if (!managedMemory::defaultManager->mrealloc(chunk->id, s_size * n_elem)) {
+        return false;
+    }
+    this->n_elem = n_elem;
+    return true;
+}
+
 bool genericManagedPtr::prepareUse() const {
     managedMemory::defaultManager->prepareUse(*chunk, true);
     return true;
@@ -102,6 +116,22 @@ bool genericManagedPtr::unsetUse(unsigned int loaded) const {
     return managedMemory::defaultManager->unsetUse(*chunk, loaded);
 }
 
+bool genericManagedPtr::pin() const {
+    return managedMemory::defaultManager->pin(&chunk, chunk ? 1 : 0);
+}
+
+bool genericManagedPtr::unpin() const {
+    return managedMemory::defaultManager->unpin(&chunk, chunk ? 1 : 0);
+}
+
+void genericManagedPtr::setEvictionPriority(int priority) const {
+    managedMemory::defaultManager->setEvictionPriority(&chunk, chunk ? 1 : 0, priority);
+}
+
+void genericManagedPtr::resetEvictionPriority() const {
+    managedMemory::defaultManager->setEvictionPriority(&chunk, chunk ? 1 : 0, PRIORITY_NORMAL, false);
+}
+
 genericManagedPtr& genericManagedPtr::operator= (const genericManagedPtr& ref) {
     if (chunk) {
         if (ref.chunk == chunk) {
@@ -144,7 +174,7 @@ void genericManagedPtr::waitForSwapin() const {
     //While in this case, we are not the guy who actually enforce the swapin, we never the less have to wait
     //for the chunk to become ready. This is done in the following way:
     if (!(chunk->status & MEM_ALLOCATED)) { // We may savely check against this as use will be set by other adhereTo thread and cannot be undone as long as calling adhereTo exists
-        rambrain_pthread_mutex_lock(&managedMemory::defaultManager->stateChangeMutex);
+        managedMemory::lockStateChangeMutex();
         //We will burn a little bit of power here, eventually, but this is a very rare case.
         while (!managedMemory::defaultManager->waitForSwapin(*chunk, true)) {};
         rambrain_pthread_mutex_unlock(&managedMemory::defaultManager->stateChangeMutex);
@@ -155,10 +185,10 @@ genericAdhereTo::genericAdhereTo(const genericAdhereTo& ref) : data(ref.data) {
     loadedReadable = ref.loadedReadable;
     loadedWritable = ref.loadedWritable;
     if (loadedWritable) {
-        data->setUse(loadedWritable);
+        data->setUse(true);
     }
-    if (loadedReadable) {
-        data->setUse(loadedReadable);
+    if (loadedReadable) { //A read-only use must not invalidate the clean copy in swap
+        data->setUse(false);
     }
 };
 
@@ -180,10 +210,10 @@ genericAdhereTo& genericAdhereTo::operator= (const genericAdhereTo& ref) {
     loadedWritable = ref.loadedWritable;
 
     if (loadedWritable) {
-        data->setUse(loadedWritable);
+        data->setUse(true);
     }
-    if (loadedReadable) {
-        data->setUse(loadedReadable);
+    if (loadedReadable) { //A read-only use must not invalidate the clean copy in swap
+        data->setUse(false);
     }
     return *this;
 }
@@ -60,6 +60,12 @@ namespace rambrain
             return n_elem;
         }
 
+        /** @brief resizes to n_elem elements, keeping the contents of the elements present before and after
+         *  @return false if there is not enough memory, the object is left untouched then
+         *  @warning the object must not be adhered to or copied
+         **/
+        bool mrealloc(unsigned int n_elem);
+
         ///@brief tells the memory manager to possibly swap in chunk for near future use
         bool prepareUse() const;
 
@@ -69,6 +75,21 @@ namespace rambrain
         ///@brief unsets use count on memory chunk
         bool unsetUse(unsigned int loaded = 1) const;
 
+        /** @brief keeps the object resident until unpin() is called as often, swapping it in if it is not
+         *  @return false if the pinned bytes would exceed their share of the memory limit, see managedMemory::setPinFraction()
+         *  @note unlike holding a genericAdhereTo, a pin does not count as use and the object may still be freed
+         **/
+        bool pin() const;
+
+        ///@brief releases a pin set by pin(), returns false if the object was not pinned
+        bool unpin() const;
+
+        ///@brief sets the eviction priority of the object, overriding the priority of its label, see evictionPriorityLevel
+        void setEvictionPriority(int priority) const;
+
+        ///@brief lets the object go back to the eviction priority of its label
+        void resetEvictionPriority() const;
+
         ///@brief assignment operator
         genericManagedPtr& operator= (const genericManagedPtr& ref);
 
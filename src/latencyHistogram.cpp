@@ -0,0 +1,156 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "latencyHistogram.h"
+#include <bit>
+
+namespace rambrain
+{
+
+///Shard of the calling thread, threads are dealt out to shards round robin on their first record
+static unsigned int threadShard()
+{
+    static std::atomic<unsigned int> threadsSeen ( 0 );
+    static thread_local unsigned int shard = threadsSeen.fetch_add ( 1, std::memory_order_relaxed ) % latencyHistogram::shards;
+    return shard;
+}
+
+latencyHistogram::latencyHistogram() : counts ( new std::atomic<uint64_t>[shards * buckets] ), maxValue ( 0 ), total ( 0 )
+{
+    reset();
+}
+
+latencyHistogram::~latencyHistogram()
+{
+    delete[] counts;
+}
+
+unsigned int latencyHistogram::bucketOf ( uint64_t ns )
+{
+    if ( ns < subBuckets ) {
+        return ns;
+    }
+    unsigned int exponent = std::bit_width ( ns ) - 1;
+    if ( exponent >= maxExponent ) {
+        return buckets - 1;
+    }
+    //Below subBuckets, each value has its bucket. Above, the subBucketBits bits following the leading one select the linear bucket:
+    unsigned int sub = ( ns >> ( exponent - subBucketBits ) ) & ( subBuckets - 1 );
+    return ( exponent - subBucketBits + 1 ) * subBuckets + sub;
+}
+
+uint64_t latencyHistogram::bucketUpperBound ( unsigned int b )
+{
+    if ( b < subBuckets ) {
+        return b;
+    }
+    if ( b >= buckets - 1 ) {
+        return UINT64_MAX;
+    }
+    unsigned int exponent = b / subBuckets + subBucketBits - 1;
+    uint64_t sub = b % subBuckets;
+    return ( ( subBuckets + sub + 1 ) << ( exponent - subBucketBits ) ) - 1;
+}
+
+void latencyHistogram::record ( uint64_t ns )
+{
+    counts[threadShard() * buckets + bucketOf ( ns )].fetch_add ( 1, std::memory_order_relaxed );
+    total.fetch_add ( ns, std::memory_order_relaxed );
+    uint64_t seen = maxValue.load ( std::memory_order_relaxed );
+    while ( ns > seen && !maxValue.compare_exchange_weak ( seen, ns, std::memory_order_relaxed ) ) {}
+}
+
+void latencyHistogram::merge ( uint64_t *merged ) const
+{
+    for ( unsigned int b = 0; b < buckets; ++b ) {
+        merged[b] = 0;
+    }
+    for ( unsigned int s = 0; s < shards; ++s ) {
+        const std::atomic<uint64_t> *shard = counts + s * buckets;
+        for ( unsigned int b = 0; b < buckets; ++b ) {
+            merged[b] += shard[b].load ( std::memory_order_relaxed );
+        }
+    }
+}
+
+uint64_t latencyHistogram::percentileOf ( const uint64_t *merged, uint64_t total, double p ) const
+{
+    if ( total == 0 ) {
+        return 0;
+    }
+    uint64_t rank = p * total + 0.5;
+    rank = rank < 1 ? 1 : ( rank > total ? total : rank );
+    uint64_t seen = 0;
+    for ( unsigned int b = 0; b < buckets; ++b ) {
+        seen += merged[b];
+        if ( seen >= rank ) {
+            uint64_t bound = bucketUpperBound ( b );
+            return bound < max() ? bound : max();
+        }
+    }
+    return max();
+}
+
+uint64_t latencyHistogram::count() const
+{
+    uint64_t total = 0;
+    for ( unsigned int c = 0; c < shards * buckets; ++c ) {
+        total += counts[c].load ( std::memory_order_relaxed );
+    }
+    return total;
+}
+
+uint64_t latencyHistogram::percentile ( double p ) const
+{
+    uint64_t merged[buckets];
+    merge ( merged );
+    uint64_t total = 0;
+    for ( unsigned int b = 0; b < buckets; ++b ) {
+        total += merged[b];
+    }
+    return percentileOf ( merged, total, p );
+}
+
+latencySummary latencyHistogram::summary() const
+{
+    uint64_t merged[buckets];
+    merge ( merged );
+    latencySummary result;
+    result.count = 0;
+    for ( unsigned int b = 0; b < buckets; ++b ) {
+        result.count += merged[b];
+    }
+    result.p50 = percentileOf ( merged, result.count, 0.5 );
+    result.p90 = percentileOf ( merged, result.count, 0.9 );
+    result.p99 = percentileOf ( merged, result.count, 0.99 );
+    result.sum = result.count == 0 ? 0 : sum();
+    result.max = result.count == 0 ? 0 : max();
+    return result;
+}
+
+void latencyHistogram::reset()
+{
+    for ( unsigned int c = 0; c < shards * buckets; ++c ) {
+        counts[c].store ( 0, std::memory_order_relaxed );
+    }
+    maxValue.store ( 0, std::memory_order_relaxed );
+    total.store ( 0, std::memory_order_relaxed );
+}
+
+}
@@ -0,0 +1,130 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include "common.h"
+#include <atomic>
+#include <chrono>
+
+namespace rambrain
+{
+
+///@brief percentiles of a latencyHistogram in nanoseconds, read at once
+struct latencySummary {
+    uint64_t count;
+    ///Sum of all recorded latencies
+    uint64_t sum;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+};
+
+/** @brief Log-linear histogram of latencies in nanoseconds
+ *
+ *  Every power of two is split into subBuckets linear buckets, so that a recorded value is known to about 6% whatever its magnitude.
+ *  Recording threads count into one of a few shards, picked per thread, to not fight over cache lines. Shards are merged on read.
+ *  @note _thread-safety_: record() may be called by any thread at any time, also concurrent to reading. Reading does not lock and
+ *        is safe inside a signal handler, but may miss values recorded meanwhile.
+ **/
+class RAMBRAINAPI latencyHistogram
+{
+public:
+    latencyHistogram();
+    ~latencyHistogram();
+
+    latencyHistogram ( const latencyHistogram &ref ) = delete;
+    latencyHistogram &operator= ( const latencyHistogram &ref ) = delete;
+
+    ///@brief counts a latency of ns nanoseconds
+    void record ( uint64_t ns );
+    ///@brief counts the time since start
+    inline void recordSince ( std::chrono::steady_clock::time_point start ) {
+        record ( std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::steady_clock::now() - start ).count() );
+    }
+
+    ///@brief returns the number of recorded latencies
+    uint64_t count() const;
+    ///@brief returns the largest recorded latency, exact
+    uint64_t max() const {
+        return maxValue.load ( std::memory_order_relaxed );
+    }
+    ///@brief returns the sum of all recorded latencies, exact
+    uint64_t sum() const {
+        return total.load ( std::memory_order_relaxed );
+    }
+    /** @brief returns the latency below or at which the fraction p of all recorded latencies lies
+     *  @param p in [0,1]
+     *  @return upper end of the bucket the percentile falls into, but at most max(). 0 if nothing has been recorded.
+     **/
+    uint64_t percentile ( double p ) const;
+    ///@brief returns p50, p90, p99 and max, merging shards only once
+    latencySummary summary() const;
+    ///@brief forgets all recorded latencies
+    void reset();
+
+    ///@brief returns the bucket a value is counted in
+    static unsigned int bucketOf ( uint64_t ns );
+    ///@brief returns the largest value counted in bucket b
+    static uint64_t bucketUpperBound ( unsigned int b );
+
+    static const unsigned int subBucketBits = 4;
+    static const unsigned int subBuckets = 1 << subBucketBits;
+    ///Values of 2^maxExponent ns (~18 minutes) and above are counted in the last bucket
+    static const unsigned int maxExponent = 40;
+    static const unsigned int buckets = ( maxExponent - subBucketBits + 1 ) * subBuckets;
+    static const unsigned int shards = 8;
+
+private:
+    void merge ( uint64_t *merged ) const;
+    uint64_t percentileOf ( const uint64_t *merged, uint64_t total, double p ) const;
+
+    std::atomic<uint64_t> *counts;
+    std::atomic<uint64_t> maxValue;
+    std::atomic<uint64_t> total;
+};
+
+///@brief records the time from its construction to its destruction into a histogram, if armed
+class scopedLatency
+{
+public:
+    scopedLatency ( latencyHistogram &histogram, bool armed = true ) : histogram ( armed ? &histogram : NULL ) {
+        if ( armed ) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+    ~scopedLatency() {
+        if ( histogram ) {
+            histogram->recordSince ( start );
+        }
+    }
+
+    scopedLatency ( const scopedLatency &ref ) = delete;
+    scopedLatency &operator= ( const scopedLatency &ref ) = delete;
+
+private:
+    latencyHistogram *histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+}
+
+#endif
@@ -43,13 +43,13 @@ global_bytesize managedDummySwap::swapOut ( managedMemoryChunk *chunk )
     if ( buf ) {
         chunk->swapBuf = buf;
         memcpy ( chunk->swapBuf, chunk->locPtr, chunk->size );
-        _mm_free ( chunk->locPtr );
+        managedMemory::releaseLocation ( *chunk );
         chunk->locPtr = NULL; // not strictly required.
         chunk->status = MEM_SWAPPED;
         claimUsageof ( chunk->size, false, true );
         claimUsageof ( chunk->size, true, false );
 #ifdef SWAPSTATS
-        managedMemory::defaultManager->swap_out_bytes += chunk->size;
+        managedMemory::defaultManager->countSwapOut ( *chunk, chunk->size );
 #endif
         ///We are not writing asynchronous, thus, we have to signal that we're done writing...
         managedMemory::signalSwappingCond();
@@ -76,9 +76,9 @@ global_bytesize managedDummySwap::swapOut ( managedMemoryChunk **chunklist, unsi
 
 global_bytesize managedDummySwap::swapIn ( managedMemoryChunk *chunk )
 {
-    void *buf = _mm_malloc ( chunk->size,  memoryAlignment );
+    void *buf = managedMemory::allocLocation ( *chunk, chunk->size,  memoryAlignment );
     if ( buf ) {
-        chunk->locPtr = buf;
+        managedMemory::claimLocation ( *chunk, buf );
         memcpy ( chunk->locPtr, chunk->swapBuf, chunk->size );
         _mm_free ( chunk->swapBuf );
         chunk->swapBuf = NULL; // Not strictly required
@@ -86,7 +86,7 @@ global_bytesize managedDummySwap::swapIn ( managedMemoryChunk *chunk )
         claimUsageof ( chunk->size, false, false );
         claimUsageof ( chunk->size, true, true );
 #ifdef SWAPSTATS
-        managedMemory::defaultManager->swap_in_bytes += chunk->size;
+        managedMemory::defaultManager->countSwapIn ( *chunk, chunk->size );
 #endif
         ///We are not writing asynchronous, thus, we have to signal that we're done reading...
         managedMemory::signalSwappingCond();
@@ -118,5 +118,23 @@ void managedDummySwap::swapDelete ( managedMemoryChunk *chunk )
     }
 }
 
+bool managedDummySwap::resize ( managedMemoryChunk *chunk, global_bytesize sizereq )
+{
+    if ( sizereq > chunk->size && sizereq - chunk->size + swapUsed > swapSize ) {
+        return false;
+    }
+    void *buf = _mm_malloc ( sizereq, memoryAlignment );
+    if ( !buf ) {
+        return false;
+    }
+    memcpy ( buf, chunk->swapBuf, chunk->size < sizereq ? chunk->size : sizereq );
+    _mm_free ( chunk->swapBuf );
+    chunk->swapBuf = buf;
+    claimUsageof ( chunk->size, false, false );
+    claimUsageof ( sizereq, false, true );
+    chunk->size = sizereq;
+    return true;
+}
+
 }
 
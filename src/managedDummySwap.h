@@ -41,6 +41,7 @@ public:
     virtual global_bytesize swapOut ( managedMemoryChunk **chunklist, unsigned int nchunks );
     virtual global_bytesize swapOut ( managedMemoryChunk *chunk );
     virtual void swapDelete ( managedMemoryChunk *chunk );
+    virtual bool resize ( managedMemoryChunk *chunk, global_bytesize sizereq );
 
     virtual void close() {
         closed = true;
@@ -29,6 +29,7 @@
 #include <sys/stat.h>
 #include "exceptions.h"
 #include "managedMemory.h"
+#include "eventTrace.h"
 #include <signal.h>
 #include <sys/types.h>
 #include <fcntl.h>
@@ -576,9 +577,44 @@ void managedFileSwap::setDMA ( bool arg1 )
 #endif
 }
 
+bool managedFileSwap::setDirtyTracking ( bool track )
+{
+    bool old = dirtyTracker != NULL;
+    if ( track == old ) {
+        return old;
+    }
+    if ( track ) {
+        if ( !dirtyPageTracker::isSupported() ) {
+            warnmsg ( "Dirty page tracking is not supported on this platform" );
+            return old;
+        }
+        if ( enableDMA ) { //Modified ranges do not meet DMA alignment
+            warnmsg ( "Dirty page tracking can not be used together with DMA" );
+            return old;
+        }
+        dirtyTracker = new dirtyPageTracker();
+    } else {
+        managedMemory::lockStateChangeMutex();
+        for ( managedMemoryChunk *chunk : dirtyTracker->trackedChunks() ) {
+            std::vector<dirtyRange> dirty;
+            dirtyTracker->release ( *chunk, &dirty );
+            if ( !dirty.empty() ) { //Copy is outdated and we will not know where anymore.
+                pffree ( ( pageFileLocation * ) chunk->swapBuf );
+                chunk->swapBuf = NULL;
+            }
+        }
+        delete dirtyTracker;
+        dirtyTracker = NULL;
+        rambrain_pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
+    }
+    return old;
+}
+
 void managedFileSwap::close()
 {
     if ( !closed ) {
+        delete dirtyTracker; //Lifts all write protections
+        dirtyTracker = NULL;
         free ( aio_eventarr );
         closeSwapFiles();
         free ( ( void * ) filemask );
@@ -950,6 +986,14 @@ void managedFileSwap::pffree ( pageFileLocation *pagePtr )
 void managedFileSwap::swapDelete ( managedMemoryChunk *chunk )
 {
     if ( chunk->swapBuf ) { //Must not be swapped, as read-only access should lead to keeping the swapped out locs for the moment.
+        //Temporary locations of a partial swapout do not lock the chunk's locations, wait for them explicitly:
+        while ( pendingPartialSwapOuts.find ( chunk ) != pendingPartialSwapOuts.end() )
+            if ( !checkForAIO() ) {
+                pthread_cond_wait ( &managedMemory::swappingCond, &managedMemory::defaultManager->stateChangeMutex );
+            }
+        if ( dirtyTracker ) {
+            dirtyTracker->release ( *chunk );
+        }
         pageFileLocation *loc = ( pageFileLocation * ) chunk->swapBuf;
         pffree ( loc );
         chunk->swapBuf = NULL;
@@ -959,12 +1003,90 @@ void managedFileSwap::swapDelete ( managedMemoryChunk *chunk )
     }
 }
 
+bool managedFileSwap::resize ( managedMemoryChunk *chunk, global_bytesize sizereq )
+{
+    pageFileLocation *loc = ( pageFileLocation * ) chunk->swapBuf;
+    if ( !loc || sizereq == 0 ) {
+        return false;
+    }
+    if ( sizereq > chunk->size ) {
+        global_bytesize growth = sizereq - chunk->size;
+        if ( growth > swapFree ) {
+            return false;
+        }
+        while ( loc->status != PAGE_END ) {
+            loc = loc->glob_off_next.glob_off_next;
+        }
+        //Grow the last part in place if free space directly follows its data, append new parts otherwise:
+        global_offset dataEnd = determineGlobalOffset ( *loc ) + loc->size;
+        auto follower = free_space.find ( dataEnd );
+        global_bytesize paddedGrowth = ( growth + memoryAlignment - 1 ) / memoryAlignment * memoryAlignment;
+        pageFileLocation *appended = NULL;
+        if ( loc->size % memoryAlignment == 0 && follower != free_space.end() && follower->second->file == loc->file && follower->second->size >= paddedGrowth ) {
+            appended = allocInFree ( follower->second, growth );
+        }
+        if ( appended ) {
+            loc->size += appended->size;
+            all_space.erase ( dataEnd );
+            delete appended;
+        } else {
+            try {
+                appended = pfmalloc ( growth, chunk );
+            } catch ( memoryException &e ) {
+                return false;
+            }
+            if ( !appended ) {
+                return false;
+            }
+            loc->status = PAGE_PART;
+            loc->glob_off_next.glob_off_next = appended;
+        }
+        claimUsageof ( growth, false, true );
+    } else {
+        //Find the part holding the new end:
+        global_bytesize kept = 0;
+        while ( kept + loc->size < sizereq ) {
+            kept += loc->size;
+            loc = loc->glob_off_next.glob_off_next;
+        }
+        pageFileLocation *rest = ( loc->status == PAGE_END ? NULL : loc->glob_off_next.glob_off_next );
+        global_bytesize partSize = sizereq - kept;
+        global_bytesize padded = ( partSize + memoryAlignment - 1 ) / memoryAlignment * memoryAlignment;
+        pageFileLocation *tail = NULL;
+        if ( padded < loc->size ) {
+            tail = new pageFileLocation ( loc->file, loc->offset + padded, loc->size - padded, PAGE_END );
+            all_space[determineGlobalOffset ( *tail )] = tail;
+        } else {
+            padded = loc->size;
+        }
+        //Padding behind the new end is not available for allocation, just as in allocInFree:
+        swapFree -= padded - partSize;
+        loc->size = partSize;
+        loc->status = PAGE_END;
+        loc->glob_off_next.chunk = chunk;
+        if ( tail ) {
+            pffree ( tail );
+        }
+        if ( rest ) {
+            pffree ( rest );
+        }
+        claimUsageof ( chunk->size - sizereq, false, false );
+    }
+    chunk->size = sizereq;
+    return true;
+}
+
 global_bytesize managedFileSwap::swapIn ( managedMemoryChunk *chunk )
 {
 #ifdef DBG_AIO
     printf ( "swapping in chunk %lu\n", chunk->id );
 #endif
-    void *buf = _mm_malloc ( chunk->size, memoryAlignment );
+    void *buf;
+    if ( dirtyTracker && chunk->size >= pageSize ) { //Give the chunk pages of its own, so that all of them can be tracked
+        buf = managedMemory::allocLocation ( *chunk, ( chunk->size + pageSize - 1 ) / pageSize * pageSize, pageSize );
+    } else {
+        buf = managedMemory::allocLocation ( *chunk, chunk->size, memoryAlignment );
+    }
     if ( !chunk->swapBuf || chunk->status == MEM_SWAPIN ) {
         return 0;
     }
@@ -972,7 +1094,7 @@ global_bytesize managedFileSwap::swapIn ( managedMemoryChunk *chunk )
         if ( chunk->status & MEM_ALLOCATED || chunk->status == MEM_SWAPIN ) {
             return 0;    //chunk is available or will become available
         }
-        chunk->locPtr = buf;
+        managedMemory::claimLocation ( *chunk, buf );
         claimUsageof ( chunk->size, true, true );
         chunk->status = MEM_SWAPIN;
         copyMem ( chunk->locPtr, * ( ( pageFileLocation * ) chunk->swapBuf ) );
@@ -1002,18 +1124,43 @@ global_bytesize managedFileSwap::swapOut ( managedMemoryChunk *chunk )
     if ( chunk->status == MEM_SWAPPED || chunk->status == MEM_SWAPOUT ) {
         return chunk->size;    //chunk is or will be swapped
     }
-    if ( chunk->swapBuf ) { //We already have a position to store to! (happens when read-only was triggered)
+    if ( chunk->swapBuf ) { //We already have a position to store to! (happens when read-only was triggered or the chunk was written back)
+        auto writeBack = pendingWriteBacks.find ( chunk );
+        if ( writeBack != pendingWriteBacks.end() ) {
+            if ( writeBack->second ) { //The copy on its way is outdated, we have to wait for it before we can write anew.
+                return 0;
+            }
+            //The copy on its way is good, just turn the writeBack into a regular swapOut:
+            pendingWriteBacks.erase ( writeBack );
+            claimUsageof ( chunk->size, false, true );
+            managedMemory::defaultManager->claimTobefreed ( chunk->size, true );
+            chunk->status = MEM_SWAPOUT;
+#ifdef SWAPSTATS
+            ++managedMemory::defaultManager->n_clean_evictions;
+            managedMemory::defaultManager->clean_eviction_bytes += chunk->size;
+#endif
+            return chunk->size;
+        }
+        std::vector<dirtyRange> dirty;
+        if ( dirtyTracker && dirtyTracker->release ( *chunk, &dirty ) && !dirty.empty() ) {
+            return swapOutDirtyRanges ( chunk, dirty );
+        }
         //Nothing to do here, we have read the element and swapOut is trivial from our point of view
 
 #ifdef DBG_AIO
         printf ( "chunks is cached, we have no need to schedule: %lu\n", chunk->id );
 #endif
         //We may just mark the chunk as swapped out.
-        _mm_free ( chunk->locPtr );
+        managedMemory::releaseLocation ( *chunk );
         chunk->locPtr = NULL;
         chunk->status = MEM_SWAPPED;
         claimUsageof ( chunk->size, true, false );//Double booking :-)
         claimUsageof ( chunk->size, false, true );
+#ifdef SWAPSTATS
+        ++managedMemory::defaultManager->n_clean_evictions;
+        managedMemory::defaultManager->clean_eviction_bytes += chunk->size;
+        managedMemory::defaultManager->countSwapOut ( *chunk, 0 );
+#endif
         managedMemory::signalSwappingCond();
         return chunk->size;
 
@@ -1046,6 +1193,86 @@ global_bytesize managedFileSwap::swapOut ( managedMemoryChunk **chunklist, unsig
     return n_swapped;
 }
 
+global_bytesize managedFileSwap::swapOutDirtyRanges ( managedMemoryChunk *chunk, const std::vector<dirtyRange> &dirty )
+{
+#ifdef DBG_AIO
+    printf ( "rewriting %lu ranges of chunk %lu\n", dirty.size(), chunk->id );
+#endif
+    global_bytesize written = 0;
+    claimUsageof ( chunk->size, false, true );
+    managedMemory::defaultManager->claimTobefreed ( chunk->size, true );
+    chunk->status = MEM_SWAPOUT;
+
+    int *tracker = new int ( 1 );
+    ++totalSwapActionsQueued;
+    //Map the ranges onto the (possibly fragmented) locations the chunk already owns:
+    auto range = dirty.begin();
+    global_bytesize partStart = 0;
+    pageFileLocation *part = ( pageFileLocation * ) chunk->swapBuf;
+    while ( range != dirty.end() ) {
+        global_bytesize partEnd = partStart + part->size;
+        while ( range != dirty.end() && range->first < partEnd ) {
+            global_bytesize from = max ( range->first, partStart );
+            global_bytesize to = min ( range->first + range->second, partEnd );
+            pageFileLocation *loc = new pageFileLocation ( part->file, part->offset + ( from - partStart ), to - from, ( pageChunkStatus ) ( PAGE_END | PAGE_DIRTYRANGE ) );
+            loc->glob_off_next.chunk = chunk;
+            scheduleCopy ( *loc, ( char * ) chunk->locPtr + from, tracker );
+            written += to - from;
+            if ( range->first + range->second > partEnd ) { //Range continues in next part
+                break;
+            }
+            ++range;
+        }
+        if ( part->status & PAGE_END ) {
+            break;
+        }
+        partStart = partEnd;
+        part = part->glob_off_next.glob_off_next;
+    }
+    pendingPartialSwapOuts[chunk] = written;
+
+    int trval = ( *tracker )--;
+    --totalSwapActionsQueued;
+    if ( trval == 1 ) {
+        pageFileLocation done ( 0, 0, 0, PAGE_END );
+        done.glob_off_next.chunk = chunk;
+        completeTransactionOn ( &done );
+        delete tracker;
+    }
+    return chunk->size;
+}
+
+global_bytesize managedFileSwap::writeBack ( managedMemoryChunk *chunk )
+{
+    //Only unused, resident chunks without a valid copy on disk are worth it:
+    if ( chunk->status != MEM_ALLOCATED || chunk->swapBuf || chunk->size == 0 || chunk->size > swapFree ) {
+        return 0;
+    }
+    pageFileLocation *newAlloced = pfmalloc ( chunk->size, chunk );
+    if ( !newAlloced ) {
+        return 0;
+    }
+#ifdef DBG_AIO
+    printf ( "writing back chunk %lu\n", chunk->id );
+#endif
+    //Swap usage is not claimed, as for all cached elements: the copy may be dropped whenever space is needed.
+    chunk->swapBuf = newAlloced;
+    pendingWriteBacks[chunk] = false;
+    copyMem ( *newAlloced, chunk->locPtr );
+    return chunk->size;
+}
+
+bool managedFileSwap::writeBackPending ( const managedMemoryChunk &chunk ) const
+{
+    return pendingWriteBacks.find ( &chunk ) != pendingWriteBacks.end();
+}
+
+bool managedFileSwap::writeBackOutdated ( const managedMemoryChunk &chunk ) const
+{
+    auto writeBack = pendingWriteBacks.find ( &chunk );
+    return writeBack != pendingWriteBacks.end() && writeBack->second;
+}
+
 
 global_offset managedFileSwap::determineGlobalOffset ( const pageFileLocation &ref ) const
 {
@@ -1085,6 +1312,7 @@ void managedFileSwap::scheduleCopy ( pageFileLocation &ref, void *ramBuf, int *t
     struct iocb *aio = & ( ref.aio_ptr->aio );
 
     ref.aio_ptr->tracker = tracker;
+    ref.aio_ptr->reading = reverse;
 #ifdef DBG_AIO
     reverse ? printf ( "scheduling read\n" ) : printf ( "scheduling write\n" );
 #endif
@@ -1094,6 +1322,10 @@ void managedFileSwap::scheduleCopy ( pageFileLocation &ref, void *ramBuf, int *t
     reverse ? io_prep_pread ( aio, fd, ramBuf, length, ref.offset ) : io_prep_pwrite ( aio, fd, ramBuf, length, ref.offset );
 
     pendingAios[aio] = &ref;
+#ifdef SWAPSTATS
+    ref.aio_ptr->submitted = std::chrono::steady_clock::now();
+#endif
+    eventTrace::record ( TRACE_AIO_SUBMIT, ( uintptr_t ) aio, ref.size, reverse );
     my_io_submit ( aio );
 
 }
@@ -1130,7 +1362,7 @@ void *managedFileSwap::io_arrrive_worker ( void *ptr )
     managedFileSwap *dhis = ( managedFileSwap * ) ptr;
     while ( dhis->io_arrive_work ) {
         if ( dhis->totalSwapActionsQueued > 0 ) {
-            pthread_mutex_lock ( &managedMemory::stateChangeMutex );
+            managedMemory::lockStateChangeMutex();
             dhis->checkForAIO();
             pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
         }
@@ -1151,56 +1383,74 @@ void managedFileSwap::my_io_submit ( struct iocb *aio )
 }
 
 
-void managedFileSwap::completeTransactionOn ( pageFileLocation *ref, bool lock )
+void managedFileSwap::completeTransactionOn ( pageFileLocation *ref )
 {
 #ifdef DBG_AIO
     printf ( "got a call\n" );
 #endif
-    while ( ref->status != PAGE_END ) {
+    while ( ! ( ref->status & PAGE_END ) ) {
         ref = ref->glob_off_next.glob_off_next;
     }
     managedMemoryChunk *chunk = ref->glob_off_next.chunk;
 #ifdef DBG_AIO
     printf ( "Working on chunk %lu\n", chunk->id );
 #endif
+    auto writeBack = pendingWriteBacks.find ( chunk );
+    if ( writeBack != pendingWriteBacks.end() ) { //The chunk stayed in ram, we just got a clean copy on disk
+        if ( writeBack->second ) { //...which has been outdated by the user in the meantime.
+            pffree ( ( pageFileLocation * ) chunk->swapBuf );
+            chunk->swapBuf = NULL;
+#ifdef SWAPSTATS
+            managedMemory::defaultManager->writeback_wasted_bytes += chunk->size;
+#endif
+        } else if ( dirtyTracker ) {
+            dirtyTracker->track ( *chunk );
+        }
+        pendingWriteBacks.erase ( writeBack );
+        managedMemory::signalSwappingCond();
+        return;
+    }
     switch ( chunk->status ) {
     case MEM_SWAPIN:
 #ifdef DBG_AIO
         printf ( "Accounting for a swapin of chunk %lu\n", chunk->id );
 #endif
-        if ( lock ) {
-            rambrain_pthread_mutex_lock ( &managedMemory::stateChangeMutex );
-        }
         //if we have a user for this object, protect it from being swapped out again
         chunk->status = chunk->useCnt == 0 ? MEM_ALLOCATED : MEM_ALLOCATED_INUSE_READ;
         claimUsageof ( chunk->size, false, false );
+        if ( dirtyTracker ) { //We keep the copy on disk, catch writes from now on
+            dirtyTracker->track ( *chunk );
+        }
+        managedMemory::defaultManager->finishAsyncUses ( *chunk );
         managedMemory::signalSwappingCond();
 #ifdef SWAPSTATS
-        managedMemory::defaultManager->swap_in_bytes += chunk->size;
+        managedMemory::defaultManager->countSwapIn ( *chunk, chunk->size );
 #endif
-        if ( lock ) {
-            rambrain_pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
-        }
         break;
     case MEM_SWAPOUT:
 #ifdef DBG_AIO
         printf ( "Accounting for a swapout\n" );
 #endif
-        if ( lock ) {
-            rambrain_pthread_mutex_lock ( &managedMemory::stateChangeMutex );
-        }
-        _mm_free ( chunk->locPtr );
+        managedMemory::releaseLocation ( *chunk );
         chunk->locPtr = NULL; // not strictly required.
         chunk->status = MEM_SWAPPED;
         claimUsageof ( chunk->size, true, false );
+        {
+            auto partial = pendingPartialSwapOuts.find ( chunk );
+            if ( partial != pendingPartialSwapOuts.end() ) {
+#ifdef SWAPSTATS
+                managedMemory::defaultManager->countSwapOut ( *chunk, partial->second );
+                managedMemory::defaultManager->partial_swapout_saved_bytes += chunk->size - partial->second;
+#endif
+                pendingPartialSwapOuts.erase ( partial );
+            } else {
 #ifdef SWAPSTATS
-        managedMemory::defaultManager->swap_out_bytes += chunk->size;
+                managedMemory::defaultManager->countSwapOut ( *chunk, chunk->size );
 #endif
+            }
+        }
         managedMemory::defaultManager->claimTobefreed ( chunk->size, false );
         managedMemory::signalSwappingCond();
-        if ( lock ) {
-            rambrain_pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
-        }
         break;
     default:
         throw memoryException ( "AIO Synchronization broken!" );
@@ -1235,7 +1485,7 @@ tryagain:
     if ( no_arrived == 0 ) {
         rambrain_pthread_mutex_unlock ( & ( managedMemory::stateChangeMutex ) );
         no_arrived = io_getevents ( aio_context, 1, aio_max_transactions, aio_eventarr, &timeout );
-        rambrain_pthread_mutex_lock ( & ( managedMemory::stateChangeMutex ) );
+        managedMemory::lockStateChangeMutex();
     }
 
     if ( no_arrived < 0 ) {
@@ -1285,15 +1535,22 @@ void managedFileSwap::asyncIoArrived ( rambrain::pageFileLocation *ref, io_event
 
     int err = event->res2; //Seems to be that a value of zero here indicates success.
     if ( err == 0 && event->res == ref->size + ( ref->size % memoryAlignment == 0 ? 0 : memoryAlignment - ref->size % memoryAlignment ) ) { //This part arrived successfully
+#ifdef SWAPSTATS
+        managedMemory::defaultManager->latencies[managedMemory::LATENCY_AIO].recordSince ( ref->aio_ptr->submitted );
+#endif
+        eventTrace::record ( TRACE_AIO_COMPLETE, ( uintptr_t ) & ( ref->aio_ptr->aio ), ref->size, ref->aio_ptr->reading );
         delete ref->aio_ptr;
         ref->aio_ptr = NULL;
         ref->aio_lock = 0;
 
         int lastval = ( *tracker )--;
         if ( lastval == 1 ) {
-            completeTransactionOn ( ref , false );
+            completeTransactionOn ( ref );
             delete tracker;
         }
+        if ( ref->status & PAGE_DIRTYRANGE ) { //Temporary location of a partial swapout
+            delete ref;
+        }
 
         --totalSwapActionsQueued; //Do this at the very last line, as completeTransactionOn() has to be done beforehands.
 
@@ -1326,7 +1583,7 @@ void managedFileSwap::copyMem (  pageFileLocation &ref, void *ramBuf , bool reve
     unsigned int trval = ( *tracker )--;
     --totalSwapActionsQueued;
     if ( trval == 1 ) {
-        completeTransactionOn ( cur , false ); //We already call having aquired the lock and know that nothing fatal happens
+        completeTransactionOn ( cur ); //We already call having aquired the lock and know that nothing fatal happens
         delete tracker;
     }
 }
@@ -1376,8 +1633,11 @@ bool managedFileSwap::cleanupCachedElements ( global_bytesize minimum_size )
     auto it = managedMemory::defaultManager->memChunks.begin();
     while ( ( minimum_size == 0 || cleanedUp < minimum_size ) && it != managedMemory::defaultManager->memChunks.end() ) {
         managedMemoryChunk *chunk = it->second;
-        if ( chunk->status & MEM_ALLOCATED && chunk->swapBuf != NULL ) { // We may safely delete the pageFileLocation
+        if ( chunk->status & MEM_ALLOCATED && chunk->swapBuf != NULL && !writeBackPending ( *chunk ) ) { // We may safely delete the pageFileLocation
             cleanedUp += chunk->size;
+            if ( dirtyTracker ) {
+                dirtyTracker->release ( *chunk );
+            }
             pffree ( ( pageFileLocation * ) chunk->swapBuf );
             chunk->swapBuf = NULL;
         }
@@ -1392,6 +1652,14 @@ bool managedFileSwap::cleanupCachedElements ( global_bytesize minimum_size )
 
 void managedFileSwap::invalidateCacheFor ( managedMemoryChunk &chunk )
 {
+    auto writeBack = pendingWriteBacks.find ( &chunk );
+    if ( writeBack != pendingWriteBacks.end() ) { //We may not free locations with aio pending, drop the copy on arrival.
+        writeBack->second = true;
+        return;
+    }
+    if ( dirtyTracker && dirtyTracker->isTracked ( chunk ) ) { //Writes are caught page by page, the copy stays valid apart from these.
+        return;
+    }
     if ( chunk.swapBuf ) {
         pffree ( ( pageFileLocation * ) chunk.swapBuf );
         chunk.swapBuf = NULL;
@@ -21,6 +21,7 @@
 #define MANAGEDFILESWAP_H
 
 #include "managedSwap.h"
+#include "dirtyPageTracker.h"
 #include <stdio.h>
 #ifndef _WIN32
 #include <unistd.h>
@@ -51,6 +52,7 @@ class managedFileSwap_Unit_SwapAllocation_Test;
 class managedFileSwap_Integration_RandomAccess_Test;
 class managedFileSwap_Integration_RandomAccessVariousSize_Test;
 class managedFileSwap_Unit_SwapPolicy_Test;
+class microBenchmarkAccess;
 #endif
 
 namespace rambrain
@@ -60,7 +62,8 @@ enum pageChunkStatus {PAGE_FREE = 1 /** PageChunk is free space not occupied by
                       PAGE_PART = 2 /** PageChunk is part of an object **/,
                       PAGE_END = 4 /** PageChunk is last part of an object ( or whole object) **/,
                       PAGE_WASREAD = 8 /** PageChunk has been read by user**/,
-                      PAGE_UNKNOWN_STATE = 16 /** PageChunk has unknown state ( temporary ) **/
+                      PAGE_UNKNOWN_STATE = 16 /** PageChunk has unknown state ( temporary ) **/,
+                      PAGE_DIRTYRANGE = 32 /** PageChunk covers a modified range inside a chunk's existing locations and is deleted when written ( temporary ) **/
                      };
 
 typedef uint64_t global_offset;
@@ -102,6 +105,11 @@ struct io_event {
 struct aiotracker {
     struct iocb aio;
     int *tracker;
+    ///Whether the transfer reads from swap, for the event trace
+    bool reading;
+#ifdef SWAPSTATS
+    std::chrono::steady_clock::time_point submitted;
+#endif
 };
 
 ///@brief saves some storage in pageFileLocation
@@ -151,14 +159,29 @@ public:
     virtual ~managedFileSwap();
 
     virtual void swapDelete ( managedMemoryChunk *chunk );
+    virtual bool resize ( managedMemoryChunk *chunk, global_bytesize sizereq );
     virtual global_bytesize swapIn ( managedMemoryChunk **chunklist, unsigned int nchunks );
     virtual global_bytesize swapIn ( managedMemoryChunk *chunk );
     virtual global_bytesize swapOut ( managedMemoryChunk **chunklist, unsigned int nchunks );
     virtual global_bytesize swapOut ( managedMemoryChunk *chunk );
+    virtual global_bytesize writeBack ( managedMemoryChunk *chunk );
+    virtual bool writeBackPending ( const managedMemoryChunk &chunk ) const;
+    virtual bool writeBackOutdated ( const managedMemoryChunk &chunk ) const;
     virtual bool extendSwap ( global_bytesize size );
     virtual bool extendSwapByPolicy ( global_bytesize min_size );
 
     void setDMA ( bool arg1 );
+    /** @brief sets whether writes to chunks with a clean copy on disk are tracked page by page
+     *  @param track iff true, a written chunk keeps its copy and only modified pages are rewritten on swapout
+     *  @note not available together with DMA or on windows
+     *  @note must not be called holding stateChangeMutex
+     *  @return previous value
+     **/
+    bool setDirtyTracking ( bool track );
+    ///@brief simple getter
+    inline bool getDirtyTracking() const {
+        return dirtyTracker != NULL;
+    }
 
     virtual void close();
 
@@ -229,8 +252,10 @@ protected:
     //sigEvent Handler:
     /** @brief deals with a single asynchronous IO event completion**/
     void asyncIoArrived ( rambrain::pageFileLocation *ref, struct io_event *aio );
-    /** @brief called to finish a transaction when all pending aio on a managedMemoryChunk has completed**/
-    void completeTransactionOn ( rambrain::pageFileLocation *ref, bool lock = true );
+    /** @brief called to finish a transaction when all pending aio on a managedMemoryChunk has completed
+     *  @note this function must be called having stateChangeMutex acquired.
+     **/
+    void completeTransactionOn ( rambrain::pageFileLocation *ref );
 
     /** @brief gives this class the chance to treat incoming aio events
      *  @return true if there is pending IO to wait for, false otherwise
@@ -245,6 +270,15 @@ protected:
     pthread_mutex_t aioWaiterLock = PTHREAD_MUTEX_INITIALIZER;
 
     std::unordered_map<struct iocb *, pageFileLocation *> pendingAios;
+    /** Chunks with a writeBack in flight. The value tells whether the user changed the chunk meanwhile, so the copy is outdated on arrival**/
+    std::unordered_map<const managedMemoryChunk *, bool> pendingWriteBacks;
+
+    /** Write protects resident chunks having a clean copy on disk, if dirty tracking is switched on**/
+    dirtyPageTracker *dirtyTracker = NULL;
+    /** Chunks swapped out by rewriting only their modified ranges, along with the bytes written**/
+    std::unordered_map<const managedMemoryChunk *, global_bytesize> pendingPartialSwapOuts;
+    /** @brief swaps out a chunk by writing only the given ranges into its existing pageFileLocations**/
+    global_bytesize swapOutDirtyRanges ( managedMemoryChunk *chunk, const std::vector<dirtyRange> &dirty );
 
     static managedFileSwap *instance;
     /** @brief returns some statistics. Typically, we will be sensitive to SIGUSR2 if compiled with -DSWAPSTATS=on**/
@@ -280,6 +314,7 @@ protected:
     friend class ::managedFileSwap_Integration_RandomAccess_Test;
     friend class ::managedFileSwap_Integration_RandomAccessVariousSize_Test;
     friend class ::managedFileSwap_Unit_SwapPolicy_Test;
+    friend class ::microBenchmarkAccess;
 #endif
 };
 
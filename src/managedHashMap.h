@@ -0,0 +1,396 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MANAGEDHASHMAP_H
+#define MANAGEDHASHMAP_H
+
+#include "managedPtr.h"
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <stdint.h>
+
+namespace rambrain
+{
+
+/**
+ * \brief Hash map keeping its buckets in managed chunks, so that tables larger than the memory limit can be used
+ *
+ * Buckets are grouped into chunks of about a page (extendible hashing). Only the directory, which maps the lower bits of a
+ * key's hash to its chunk, and a few bytes of bookkeeping per chunk stay resident, the chunks themselves are swapped by the
+ * scheduler like any other managedPtr. A chunk is split in two once it is filled to three quarters, the directory is doubled
+ * when needed. Within a chunk, collisions are resolved by linear probing.
+ *
+ * As every single access adheres to a chunk, use getMany() and bulkLoad() for many keys at once: they sort the keys by chunk,
+ * so each chunk is swapped in at most once per call, and request the next chunk from swap while working on the current one.
+ *
+ * @note keys and values are stored as they are, thus they have to be trivially copyable
+ * @warning _thread-safety_
+ * * The object itself is not thread-safe
+ * **/
+template <class K, class V, class Hash = std::hash<K> >
+class managedHashMap
+{
+public:
+    /** @brief creates an empty map consisting of a single chunk
+     *  @param slotsPerChunk number of buckets per chunk, 0 chooses as many as fit into 4KiB
+     **/
+    explicit managedHashMap ( unsigned int slotsPerChunk = 0 ) : slots ( slotsPerChunk ) {
+        if ( slots == 0 ) {
+            slots = 4 * kib / sizeof ( slot );
+        }
+        if ( slots < 4 ) {
+            slots = 4;
+        }
+        if ( managedMemory::defaultManager->getSegmentSizeFor ( slots * sizeof ( slot ) ) != 0 ) {
+            throw memoryException ( "Chunks of managedHashMap too large, they would be split by the memory manager" );
+        }
+        maxLoad = slots * 3 / 4;
+        chunks.push_back ( bucketChunk ( new managedPtr<slot> ( slots ), 0 ) );
+        directory.push_back ( 0 );
+    }
+
+    managedHashMap ( const managedHashMap<K, V, Hash> &ref ) = delete;
+    managedHashMap<K, V, Hash> &operator= ( const managedHashMap<K, V, Hash> &ref ) = delete;
+
+    ~managedHashMap() {
+        for ( bucketChunk &c : chunks ) {
+            delete c.data;
+        }
+    }
+
+    /// @brief Simple getter
+    inline size_t size() const {
+        return n_elem;
+    }
+    /// @brief Simple getter
+    inline bool empty() const {
+        return n_elem == 0;
+    }
+    /// @brief returns the number of bucket chunks
+    inline unsigned int chunkCount() const {
+        return chunks.size();
+    }
+    /// @brief returns the number of buckets per chunk
+    inline unsigned int slotsPerChunk() const {
+        return slots;
+    }
+    /// @brief returns the number of directory entries, which are kept resident
+    inline size_t directorySize() const {
+        return directory.size();
+    }
+
+    /** @brief inserts key with value, or assigns value if key is already present
+     *  @return whether the key has been inserted
+     **/
+    bool set ( const K &key, const V &value ) {
+        uint64_t h = hashOf ( key );
+        while ( true ) {
+            unsigned int c = chunkOf ( h );
+            int inserted;
+            {
+                adhereTo<slot> glue ( chunks[c].data );
+                slot *arr = glue;
+                inserted = insertInto ( arr, chunks[c], key, value, h );
+            }
+            if ( inserted >= 0 ) {
+                n_elem += inserted;
+                return inserted;
+            }
+            split ( c );
+        }
+    }
+
+    /** @brief looks up key
+     *  @param value receives the value if the key is present
+     *  @return whether the key is present
+     **/
+    bool get ( const K &key, V &value ) const {
+        uint64_t h = hashOf ( key );
+        const adhereTo<slot> glue ( chunks[chunkOf ( h )].data );
+        const slot *arr = glue;
+        int pos = find ( arr, key, h );
+        if ( pos < 0 ) {
+            return false;
+        }
+        value = arr[pos].value;
+        return true;
+    }
+
+    ///@brief returns whether key is present
+    bool contains ( const K &key ) const {
+        V dummy;
+        return get ( key, dummy );
+    }
+
+    /** @brief removes key
+     *  @return whether the key was present
+     **/
+    bool erase ( const K &key ) {
+        uint64_t h = hashOf ( key );
+        bucketChunk &c = chunks[chunkOf ( h )];
+        adhereTo<slot> glue ( c.data );
+        slot *arr = glue;
+        int pos = find ( arr, key, h );
+        if ( pos < 0 ) {
+            return false;
+        }
+        //Move entries up that would not be found anymore behind the hole (backward shift deletion):
+        unsigned int hole = pos;
+        unsigned int next = ( hole + 1 ) % slots;
+        while ( arr[next].used ) {
+            unsigned int home = homeOf ( hashOf ( arr[next].key ) );
+            bool between = hole <= next ? ( hole < home && home <= next ) : ( hole < home || home <= next );
+            if ( !between ) {
+                arr[hole] = arr[next];
+                hole = next;
+            }
+            next = ( next + 1 ) % slots;
+        }
+        arr[hole].used = 0;
+        --c.count;
+        --n_elem;
+        return true;
+    }
+
+    /** @brief looks up n keys, swapping in every chunk involved only once
+     *  @param values receives the values of keys present, entries of missing keys are left untouched
+     *  @param found if not NULL, receives for each key whether it is present
+     *  @return number of keys present
+     **/
+    unsigned int getMany ( const K *keys, V *values, bool *found, unsigned int n ) const {
+        std::vector<std::pair<unsigned int, unsigned int> > order = sortByChunk ( keys, n );
+        unsigned int hits = 0;
+        unsigned int k = 0;
+        while ( k < n ) {
+            unsigned int c = order[k].first;
+            unsigned int end = k;
+            while ( end < n && order[end].first == c ) {
+                ++end;
+            }
+            const adhereTo<slot> glue ( chunks[c].data );
+            if ( end < n ) {
+                chunks[order[end].first].data->prepareUse();
+            }
+            const slot *arr = glue;
+            for ( ; k < end; ++k ) {
+                unsigned int idx = order[k].second;
+                int pos = find ( arr, keys[idx], hashOf ( keys[idx] ) );
+                if ( pos >= 0 ) {
+                    values[idx] = arr[pos].value;
+                    ++hits;
+                }
+                if ( found ) {
+                    found[idx] = pos >= 0;
+                }
+            }
+        }
+        return hits;
+    }
+
+    /** @brief inserts or assigns n key value pairs, chunks are split beforehand as needed and filled one after the other
+     *  @note if a key occurs more than once, one of its values is kept
+     *  @return number of keys inserted
+     **/
+    size_t bulkLoad ( const K *keys, const V *values, unsigned int n ) {
+        reserve ( n_elem + n );
+        std::vector<std::pair<unsigned int, unsigned int> > order = sortByChunk ( keys, n );
+        size_t inserted = 0;
+        adhereTo<slot> *glue = NULL;
+        slot *arr = NULL;
+        unsigned int glued = 0;
+        for ( unsigned int k = 0; k < n; ++k ) {
+            unsigned int idx = order[k].second;
+            uint64_t h = hashOf ( keys[idx] );
+            unsigned int c = chunkOf ( h );
+            if ( !glue || glued != c ) {
+                delete glue;
+                glue = new adhereTo<slot> ( chunks[c].data );
+                glued = c;
+                for ( unsigned int next = k + 1; next < n; ++next ) {
+                    if ( order[next].first != order[k].first ) {
+                        chunks[chunkOf ( hashOf ( keys[order[next].second] ) )].data->prepareUse();
+                        break;
+                    }
+                }
+                arr = *glue;
+            }
+            int r = insertInto ( arr, chunks[c], keys[idx], values[idx], h );
+            if ( r < 0 ) { //Unlucky distribution, split and retry this key:
+                delete glue;
+                glue = NULL;
+                split ( c );
+                --k;
+                continue;
+            }
+            inserted += r;
+        }
+        delete glue;
+        n_elem += inserted;
+        return inserted;
+    }
+
+    ///@brief splits chunks until n entries fit in without further splits, provided they are evenly distributed
+    void reserve ( size_t n ) {
+        while ( ( size_t ) chunks.size() * maxLoad < n ) {
+            unsigned int existing = chunks.size();
+            unsigned int depth = globalDepth;
+            for ( unsigned int c = 0; c < existing; ++c ) {
+                depth = chunks[c].localDepth < depth ? chunks[c].localDepth : depth;
+            }
+            for ( unsigned int c = 0; c < existing; ++c ) {
+                if ( chunks[c].localDepth == depth ) {
+                    split ( c );
+                }
+            }
+        }
+    }
+
+private:
+    static_assert ( std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value, "managedHashMap stores keys and values by bytes, they have to be trivially copyable" );
+
+    struct slot {
+        K key;
+        V value;
+        unsigned char used = 0;
+    };
+
+    struct bucketChunk {
+        bucketChunk ( managedPtr<slot> *data, unsigned int localDepth ) : data ( data ), localDepth ( localDepth ) {}
+        managedPtr<slot> *data;
+        ///Number of lower hash bits all keys in this chunk share
+        unsigned int localDepth;
+        unsigned int count = 0;
+    };
+
+    std::vector<bucketChunk> chunks;
+    ///Maps the lower globalDepth bits of a hash to the chunk holding the key
+    std::vector<unsigned int> directory;
+    unsigned int globalDepth = 0;
+    unsigned int slots;
+    unsigned int maxLoad;
+    size_t n_elem = 0;
+    Hash hasher;
+
+    ///@brief spreads the user's hash over all bits, as e.g. std::hash of integers is the identity
+    inline uint64_t hashOf ( const K &key ) const {
+        uint64_t h = hasher ( key );
+        h = ( h ^ ( h >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+        h = ( h ^ ( h >> 27 ) ) * 0x94d049bb133111ebULL;
+        return h ^ ( h >> 31 );
+    }
+    inline unsigned int chunkOf ( uint64_t h ) const {
+        return directory[h & ( directory.size() - 1 )];
+    }
+    ///@brief first bucket to probe in a chunk, uses the upper bits that do not select the chunk
+    inline unsigned int homeOf ( uint64_t h ) const {
+        return ( h >> 32 ) % slots;
+    }
+
+    ///@brief returns the bucket holding key or -1
+    int find ( const slot *arr, const K &key, uint64_t h ) const {
+        unsigned int pos = homeOf ( h );
+        while ( arr[pos].used ) {
+            if ( arr[pos].key == key ) {
+                return pos;
+            }
+            pos = ( pos + 1 ) % slots;
+        }
+        return -1;
+    }
+
+    ///@brief returns 1 if key was inserted, 0 if its value was assigned and -1 if the chunk has to be split first
+    int insertInto ( slot *arr, bucketChunk &c, const K &key, const V &value, uint64_t h ) {
+        unsigned int pos = homeOf ( h );
+        while ( arr[pos].used ) {
+            if ( arr[pos].key == key ) {
+                arr[pos].value = value;
+                return 0;
+            }
+            pos = ( pos + 1 ) % slots;
+        }
+        if ( c.count >= maxLoad ) {
+            return -1;
+        }
+        arr[pos].key = key;
+        arr[pos].value = value;
+        arr[pos].used = 1;
+        ++c.count;
+        return 1;
+    }
+
+    ///@brief distributes the keys of chunk c over c and a new chunk by the next hash bit
+    void split ( unsigned int c ) {
+        if ( chunks[c].localDepth == globalDepth ) {
+            if ( globalDepth == 32 ) {
+                throw memoryException ( "Too many keys with equal hashes in managedHashMap" );
+            }
+            size_t oldSize = directory.size();
+            directory.resize ( 2 * oldSize );
+            std::copy ( directory.begin(), directory.begin() + oldSize, directory.begin() + oldSize );
+            ++globalDepth;
+        }
+        uint64_t bit = 1ULL << chunks[c].localDepth;
+        ++chunks[c].localDepth;
+        unsigned int n = chunks.size();
+        chunks.push_back ( bucketChunk ( new managedPtr<slot> ( slots ), chunks[c].localDepth ) );
+        for ( size_t i = 0; i < directory.size(); ++i ) {
+            if ( directory[i] == c && ( i & bit ) ) {
+                directory[i] = n;
+            }
+        }
+
+        std::vector<slot> entries;
+        adhereTo<slot> oldGlue ( chunks[c].data );
+        adhereTo<slot> newGlue ( chunks[n].data );
+        slot *oldArr = oldGlue;
+        slot *newArr = newGlue;
+        for ( unsigned int s = 0; s < slots; ++s ) {
+            if ( oldArr[s].used ) {
+                entries.push_back ( oldArr[s] );
+                oldArr[s].used = 0;
+            }
+        }
+        chunks[c].count = 0;
+        for ( const slot &e : entries ) {
+            uint64_t h = hashOf ( e.key );
+            if ( h & bit ) {
+                insertInto ( newArr, chunks[n], e.key, e.value, h );
+            } else {
+                insertInto ( oldArr, chunks[c], e.key, e.value, h );
+            }
+        }
+    }
+
+    ///@brief returns ( chunk, index into keys ) for all keys, sorted by chunk
+    std::vector<std::pair<unsigned int, unsigned int> > sortByChunk ( const K *keys, unsigned int n ) const {
+        std::vector<std::pair<unsigned int, unsigned int> > order ( n );
+        for ( unsigned int k = 0; k < n; ++k ) {
+            order[k] = std::make_pair ( chunkOf ( hashOf ( keys[k] ) ), k );
+        }
+        std::sort ( order.begin(), order.end() );
+        return order;
+    }
+};
+
+}
+
+#endif
@@ -26,13 +26,24 @@
 #endif
 #include "rambrainconfig.h"
 #include "rambrain_atomics.h"
+#include "eventTrace.h"
+#include "accessTrace.h"
 #ifndef _WIN32
 #include "git_info.h"
 #endif
 #include "managedPtr.h"
 #include <time.h>
+#include <chrono>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
 #ifndef _WIN32
 #include <mm_malloc.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#else
+#include <windows.h>
 #endif
 
 namespace rambrain
@@ -43,6 +54,8 @@ rambrainConfig config;
 }
 
 managedMemory *managedMemory::defaultManager;
+///Label of the chunks allocated by this thread, see allocationLabel
+static thread_local const char *allocationLabelOfThread = NULL;
 
 #ifdef SWAPSTATS
 #ifdef LOGSTATS
@@ -82,7 +95,7 @@ managedMemory::managedMemory ( managedSwap *swap, global_bytesize size  )
     if ( !swap ) {
         throw incompleteSetupException ( "no swap manager defined" );
     }
-#if !defined SWAPSTATS && !defined _WIN32
+#if defined SWAPSTATS && !defined _WIN32
     signal ( SIGUSR1, sigswapstats );
 
 #ifdef LOGSTATS
@@ -95,6 +108,7 @@ managedMemory::managedMemory ( managedSwap *swap, global_bytesize size  )
 
 managedMemory::~managedMemory()
 {
+    setBackgroundReclaim ( false );
 #ifdef SWAPSTATS
 #ifdef LOGSTATS
     if ( previousManager == NULL ) {
@@ -106,10 +120,6 @@ managedMemory::~managedMemory()
 #endif
 #endif
 
-    if ( defaultManager == this ) {
-
-        defaultManager = previousManager;
-    }
     if ( swap ) {
         swap->waitForCleanExit();
     }
@@ -119,6 +129,14 @@ managedMemory::~managedMemory()
 #else
     linearMfree();
 #endif
+    for ( labelPolicy *policy : labelPolicies ) {
+        delete policy;
+    }
+    //The swap books freed chunks to the default manager, so we stay it until our chunks are gone:
+    if ( defaultManager == this ) {
+
+        defaultManager = previousManager;
+    }
 }
 
 void managedMemory::closeSwap()
@@ -151,7 +169,7 @@ global_bytesize managedMemory::getTotalSwapMemory() const
 
 bool managedMemory::setMemoryLimit ( global_bytesize size )
 {
-    rambrain_pthread_mutex_lock ( &stateChangeMutex );
+    lockStateChangeMutex();
     if ( size > memory_max ) {
         memory_max = size;
         rambrain_pthread_mutex_unlock ( &stateChangeMutex );
@@ -187,9 +205,146 @@ bool managedMemory::setOutOfSwapIsFatal ( bool fatal )
     return old;
 }
 
+bool managedMemory::setBackgroundReclaim ( bool background )
+{
+    lockStateChangeMutex();
+    bool old = reclaimWork;
+    if ( background == old ) {
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        return old;
+    }
+    reclaimWork = background;
+    if ( background ) {
+        if ( pthread_create ( &reclaimThread, NULL, &reclaimWorker, this ) ) {
+            reclaimWork = false;
+            rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+            Throw ( memoryException ( "Could not create background reclaim thread" ) );
+        }
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    } else {
+        pthread_cond_signal ( &reclaimCond );
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        pthread_join ( reclaimThread, NULL );
+    }
+    return old;
+}
+
+bool managedMemory::setReclaimWatermarks ( float low, float high )
+{
+    if ( low <= 0. || low > high || high > 1. ) {
+        warnmsg ( "Inconsistent watermarks for background reclaim, keeping old ones" );
+        return false;
+    }
+    lockStateChangeMutex();
+    reclaimLowWatermark = low;
+    reclaimHighWatermark = high;
+    checkReclaimWatermark();
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return true;
+}
+
+global_bytesize managedMemory::setWriteBackRate ( global_bytesize bytesPerSecond )
+{
+    lockStateChangeMutex();
+    global_bytesize old = writeBackRate;
+    writeBackRate = bytesPerSecond;
+    pthread_cond_signal ( &reclaimCond );
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return old;
+}
+
+global_bytesize managedMemory::setSegmentSize ( global_bytesize bytes )
+{
+    global_bytesize old = segmentSize;
+    segmentSize = bytes;
+    return old;
+}
+
+global_bytesize managedMemory::getSegmentSizeFor ( global_bytesize bytes ) const
+{
+    //Segmentation is opt-in, arrays stay in one chunk unless a segment size has been set:
+    return segmentSize != 0 && bytes > segmentSize ? segmentSize : 0;
+}
+
+global_bytesize managedMemory::getDefaultBlockSize() const
+{
+    //Many blocks fit into memory, so that the scheduler has a choice, while the overhead per chunk stays small:
+    global_bytesize bytes = memory_max / 16;
+    return bytes > mib ? mib : bytes;
+}
+
+void managedMemory::checkReclaimWatermark()
+{
+    if ( reclaimWork && memory_used > memory_tobefreed && memory_used - memory_tobefreed > reclaimHighWatermark * memory_max ) {
+        pthread_cond_signal ( &reclaimCond );
+    }
+}
+
+void *managedMemory::reclaimWorker ( void *ptr )
+{
+    managedMemory *dhis = ( managedMemory * ) ptr;
+    lockStateChangeMutex();
+    while ( dhis->reclaimWork ) {
+        //Memory that is about to be written out already counts as free:
+        global_bytesize pending = dhis->memory_used > dhis->memory_tobefreed ? dhis->memory_used - dhis->memory_tobefreed : 0;
+        global_bytesize low = dhis->reclaimLowWatermark * dhis->memory_max;
+        if ( pending <= dhis->reclaimHighWatermark * dhis->memory_max ) {
+            if ( dhis->writeBackRate == 0 ) {
+                pthread_cond_wait ( &dhis->reclaimCond, &stateChangeMutex );
+                continue;
+            }
+            std::chrono::nanoseconds wakeup = ( std::chrono::system_clock::now() + std::chrono::milliseconds ( 1000 / writeBackFrequency ) ).time_since_epoch();
+            struct timespec until = { ( time_t ) ( wakeup.count() / 1000000000 ), ( long ) ( wakeup.count() % 1000000000 ) };
+            if ( pthread_cond_timedwait ( &dhis->reclaimCond, &stateChangeMutex, &until ) == ETIMEDOUT ) {
+                //Nothing to reclaim for a while, use the time to give cold chunks a clean copy on disk:
+                global_bytesize written = dhis->writeBackCold ( dhis->writeBackRate / writeBackFrequency );
+#ifdef SWAPSTATS
+                dhis->writeback_bytes += written;
+#else
+                ( void ) written;
+#endif
+            }
+            continue;
+        }
+#ifdef SWAPSTATS
+        global_bytesize scheduled = dhis->swap_out_scheduled_bytes;
+#endif
+        swapErrorCode err = ERR_NOTENOUGHCANDIDATES;
+        //An empty topology makes swapOut throw after dropping our lock, so we do not even try:
+        if ( dhis->hasSwapOutCandidates() ) {
+            try {
+                err = dhis->swapOut ( pending - low );
+            } catch ( memoryException &e ) {
+                //Throwing would take down the process from this detached thread, treat it as a failed pass.
+                warnmsgf ( "Background reclaim failed: %s", e.what() );
+                err = ERR_SWAPFULL;
+            }
+        }
+#ifdef SWAPSTATS
+        if ( dhis->swap_out_scheduled_bytes != scheduled ) {
+            ++dhis->n_background_reclaim;
+            dhis->background_reclaim_bytes += dhis->swap_out_scheduled_bytes - scheduled;
+        }
+#endif
+        if ( err != ERR_SUCCESS ) {
+            //Nothing can be done right now (e.g. everything is in use). Allocations keep signalling us while
+            //we are above the high watermark, so back off for a while instead of retrying immediately:
+            std::chrono::nanoseconds wakeup = ( std::chrono::system_clock::now() + std::chrono::milliseconds ( 1000 / writeBackFrequency ) ).time_since_epoch();
+            struct timespec until = { ( time_t ) ( wakeup.count() / 1000000000 ), ( long ) ( wakeup.count() % 1000000000 ) };
+            while ( dhis->reclaimWork && pthread_cond_timedwait ( &dhis->reclaimCond, &stateChangeMutex, &until ) != ETIMEDOUT );
+        }
+    }
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return NULL;
+}
+
 
 bool managedMemory::ensureEnoughSpace ( global_bytesize sizereq, managedMemoryChunk *orisSwappedin )
 {
+#ifdef SWAPSTATS
+    scopedLatency stall ( latencies[LATENCY_ENSURE_SPACE], sizereq + memory_used > memory_max );
+#endif
+    traceWait traced ( TRACE_WAIT_SPACE, sizereq, sizereq + memory_used > memory_max );
     bool cacheCleaned = false;
     while ( sizereq + memory_used > memory_max ) {
         if ( orisSwappedin && ( orisSwappedin->status & MEM_ALLOCATED || orisSwappedin->status == MEM_SWAPIN ) ) {
@@ -238,13 +393,14 @@ bool managedMemory::ensureEnoughSpace ( global_bytesize sizereq, managedMemoryCh
 }
 
 
-managedMemoryChunk *managedMemory::mmalloc ( global_bytesize sizereq )
+managedMemoryChunk *managedMemory::mmalloc ( global_bytesize sizereq, bool fixedLocation )
 {
-    rambrain_pthread_mutex_lock ( &stateChangeMutex );
+    lockStateChangeMutex();
     sizereq += sizereq % memoryAlignment == 0 ? 0 : memoryAlignment - sizereq % memoryAlignment; //f**k memoryAlignment
     ensureEnoughSpace ( sizereq );
 
     memory_used += sizereq;
+    checkReclaimWatermark();
 
     //We are left with enough free space to malloc.
 #ifdef PARENTAL_CONTROL
@@ -255,6 +411,13 @@ managedMemoryChunk *managedMemory::mmalloc ( global_bytesize sizereq )
     chunk->status = MEM_ALLOCATED;
     chunk->size = sizereq;
     chunk->swapBuf = NULL;
+    chunk->label = allocationLabelOfThread;
+    if ( chunk->label && !labelPolicies.empty() ) {
+        chunk->policy = findLabelPolicy ( chunk->label );
+        if ( chunk->policy ) {
+            chunk->policy->resident += sizereq;
+        }
+    }
 #ifdef PARENTAL_CONTROL
     chunk->child = invalid;
     chunk->parent = parent;
@@ -282,7 +445,21 @@ managedMemoryChunk *managedMemory::mmalloc ( global_bytesize sizereq )
 #endif
 
     memChunks.insert ( {chunk->id, chunk} );
-    if ( sizereq != 0 ) {
+    accessTrace::record ( ACCESS_ALLOC, *chunk );
+    if ( sizereq != 0 && fixedLocation ) {
+#ifdef _WIN32
+        chunk->fixedLoc = VirtualAlloc ( NULL, sizereq, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+#else
+        chunk->fixedLoc = mmap ( NULL, sizereq, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        chunk->fixedLoc = chunk->fixedLoc == MAP_FAILED ? NULL : chunk->fixedLoc;
+#endif
+        chunk->locPtr = chunk->fixedLoc;
+        if ( !chunk->locPtr ) {
+            Throw ( memoryException ( "Malloc failed" ) );
+            rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+            return NULL;
+        }
+    } else if ( sizereq != 0 ) {
         chunk->locPtr = _mm_malloc ( sizereq , memoryAlignment );
         if ( !chunk->locPtr ) {
             Throw ( memoryException ( "Malloc failed" ) );
@@ -303,8 +480,10 @@ bool managedMemory::swapIn ( memoryID id )
 bool managedMemory::prepareUse ( managedMemoryChunk &chunk, bool acquireLock )
 {
     if ( acquireLock ) {
-        rambrain_pthread_mutex_lock ( &stateChangeMutex );
+        lockStateChangeMutex();
     }
+    std::chrono::high_resolution_clock::time_point missStart;
+    std::chrono::duration<double> missed;
     switch ( chunk.status ) {
     case MEM_SWAPOUT: // Object is about to be swapped out.
         if ( !waitForSwapout ( chunk, true ) ) {
@@ -318,6 +497,7 @@ bool managedMemory::prepareUse ( managedMemoryChunk &chunk, bool acquireLock )
         ++swap_misses;
         --swap_hits;
 #endif
+        missStart = std::chrono::high_resolution_clock::now();
         if ( !swapIn ( chunk ) ) {
             errmsgf ( "Could not swap in chunk %lu", chunk.id );
             if ( acquireLock ) {
@@ -325,6 +505,8 @@ bool managedMemory::prepareUse ( managedMemoryChunk &chunk, bool acquireLock )
             }
             return false;
         }
+        missed = std::chrono::high_resolution_clock::now() - missStart;
+        schedulerMissed ( chunk, missed.count(), true );
     default:
         ;
     }
@@ -338,9 +520,15 @@ bool managedMemory::prepareUse ( managedMemoryChunk &chunk, bool acquireLock )
 
 bool managedMemory::setUse ( managedMemoryChunk &chunk, bool writeAccess = false )
 {
-    rambrain_pthread_mutex_lock ( &stateChangeMutex );
+    lockStateChangeMutex();
+    accessTrace::record ( ACCESS_USE, chunk, writeAccess );
+#ifdef SWAPSTATS
+    countAccess ( chunk );
+#endif
     //printf("setUse on %d\n",chunk.id);
     ++chunk.useCnt;//This protects element from being swapped out by somebody else if it was swapped in.
+    std::chrono::high_resolution_clock::time_point waitStart;
+    std::chrono::duration<double> waited;
     switch ( chunk.status ) {
     case MEM_SWAPOUT: // Object is about to be swapped out.
 
@@ -350,6 +538,7 @@ bool managedMemory::setUse ( managedMemoryChunk &chunk, bool writeAccess = false
             return false;
         }
     case MEM_SWAPIN: // Wait for object to appear
+        waitStart = std::chrono::high_resolution_clock::now();
         if ( !waitForSwapin ( chunk, true ) ) {
             if ( ! ( chunk.status & MEM_ALLOCATED ) ) {
                 rambrain_pthread_mutex_unlock ( &stateChangeMutex );
@@ -357,6 +546,8 @@ bool managedMemory::setUse ( managedMemoryChunk &chunk, bool writeAccess = false
                 return false;
             }
         }
+        waited = std::chrono::high_resolution_clock::now() - waitStart;
+        schedulerMissed ( chunk, waited.count(), false );
     case MEM_ALLOCATED:
         chunk.status = MEM_ALLOCATED_INUSE_READ;
     case MEM_ALLOCATED_INUSE:
@@ -382,28 +573,238 @@ bool managedMemory::setUse ( managedMemoryChunk &chunk, bool writeAccess = false
     return false;
 }
 
-bool managedMemory::mrealloc ( memoryID id, global_bytesize sizereq )
+bool managedMemory::setUse ( managedMemoryChunk **chunks, unsigned int nchunks, bool writeAccess )
+{
+    //The same chunk may be listed several times, but needs its room only once:
+    std::vector<managedMemoryChunk *> distinct ( chunks, chunks + nchunks );
+    std::sort ( distinct.begin(), distinct.end() );
+    distinct.erase ( std::unique ( distinct.begin(), distinct.end() ), distinct.end() );
+    global_bytesize totalsize = 0;
+    for ( managedMemoryChunk *chunk : distinct ) {
+        if ( chunk->status == MEM_ROOT ) {
+            return false;
+        }
+        totalsize += chunk->size;
+    }
+
+    lockStateChangeMutex();
+    if ( totalsize > memory_max ) {
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        return Throw ( memoryException ( "Can not use chunks that do not fit into memory at once" ) );
+    }
+    for ( unsigned int n = 0; n < nchunks; ++n ) {
+        ++chunks[n]->useCnt;//Protects all of them from being swapped out while we make room for the missing ones.
+        accessTrace::record ( ACCESS_USE, *chunks[n], writeAccess );
+#ifdef SWAPSTATS
+        countAccess ( *chunks[n] );
+#endif
+    }
+    //Chunks on their way to swap have to arrive there before they can be read again:
+    for ( managedMemoryChunk *chunk : distinct ) {
+        while ( chunk->status == MEM_SWAPOUT ) {
+            waitForAIO();
+        }
+    }
+
+    unsigned int missing = 0;
+    for ( managedMemoryChunk *chunk : distinct ) {
+        missing += chunk->status == MEM_SWAPPED ? 1 : 0;
+    }
+    if ( missing > 0 ) {
+        std::chrono::high_resolution_clock::time_point missStart = std::chrono::high_resolution_clock::now();
+        bool success;
+        try {
+            success = swapIn ( distinct.data(), distinct.size() );
+        } catch ( memoryException & ) {
+            //swapIn unlocked before throwing, the chunks must not stay protected:
+            unsetUse ( chunks, nchunks );
+            throw;
+        }
+        if ( !success ) {
+            errmsgf ( "Could not swap in %u chunks", missing );
+            releaseUses ( chunks, nchunks );
+            rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+            return false;
+        }
+        std::chrono::duration<double> missed = std::chrono::high_resolution_clock::now() - missStart;
+        for ( managedMemoryChunk *chunk : distinct ) {
+            if ( chunk->status == MEM_SWAPIN ) {
+                schedulerMissed ( *chunk, missed.count() / missing, true );
+            }
+        }
+#ifdef SWAPSTATS
+        swap_misses += missing;
+#endif
+    }
+
+    //Wait once for all transfers, ours and the ones requested by others:
+    std::chrono::high_resolution_clock::time_point waitStart = std::chrono::high_resolution_clock::now();
+    bool waitedFor = false;
+    for ( managedMemoryChunk *chunk : distinct ) {
+        while ( chunk->status == MEM_SWAPIN ) {
+            waitedFor = true;
+            waitForAIO();
+        }
+        if ( ! ( chunk->status & MEM_ALLOCATED ) ) {
+            releaseUses ( chunks, nchunks );
+            rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+            errmsgf ( "Waited for swapin of chunk %lu and could not make it.", chunk->id );
+            return false;
+        }
+    }
+    if ( waitedFor ) {
+        std::chrono::duration<double> waited = std::chrono::high_resolution_clock::now() - waitStart;
+        schedulerMissed ( *distinct.front(), waited.count(), false );
+    }
+
+    for ( managedMemoryChunk *chunk : distinct ) {
+        if ( chunk->status == MEM_ALLOCATED ) {
+            chunk->status = MEM_ALLOCATED_INUSE_READ;
+        }
+        if ( writeAccess && chunk->status != MEM_ALLOCATED_INUSE_WRITE ) {
+            chunk->status = MEM_ALLOCATED_INUSE_WRITE;
+            swap->invalidateCacheFor ( *chunk );
+        }
+        touch ( *chunk );
+    }
+#ifdef SWAPSTATS
+    swap_hits += nchunks - missing;
+#endif
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return true;
+}
+
+bool managedMemory::swapIn ( managedMemoryChunk **chunklist, unsigned int nchunks )
 {
+    global_bytesize missingsize = 0;
+    for ( unsigned int n = 0; n < nchunks; ++n ) {
+        missingsize += chunklist[n]->status == MEM_SWAPPED ? chunklist[n]->size : 0;
+    }
+    ensureEnoughSpace ( missingsize );
+
+    //Other threads may have requested some of the chunks while we were making room:
+    std::vector<managedMemoryChunk *> swapped;
+    global_bytesize swappedsize = 0;
+    for ( unsigned int n = 0; n < nchunks; ++n ) {
+        if ( chunklist[n]->status == MEM_SWAPPED ) {
+            swapped.push_back ( chunklist[n] );
+            swappedsize += chunklist[n]->size;
+        }
+    }
+    if ( swapped.empty() ) {
+        return true;
+    }
+    if ( swap->swapIn ( swapped.data(), swapped.size() ) != swappedsize ) {
+        //Unlock mutex under which we were called, as we'll be throwing...
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        return Throw ( memoryException ( "Could not swap in elements." ) );
+    }
+    for ( managedMemoryChunk *chunk : swapped ) {
+        touch ( *chunk );
+    }
+#ifdef SWAPSTATS
+    swap_in_scheduled_bytes += swappedsize;
+    n_swap_in += 1;
+#endif
+    return true;
+}
 
-    throw unfinishedCodeException ( "TODO: Locking, synchronizing, and everything" );
+bool managedMemory::mrealloc ( memoryID id, global_bytesize sizereq )
+{
+    lockStateChangeMutex();
     managedMemoryChunk &chunk = resolveMemChunk ( id );
-    if ( !setUse ( chunk ) ) {
-        return false;
+    sizereq += sizereq % memoryAlignment == 0 ? 0 : memoryAlignment - sizereq % memoryAlignment;
+    if ( sizereq == 0 || chunk.size == 0 ) {
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        return Throw ( memoryException ( "Can not reallocate from or to zero size" ) );
     }
-    rambrain_pthread_mutex_lock ( &stateChangeMutex );
-    void *realloced = realloc ( chunk.locPtr, sizereq );
-    if ( realloced ) {
-        memory_used -= chunk.size - sizereq;
-        chunk.size = sizereq;
-        chunk.locPtr = realloced;
+    if ( chunk.fixedLoc ) {
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        return Throw ( memoryException ( "Can not reallocate memory with a fixed location" ) );
+    }
+    //Let transfers of the chunk's buffers settle first:
+    while ( chunk.status == MEM_SWAPIN || chunk.status == MEM_SWAPOUT || swap->writeBackPending ( chunk ) ) {
+        waitForAIO();
+    }
+    if ( chunk.status & MEM_ALLOCATED_INUSE ) {
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        return Throw ( memoryException ( "Can not reallocate memory which is in use" ) );
+    }
+    if ( sizereq == chunk.size ) {
         rambrain_pthread_mutex_unlock ( &stateChangeMutex );
-        unsetUse ( chunk );
         return true;
-    } else {
+    }
+    //Swapped out chunks are resized on disk without reading them back:
+    if ( chunk.status == MEM_SWAPPED && swap->resize ( &chunk, sizereq ) ) {
+#ifdef SWAPSTATS
+        ++n_swapped_reallocs;
+#endif
         rambrain_pthread_mutex_unlock ( &stateChangeMutex );
-        unsetUse ( chunk );
+        return true;
+    }
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+
+    //Otherwise we resize in ram, holding a use so that the chunk is not swapped out meanwhile:
+    if ( !setUse ( chunk, true ) ) {
         return false;
     }
+    lockStateChangeMutex();
+    if ( chunk.useCnt != 1 ) {
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        unsetUse ( chunk );
+        return Throw ( memoryException ( "Can not reallocate memory which is in use" ) );
+    }
+    //The copy on disk would be outdated:
+    if ( chunk.swapBuf ) {
+        swap->swapDelete ( &chunk );
+    }
+    global_bytesize growth = sizereq > chunk.size ? sizereq - chunk.size : 0;
+    if ( growth > 0 ) {
+        try {
+            ensureEnoughSpace ( growth );
+        } catch ( memoryException & ) {
+            //ensureEnoughSpace unlocked before throwing
+            unsetUse ( chunk );
+            throw;
+        }
+        memory_used += growth;
+        checkReclaimWatermark();
+    }
+    void *realloced;
+#ifdef _WIN32
+    realloced = _aligned_realloc ( chunk.locPtr, sizereq, memoryAlignment );
+#else
+    if ( memoryAlignment == 1 ) {
+        //_mm_malloc hands out plain malloc memory in this case, so realloc may grow in place or remap large buffers
+        realloced = realloc ( chunk.locPtr, sizereq );
+    } else {
+        realloced = _mm_malloc ( sizereq, memoryAlignment );
+        if ( realloced ) {
+            memcpy ( realloced, chunk.locPtr, growth > 0 ? chunk.size : sizereq );
+            _mm_free ( chunk.locPtr );
+        }
+    }
+#endif
+    bool success = realloced != NULL;
+    if ( success ) {
+        memory_used -= chunk.size + growth - sizereq;
+        if ( chunk.policy ) {
+            chunk.policy->resident += sizereq - chunk.size;
+        }
+        if ( chunk.pinCnt > 0 ) {
+            pinned_bytes += sizereq - chunk.size;
+        }
+        chunk.locPtr = realloced;
+        chunk.size = sizereq;
+#ifdef SWAPSTATS
+        ++n_resident_reallocs;
+#endif
+    } else {
+        memory_used -= growth;
+    }
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    unsetUse ( chunk );
+    return success;
 }
 
 
@@ -423,7 +824,7 @@ bool managedMemory::setUse ( memoryID id )
 bool managedMemory::unsetUse ( managedMemoryChunk &chunk , unsigned int no_unsets )
 {
     //printf("unsetUse on %d, %d times\n",chunk.id,no_unsets);
-    rambrain_pthread_mutex_lock ( &stateChangeMutex );
+    lockStateChangeMutex();
 
     if ( no_unsets == 0 ) {
         rambrain_pthread_mutex_unlock ( &stateChangeMutex );
@@ -436,6 +837,9 @@ bool managedMemory::unsetUse ( managedMemoryChunk &chunk , unsigned int no_unset
     }
 
     chunk.useCnt -= no_unsets;
+    for ( unsigned int n = 0; n < no_unsets; ++n ) {
+        accessTrace::record ( ACCESS_UNUSE, chunk );
+    }
     if ( chunk.status & MEM_ALLOCATED_INUSE_READ ) {
         chunk.status = ( chunk.useCnt == 0 ? MEM_ALLOCATED : chunk.status );
 
@@ -446,6 +850,148 @@ bool managedMemory::unsetUse ( managedMemoryChunk &chunk , unsigned int no_unset
     return true;
 }
 
+bool managedMemory::unsetUse ( managedMemoryChunk **chunks, unsigned int nchunks )
+{
+    lockStateChangeMutex();
+    //A chunk listed n times has to be in use at least n times:
+    std::vector<managedMemoryChunk *> sorted ( chunks, chunks + nchunks );
+    std::sort ( sorted.begin(), sorted.end() );
+    for ( unsigned int n = 0; n < nchunks; ) {
+        unsigned int uses = std::upper_bound ( sorted.begin() + n, sorted.end(), sorted[n] ) - ( sorted.begin() + n );
+        if ( sorted[n]->useCnt < uses ) {
+            rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+            return Throw ( memoryException ( "Can not unset use of not used memory" ) );
+        }
+        n += uses;
+    }
+
+    releaseUses ( chunks, nchunks );
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return true;
+}
+
+void managedMemory::releaseUses ( managedMemoryChunk **chunks, unsigned int nchunks )
+{
+    for ( unsigned int n = 0; n < nchunks; ++n ) {
+        managedMemoryChunk &chunk = *chunks[n];
+        --chunk.useCnt;
+        accessTrace::record ( ACCESS_UNUSE, chunk );
+        if ( chunk.status & MEM_ALLOCATED_INUSE_READ ) {
+            chunk.status = ( chunk.useCnt == 0 ? MEM_ALLOCATED : chunk.status );
+        }
+        untouch ( chunk );
+    }
+    signalSwappingCond();//Unsetting use may trigger different possible swapouts.
+}
+
+bool managedMemory::setUseAsync ( asyncUse &request )
+{
+    managedMemoryChunk &chunk = *request.chunk;
+    lockStateChangeMutex();
+    if ( chunk.status == MEM_ROOT ) {
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        return false;
+    }
+    ++chunk.useCnt;//This protects element from being swapped out by somebody else if it was swapped in.
+    accessTrace::record ( ACCESS_USE, chunk, request.writeAccess );
+#ifdef SWAPSTATS
+    countAccess ( chunk );
+#endif
+    //A chunk on its way to swap has to arrive there before it can be read again:
+    while ( chunk.status == MEM_SWAPOUT ) {
+        waitForAIO();
+    }
+    if ( chunk.status == MEM_SWAPPED ) {
+#ifdef SWAPSTATS
+        ++swap_misses;
+        --swap_hits;
+#endif
+        if ( !swapIn ( chunk ) ) {
+            --chunk.useCnt;
+            accessTrace::record ( ACCESS_UNUSE, chunk );
+            errmsgf ( "Could not swap in chunk %lu", chunk.id );
+            rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+            return false;
+        }
+    }
+    if ( chunk.status == MEM_SWAPIN ) { //The swap will tell us when it arrived
+        asyncUses.insert ( {&chunk, &request} );
+    } else {
+        completeAsyncUse ( request );
+    }
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return true;
+}
+
+void managedMemory::waitForUse ( asyncUse &request )
+{
+    if ( request.ready ) {
+        return;
+    }
+    lockStateChangeMutex();
+    while ( !request.ready ) {
+        waitForAIO();
+    }
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+}
+
+bool managedMemory::cancelUseAsync ( asyncUse &request )
+{
+    lockStateChangeMutex();
+    if ( request.ready ) {
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        return false;
+    }
+    auto range = asyncUses.equal_range ( request.chunk );
+    for ( auto it = range.first; it != range.second; ++it ) {
+        if ( it->second == &request ) {
+            asyncUses.erase ( it );
+            break;
+        }
+    }
+    //The chunk is still on its way, it will arrive unused:
+    --request.chunk->useCnt;
+    accessTrace::record ( ACCESS_UNUSE, *request.chunk );
+    signalSwappingCond();
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return true;
+}
+
+void managedMemory::finishAsyncUses ( managedMemoryChunk &chunk )
+{
+    if ( asyncUses.empty() ) {
+        return;
+    }
+    auto range = asyncUses.equal_range ( &chunk );
+    for ( auto it = range.first; it != range.second; ) {
+        asyncUse *request = it->second;
+        it = asyncUses.erase ( it );
+        completeAsyncUse ( *request );
+    }
+}
+
+void managedMemory::completeAsyncUse ( asyncUse &request )
+{
+    managedMemoryChunk &chunk = *request.chunk;
+    if ( chunk.status == MEM_ALLOCATED ) {
+        chunk.status = MEM_ALLOCATED_INUSE_READ;
+    }
+    if ( request.writeAccess && chunk.status != MEM_ALLOCATED_INUSE_WRITE ) {
+        chunk.status = MEM_ALLOCATED_INUSE_WRITE;
+        swap->invalidateCacheFor ( chunk );
+    }
+#ifdef SWAPSTATS
+    ++swap_hits;
+#endif
+    touch ( chunk );
+    //The requester may drop the request as soon as it sees it ready:
+    std::function<void() > onReady = request.onReady;
+    request.ready = true;
+    if ( onReady ) {
+        onReady();
+    }
+}
+
 bool managedMemory::Throw ( memoryException e )
 {
 
@@ -465,13 +1011,18 @@ bool managedMemory::Throw ( memoryException e )
 
 void managedMemory::mfree ( memoryID id, bool inCleanup )
 {
-    rambrain_pthread_mutex_lock ( &stateChangeMutex );
+    lockStateChangeMutex();
     managedMemoryChunk *chunk = memChunks[id];
     if ( chunk->status & MEM_ALLOCATED_INUSE ) {
         rambrain_pthread_mutex_unlock ( &stateChangeMutex );
         Throw ( memoryException ( "Can not free memory which is in use" ) );
         return;
     }
+    accessTrace::record ( ACCESS_FREE, *chunk );
+    //The swap may still be reading our ram to write a copy:
+    while ( swap->writeBackPending ( *chunk ) ) {
+        waitForAIO();
+    }
 
 
 
@@ -485,13 +1036,17 @@ void managedMemory::mfree ( memoryID id, bool inCleanup )
         if ( !inCleanup ) {
             schedulerDelete ( *chunk );
         }
+        if ( chunk->swapBuf ) {
+            swap->swapDelete ( chunk );
+        }
         if ( chunk->status == MEM_ALLOCATED ) {
-            _mm_free ( chunk->locPtr );
+            releaseLocation ( *chunk );
             memory_used -= chunk->size ;
         }
-        if ( chunk->swapBuf ) {
-            swap->swapDelete ( chunk );
+        if ( chunk->pinCnt > 0 ) {
+            pinned_bytes -= chunk->size;
         }
+        unmapFixedLocation ( *chunk );
         managedMemoryChunk *pchunk = &resolveMemChunk ( chunk->parent );
         if ( pchunk->child == chunk->id ) {
             pchunk->child = chunk->next;
@@ -514,13 +1069,18 @@ void managedMemory::mfree ( memoryID id, bool inCleanup )
     if ( !inCleanup ) {
         schedulerDelete ( *chunk );
     }
+    //The swap has to let go of the chunk's ram before it is freed:
+    if ( chunk->swapBuf ) {
+        swap->swapDelete ( chunk );
+    }
     if ( chunk->status == MEM_ALLOCATED ) {
-        _mm_free ( chunk->locPtr );
+        releaseLocation ( *chunk );
         memory_used -= chunk->size ;
     }
-    if ( chunk->swapBuf ) {
-        swap->swapDelete ( chunk );
+    if ( chunk->pinCnt > 0 ) {
+        pinned_bytes -= chunk->size;
     }
+    unmapFixedLocation ( *chunk );
 #endif
     //Delete element itself
     memChunks.erase ( id );
@@ -528,11 +1088,61 @@ void managedMemory::mfree ( memoryID id, bool inCleanup )
     rambrain_pthread_mutex_unlock ( &stateChangeMutex );
 }
 
+void *managedMemory::allocLocation ( const managedMemoryChunk &chunk, global_bytesize bytes, global_bytesize alignment )
+{
+    if ( !chunk.fixedLoc ) {
+        return _mm_malloc ( bytes, alignment );
+    }
+#ifdef _WIN32
+    return VirtualAlloc ( chunk.fixedLoc, chunk.size, MEM_COMMIT, PAGE_READWRITE );
+#else
+    return mprotect ( chunk.fixedLoc, chunk.size, PROT_READ | PROT_WRITE ) == 0 ? chunk.fixedLoc : NULL;
+#endif
+}
+
+void managedMemory::claimLocation ( managedMemoryChunk &chunk, void *location )
+{
+    chunk.locPtr = location;
+    if ( chunk.policy ) {
+        chunk.policy->resident += chunk.size;
+    }
+}
+
+void managedMemory::releaseLocation ( managedMemoryChunk &chunk )
+{
+    if ( chunk.policy ) {
+        chunk.policy->resident -= chunk.size;
+    }
+    if ( !chunk.fixedLoc ) {
+        _mm_free ( chunk.locPtr );
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree ( chunk.fixedLoc, chunk.size, MEM_DECOMMIT );
+#else
+    //Drop the pages but keep the range reserved, so that nobody else gets this address until the chunk is back:
+    mmap ( chunk.fixedLoc, chunk.size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0 );
+#endif
+}
+
+void managedMemory::unmapFixedLocation ( managedMemoryChunk &chunk )
+{
+    if ( !chunk.fixedLoc ) {
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree ( chunk.fixedLoc, 0, MEM_RELEASE );
+#else
+    munmap ( chunk.fixedLoc, chunk.size );
+#endif
+    chunk.fixedLoc = NULL;
+}
+
 #ifdef PARENTAL_CONTROL
 
 unsigned int managedMemory::getNumberOfChildren ( const memoryID &id )
 {
-    rambrain_pthread_mutex_lock ( &stateChangeMutex );
+    lockStateChangeMutex();
     const managedMemoryChunk &chunk = resolveMemChunk ( id );
     if ( chunk.child == invalid ) {
         rambrain_pthread_mutex_unlock ( &stateChangeMutex );
@@ -551,7 +1161,7 @@ unsigned int managedMemory::getNumberOfChildren ( const memoryID &id )
 
 void managedMemory::printTree ( managedMemoryChunk *current, unsigned int nspaces )
 {
-    rambrain_pthread_mutex_lock ( &stateChangeMutex );
+    lockStateChangeMutex();
     if ( !current ) {
         current = &resolveMemChunk ( root );
     }
@@ -648,15 +1258,69 @@ void managedMemory::printSwapstats() const
           \n\tA total of %lu swapins occured, reading in %lu bytes (%.3e Bytes/avg)\
           \n\twe used already loaded elements %lu times, %lu had to be fetched\
           \n\tthus, the hits over misses rate was %.5f\
-          \n\tfraction of swapped out ram (currently) %.2e\n\t %lu scheduled out bytes  and %lu scheduled in bytes saved by caching.", n_swap_out, swap_out_bytes, \
+          \n\tfraction of swapped out ram (currently) %.2e\n\t %lu scheduled out bytes  and %lu scheduled in bytes saved by caching.\
+          \n\t%lu direct reclaims scheduled %lu bytes, %lu background reclaims scheduled %lu bytes\
+          \n\t%lu bytes written back ahead of eviction (%lu outdated on arrival), %lu evictions (%lu bytes) satisfied by a clean copy\
+          \n\t%lu bytes left unwritten by swapouts of partially modified chunks\
+          \n\t%lu reallocations done on swap, %lu in ram", n_swap_out, swap_out_bytes, \
                ( ( float ) swap_out_bytes ) / n_swap_out, n_swap_in, swap_in_bytes, ( ( float ) swap_in_bytes ) / n_swap_in, \
                swap_hits, swap_misses, ( ( float ) swap_hits / swap_misses ), ( ( float ) memory_swapped ) / ( memory_used + memory_swapped ),
-               swap_out_scheduled_bytes - swap_out_bytes, swap_in_scheduled_bytes - swap_in_bytes );
+               swap_out_scheduled_bytes - swap_out_bytes, swap_in_scheduled_bytes - swap_in_bytes,
+               n_swap_out - n_background_reclaim, getDirectReclaimBytes(), n_background_reclaim, background_reclaim_bytes,
+               writeback_bytes, writeback_wasted_bytes, n_clean_evictions, clean_eviction_bytes,
+               partial_swapout_saved_bytes, n_swapped_reallocs, n_resident_reallocs );
+    for ( int l = 0; l < LATENCY_STATS; ++l ) {
+        latencySummary lat = getLatency ( ( latencyStat ) l );
+        infomsgf ( "%lu stalls %s, p50 %.3e s, p90 %.3e s, p99 %.3e s, max %.3e s", lat.count, latencyName ( ( latencyStat ) l ),
+                   lat.p50 * 1e-9, lat.p90 * 1e-9, lat.p99 * 1e-9, lat.max * 1e-9 );
+    }
+    printSchedulerStats();
 }
 
 void managedMemory::resetSwapstats()
 {
     swap_hits = swap_misses = swap_in_bytes = swap_out_bytes = n_swap_in = n_swap_out = 0;
+    swap_out_scheduled_bytes = swap_in_scheduled_bytes = 0;
+    n_background_reclaim = background_reclaim_bytes = 0;
+    writeback_bytes = writeback_wasted_bytes = n_clean_evictions = clean_eviction_bytes = 0;
+    partial_swapout_saved_bytes = 0;
+    n_swapped_reallocs = n_resident_reallocs = 0;
+    for ( int l = 0; l < LATENCY_STATE_LOCK; ++l ) {
+        latencies[l].reset();
+    }
+    stateLockLatency().reset();
+}
+
+latencyHistogram &managedMemory::stateLockLatency()
+{
+    static latencyHistogram histogram;
+    return histogram;
+}
+
+const char *managedMemory::latencyName ( latencyStat which )
+{
+    switch ( which ) {
+    case LATENCY_SWAPIN_WAIT:
+        return "waiting for swapin";
+    case LATENCY_SWAPOUT_WAIT:
+        return "waiting for swapout";
+    case LATENCY_ENSURE_SPACE:
+        return "making space";
+    case LATENCY_AIO:
+        return "in swap file io";
+    case LATENCY_STATE_LOCK:
+        return "waiting for the state lock";
+    default:
+        return "unknown";
+    }
+}
+
+void managedMemory::printLatencies ( FILE *out )
+{
+    for ( int l = 0; l < LATENCY_STATS; ++l ) {
+        latencySummary lat = defaultManager->getLatency ( ( latencyStat ) l );
+        fprintf ( out, "#Stalls %s [ns]\t%lu\t%lu\t%lu\t%lu\t%lu\n", latencyName ( ( latencyStat ) l ), lat.count, lat.p50, lat.p90, lat.p99, lat.max );
+    }
 }
 
 #define SAFESWAP(func) (defaultManager->swap != NULL ? defaultManager->swap->func : 0lu)
@@ -673,7 +1337,7 @@ void managedMemory::sigswapstats ( int )
 #ifdef LOGSTATS
     if ( firstLog ) {
         fprintf ( managedMemory::logFile, "#Time [ms]\tPrep for swap out [B] \tSwapped out [B]\tSwapped out last [B]\tPrep for swap in [B] \tSwapped in [B]\tSwapped in last [B]\tHits / Miss\tMemory Used [B]\t\
-                  Memory Used\tSwap Used [B]\tSwap Used\n" );
+                  Memory Used\tSwap Used [B]\tSwap Used\n#Stall lines hold count, p50, p90, p99 and max\n" );
         firstLog = false;
     }
     int64_t now = std::chrono::duration_cast<std::chrono::milliseconds> ( std::chrono::high_resolution_clock::now().time_since_epoch() ).count();
@@ -690,6 +1354,7 @@ void managedMemory::sigswapstats ( int )
               ( double ) defaultManager->memory_used / defaultManager->memory_max,
               usedSwap,
               ( double ) usedSwap / totalSwap );
+    printLatencies ( logFile );
     fflush ( logFile );
 #else
     printf ( "%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%e\t%lu\t%e\t%lu\t%e\n",
@@ -704,6 +1369,7 @@ void managedMemory::sigswapstats ( int )
              ( double ) defaultManager->memory_used / defaultManager->memory_max,
              usedSwap,
              ( double ) usedSwap / totalSwap );
+    printLatencies ( stdout );
 #endif
     defaultManager->swap_out_bytes_last = defaultManager->swap_out_bytes;
     defaultManager->swap_in_bytes_last = defaultManager->swap_in_bytes;
@@ -751,6 +1417,140 @@ void managedMemory::signalSwappingCond()
     pthread_cond_broadcast ( &swappingCond );
 }
 
+const char *managedMemory::setAllocationLabel ( const char *label )
+{
+    const char *previous = allocationLabelOfThread;
+    allocationLabelOfThread = label;
+    return previous;
+}
+
+const char *managedMemory::getAllocationLabel()
+{
+    return allocationLabelOfThread;
+}
+
+void managedMemory::setLabelPolicy ( const char *label, global_bytesize budget, int priority )
+{
+    lockStateChangeMutex();
+    labelPolicy *policy = findLabelPolicy ( label );
+    if ( !policy ) {
+        policy = new labelPolicy;
+        policy->label = label;
+        labelPolicies.push_back ( policy );
+        //Chunks allocated before get the policy as well:
+        for ( auto &idChunk : memChunks ) {
+            managedMemoryChunk &chunk = *idChunk.second;
+            if ( chunk.label && policy->label == chunk.label ) {
+                chunk.policy = policy;
+                if ( chunk.status != MEM_SWAPPED && chunk.status != MEM_ROOT ) {
+                    policy->resident += chunk.size;
+                }
+            }
+        }
+    }
+    policy->budget = budget;
+    policy->priority = priority;
+    addEvictionLevel ( priority );
+    labelBudgets = false;
+    for ( labelPolicy *other : labelPolicies ) {
+        labelBudgets = labelBudgets || other->budget != 0;
+    }
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+}
+
+void managedMemory::addEvictionLevel ( int priority )
+{
+    auto pos = std::lower_bound ( evictionLevels.begin(), evictionLevels.end(), priority );
+    if ( pos == evictionLevels.end() || *pos != priority ) {
+        evictionLevels.insert ( pos, priority );
+    }
+}
+
+bool managedMemory::setPinFraction ( double fraction )
+{
+    if ( fraction < 0. || fraction > 1. ) {
+        warnmsg ( "Pin fraction has to be within [0,1], keeping the old one" );
+        return false;
+    }
+    pinFraction = fraction;
+    return true;
+}
+
+global_bytesize managedMemory::getPinnedMemory() const
+{
+    return pinned_bytes;
+}
+
+bool managedMemory::pin ( managedMemoryChunk *const *chunks, unsigned int nchunks )
+{
+    lockStateChangeMutex();
+    global_bytesize newlyPinned = 0;
+    for ( unsigned int n = 0; n < nchunks; ++n ) {
+        newlyPinned += chunks[n]->pinCnt == 0 ? chunks[n]->size : 0;
+    }
+    if ( pinned_bytes + newlyPinned > pinFraction * memory_max ) {
+        rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+        return false;
+    }
+    pinned_bytes += newlyPinned;
+    for ( unsigned int n = 0; n < nchunks; ++n ) {
+        ++chunks[n]->pinCnt;
+    }
+    //Bring back what is not resident, from now on it is not swapped out any more:
+    for ( unsigned int n = 0; n < nchunks; ++n ) {
+        managedMemoryChunk &chunk = *chunks[n];
+        if ( chunk.status == MEM_SWAPOUT ) {
+            waitForSwapout ( chunk, true );
+        }
+        if ( chunk.status == MEM_SWAPPED && !swapIn ( chunk ) ) {
+            errmsgf ( "Could not swap in chunk %lu to pin it, it stays pinned and is kept once it is used", chunk.id );
+        }
+    }
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return true;
+}
+
+bool managedMemory::unpin ( managedMemoryChunk *const *chunks, unsigned int nchunks )
+{
+    lockStateChangeMutex();
+    bool allPinned = true;
+    for ( unsigned int n = 0; n < nchunks; ++n ) {
+        managedMemoryChunk &chunk = *chunks[n];
+        if ( chunk.pinCnt == 0 ) {
+            allPinned = false;
+            continue;
+        }
+        if ( --chunk.pinCnt == 0 ) {
+            pinned_bytes -= chunk.size;
+        }
+    }
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+    return allPinned;
+}
+
+void managedMemory::setEvictionPriority ( managedMemoryChunk *const *chunks, unsigned int nchunks, int priority, bool hint )
+{
+    lockStateChangeMutex();
+    for ( unsigned int n = 0; n < nchunks; ++n ) {
+        chunks[n]->priority = priority;
+        chunks[n]->priorityHint = hint;
+    }
+    if ( hint ) {
+        addEvictionLevel ( priority );
+    }
+    rambrain_pthread_mutex_unlock ( &stateChangeMutex );
+}
+
+labelPolicy *managedMemory::findLabelPolicy ( const char *label ) const
+{
+    for ( labelPolicy *policy : labelPolicies ) {
+        if ( policy->label == label ) {
+            return policy;
+        }
+    }
+    return NULL;
+}
+
 void managedMemory::waitForAIO()
 {
     if ( swap->checkForAIO() ) { //Some AIO has arrived...
@@ -769,6 +1569,10 @@ bool managedMemory::waitForSwapin ( managedMemoryChunk &chunk, bool keepSwapLock
         }
         return false;
     }
+#ifdef SWAPSTATS
+    scopedLatency stall ( latencies[LATENCY_SWAPIN_WAIT], chunk.status == MEM_SWAPIN );
+#endif
+    traceWait traced ( TRACE_WAIT_SWAPIN, chunk.id, chunk.status == MEM_SWAPIN );
     while ( chunk.status == MEM_SWAPIN ) {
         waitForAIO();
     }
@@ -791,6 +1595,10 @@ bool managedMemory::waitForSwapout ( managedMemoryChunk &chunk, bool keepSwapLoc
         }
         return false;
     }
+#ifdef SWAPSTATS
+    scopedLatency stall ( latencies[LATENCY_SWAPOUT_WAIT], chunk.status == MEM_SWAPOUT );
+#endif
+    traceWait traced ( TRACE_WAIT_SWAPOUT, chunk.id, chunk.status == MEM_SWAPOUT );
     while ( chunk.status == MEM_SWAPOUT ) {
         waitForAIO();
     }
@@ -812,6 +1620,9 @@ void rambrain::managedMemory::claimUsageof ( rambrain::global_bytesize bytes, bo
 {
     if ( rambytes ) {
         memory_used += used ? bytes : -(long long)bytes ;
+        if ( used ) {
+            checkReclaimWatermark();
+        }
     } else {
         memory_swapped += used ? bytes : -(long long)bytes ;
     }
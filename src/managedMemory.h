@@ -23,6 +23,10 @@
 #include <stdlib.h>
 #include <map>
 #include <pthread.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <limits>
 
 #ifdef SWAPSTATS
 #include <signal.h>
@@ -34,6 +38,9 @@
 
 #include "managedMemoryChunk.h"
 #include "exceptions.h"
+#ifdef SWAPSTATS
+#include "latencyHistogram.h"
+#endif
 
 
 //Test classes
@@ -43,6 +50,7 @@ class managedFileSwap_Unit_ManualSwappingDelete_Test;
 class managedFileSwap_Unit_ManualMultiSwapping_Test;
 class managedFileSwap_Unit_CheckSwapStats_Test;
 class cyclicManagedMemory_Integration_ArrayAccess_Test;
+class microBenchmarkAccess;
 #endif
 
 namespace rambrain
@@ -50,10 +58,31 @@ namespace rambrain
 class managedFileSwap;
 class managedDummySwap;
 class managedSwap;
+struct rambrainStats;
+struct chunkReportEntry;
+struct labelReportEntry;
+struct accessRecord;
+struct accessReplayResult;
 template<class T, int dim>
 class managedPtr;
 
 class AllocatorAccessor;
+
+/** @brief State of an asynchronous use request on a chunk, shared between requester and managedMemory
+ *  @see managedMemory::setUseAsync()
+ **/
+struct asyncUse {
+    asyncUse ( managedMemoryChunk &chunk, bool writeAccess, std::function<void() > onReady = std::function<void() >() ) : chunk ( &chunk ), writeAccess ( writeAccess ), onReady ( onReady ) {}
+
+    managedMemoryChunk *const chunk;
+    const bool writeAccess;
+    /** Called once the chunk is resident and in use. This happens in the thread completing the swap in, while stateChangeMutex is held.
+     *  Thus, it must not call into rambrain but should hand over to the user's scheduler**/
+    const std::function<void() > onReady;
+    ///Whether the chunk is resident and in use, may be polled without locking
+    std::atomic<bool> ready{false};
+};
+
 /**
  * @brief Backend class to handle raw memory and interaction/storage with managedSwap.
  *
@@ -110,6 +139,37 @@ public:
      **/
     bool setOutOfSwapIsFatal ( bool fatal = true );
 
+    /** @brief starts or stops a thread that swaps out cold chunks before the user runs out of ram
+     *  @param background iff set to true, reclaim starts when ram usage exceeds the high watermark and stops at the low watermark
+     *  @note must not be called having stateChangeMutex acquired
+     *  @return previous value
+     **/
+    bool setBackgroundReclaim ( bool background );
+    /** @brief sets the fractions of the memory limit between which the background reclaimer works
+     *  @return false if the watermarks are inconsistent and have not been applied
+     **/
+    bool setReclaimWatermarks ( float low, float high );
+    /** @brief sets the rate at which the background reclaimer writes cold chunks to swap while there is nothing to reclaim
+     *  @param bytesPerSecond write back budget, 0 switches write back off
+     *  @note the chunks stay in ram, when they have to be evicted later on, no writing is needed any more
+     *  @note only active with background reclaim
+     *  @return previous value
+     **/
+    global_bytesize setWriteBackRate ( global_bytesize bytesPerSecond );
+    /** @brief sets the size of the segments managedPtr arrays are split into
+     *  @param bytes arrays larger than this are split into independently swappable segments of this size, 0 disables segmentation
+     *  @note only affects arrays allocated afterwards
+     *  @return previous value
+     **/
+    global_bytesize setSegmentSize ( global_bytesize bytes );
+    /** @brief returns the size of the segments an array of bytes should be split into
+     *  @return 0 if the array should not be segmented
+     **/
+    global_bytesize getSegmentSizeFor ( global_bytesize bytes ) const;
+    /** @brief returns the bytes per block that containers like managedVector and managedTensor split their elements into unless told otherwise
+     *  @return up to a MiB, but at most 1/16 of the memory limit
+     **/
+    global_bytesize getDefaultBlockSize() const;
 
     //Chunk Management
     ///Triggers swapin of chunk
@@ -129,6 +189,34 @@ public:
      *  @param chunk the chunk that will not be needed in near future
      *  @param no_unsets if you set use to the chunk n times, you may set this to n instead of calling n times**/
     bool unsetUse ( managedMemoryChunk &chunk , unsigned int no_unsets = 1 );
+    /** @brief Marks several chunks as used at once and prevents their swapout
+     * @return success
+     * @param chunks the chunks that will be used, a chunk may be listed more than once
+     * @param nchunks number of entries in chunks
+     * @param writeAccess set this to false if the chunks will not be written to
+     * Room for all missing chunks is made once and they are requested from swap in a single batch. As all chunks are protected
+     * from the beginning, the scheduler will not swap out one of them to make room for another.
+     * @note throws if the chunks do not fit into memory at once
+     **/
+    bool setUse ( managedMemoryChunk **chunks, unsigned int nchunks, bool writeAccess );
+    /** @brief Marks several chunks as unused again, unsetting one use per entry
+     *  @return success
+     *  @see setUse ( managedMemoryChunk **chunks, unsigned int nchunks, bool writeAccess )**/
+    bool unsetUse ( managedMemoryChunk **chunks, unsigned int nchunks );
+    /** @brief Marks chunk as used like setUse(), but does not wait for the chunk to arrive from swap
+     *  @return success of requesting the chunk
+     *  @param request the request, has to stay alive until it is ready or cancelled
+     *  The chunk is protected from the beginning. As soon as it is resident, it is marked as in use, request.ready is set and request.onReady is called.
+     *  This may already happen before this function returns. Use is given back by unsetUse() as usual.
+     *  @note a chunk on its way to swap has to arrive there first, this is waited for
+     **/
+    bool setUseAsync ( asyncUse &request );
+    ///@brief blocks until request is ready
+    void waitForUse ( asyncUse &request );
+    /** @brief withdraws a request, giving back its use
+     *  @return false if the request was ready already, in this case, nothing is done and the use has to be given back by unsetUse()
+     **/
+    bool cancelUseAsync ( asyncUse &request );
 
 
 #ifdef PARENTAL_CONTROL
@@ -158,13 +246,62 @@ public:
      * **/
 
     static void signalSwappingCond();
+
+    /** @brief sets the label chunks allocated by the calling thread get from now on, NULL for none
+     *  @return the label set before
+     *  @see allocationLabel
+     **/
+    static const char *setAllocationLabel ( const char *label );
+    ///@brief returns the label chunks allocated by the calling thread get
+    static const char *getAllocationLabel();
+    /** @brief gives the chunks allocated under label a soft ram budget and an eviction priority
+     *  @param budget resident bytes above which the label's chunks are swapped out before all others, 0 for no budget
+     *  @param priority chunks of lower priority are swapped out first, chunks without label or policy have priority 0
+     *  @note applies to chunks already allocated under label as well. Setting a label's policy again replaces the old one.
+     **/
+    void setLabelPolicy ( const char *label, global_bytesize budget, int priority );
+    /** @brief sets the fraction of the memory limit pinned chunks may take at most, see managedPtr::pin()
+     *  @return false if fraction is not within [0,1], keeping the old one
+     **/
+    bool setPinFraction ( double fraction );
+    ///@brief returns the bytes of pinned chunks
+    global_bytesize getPinnedMemory() const;
 protected:
-    /// @brief allocates and registers a new raw memory chunk of size sizereq to be filled in by managedPtr
-    managedMemoryChunk *mmalloc ( global_bytesize sizereq );
-    /// @brief this function is a stub. In the future it should be capable of resizing an existing allocation
+    /** @brief gives scheduler code the opportunity to report its own counters into a statsSnapshot()
+     *  @note called having stateChangeMutex acquired. Default implementation reports nothing. **/
+    virtual void reportSchedulerStats ( rambrainStats &stats ) const {}
+    /** @brief allocates and registers a new raw memory chunk of size sizereq to be filled in by managedPtr
+     *  @param fixedLocation if true, the chunk will keep its address for its whole lifetime. Its address range stays reserved while it is swapped out,
+     *  accessing it then faults. Such chunks can not be reallocated.
+     **/
+    managedMemoryChunk *mmalloc ( global_bytesize sizereq, bool fixedLocation = false );
+    /** @brief resizes an existing allocation, keeping its contents up to the smaller of both sizes
+     *  @return false if there is not enough memory, the chunk is left untouched then
+     *  @note swapped out chunks are resized by the swap without reading them back if it supports this, all others are reallocated in ram
+     *  @note throws if the chunk is in use
+     **/
     bool mrealloc ( memoryID id, global_bytesize sizereq );
     /// @brief this function unregisters and deallocates a chunk
     void mfree ( rambrain::memoryID id, bool inCleanup = false );
+    /** @brief returns memory of bytes to hold the chunk's data when it is swapped in, to be used by swaps instead of _mm_malloc
+     *  @note chunks with a fixed location get their reserved address range back
+     **/
+    static void *allocLocation ( const managedMemoryChunk &chunk, global_bytesize bytes, global_bytesize alignment );
+    /// @brief frees the chunk's data when it has been swapped out, to be used by swaps instead of _mm_free
+    static void releaseLocation ( managedMemoryChunk &chunk );
+    /// @brief hands location from allocLocation to the chunk once it is going to hold the chunk's data
+    static void claimLocation ( managedMemoryChunk &chunk, void *location );
+    /** @brief keeps the chunks resident until they are unpinned as often, swapping in the ones that are not
+     *  @return false, pinning none of them, if the chunks not pinned yet would exceed pinFraction of the memory limit
+     *  @note a pin is no use, the chunks may still be freed
+     **/
+    bool pin ( managedMemoryChunk *const *chunks, unsigned int nchunks );
+    /// @brief releases a pin of each of the chunks, returns false if one of them was not pinned
+    bool unpin ( managedMemoryChunk *const *chunks, unsigned int nchunks );
+    /// @brief sets the eviction priority of the chunks, overriding the one of their label. If hint is false, they go back to their label's one.
+    void setEvictionPriority ( managedMemoryChunk *const *chunks, unsigned int nchunks, int priority, bool hint = true );
+    /// @brief gives back the address range of a chunk with fixed location when it is deleted
+    static void unmapFixedLocation ( managedMemoryChunk &chunk );
     ///returns a reference to the memoryChunk indexed by id id
     managedMemoryChunk &resolveMemChunk ( const memoryID &id );
 
@@ -188,6 +325,10 @@ protected:
      *
      **/
     virtual swapErrorCode swapOut ( global_bytesize min_size ) = 0;
+    ///@brief whether swapOut has anything to look at; swapOut throws after releasing stateChangeMutex otherwise
+    virtual bool hasSwapOutCandidates() const {
+        return true;
+    }
     /// @brief Convenience function for swapIn ( managedMemoryChunk &chunk ) @see swapIn(managedMemoryChunk &chunk)
     virtual bool swapIn ( memoryID id );
     /** @brief Tries to swap in chunk chunk
@@ -197,6 +338,14 @@ protected:
      *  @note this function must be called having stateChangeMutex acquired.
     **/
     virtual bool swapIn ( managedMemoryChunk &chunk ) = 0;
+    /** @brief Swaps in all swapped out chunks of chunklist as one batch, without preemptive guesses
+     *  @return success
+     *  @param chunklist the chunks subject to be swapped in, the ones not swapped out are skipped
+     *  @param nchunks number of entries in chunklist
+     *  Successful return does not mean that the chunks are available at an instant.
+     *  @note this function must be called having stateChangeMutex acquired and the chunks protected by their use count.
+    **/
+    virtual bool swapIn ( managedMemoryChunk **chunklist, unsigned int nchunks );
     /** @brief marks chunk as recently active as a hint for scheduling **/
     virtual bool touch ( managedMemoryChunk &chunk ) = 0;
     /** @brief marks chunk as recently not needed any more**/
@@ -205,12 +354,39 @@ protected:
     virtual void schedulerRegister ( managedMemoryChunk &chunk ) = 0;
     ///@brief signals deletion of chunk to scheduler code
     virtual void schedulerDelete ( managedMemoryChunk &chunk ) = 0;
+    /** @brief signals that a user had to wait for chunk to arrive from swap
+     *  @param seconds time the user was blocked
+     *  @param miss true if chunk had to be requested from swap, false if we waited for an already scheduled swapin
+     *  @note called having stateChangeMutex acquired. Default implementation ignores the event. **/
+    virtual void schedulerMissed ( managedMemoryChunk &, double, bool ) {}
+    /** @brief asks the scheduler to write back up to bytes bytes of its coldest unused chunks, keeping them resident
+     *  @return number of bytes scheduled for writing
+     *  @note called having stateChangeMutex acquired. Default implementation does nothing. **/
+    virtual global_bytesize writeBackCold ( global_bytesize ) {
+        return 0;
+    }
+
+    /** @brief marks pending asynchronous use requests of chunk as ready once it arrived
+     *  @note this function must be called having stateChangeMutex acquired, it is called by the swap completing a swap in.**/
+    void finishAsyncUses ( managedMemoryChunk &chunk );
+    ///@brief marks chunk as in use for request and signals it, chunk has to be resident and stateChangeMutex acquired
+    void completeAsyncUse ( asyncUse &request );
+    ///Pending asynchronous use requests of chunks that have not arrived yet
+    std::multimap<managedMemoryChunk *, asyncUse *> asyncUses;
 
     /** @brief This function ensures that there is sizereq space left in ram
         @param orisSwappedin if not null, this chunk will be checked for ram presence
         @return If \p orisSwappedin is set, return value tells whether the chunk \p orisSwappedin is pointing to has been or is about to be swapped in. Otherwise false**/
 
     bool ensureEnoughSpace ( global_bytesize sizereq, managedMemoryChunk *orIsSwappedin = NULL );
+    /** @brief wakes up the background reclaimer if ram usage crossed the high watermark
+     *  @note this function must be called having stateChangeMutex acquired.**/
+    void checkReclaimWatermark();
+    /** @brief drops one use per entry of chunks without checking that the uses exist
+     *  @note this function must be called having stateChangeMutex acquired.**/
+    void releaseUses ( managedMemoryChunk **chunks, unsigned int nchunks );
+    ///@brief main loop of the background reclaimer
+    static void *reclaimWorker ( void *ptr );
 
     //Swap Storage manager iface:
     managedSwap *swap = 0;
@@ -221,8 +397,53 @@ protected:
     global_bytesize memory_tobefreed = 0;
     bool outOfSwapIsFatal = true;
 
+    //Background reclaim:
+    bool reclaimWork = false;
+    pthread_t reclaimThread;
+    pthread_cond_t reclaimCond = PTHREAD_COND_INITIALIZER;
+    float reclaimLowWatermark = .85;
+    float reclaimHighWatermark = .95;
+    global_bytesize writeBackRate = 0;
+    ///Number of write back rounds per second
+    static const unsigned int writeBackFrequency = 10;
+
+    //Segmentation of large arrays:
+    global_bytesize segmentSize = 0;
+
     std::map<memoryID, managedMemoryChunk *> memChunks;
 
+    //Label policies:
+    std::vector<labelPolicy *> labelPolicies;
+    ///Distinct priorities ever set for labels or chunks and 0, ascending
+    std::vector<int> evictionLevels = {0};
+    ///Whether a label policy has a budget, the scheduler has to look at priorities then even if all of them are equal
+    bool labelBudgets = false;
+    ///@brief adds priority to evictionLevels
+    void addEvictionLevel ( int priority );
+    ///@brief returns the policy of label, NULL if there is none
+    labelPolicy *findLabelPolicy ( const char *label ) const;
+    /** @brief returns the priority the scheduler swaps chunk out with
+     *  A priority set for the chunk itself counts first. Otherwise, chunks of labels exceeding their budget by more than the bytes already selected
+     *  get the lowest priority possible.
+     **/
+    static inline int evictionPriority ( const managedMemoryChunk &chunk ) {
+        if ( chunk.priorityHint ) {
+            return chunk.priority;
+        }
+        const labelPolicy *policy = chunk.policy;
+        if ( !policy ) {
+            return 0;
+        }
+        if ( policy->budget != 0 && policy->resident > policy->budget + policy->selected ) {
+            return std::numeric_limits<int>::min();
+        }
+        return policy->priority;
+    }
+
+    //Pinning:
+    double pinFraction = .5;
+    global_bytesize pinned_bytes = 0;
+
     memoryAtime atime = 0;
     memoryID memID_pace = 1;
 
@@ -232,6 +453,19 @@ protected:
     static bool Throw ( memoryException e );
 
     static pthread_mutex_t stateChangeMutex;
+    ///@brief acquires stateChangeMutex, with SWAPSTATS the time waited for another thread to release it is recorded
+    static inline void lockStateChangeMutex() {
+#ifdef SWAPSTATS
+        if ( pthread_mutex_trylock ( &stateChangeMutex ) == 0 ) {
+            return;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        rambrain_pthread_mutex_lock ( &stateChangeMutex );
+        stateLockLatency().recordSince ( start );
+#else
+        rambrain_pthread_mutex_lock ( &stateChangeMutex );
+#endif
+    }
     //Signalled after every swapin. Synchronization is happening via stateChangeMutex
     static pthread_cond_t swappingCond;
     /*static pthread_cond_t topologicalCond;*/
@@ -245,6 +479,11 @@ protected:
     friend class genericManagedPtr;
 
     friend class AllocatorAccessor;
+    friend class pinnedMemoryResource;
+    friend rambrainStats statsSnapshot ( managedMemory *manager );
+    friend std::vector<chunkReportEntry> topChunks ( unsigned int n, managedMemory *manager );
+    friend std::vector<labelReportEntry> labelReport ( managedMemory *manager );
+    friend accessReplayResult replayAccessTrace ( const std::vector<accessRecord> &records, managedMemory *manager, double bandwidth, double latency );
 
     //Test classes
 #ifdef BUILD_TESTS
@@ -254,10 +493,29 @@ protected:
     friend class ::cyclicManagedMemory_Integration_ArrayAccess_Test;
     friend class ::managedFileSwap_Unit_CheckSwapStats_Test;
     friend managedSwap *configTestGetSwap ( managedMemory *man );
+    friend class ::microBenchmarkAccess;
 #endif
 
-#ifdef SWAPSTATS
+public:
+    /** @brief where threads stall, each counted only when a thread actually had to wait
+     *  All are kept as latencyHistogram in nanoseconds
+     **/
+    enum latencyStat {
+        ///Blocked in waitForSwapin() until the chunk arrived
+        LATENCY_SWAPIN_WAIT,
+        ///Blocked in waitForSwapout() until the chunk was written
+        LATENCY_SWAPOUT_WAIT,
+        ///Making room for an allocation or swapin in ensureEnoughSpace()
+        LATENCY_ENSURE_SPACE,
+        ///From submitting a request to the swap file until it arrived, per request
+        LATENCY_AIO,
+        ///Waiting for stateChangeMutex held by another thread, shared by all managers
+        LATENCY_STATE_LOCK,
+        LATENCY_STATS
+    };
+
 protected:
+#ifdef SWAPSTATS
     global_bytesize n_swap_out = 0;
     global_bytesize n_swap_in = 0;
 
@@ -272,6 +530,44 @@ protected:
 
     global_bytesize swap_hits = 0;
     global_bytesize swap_misses = 0;
+
+    ///Swapouts scheduled by the reclaimer thread. All others happened on the user's thread ( direct reclaim )
+    global_bytesize n_background_reclaim = 0;
+    global_bytesize background_reclaim_bytes = 0;
+    ///Bytes written back while staying in ram, and those of them changed before the copy arrived
+    global_bytesize writeback_bytes = 0;
+    global_bytesize writeback_wasted_bytes = 0;
+    ///Evictions that did not need to write, as a clean copy was present on disk
+    global_bytesize n_clean_evictions = 0;
+    global_bytesize clean_eviction_bytes = 0;
+    ///Bytes not written on swapout as dirty tracking found them unchanged since the chunk's copy was made
+    global_bytesize partial_swapout_saved_bytes = 0;
+    ///Reallocations done on disk without swapping in / done in ram
+    global_bytesize n_swapped_reallocs = 0;
+    global_bytesize n_resident_reallocs = 0;
+
+    ///@brief counts a use of chunk into its counters
+    static inline void countAccess ( managedMemoryChunk &chunk ) {
+        ++chunk.counters.accesses;
+        chunk.counters.last_access = std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::system_clock::now().time_since_epoch() ).count();
+    }
+    ///@brief counts bytes of chunk that arrived from swap, for the manager and the chunk
+    inline void countSwapIn ( managedMemoryChunk &chunk, global_bytesize bytes ) {
+        swap_in_bytes += bytes;
+        ++chunk.counters.swapins;
+        chunk.counters.swapin_bytes += bytes;
+    }
+    ///@brief counts bytes of chunk written to swap on its swapout, for the manager and the chunk
+    inline void countSwapOut ( managedMemoryChunk &chunk, global_bytesize bytes ) {
+        swap_out_bytes += bytes;
+        ++chunk.counters.swapouts;
+        chunk.counters.swapout_bytes += bytes;
+    }
+
+    ///Stall times of this manager, except for the lock wait, which belongs to the static mutex
+    latencyHistogram latencies[LATENCY_STATE_LOCK];
+    ///Lock waits on stateChangeMutex, constructed on first use so that locking in static initialisation is safe
+    static latencyHistogram &stateLockLatency();
 #endif
     /** @brief Waits until a certain chunk is present
      *  @return success
@@ -316,6 +612,8 @@ public:
     void resetSwapstats();
     ///@brief returns current hits over misses rate for accessing elements.
     double getHitsOverMisses();
+    ///@brief gives scheduler code the opportunity to report its own statistics along printSwapstats
+    virtual void printSchedulerStats() const {}
 
     ///@brief simple Getter
     double getTotalSwappedOutBytes() {
@@ -325,16 +623,87 @@ public:
     double getTotalSwappedInBytes() {
         return swap_in_bytes;
     };
+    ///@brief returns bytes scheduled for swapout on the user's thread, i.e. not by the background reclaimer
+    global_bytesize getDirectReclaimBytes() const {
+        return swap_out_scheduled_bytes - background_reclaim_bytes;
+    };
+    ///@brief simple Getter
+    global_bytesize getBackgroundReclaimBytes() const {
+        return background_reclaim_bytes;
+    };
+    ///@brief simple Getter
+    global_bytesize getWriteBackBytes() const {
+        return writeback_bytes;
+    };
+    ///@brief simple Getter
+    global_bytesize getCleanEvictionBytes() const {
+        return clean_eviction_bytes;
+    };
+    ///@brief simple Getter
+    global_bytesize getPartialSwapOutSavedBytes() const {
+        return partial_swapout_saved_bytes;
+    };
+    ///@brief simple Getter
+    global_bytesize getSwappedReallocs() const {
+        return n_swapped_reallocs;
+    };
+    ///@brief simple Getter
+    global_bytesize getResidentReallocs() const {
+        return n_resident_reallocs;
+    };
+
+    ///@brief returns the histogram of the given stall
+    const latencyHistogram &getLatencyHistogram ( latencyStat which ) const {
+        return which == LATENCY_STATE_LOCK ? stateLockLatency() : latencies[which];
+    }
+    ///@brief returns count, p50, p90, p99 and max in nanoseconds of the given stall
+    latencySummary getLatency ( latencyStat which ) const {
+        return getLatencyHistogram ( which ).summary();
+    }
+    ///@brief returns a short name of the stall, as used by printSwapstats()
+    static const char *latencyName ( latencyStat which );
 
     /** @brief static binding that will print out some stats.
-    Compile with cmake -DSWAPSTATS=on and send process SIGUSR1 to call this function
+    Compile with cmake -DSWAPSTATS=on and send process SIGUSR1 to call this function.
+    The line of byte counters is followed by a line per latencyStat holding count, p50, p90, p99 and max in nanoseconds, starting with '#'.
     */
     static void sigswapstats ( int sig );
+    ///@brief writes the stall lines of sigswapstats() for the default manager
+    static void printLatencies ( FILE *out );
 #endif
     ///@brief prints out a GIT version info and a diff on this version at compile time
     static void versionInfo();
 };
 
+/** @brief gives chunks allocated by the constructing thread a label, until it is destroyed
+ *
+ *  Labels show up in the reports of statsSnapshot.h, so that swapping can be traced back to the data structure causing it.
+ *  A label may be passed as first argument of a managedPtr constructor, or be kept alive over several allocations:
+ *  @code
+ *  managedPtr<double> field ( allocationLabel ( "fields" ), n );
+ *  {
+ *      allocationLabel label ( "mesh" );
+ *      managedPtr<vertex> vertices ( nvertices );
+ *      managedPtr<cell> cells ( ncells );
+ *  }
+ *  @endcode
+ *  @note the label is not copied and must outlive the chunks, string literals are fine
+ **/
+class allocationLabel
+{
+public:
+    explicit allocationLabel ( const char *label ) : previous ( managedMemory::setAllocationLabel ( label ) ) {}
+    ~allocationLabel() {
+        managedMemory::setAllocationLabel ( previous );
+    }
+
+    allocationLabel ( const allocationLabel &ref ) = delete;
+    allocationLabel &operator= ( const allocationLabel &ref ) = delete;
+
+private:
+    const char *previous;
+};
+
 }
 
 #endif
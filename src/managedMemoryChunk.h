@@ -21,6 +21,7 @@
 #define MANAGEDMEMORYCHUNK_H
 
 #include "common.h"
+#include <string>
 
 namespace rambrain
 {
@@ -38,6 +39,39 @@ enum memoryStatus {MEM_ROOT = 0,
 typedef uint64_t memoryID;
 typedef uint64_t memoryAtime;
 
+///@brief what happened to a chunk since its allocation, counted if built with SWAPSTATS
+struct chunkCounters {
+    ///Uses by adhereTo and the like
+    global_bytesize accesses = 0;
+    global_bytesize swapins = 0;
+    global_bytesize swapouts = 0;
+    global_bytesize swapin_bytes = 0;
+    ///Bytes written to swap, less than the chunk's size per swapout if dirty tracking or a clean copy on disk saved writing
+    global_bytesize swapout_bytes = 0;
+    ///Nanoseconds since the epoch of the last use, 0 if never used
+    int64_t last_access = 0;
+};
+
+///@brief eviction priorities for managedPtr::setEvictionPriority() and label policies, chunks of lower priority are swapped out first. Other values work as well.
+enum evictionPriorityLevel {
+    PRIORITY_LOW = -1,
+    PRIORITY_NORMAL = 0,
+    PRIORITY_HIGH = 1
+};
+
+///@brief ram budget and eviction priority of the chunks allocated under a label, see managedMemory::setLabelPolicy()
+struct labelPolicy {
+    std::string label;
+    ///Resident bytes above which the label's chunks are swapped out first, 0 for none
+    global_bytesize budget = 0;
+    ///Chunks of lower priority are swapped out first, chunks without policy have priority 0
+    int priority = 0;
+    ///Bytes of the label's chunks holding ram, kept up to date by managedMemory
+    global_bytesize resident = 0;
+    ///Bytes of the label's chunks the scheduler has selected for swapping out while it is selecting
+    global_bytesize selected = 0;
+};
+
 /** \brief manages all managed Chunks of raw memory
  *
  * This object tracks the dimesions and status of a chunk of memory we manage.
@@ -77,9 +111,20 @@ public:
 
     //Swap scheduling:
     void *schedBuf /** @brief a place to store additional scheduling information **/;
+    labelPolicy *policy = NULL /** @brief policy of the chunk's label, NULL if there is none **/;
+    unsigned short pinCnt = 0 /** @brief Number of pins keeping the chunk resident, see managedMemory::pin() **/;
+    bool priorityHint = false /** @brief whether priority overrides the priority of the chunk's label **/;
+    int priority = PRIORITY_NORMAL /** @brief eviction priority set for this chunk, see managedMemory::setEvictionPriority() **/;
 
     //Swap raw management:
     void *swapBuf/** @brief a place to store additional swapping information **/;
+    void *fixedLoc = NULL /** @brief if set, the chunk's data always resides at this address, even after swapping it out and in again **/;
+
+    //Introspection:
+    const char *label = NULL /** @brief label of the allocation site, set by allocationLabel **/;
+#ifdef SWAPSTATS
+    chunkCounters counters;
+#endif
 };
 
 }
@@ -26,6 +26,8 @@
 #include "exceptions.h"
 #include <type_traits>
 #include <pthread.h>
+#include <vector>
+#include <initializer_list>
 
 //Test classes
 #ifdef BUILD_TESTS
@@ -39,6 +41,12 @@ class adhereTo_Unit_LoadUnload_Test;
 class adhereTo_Unit_LoadUnloadConst_Test;
 class adhereTo_Unit_TwiceAdhered_Test;
 class adhereTo_Unit_TwiceAdheredOnceUsed_Test;
+class adhereTo_Unit_ManyLoadsAllAtOnce_Test;
+class adhereTo_Unit_ManyReadOnlyDuplicatesAndSegments_Test;
+class adhereTo_Unit_ManyTooLarge_Test;
+class adhereTo_Unit_AsyncDummySwap_Test;
+class adhereTo_Unit_AsyncFileSwap_Test;
+class cyclicManagedMemory_Unit_LabelBudgetWithoutPriority_Test;
 #endif
 
 namespace rambrain
@@ -46,6 +54,10 @@ namespace rambrain
 
 template <class T>
 class adhereTo;
+template <class T>
+class adhereToMany;
+template <class T>
+class asyncAdhereTo;
 
 
 //Convenience macros
@@ -69,6 +81,9 @@ class adhereTo;
 /**
  * \brief Main class to allocate memory that is managed by the rambrain memory defaultManager
  *
+ * Each element of the first dimension gets managedPtrs of its own, e.g. a matrix is stored as one chunk per row.
+ * Use managedTensor for arrays that are accessed along other dimensions or block-wise as well.
+ *
  * @warning _thread-safety_
  * * The object itself is not thread-safe
  * * Do not pass pointers/references to this object over thread boundaries
@@ -96,6 +111,10 @@ public:
         }
     }
 
+    ///@brief as managedPtr ( unsigned int n_elem, ctor_args... Args ), labelling all chunks
+    template <typename... ctor_args>
+    managedPtr ( const allocationLabel &, unsigned int n_elem , ctor_args... Args ) : managedPtr ( n_elem, Args... ) {}
+
     ///@brief with no arguments given, instantiates an array with one element
     managedPtr() : managedPtr ( 1 ) {}
 
@@ -125,6 +144,42 @@ public:
         return subPtrs[i];
     }
 
+    ///@brief pins all sub arrays, see managedPtr<T, 1>::pin(). Either all or none of them get pinned.
+    bool pin() const {
+        for ( unsigned int i = 0; i < n_elem; ++i ) {
+            if ( !subPtrs[i].pin() ) {
+                while ( i-- > 0 ) {
+                    subPtrs[i].unpin();
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ///@brief unpins all sub arrays, see managedPtr<T, 1>::unpin()
+    bool unpin() const {
+        bool result = true;
+        for ( unsigned int i = 0; i < n_elem; ++i ) {
+            result &= subPtrs[i].unpin();
+        }
+        return result;
+    }
+
+    ///@brief sets the eviction priority of all sub arrays, see managedPtr<T, 1>::setEvictionPriority()
+    void setEvictionPriority ( int priority ) const {
+        for ( unsigned int i = 0; i < n_elem; ++i ) {
+            subPtrs[i].setEvictionPriority ( priority );
+        }
+    }
+
+    ///@brief lets all sub arrays go back to the eviction priority of their label
+    void resetEvictionPriority() const {
+        for ( unsigned int i = 0; i < n_elem; ++i ) {
+            subPtrs[i].resetEvictionPriority();
+        }
+    }
+
 private:
     unsigned int n_elem;
     managedPtr < T, dim - 1 > * subPtrs;
@@ -146,13 +201,17 @@ class managedPtr<T, 1>
 {
 public:
     ///@brief copy ctor
-    managedPtr ( const managedPtr<T, 1> &ref ) : chunk ( ref.chunk ), tracker ( ref.tracker ), n_elem ( ref.n_elem ) {
+    managedPtr ( const managedPtr<T, 1> &ref ) : chunk ( ref.chunk ), tracker ( ref.tracker ), n_elem ( ref.n_elem ), segments ( ref.segments ), segmentElems ( ref.segmentElems ) {
         rambrain_atomic_add_fetch ( tracker, 1 );
     }
 
     ///@brief with no arguments given, instantiates an array with one element
     managedPtr() : managedPtr ( 1 ) {}
 
+    ///@brief as managedPtr ( unsigned int n_elem, ctor_args... Args ), labelling the chunk, e.g. managedPtr<double> ( allocationLabel ( "mesh" ), n )
+    template <typename... ctor_args>
+    managedPtr ( const allocationLabel &, unsigned int n_elem , ctor_args... Args ) : managedPtr ( n_elem, Args... ) {}
+
     ///@brief instantiates managedPtr containing n_elem elements and passes Args as arguments to the constructor of these
     template <typename... ctor_args>
     managedPtr ( unsigned int n_elem , ctor_args... Args ) {
@@ -199,7 +258,17 @@ public:
         }
 #endif
 
-        chunk = managedMemory::defaultManager->mmalloc ( sizeof ( T ) * n_elem );
+        //Arrays larger than the configured segment size are split into independently swappable segments:
+        global_bytesize segmentBytes = managedMemory::defaultManager->getSegmentSizeFor ( sizeof ( T ) * n_elem );
+        if ( segmentBytes != 0 && segmentBytes / sizeof ( T ) < n_elem ) {
+            segmentElems = segmentBytes < sizeof ( T ) ? 1 : segmentBytes / sizeof ( T );
+            segments = new managedMemoryChunk *[ ( n_elem + segmentElems - 1 ) / segmentElems];
+        }
+
+        chunk = managedMemory::defaultManager->mmalloc ( sizeof ( T ) * segmentElements ( 0 ) );
+        if ( segments ) {
+            segments[0] = chunk;
+        }
 
 #ifdef PARENTAL_CONTROL
         //Now call constructor and save possible children's sake:
@@ -207,11 +276,17 @@ public:
         managedMemory::parent = chunk->id;
 #endif
 
-        setUse();
-        for ( unsigned int n = 0; n < n_elem; n++ ) {
-            new ( ( ( T * ) chunk->locPtr ) + n ) T ( Args... );
+        for ( unsigned int s = 0; s < numSegments(); ++s ) {
+            if ( s > 0 ) {
+                segments[s] = managedMemory::defaultManager->mmalloc ( sizeof ( T ) * segmentElements ( s ) );
+            }
+            setUse ( true, NULL, s );
+            T *loc = ( T * ) segmentChunk ( s ).locPtr;
+            for ( unsigned int n = 0; n < segmentElements ( s ); n++ ) {
+                new ( loc + n ) T ( Args... );
+            }
+            unsetUse ( 1, s );
         }
-        unsetUse();
 #ifdef PARENTAL_CONTROL
         managedMemory::parent = savedParent;
         if ( iamSyncer ) {
@@ -235,27 +310,86 @@ public:
         return n_elem;
     }
 
-    ///@brief tells the memory manager to possibly swap in chunk for near future use
-    bool prepareUse() const {
-        managedMemory::defaultManager->prepareUse ( *chunk, true );
+    /// @brief returns whether the elements are split into independently swappable segments
+    inline bool isSegmented() const {
+        return segments != NULL;
+    }
+
+    /** @brief returns the number of elements per segment, size() if not segmented
+     *  @note segment n holds the elements [n * segmentLength(), (n + 1) * segmentLength())
+     **/
+    inline unsigned int segmentLength() const {
+        return segments ? segmentElems : n_elem;
+    }
+
+    /** @brief resizes the array to n_elem elements, keeping the values of the elements present before and after
+     *  @return false if there is not enough memory, the array is left untouched then
+     *  @note added elements are left uninitialized, thus only arrays of trivially copyable elements can be resized
+     *  @note a swapped out array is resized on disk if the swap supports this
+     *  @warning the array must not be adhered to, copied to other managedPtrs or segmented
+     **/
+    bool mrealloc ( unsigned int n_elem ) {
+        static_assert ( std::is_trivially_copyable<T>::value, "Only arrays of trivially copyable elements can be resized" );
+        if ( this->n_elem == 0 || n_elem == 0 || segments ) {
+            throw memoryException ( "Can only resize non-empty, non-segmented arrays to a non-zero size" );
+        }
+        if ( *tracker != 1 ) {
+            throw memoryException ( "Can not resize an array shared with other managedPtrs" );
+        }
+        if ( !managedMemory::defaultManager->mrealloc ( chunk->id, sizeof ( T ) * n_elem ) ) {
+            return false;
+        }
+        this->n_elem = n_elem;
+        return true;
+    }
+
+    ///@brief tells the memory manager to possibly swap in chunk (or the given segment) for near future use
+    bool prepareUse ( unsigned int segment = 0 ) const {
+        managedMemory::defaultManager->prepareUse ( segmentChunk ( segment ), true );
         return true;
     }
 
-    ///@brief Atomically sets use to a chunk if tracker is not already set to true. returns whether we set use or not.
-    bool setUse ( bool writable = true, bool *tracker = NULL ) const {
+    ///@brief Atomically sets use to a chunk (or the given segment) if tracker is not already set to true. returns whether we set use or not.
+    bool setUse ( bool writable = true, bool *tracker = NULL, unsigned int segment = 0 ) const {
         if ( tracker )
             if ( !rambrain_atomic_bool_compare_and_swap ( tracker, false, true ) ) {
-                waitForSwapin();
+                waitForSwapin ( segment );
                 return false;
             }
-        bool result = managedMemory::defaultManager->setUse ( *chunk , writable );
+        bool result = managedMemory::defaultManager->setUse ( segmentChunk ( segment ) , writable );
 
         return result;
     }
 
-    ///@brief unsets use count on memory chunk
-    bool unsetUse ( unsigned int loaded = 1 ) const {
-        return managedMemory::defaultManager->unsetUse ( *chunk , loaded );
+    ///@brief unsets use count on memory chunk (or the given segment)
+    bool unsetUse ( unsigned int loaded = 1, unsigned int segment = 0 ) const {
+        return managedMemory::defaultManager->unsetUse ( segmentChunk ( segment ) , loaded );
+    }
+
+    /** @brief keeps the array (all of its segments) resident until unpin() is called as often, swapping it in if it is not
+     *  @return false, pinning nothing, if the pinned bytes would exceed their share of the memory limit, see managedMemory::setPinFraction()
+     *  @note unlike holding an adhereTo, a pin does not count as use. The array may still be freed, which releases its pins.
+     *  Copies of the managedPtr share the pins.
+     **/
+    bool pin() const {
+        return managedMemory::defaultManager->pin ( segments ? segments : &chunk, chunk ? numSegments() : 0 );
+    }
+
+    ///@brief releases a pin set by pin(), returns false if the array was not pinned
+    bool unpin() const {
+        return managedMemory::defaultManager->unpin ( segments ? segments : &chunk, chunk ? numSegments() : 0 );
+    }
+
+    /** @brief sets the eviction priority of the array, overriding the priority of its label
+     *  @param priority chunks of lower priority are swapped out first, see evictionPriorityLevel
+     **/
+    void setEvictionPriority ( int priority ) const {
+        managedMemory::defaultManager->setEvictionPriority ( segments ? segments : &chunk, chunk ? numSegments() : 0, priority );
+    }
+
+    ///@brief lets the array go back to the eviction priority of its label
+    void resetEvictionPriority() const {
+        managedMemory::defaultManager->setEvictionPriority ( segments ? segments : &chunk, chunk ? numSegments() : 0, PRIORITY_NORMAL, false );
     }
 
     ///@brief assignment operator
@@ -271,61 +405,86 @@ public:
         n_elem = ref.n_elem;
         chunk = ref.chunk;
         tracker = ref.tracker;
+        segments = ref.segments;
+        segmentElems = ref.segmentElems;
         rambrain_atomic_add_fetch ( tracker, 1 );
         return *this;
     }
 
     ///@note This operator can only be called safely in single threaded situations when preemptive swapOut actions have been disabled
     DEPRECATED T &operator[] ( int i ) {
-        managedPtr<T> &self = *this;
-        ADHERETOLOC ( T, self, loc );
-        return loc[i];
+        adhereTo<T> glue ( *this, i, i + 1 );
+        T *loc = glue;
+        return *loc;
     }
     ///@note This operator can only be called safely in single threaded situations when preemptive swapOut actions have been disabled
     DEPRECATED const T &operator[] ( int i ) const {
-        const managedPtr<T> &self = *this;
-        ADHERETOLOCCONST ( T, self, loc );
-        return loc[i];
+        const adhereTo<T> glue ( *this, i, i + 1 );
+        const T *loc = glue;
+        return *loc;
     }
 
-    /** @brief returns local pointer to object
+    /** @brief returns local pointer to object (or the first element of the given segment)
      *  @note when called, you have to care for setting use to the chunk, first
      * */
-    T *getLocPtr() const {
-        if ( chunk->status != MEM_ALLOCATED_INUSE_WRITE ) {
-            waitForSwapin();
+    T *getLocPtr ( unsigned int segment = 0 ) const {
+        managedMemoryChunk &chunk = segmentChunk ( segment );
+        if ( chunk.status != MEM_ALLOCATED_INUSE_WRITE ) {
+            waitForSwapin ( segment );
         }
-        return ( T * ) chunk->locPtr;
+        return ( T * ) chunk.locPtr;
     }
 
-    /** @brief returns const local pointer to object
+    /** @brief returns const local pointer to object (or the first element of the given segment)
      *  @note when called, you have to care for setting use to the chunk, first
      * */
-    const T *getConstLocPtr() const {
-        if ( ! ( chunk->status & MEM_ALLOCATED_INUSE_READ ) ) {
-            waitForSwapin();
+    const T *getConstLocPtr ( unsigned int segment = 0 ) const {
+        managedMemoryChunk &chunk = segmentChunk ( segment );
+        if ( ! ( chunk.status & MEM_ALLOCATED_INUSE_READ ) ) {
+            waitForSwapin ( segment );
         }
-        return ( T * ) chunk->locPtr;
+        return ( T * ) chunk.locPtr;
     }
 
 private:
     managedMemoryChunk *chunk;
     unsigned int *tracker;
     unsigned int n_elem;
+    ///Chunks of the segments if split, NULL otherwise. chunk points to the first one.
+    managedMemoryChunk **segments = NULL;
+    ///Elements per segment, only meaningful if segmented
+    unsigned int segmentElems = 0;
+
+    inline unsigned int numSegments() const {
+        if ( n_elem == 0 ) {
+            return 0;
+        }
+        return segments ? ( n_elem + segmentElems - 1 ) / segmentElems : 1;
+    }
+    ///@brief returns the number of elements in segment, the last one may be shorter
+    inline unsigned int segmentElements ( unsigned int segment ) const {
+        return segment + 1 < numSegments() ? segmentElems : n_elem - segment * segmentElems;
+    }
+    inline managedMemoryChunk &segmentChunk ( unsigned int segment ) const {
+        return segments ? *segments[segment] : *chunk;
+    }
 
     ///@brief This function manages correct deallocation for array elements having a destructor
     template <class G>
     typename std::enable_if<std::is_class<G>::value>::type
     mDelete (  ) const {
         if ( n_elem > 0 ) {
-
-            setUse();
-            for ( unsigned int n = 0; n < n_elem; n++ ) {
-                ( ( ( G * ) chunk->locPtr ) + n )->~G();
+            for ( unsigned int s = 0; s < numSegments(); ++s ) {
+                setUse ( true, NULL, s );
+                G *loc = ( G * ) segmentChunk ( s ).locPtr;
+                for ( unsigned int n = 0; n < segmentElements ( s ); n++ ) {
+                    ( loc + n )->~G();
+                }
+                unsetUse ( 1, s );
+                managedMemory::defaultManager->mfree ( segmentChunk ( s ).id );
             }
-            unsetUse();
-            managedMemory::defaultManager->mfree ( chunk->id );
         }
+        delete[] segments;
         delete tracker;
     }
     ///@brief This function manages correct deallocation for array elements lacking a destructor
@@ -333,8 +492,11 @@ private:
     typename std::enable_if < !std::is_class<G>::value >::type
     mDelete (  ) {
         if ( n_elem > 0 ) {
-            managedMemory::defaultManager->mfree ( chunk->id );
+            for ( unsigned int s = 0; s < numSegments(); ++s ) {
+                managedMemory::defaultManager->mfree ( segmentChunk ( s ).id );
+            }
         }
+        delete[] segments;
         delete tracker;
     }
 
@@ -343,13 +505,14 @@ private:
      *  checking this in a save way would produce lots of overhead. Thus, it is better to wait
      *  indefinitely in this case, as under normal use, the chunk will become available.
     **/
-    void waitForSwapin() const {
+    void waitForSwapin ( unsigned int segment = 0 ) const {
+        managedMemoryChunk &chunk = segmentChunk ( segment );
         //While in this case, we are not the guy who actually enforce the swapin, we never the less have to wait
         //for the chunk to become ready. This is done in the following way:
-        if ( ! ( chunk->status & MEM_ALLOCATED ) ) { // We may savely check against this as use will be set by other adhereTo thread and cannot be undone as long as calling adhereTo exists
-            rambrain_pthread_mutex_lock ( &managedMemory::defaultManager->stateChangeMutex );
+        if ( ! ( chunk.status & MEM_ALLOCATED ) ) { // We may savely check against this as use will be set by other adhereTo thread and cannot be undone as long as calling adhereTo exists
+            managedMemory::lockStateChangeMutex();
             //We will burn a little bit of power here, eventually, but this is a very rare case.
-            while ( ! managedMemory::defaultManager->waitForSwapin ( *chunk, true ) ) {};
+            while ( ! managedMemory::defaultManager->waitForSwapin ( chunk, true ) ) {};
             rambrain_pthread_mutex_unlock ( &managedMemory::defaultManager->stateChangeMutex );
         }
     }
@@ -361,6 +524,14 @@ private:
     friend class adhereTo;
     template<class G>
     friend class adhereToConst;
+    template<class G>
+    friend class adhereToMany;
+    template<class G>
+    friend class asyncAdhereTo;
+    template<class G>
+    friend class inUse;
+    template<class G>
+    friend class useAwaiter;
 
     //Test classes
 #ifdef BUILD_TESTS
@@ -370,6 +541,12 @@ private:
     friend class ::managedFileSwap_Unit_SwapSingleIsland_Test;
     friend class ::managedFileSwap_Unit_SwapNextAndSingleIsland_Test;
     friend class ::adhereTo_Unit_TwiceAdheredOnceUsed_Test;
+    friend class ::adhereTo_Unit_ManyLoadsAllAtOnce_Test;
+    friend class ::adhereTo_Unit_ManyReadOnlyDuplicatesAndSegments_Test;
+    friend class ::adhereTo_Unit_ManyTooLarge_Test;
+    friend class ::adhereTo_Unit_AsyncDummySwap_Test;
+    friend class ::adhereTo_Unit_AsyncFileSwap_Test;
+    friend class ::cyclicManagedMemory_Unit_LabelBudgetWithoutPriority_Test;
 #endif
 };
 
@@ -389,14 +566,14 @@ class adhereTo
 {
 public:
     ///@brief copy constructor
-    adhereTo ( const adhereTo<T> &ref ) : data ( ref.data ) {
+    adhereTo ( const adhereTo<T> &ref ) : data ( ref.data ), segment ( ref.segment ), offset ( ref.offset ) {
         loadedReadable = ref.loadedReadable;
         loadedWritable = ref.loadedWritable;
         if ( loadedWritable ) {
-            data->setUse ( loadedWritable );
+            data->setUse ( true, NULL, segment );
         }
         if ( loadedReadable ) {
-            data->setUse ( loadedReadable );
+            data->setUse ( false, NULL, segment );
         }
     };
 
@@ -405,6 +582,9 @@ public:
      * \param data the managedPtr that is to be used in near future
     **/
     adhereTo ( const managedPtr<T> &data, bool loadImmediately = true ) : data ( &data ) {
+        if ( data.isSegmented() ) {
+            throw memoryException ( "Segmented managedPtr can only be adhered to by element range" );
+        }
         if ( loadImmediately && data.size() != 0 ) {
             data.prepareUse();
         }
@@ -414,23 +594,50 @@ public:
     /// Provides the same functionality as the other constructor but accepts a managedPtr pointer as argument. @see adhereTo ( const managedPtr<T> &data, bool loadImmediately = true )
     adhereTo ( const managedPtr<T> *data, bool loadImmediately = true ) : adhereTo ( *data, loadImmediately ) {};
 
+    /**@brief constructor fetching only the elements [begin, end) of data
+     * \param data the managedPtr that is to be used in near future
+     * \param begin first element needed
+     * \param end element behind the last one needed
+     * \param loadImmediately set this to false if you want to load the element when pulling the pointer and not beforehands
+     * @note pointers pulled from this object point to element begin
+     * @note if data is segmented, only the segment holding the range is loaded. Thus, the range must not cross a segment boundary, @see managedPtr::segmentLength()
+    **/
+    adhereTo ( const managedPtr<T> &data, unsigned int begin, unsigned int end, bool loadImmediately = true ) : data ( &data ) {
+        if ( begin >= end || end > data.size() ) {
+            throw memoryException ( "Element range to adhere to is empty or out of bounds" );
+        }
+        segment = begin / data.segmentLength();
+        if ( ( end - 1 ) / data.segmentLength() != segment ) {
+            throw memoryException ( "Element range to adhere to crosses a segment boundary" );
+        }
+        offset = begin - segment * data.segmentLength();
+        if ( loadImmediately ) {
+            data.prepareUse ( segment );
+        }
+    }
+
+    /// Provides the same functionality as the other range constructor but accepts a managedPtr pointer as argument. @see adhereTo ( const managedPtr<T> &data, unsigned int begin, unsigned int end, bool loadImmediately = true )
+    adhereTo ( const managedPtr<T> *data, unsigned int begin, unsigned int end, bool loadImmediately = true ) : adhereTo ( *data, begin, end, loadImmediately ) {};
+
     ///Simple assignment operator
     adhereTo<T> &operator= ( const adhereTo<T> &ref ) {
         if ( loadedReadable ) {
-            data->unsetUse();
+            data->unsetUse ( 1, segment );
         }
         if ( loadedWritable ) {
-            data->unsetUse();
+            data->unsetUse ( 1, segment );
         }
         this->data = ref.data;
+        segment = ref.segment;
+        offset = ref.offset;
         loadedReadable = ref.loadedReadable;
         loadedWritable = ref.loadedWritable;
 
         if ( loadedWritable ) {
-            data->setUse ( loadedWritable );
+            data->setUse ( true, NULL, segment );
         }
         if ( loadedReadable ) {
-            data->setUse ( loadedReadable );
+            data->setUse ( false, NULL, segment );
         }
         return *this;
     }
@@ -445,9 +652,9 @@ public:
             return NULL;
         }
         if ( !loadedReadable ) {
-            data->setUse ( false, &loadedReadable );
+            data->setUse ( false, &loadedReadable, segment );
         }
-        return data->getConstLocPtr();
+        return data->getConstLocPtr ( segment ) + offset;
     }
     ///@brief This operator can be used to pull the data to a non-const pointer. If you only read the data, pull the const version, as this saves execution time.
     operator  T *() {
@@ -455,20 +662,23 @@ public:
             return NULL;
         }
         if ( !loadedWritable ) {
-            data->setUse ( true, &loadedWritable );
+            data->setUse ( true, &loadedWritable, segment );
         }
-        return data->getLocPtr();
+        return data->getLocPtr ( segment ) + offset;
     }
     ///@brief destructor
     ~adhereTo() {
         unsigned char loaded = 0;
         loaded = ( loadedReadable ? 1 : 0 ) + ( loadedWritable ? 1 : 0 );
         if ( loaded > 0 && data->size() != 0 ) {
-            data->unsetUse ( loaded );
+            data->unsetUse ( loaded, segment );
         }
     }
 private:
     const managedPtr<T> *data;
+    ///Segment holding the adhered elements and index of the first one within, both zero unless adhered to by range
+    unsigned int segment = 0;
+    unsigned int offset = 0;
 
     mutable bool loadedWritable = false;
     mutable bool loadedReadable = false;
@@ -482,6 +692,193 @@ private:
 #endif
 };
 
+/**
+ * @brief Fetches the memory of several managedPtrs at once for actual usage.
+ *
+ * In contrast to one adhereTo per managedPtr, all chunks are protected in one step and the missing ones are requested from swap as a single batch.
+ * Thus, the scheduler does not swap out one of them while making room for the next. All elements of all managedPtrs are loaded, including all segments.
+ * \warning all managedPtrs together have to fit into memory
+ * \warning _thread-safety_
+ * * The object itself is not thread-safe
+ * * Do not pass pointers/references to this object over thread boundaries
+ * **/
+template <class T>
+class adhereToMany
+{
+public:
+    /**@brief constructor fetching the data of n managedPtrs
+     * \param data array of the managedPtrs that are to be used, the same managedPtr may be listed more than once
+     * \param n number of managedPtrs
+     * \param writable set this to false if the data will only be read
+    **/
+    adhereToMany ( const managedPtr<T> *const *data, unsigned int n, bool writable = true ) : writable ( writable ) {
+        for ( unsigned int p = 0; p < n; ++p ) {
+            add ( data[p] );
+        }
+        load();
+    }
+
+    /// Provides the same functionality as the other constructor but accepts a list of managedPtr pointers. @see adhereToMany ( const managedPtr<T> *const *data, unsigned int n, bool writable = true )
+    adhereToMany ( std::initializer_list<const managedPtr<T> *> data, bool writable = true ) : writable ( writable ) {
+        for ( const managedPtr<T> *ptr : data ) {
+            add ( ptr );
+        }
+        load();
+    }
+
+    adhereToMany ( const adhereToMany<T> &ref ) = delete;
+    adhereToMany<T> &operator= ( const adhereToMany<T> &ref ) = delete;
+
+    ///@brief destructor
+    ~adhereToMany() {
+        if ( !chunks.empty() ) {
+            managedMemory::defaultManager->unsetUse ( chunks.data(), chunks.size() );
+        }
+    }
+
+    ///@brief returns the number of managedPtrs adhered to
+    unsigned int size() const {
+        return ptrs.size();
+    }
+
+    /**@brief returns the local pointer to the elements of the n-th managedPtr (or the first element of the given segment)
+     * \note throws if adhered to read-only
+    **/
+    T *get ( unsigned int n, unsigned int segment = 0 ) {
+        if ( !writable ) {
+            throw memoryException ( "Can not pull writable pointer from read-only adhereToMany" );
+        }
+        return const_cast<T *> ( getConst ( n, segment ) );
+    }
+
+    ///@brief returns the const local pointer to the elements of the n-th managedPtr (or the first element of the given segment)
+    const T *getConst ( unsigned int n, unsigned int segment = 0 ) const {
+        if ( ptrs[n]->size() == 0 ) {
+            return NULL;
+        }
+        return ( const T * ) ptrs[n]->segmentChunk ( segment ).locPtr;
+    }
+
+    ///@brief Shorthand for get ( n ) @see get ( unsigned int n, unsigned int segment = 0 )
+    T *operator[] ( unsigned int n ) {
+        return get ( n );
+    }
+
+private:
+    void add ( const managedPtr<T> *ptr ) {
+        ptrs.push_back ( ptr );
+        if ( ptr->size() == 0 ) {
+            return;
+        }
+        for ( unsigned int s = 0; s < ptr->numSegments(); ++s ) {
+            chunks.push_back ( &ptr->segmentChunk ( s ) );
+        }
+    }
+
+    void load() {
+        if ( !chunks.empty() && !managedMemory::defaultManager->setUse ( chunks.data(), chunks.size(), writable ) ) {
+            chunks.clear();
+            throw memoryException ( "Could not adhere to managedPtrs" );
+        }
+    }
+
+    const bool writable;
+    std::vector<const managedPtr<T> *> ptrs;
+    ///Chunks of all segments of all managedPtrs, in use while we exist
+    std::vector<managedMemoryChunk *> chunks;
+};
+
+/**
+ * @brief Fetches the memory of a managedPtr without blocking the calling thread.
+ *
+ * The data is requested on construction. Whether it arrived can be polled by ready(), or a callback can be given which is called as soon as it did.
+ * Thus, task based code may schedule other work instead of waiting for swap. Pulling a pointer before the data is ready waits for it.
+ * \warning the callback may be called by a rambrain thread while rambrain is locked. It must not use rambrain objects but should only hand over to a scheduler.
+ * \warning _thread-safety_
+ * * The object itself is not thread-safe, apart from ready()
+ * * Do not pass pointers/references to this object over thread boundaries
+ * **/
+template <class T>
+class asyncAdhereTo
+{
+public:
+    /**@brief constructor requesting data
+     * \param data the managedPtr that is to be used in near future
+     * \param writable set this to false if the data will only be read
+     * \param onReady called once the data is resident, this may happen before the constructor returns
+    **/
+    asyncAdhereTo ( const managedPtr<T> &data, bool writable = true, std::function<void() > onReady = std::function<void() >() ) : data ( &data ), request ( *data.chunk, writable, onReady ) {
+        if ( data.isSegmented() ) {
+            throw memoryException ( "Segmented managedPtr can not be adhered to asynchronously" );
+        }
+        if ( data.size() == 0 ) {
+            request.ready = true;
+            if ( onReady ) {
+                onReady();
+            }
+            return;
+        }
+        if ( !managedMemory::defaultManager->setUseAsync ( request ) ) {
+            throw memoryException ( "Could not request managedPtr" );
+        }
+    }
+
+    asyncAdhereTo ( const asyncAdhereTo<T> &ref ) = delete;
+    asyncAdhereTo<T> &operator= ( const asyncAdhereTo<T> &ref ) = delete;
+
+    ///@brief destructor, withdraws the request if the data did not arrive yet
+    ~asyncAdhereTo() {
+        if ( data->size() != 0 && !managedMemory::defaultManager->cancelUseAsync ( request ) ) {
+            data->unsetUse ( 1 );
+        }
+    }
+
+    ///@brief returns whether the data is resident, does not block
+    bool ready() const {
+        return request.ready;
+    }
+
+    ///@brief blocks until the data is resident
+    void wait() {
+        managedMemory::defaultManager->waitForUse ( request );
+    }
+
+    ///@brief Pulls the data to a const pointer, waiting for it if necessary
+    operator const T *() {
+        wait();
+        return data->size() == 0 ? NULL : ( const T * ) data->chunk->locPtr;
+    }
+
+    ///@brief Pulls the data to a non-const pointer, waiting for it if necessary. Throws if requested read-only
+    operator T *() {
+        if ( !request.writeAccess ) {
+            throw memoryException ( "Can not pull writable pointer from read-only asyncAdhereTo" );
+        }
+        wait();
+        return data->size() == 0 ? NULL : ( T * ) data->chunk->locPtr;
+    }
+
+private:
+    const managedPtr<T> *data;
+    asyncUse request;
+};
+
+/** @brief adheres to ptrs[0], ..., ptrs[count - 1] in turn and calls f ( glue, i ) for each of them
+ *  While f works on one of them, the next one is already requested from swap. Containers walk their blocks in order this way.
+ *  @note pull the data from glue as const pointer if f only reads it
+ **/
+template <class T, class F>
+void adhereInTurn ( managedPtr<T> *const *ptrs, unsigned int count, F f )
+{
+    for ( unsigned int i = 0; i < count; ++i ) {
+        adhereTo<T> glue ( ptrs[i] );
+        if ( i + 1 < count ) {
+            ptrs[i + 1]->prepareUse();
+        }
+        f ( glue, i );
+    }
+}
+
 /** @brief this class marks a section as globally critical. Only one thread can process any section where such an object is generated.
  *
  * if called with locksByUser set to true, the user has to unlock the mutex manually calling unlock.
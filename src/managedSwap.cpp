@@ -43,11 +43,18 @@ void managedSwap::claimUsageof ( global_bytesize bytes, bool rambytes, bool used
     }
 }
 
-void managedSwap::waitForCleanExit()
+void managedSwap::waitForCleanExit ( bool lockHeld )
 {
     printf ( "\n" );
     while ( totalSwapActionsQueued != 0 ) {
+        //checkForAIO() releases the state lock while blocking, so we need it even if our caller does not hold it:
+        if ( !lockHeld ) {
+            managedMemory::lockStateChangeMutex();
+        }
         checkForAIO();
+        if ( !lockHeld ) {
+            rambrain_pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
+        }
         printf ( "waiting for aio to complete on %d objects\r", totalSwapActionsQueued );
     };
     printf ( "                                                       \r" );
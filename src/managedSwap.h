@@ -60,6 +60,15 @@ public:
      *  @note this function must be called having stateChangeMutex acquired.
      **/
     virtual void swapDelete ( managedMemoryChunk *chunk ) = 0;
+    /** @brief Resize a swapped out chunk without reading it back
+     *  @return success, the chunk is left untouched if false is returned
+     *  @note bytes beyond the former size are undefined afterwards
+     *  @note this is only called for chunks in status MEM_SWAPPED
+     *  @note this function must be called having stateChangeMutex acquired.
+     **/
+    virtual bool resize ( managedMemoryChunk *chunk, global_bytesize sizereq ) {
+        return false;
+    }
 
 
     /** @brief extend swap by policy
@@ -103,6 +112,10 @@ public:
         return oldPolicy;
     }
 
+    ///@brief returns the number of transfers submitted and not yet arrived
+    inline unsigned int getPendingSwapActions() const {
+        return totalSwapActionsQueued;
+    }
     ///Returns possible memory alignment restrictions
     inline size_t getMemoryAlignment() const {
         return memoryAlignment;
@@ -116,8 +129,9 @@ public:
     /** @brief Function waits for all asynchronous IO to complete.
       * The wait is implemented non-performant as a normal user does not have to wait for this.
       * Implementing this with a _cond just destroys performance in the respective swapIn/out procedures without increasing any user space functionality.
+      * @param lockHeld whether the caller holds stateChangeMutex, it is taken while waiting otherwise
       **/
-    void waitForCleanExit();
+    void waitForCleanExit ( bool lockHeld = false );
 
     virtual inline bool checkForAIO() {
         return false;
@@ -141,6 +155,27 @@ public:
      * @note this function must be called having stateChangeMutex acquired.
      **/
     virtual inline void invalidateCacheFor ( managedMemoryChunk &chunk ) {}
+    /** @brief writes a copy of the resident and unused chunk to swap while keeping it in ram.
+     *  If the chunk is not changed in the meantime, a later swapOut only has to free the ram.
+     *  @return number of bytes scheduled for writing
+     *  @note this function must be called having stateChangeMutex acquired.
+     **/
+    virtual inline global_bytesize writeBack ( managedMemoryChunk *chunk ) {
+        return 0;
+    }
+    /** @brief tells whether a writeBack of chunk is still in flight, so its ram must not be freed yet
+     * @note this function must be called having stateChangeMutex acquired.
+     **/
+    virtual inline bool writeBackPending ( const managedMemoryChunk &chunk ) const {
+        return false;
+    }
+    /** @brief tells whether a writeBack of chunk is in flight whose copy has been outdated by the user meanwhile.
+     *  swapOut can not take such a chunk before the copy arrived, schedulers should not select it.
+     * @note this function must be called having stateChangeMutex acquired.
+     **/
+    virtual inline bool writeBackOutdated ( const managedMemoryChunk &chunk ) const {
+        return false;
+    }
 
 protected:
     global_bytesize swapSize;
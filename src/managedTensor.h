@@ -0,0 +1,301 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MANAGEDTENSOR_H
+#define MANAGEDTENSOR_H
+
+#include "managedPtr.h"
+#include <array>
+#include <vector>
+#include <cmath>
+
+namespace rambrain
+{
+
+/**
+ * \brief Multidimensional array partitioned into rectangular tiles, each of them being a managedPtr of its own
+ *
+ * In contrast to managedPtr<T, dim>, which allocates a chunk per row, neighbouring elements along every dimension mostly
+ * share a chunk. Walking a column or working on a block thus touches few chunks instead of one per row.
+ * Tiles are numbered in row-major order of their position in the tile grid, elements inside a tile are stored row-major
+ * as well. Tiles at the upper border are clipped to the extents of the tensor.
+ *
+ * @note elements are constructed when their tile is allocated, thus T has to be default constructible
+ * @warning _thread-safety_
+ * * The object itself is not thread-safe
+ * **/
+template <class T, unsigned int dim>
+class managedTensor
+{
+public:
+    typedef std::array<unsigned int, dim> index;
+
+    /** @brief allocates all tiles of a tensor of the given extents
+     *  @param extents number of elements per dimension
+     *  @param tileShape number of elements per dimension of a tile, all zero chooses one by chooseTileShape()
+     **/
+    explicit managedTensor ( const index &extents, const index &tileShape = index() ) : ext ( extents ), shape ( tileShape ) {
+        bool choose = true;
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            if ( ext[d] == 0 ) {
+                throw memoryException ( "managedTensor needs at least one element per dimension" );
+            }
+            choose = choose && shape[d] == 0;
+        }
+        if ( choose ) {
+            shape = chooseTileShape ( ext );
+        }
+        n_tiles = 1;
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            if ( shape[d] == 0 || shape[d] > ext[d] ) {
+                throw memoryException ( "Tile shape does not fit into the extents of managedTensor" );
+            }
+            grid[d] = ( ext[d] + shape[d] - 1 ) / shape[d];
+            n_tiles *= grid[d];
+        }
+        if ( managedMemory::defaultManager->getSegmentSizeFor ( elements ( shape ) * sizeof ( T ) ) != 0 ) {
+            throw memoryException ( "Tile shape too large, tiles would be split by the memory manager" );
+        }
+
+        tilePtrs.reserve ( n_tiles );
+        for ( unsigned int t = 0; t < n_tiles; ++t ) {
+            tilePtrs.push_back ( new managedPtr<T> ( elements ( tileExtents ( t ) ) ) );
+        }
+    }
+
+    managedTensor ( const managedTensor<T, dim> &ref ) = delete;
+    managedTensor<T, dim> &operator= ( const managedTensor<T, dim> &ref ) = delete;
+
+    ~managedTensor() {
+        for ( managedPtr<T> *tile : tilePtrs ) {
+            delete tile;
+        }
+    }
+
+    /** @brief returns a tile shape of roughly tileBytes for a tensor of the given extents
+     *
+     *  The tile is chosen as close to a hypercube as the extents allow, so that it is equally cheap to walk the tensor along any dimension.
+     *  @param tileBytes bytes per tile, 0 chooses managedMemory::getDefaultBlockSize()
+     **/
+    static index chooseTileShape ( const index &extents, global_bytesize tileBytes = 0 ) {
+        if ( tileBytes == 0 ) {
+            tileBytes = managedMemory::defaultManager->getDefaultBlockSize();
+        }
+        global_bytesize budget = tileBytes < sizeof ( T ) ? 1 : tileBytes / sizeof ( T );
+
+        //Short dimensions are fit first, the budget they do not need goes to the longer ones:
+        std::array<unsigned int, dim> order;
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            order[d] = d;
+        }
+        for ( unsigned int a = 1; a < dim; ++a ) {
+            for ( unsigned int b = a; b > 0 && extents[order[b]] < extents[order[b - 1]]; --b ) {
+                std::swap ( order[b], order[b - 1] );
+            }
+        }
+
+        index result;
+        for ( unsigned int k = 0; k < dim; ++k ) {
+            const unsigned int d = order[k];
+            global_bytesize side = std::pow ( ( double ) budget, 1. / ( dim - k ) );
+            while ( side > 1 && std::pow ( ( double ) side, ( double ) ( dim - k ) ) > budget ) {
+                --side;
+            }
+            while ( std::pow ( ( double ) side + 1, ( double ) ( dim - k ) ) <= budget ) {
+                ++side;
+            }
+            side = side < 1 ? 1 : side;
+            result[d] = side > extents[d] ? extents[d] : side;
+            budget /= result[d];
+        }
+        return result;
+    }
+
+    /// @brief Simple getter
+    inline const index &extents() const {
+        return ext;
+    }
+    /// @brief Simple getter
+    inline const index &tileShape() const {
+        return shape;
+    }
+    /// @brief returns the number of tiles per dimension
+    inline const index &tileGrid() const {
+        return grid;
+    }
+    /// @brief returns the number of tiles
+    inline unsigned int tiles() const {
+        return n_tiles;
+    }
+    /// @brief returns the number of elements
+    inline size_t size() const {
+        return elements ( ext );
+    }
+
+    /** @brief returns the managedPtr of tile t for use with adhereTo
+     *  @note the tile holds tileExtents ( t ) elements per dimension, starting at tileOrigin ( t )
+     **/
+    inline const managedPtr<T> &tile ( unsigned int t ) const {
+        return *tilePtrs[t];
+    }
+    /// @brief returns the number of the tile at position pos of the tile grid
+    inline unsigned int tileAt ( const index &pos ) const {
+        unsigned int t = 0;
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            t = t * grid[d] + pos[d];
+        }
+        return t;
+    }
+    /// @brief returns the number of the tile holding element i
+    inline unsigned int tileOf ( const index &i ) const {
+        index pos;
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            pos[d] = i[d] / shape[d];
+        }
+        return tileAt ( pos );
+    }
+    /// @brief returns the index of the first element of tile t
+    index tileOrigin ( unsigned int t ) const {
+        index origin;
+        for ( unsigned int d = dim; d-- > 0; ) {
+            origin[d] = ( t % grid[d] ) * shape[d];
+            t /= grid[d];
+        }
+        return origin;
+    }
+    /// @brief returns the number of elements per dimension of tile t, smaller than tileShape() at the upper border
+    index tileExtents ( unsigned int t ) const {
+        index origin = tileOrigin ( t );
+        index result;
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            result[d] = ext[d] - origin[d] < shape[d] ? ext[d] - origin[d] : shape[d];
+        }
+        return result;
+    }
+    /// @brief returns the position of element i inside the data of its tile
+    size_t offsetInTile ( const index &i ) const {
+        const unsigned int t = tileOf ( i );
+        const index origin = tileOrigin ( t );
+        const index tileExt = tileExtents ( t );
+        size_t offset = 0;
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            offset = offset * tileExt[d] + ( i[d] - origin[d] );
+        }
+        return offset;
+    }
+
+    /** @brief returns a copy of element i
+     *  @note this adheres to the element's tile for each call, use forEachTile() for bulk access
+     **/
+    T at ( const index &i ) const {
+        checkIndex ( i );
+        const adhereTo<T> glue ( tilePtrs[tileOf ( i )] );
+        const T *loc = glue;
+        return loc[offsetInTile ( i )];
+    }
+
+    /** @brief sets element i to value
+     *  @note this adheres to the element's tile for each call, use forEachTile() for bulk access
+     **/
+    void set ( const index &i, const T &value ) {
+        checkIndex ( i );
+        adhereTo<T> glue ( tilePtrs[tileOf ( i )] );
+        T *loc = glue;
+        loc[offsetInTile ( i )] = value;
+    }
+
+    /** @brief requests all tiles intersecting the box [lower, upper) from swap without waiting for them
+     *  @return number of tiles requested
+     **/
+    unsigned int prefetch ( const index &lower, const index &upper ) const {
+        index first, last;
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            if ( lower[d] >= upper[d] || lower[d] >= ext[d] ) {
+                return 0;
+            }
+            first[d] = lower[d] / shape[d];
+            last[d] = ( ( upper[d] > ext[d] ? ext[d] : upper[d] ) - 1 ) / shape[d];
+        }
+        index pos = first;
+        unsigned int requested = 0;
+        while ( true ) {
+            tilePtrs[tileAt ( pos )]->prepareUse();
+            ++requested;
+            //Count pos up through the box of tiles, last dimension fastest:
+            unsigned int d = dim;
+            while ( d > 0 && pos[d - 1] == last[d - 1] ) {
+                pos[d - 1] = first[d - 1];
+                --d;
+            }
+            if ( d == 0 ) {
+                return requested;
+            }
+            ++pos[d - 1];
+        }
+    }
+
+    /** @brief calls f ( T *data, const index &origin, const index &tileExtents ) for every tile, in order
+     *  While f works on a tile, the next one is already requested from swap.
+     **/
+    template <class F>
+    void forEachTile ( F f ) {
+        adhereInTurn ( tilePtrs.data(), n_tiles, [&] ( adhereTo<T> &glue, unsigned int t ) {
+            T *loc = glue;
+            f ( loc, tileOrigin ( t ), tileExtents ( t ) );
+        } );
+    }
+
+    /** @brief calls f ( const T *data, const index &origin, const index &tileExtents ) for every tile, in order
+     *  @note read-only access, tiles having a copy in swap do not need to be written again when evicted
+     **/
+    template <class F>
+    void forEachTile ( F f ) const {
+        adhereInTurn ( tilePtrs.data(), n_tiles, [&] ( const adhereTo<T> &glue, unsigned int t ) {
+            const T *loc = glue;
+            f ( loc, tileOrigin ( t ), tileExtents ( t ) );
+        } );
+    }
+
+private:
+    std::vector<managedPtr<T> *> tilePtrs;
+    index ext;
+    index shape;
+    index grid;
+    unsigned int n_tiles;
+
+    static inline size_t elements ( const index &extents ) {
+        size_t n = 1;
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            n *= extents[d];
+        }
+        return n;
+    }
+
+    inline void checkIndex ( const index &i ) const {
+        for ( unsigned int d = 0; d < dim; ++d ) {
+            if ( i[d] >= ext[d] ) {
+                throw memoryException ( "Index out of range of managedTensor" );
+            }
+        }
+    }
+};
+
+}
+
+#endif
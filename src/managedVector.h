@@ -0,0 +1,245 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MANAGEDVECTOR_H
+#define MANAGEDVECTOR_H
+
+#include "managedPtr.h"
+#include <vector>
+#include <utility>
+
+namespace rambrain
+{
+
+/**
+ * \brief Growable array of elements stored in fixed-size, independently swappable segments
+ *
+ * Each segment is a managedPtr of its own, so growing never copies existing elements and the scheduler may swap out
+ * any segment not used at the moment. The segment at the end is kept adhered to, thus appending does not need to lock
+ * and the hot tail stays resident while the rest of the vector may go to swap.
+ *
+ * @note elements are constructed when their segment is allocated, thus T has to be default constructible
+ * @warning _thread-safety_
+ * * The object itself is not thread-safe
+ * **/
+template <class T>
+class managedVector
+{
+public:
+    /** @brief creates an empty vector
+     *  @param segmentLength number of elements per segment, 0 fills segments of managedMemory::getDefaultBlockSize()
+     **/
+    explicit managedVector ( unsigned int segmentLength = 0 ) : segLen ( segmentLength ) {
+        if ( segLen == 0 ) {
+            global_bytesize bytes = managedMemory::defaultManager->getDefaultBlockSize();
+            segLen = bytes < sizeof ( T ) ? 1 : bytes / sizeof ( T );
+        }
+        if ( managedMemory::defaultManager->getSegmentSizeFor ( segLen * sizeof ( T ) ) != 0 ) {
+            throw memoryException ( "Segment length too large, segments would be split by the memory manager" );
+        }
+    }
+
+    managedVector ( const managedVector<T> &ref ) = delete;
+    managedVector<T> &operator= ( const managedVector<T> &ref ) = delete;
+
+    ~managedVector() {
+        clear();
+    }
+
+    /// @brief Simple getter
+    inline size_t size() const {
+        return n_elem;
+    }
+    /// @brief Simple getter
+    inline bool empty() const {
+        return n_elem == 0;
+    }
+    /// @brief returns the number of elements that fit into the segments allocated so far
+    inline size_t capacity() const {
+        return ( size_t ) segments.size() * segLen;
+    }
+    /// @brief Simple getter
+    inline unsigned int segmentLength() const {
+        return segLen;
+    }
+    /// @brief returns the number of segments holding elements
+    inline unsigned int usedSegments() const {
+        return ( n_elem + segLen - 1 ) / segLen;
+    }
+    /** @brief returns the managedPtr of segment s for use with adhereTo
+     *  @note segment s holds the elements [s * segmentLength(), (s + 1) * segmentLength())
+     **/
+    inline const managedPtr<T> &segment ( unsigned int s ) const {
+        return *segments[s];
+    }
+
+    ///@brief appends a copy of value, allocating a new segment if the last one is full
+    void push_back ( const T &value ) {
+        appendSlot() = value;
+        ++n_elem;
+    }
+
+    ///@brief appends an element constructed from args
+    template <typename... ctor_args>
+    void emplace_back ( ctor_args &&... args ) {
+        appendSlot() = T ( std::forward<ctor_args> ( args )... );
+        ++n_elem;
+    }
+
+    ///@brief removes the last element, its segment is kept as capacity
+    void pop_back() {
+        if ( n_elem == 0 ) {
+            throw memoryException ( "Can not pop from empty managedVector" );
+        }
+        --n_elem;
+        pinTail ( n_elem / segLen ) [n_elem % segLen] = T();
+    }
+
+    ///@brief allocates segments until n elements fit
+    void reserve ( size_t n ) {
+        while ( capacity() < n ) {
+            segments.push_back ( new managedPtr<T> ( segLen ) );
+        }
+    }
+
+    ///@brief frees segments not holding any element
+    void shrink_to_fit() {
+        while ( segments.size() > usedSegments() ) {
+            if ( tailGlue && tailSegment == segments.size() - 1 ) {
+                releaseTail();
+            }
+            delete segments.back();
+            segments.pop_back();
+        }
+    }
+
+    ///@brief removes all elements and frees all segments
+    void clear() {
+        releaseTail();
+        for ( managedPtr<T> *seg : segments ) {
+            delete seg;
+        }
+        segments.clear();
+        n_elem = 0;
+    }
+
+    /** @brief returns a copy of element i
+     *  @note this adheres to the element's segment for each call, use forEachSegment() for bulk access
+     **/
+    T at ( size_t i ) const {
+        checkIndex ( i );
+        unsigned int s = i / segLen;
+        if ( tailGlue && tailSegment == s ) {
+            return tail[i % segLen];
+        }
+        const adhereTo<T> glue ( segments[s] );
+        const T *loc = glue;
+        return loc[i % segLen];
+    }
+
+    /** @brief sets element i to value
+     *  @note this adheres to the element's segment for each call, use forEachSegment() for bulk access
+     **/
+    void set ( size_t i, const T &value ) {
+        checkIndex ( i );
+        unsigned int s = i / segLen;
+        if ( tailGlue && tailSegment == s ) {
+            tail[i % segLen] = value;
+            return;
+        }
+        adhereTo<T> glue ( segments[s] );
+        T *loc = glue;
+        loc[i % segLen] = value;
+    }
+
+    /** @brief calls f ( T *data, unsigned int count, size_t firstIndex ) for every segment holding elements, in order
+     *  While f works on a segment, the next one is already requested from swap.
+     **/
+    template <class F>
+    void forEachSegment ( F f ) {
+        adhereInTurn ( segments.data(), usedSegments(), [&] ( adhereTo<T> &glue, unsigned int s ) {
+            size_t first = ( size_t ) s * segLen;
+            T *loc = tailGlue && tailSegment == s ? tail : ( T * ) glue;
+            f ( loc, n_elem - first < segLen ? ( unsigned int ) ( n_elem - first ) : segLen, first );
+        } );
+    }
+
+    /** @brief calls f ( const T *data, unsigned int count, size_t firstIndex ) for every segment holding elements, in order
+     *  @note read-only access, segments having a copy in swap do not need to be written again when evicted
+     **/
+    template <class F>
+    void forEachSegment ( F f ) const {
+        adhereInTurn ( segments.data(), usedSegments(), [&] ( const adhereTo<T> &glue, unsigned int s ) {
+            size_t first = ( size_t ) s * segLen;
+            const T *loc = tailGlue && tailSegment == s ? tail : ( const T * ) glue;
+            f ( loc, n_elem - first < segLen ? ( unsigned int ) ( n_elem - first ) : segLen, first );
+        } );
+    }
+
+    /** @brief lets go of the segment kept resident for appending
+     *  @note the next append will adhere to it again
+     **/
+    void releaseTail() {
+        if ( tailGlue ) {
+            delete tailGlue;
+            tailGlue = NULL;
+            tail = NULL;
+        }
+    }
+
+private:
+    std::vector<managedPtr<T> *> segments;
+    unsigned int segLen;
+    size_t n_elem = 0;
+
+    ///Adherence to the segment appended to, along with its local pointer
+    adhereTo<T> *tailGlue = NULL;
+    T *tail = NULL;
+    unsigned int tailSegment = 0;
+
+    inline void checkIndex ( size_t i ) const {
+        if ( i >= n_elem ) {
+            throw memoryException ( "Index out of range of managedVector" );
+        }
+    }
+
+    ///@brief returns the local pointer of segment s, keeping it adhered to until another segment is pinned
+    T *pinTail ( unsigned int s ) {
+        if ( tailGlue && tailSegment == s ) {
+            return tail;
+        }
+        releaseTail();
+        tailGlue = new adhereTo<T> ( segments[s] );
+        tail = *tailGlue;
+        tailSegment = s;
+        return tail;
+    }
+
+    ///@brief returns the slot behind the last element
+    T &appendSlot() {
+        if ( n_elem == capacity() ) {
+            segments.push_back ( new managedPtr<T> ( segLen ) );
+        }
+        return pinTail ( n_elem / segLen ) [n_elem % segLen];
+    }
+};
+
+}
+
+#endif
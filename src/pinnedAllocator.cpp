@@ -0,0 +1,211 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pinnedAllocator.h"
+#include "exceptions.h"
+#include <vector>
+
+namespace rambrain
+{
+
+pinnedMemoryResource::pinnedMemoryResource ( global_bytesize threshold, std::pmr::memory_resource *upstream ) : threshold ( threshold ), upstream ( upstream )
+{
+}
+
+pinnedMemoryResource::~pinnedMemoryResource()
+{
+    if ( !buffers.empty() ) {
+        warnmsgf ( "%lu buffers have not been deallocated before their memory resource, leaving them to the memory manager", buffers.size() );
+    }
+}
+
+pinnedMemoryResource *pinnedMemoryResource::defaultResource()
+{
+    static pinnedMemoryResource resource;
+    return &resource;
+}
+
+void *pinnedMemoryResource::do_allocate ( size_t bytes, size_t alignment )
+{
+    if ( bytes < threshold ) {
+        return upstream->allocate ( bytes, alignment );
+    }
+    //Chunks with fixed location start at a page boundary:
+    if ( alignment > 4 * kib ) {
+        throw memoryException ( "Alignment requested from pinnedMemoryResource is larger than a page" );
+    }
+    managedMemoryChunk *chunk = managedMemory::defaultManager->mmalloc ( bytes, true );
+    managedMemory::defaultManager->setUse ( *chunk, true );
+
+    rambrain_pthread_mutex_lock ( &lock );
+    buffers[ ( const char * ) chunk->locPtr] = buffer{chunk, true, false};
+    rambrain_pthread_mutex_unlock ( &lock );
+    return chunk->locPtr;
+}
+
+void pinnedMemoryResource::do_deallocate ( void *p, size_t bytes, size_t alignment )
+{
+    if ( bytes < threshold ) {
+        upstream->deallocate ( p, bytes, alignment );
+        return;
+    }
+    rambrain_pthread_mutex_lock ( &lock );
+    auto it = buffers.find ( ( const char * ) p );
+    if ( it == buffers.end() ) {
+        rambrain_pthread_mutex_unlock ( &lock );
+        throw memoryException ( "Deallocating memory not allocated by this pinnedMemoryResource" );
+    }
+    buffer buf = it->second;
+    buffers.erase ( it );
+    rambrain_pthread_mutex_unlock ( &lock );
+
+    if ( buf.pinned ) {
+        managedMemory::defaultManager->unsetUse ( *buf.chunk );
+    }
+    managedMemory::defaultManager->mfree ( buf.chunk->id );
+}
+
+bool pinnedMemoryResource::do_is_equal ( const std::pmr::memory_resource &other ) const noexcept
+{
+    return this == &other;
+}
+
+pinnedMemoryResource::buffer *pinnedMemoryResource::find ( const void *p, const char **start )
+{
+    auto it = buffers.upper_bound ( ( const char * ) p );
+    if ( it == buffers.begin() ) {
+        return NULL;
+    }
+    --it;
+    if ( ( const char * ) p >= it->first + it->second.chunk->size ) {
+        return NULL;
+    }
+    if ( start ) {
+        *start = it->first;
+    }
+    return &it->second;
+}
+
+void pinnedMemoryResource::finishPinning ( const std::vector<const char *> &keys, bool pinned )
+{
+    for ( const char *key : keys ) {
+        auto it = buffers.find ( key );
+        if ( it != buffers.end() ) {
+            it->second.pinning = false;
+            it->second.pinned = pinned;
+        }
+    }
+}
+
+bool pinnedMemoryResource::unpin ( const void *p )
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    buffer *buf = find ( p );
+    if ( !buf || !buf->pinned ) {
+        rambrain_pthread_mutex_unlock ( &lock );
+        return false;
+    }
+    buf->pinned = false;
+    managedMemory::defaultManager->unsetUse ( *buf->chunk );
+    rambrain_pthread_mutex_unlock ( &lock );
+    return true;
+}
+
+bool pinnedMemoryResource::pin ( const void *p )
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    const char *start;
+    buffer *buf = find ( p, &start );
+    if ( !buf || buf->pinned || buf->pinning ) {
+        rambrain_pthread_mutex_unlock ( &lock );
+        return false;
+    }
+    //The buffer only counts as pinned once we hold the use, so that unpin() can not release a use we do not have yet:
+    buf->pinning = true;
+    managedMemoryChunk *chunk = buf->chunk;
+    //While unpinned, the chunk may be swapped out and have no location, so we remember the buffer by its key:
+    std::vector<const char *> keys ( 1, start );
+    rambrain_pthread_mutex_unlock ( &lock );
+    //Swapping in may wait for other threads to unpin:
+    bool used = managedMemory::defaultManager->setUse ( *chunk, true );
+    rambrain_pthread_mutex_lock ( &lock );
+    finishPinning ( keys, used );
+    rambrain_pthread_mutex_unlock ( &lock );
+    return used;
+}
+
+void pinnedMemoryResource::unpinAll()
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    for ( auto &it : buffers ) {
+        if ( it.second.pinned ) {
+            it.second.pinned = false;
+            managedMemory::defaultManager->unsetUse ( *it.second.chunk );
+        }
+    }
+    rambrain_pthread_mutex_unlock ( &lock );
+}
+
+void pinnedMemoryResource::pinAll()
+{
+    std::vector<managedMemoryChunk *> chunks;
+    std::vector<const char *> keys;
+    rambrain_pthread_mutex_lock ( &lock );
+    for ( auto &it : buffers ) {
+        if ( !it.second.pinned && !it.second.pinning ) {
+            it.second.pinning = true;
+            chunks.push_back ( it.second.chunk );
+            keys.push_back ( it.first );
+        }
+    }
+    rambrain_pthread_mutex_unlock ( &lock );
+    //Request all buffers first, so that they are read in parallel:
+    for ( managedMemoryChunk *chunk : chunks ) {
+        managedMemory::defaultManager->prepareUse ( *chunk );
+    }
+    std::vector<const char *> failed;
+    for ( size_t n = 0; n < chunks.size(); ++n ) {
+        if ( !managedMemory::defaultManager->setUse ( *chunks[n], true ) ) {
+            failed.push_back ( keys[n] );
+        }
+    }
+    rambrain_pthread_mutex_lock ( &lock );
+    finishPinning ( keys, true );
+    finishPinning ( failed, false );
+    rambrain_pthread_mutex_unlock ( &lock );
+}
+
+bool pinnedMemoryResource::isPinned ( const void *p ) const
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    buffer *buf = const_cast<pinnedMemoryResource *> ( this )->find ( p );
+    bool pinned = buf && buf->pinned;
+    rambrain_pthread_mutex_unlock ( &lock );
+    return pinned;
+}
+
+size_t pinnedMemoryResource::managedBuffers() const
+{
+    rambrain_pthread_mutex_lock ( &lock );
+    size_t n = buffers.size();
+    rambrain_pthread_mutex_unlock ( &lock );
+    return n;
+}
+
+}
@@ -0,0 +1,138 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PINNEDALLOCATOR_H
+#define PINNEDALLOCATOR_H
+
+#include "managedMemory.h"
+#include <memory_resource>
+#include <map>
+#include <pthread.h>
+#include <stddef.h>
+
+namespace rambrain
+{
+
+/** @brief std::pmr::memory_resource handing out rambrain managed memory to unmodified containers
+ *
+ *  Containers keep raw pointers to their buffers, thus allocations are done as chunks with a fixed location ( see managedMemory::mmalloc() ),
+ *  which keep their address when swapped out and in again. A buffer is pinned while allocated, that is the scheduler will not swap it out.
+ *  Between phases of a computation, buffers that will not be touched for a while can be unpinned to make them candidates for swapping
+ *  and pinned again before their container is used next.
+ *
+ *  Allocations smaller than a threshold are handed to an upstream resource, as a chunk always takes whole pages.
+ *  @warning a container must not be touched while its buffer is unpinned, this includes destructors of elements. Accessing a swapped out buffer faults.
+ *  @note _thread-safety_: allocating, pinning and unpinning may be done from different threads
+ **/
+class RAMBRAINAPI pinnedMemoryResource : public std::pmr::memory_resource
+{
+public:
+    /** @param threshold allocations of less bytes are passed to upstream
+     *  @param upstream resource for small allocations
+     **/
+    pinnedMemoryResource ( global_bytesize threshold = 64 * kib, std::pmr::memory_resource *upstream = std::pmr::get_default_resource() );
+    ~pinnedMemoryResource();
+
+    pinnedMemoryResource ( const pinnedMemoryResource &ref ) = delete;
+    pinnedMemoryResource &operator= ( const pinnedMemoryResource &ref ) = delete;
+
+    /** @brief allows the buffer containing p to be swapped out
+     *  @return false if p does not belong to a buffer of this resource or it was unpinned already
+     **/
+    bool unpin ( const void *p );
+    /** @brief swaps in the buffer containing p, if needed, and keeps it resident until unpinned again
+     *  @return false if p does not belong to a buffer of this resource, it was pinned already or another thread is pinning it
+     **/
+    bool pin ( const void *p );
+    ///@brief unpins all buffers
+    void unpinAll();
+    ///@brief pins all buffers, swapping in those swapped out
+    void pinAll();
+    ///@brief returns whether p belongs to a buffer of this resource which is pinned
+    bool isPinned ( const void *p ) const;
+    ///@brief returns the number of buffers managed by rambrain
+    size_t managedBuffers() const;
+
+    ///@brief the resource used by default constructed pinned_allocators
+    static pinnedMemoryResource *defaultResource();
+
+protected:
+    void *do_allocate ( size_t bytes, size_t alignment ) override;
+    void do_deallocate ( void *p, size_t bytes, size_t alignment ) override;
+    bool do_is_equal ( const std::pmr::memory_resource &other ) const noexcept override;
+
+private:
+    struct buffer {
+        managedMemoryChunk *chunk;
+        bool pinned;
+        ///set while pin() or pinAll() wait for the chunk outside of lock, the buffer counts as unpinned meanwhile
+        bool pinning;
+    };
+
+    ///@brief returns the buffer containing p or NULL and its start address in start, if given, lock has to be held
+    buffer *find ( const void *p, const char **start = NULL );
+    ///@brief ends the pinning transition of the buffers starting at keys, lock has to be held
+    void finishPinning ( const std::vector<const char *> &keys, bool pinned );
+
+    const global_bytesize threshold;
+    std::pmr::memory_resource *const upstream;
+    ///All buffers managed by rambrain, keyed by their start address
+    std::map<const char *, buffer> buffers;
+    mutable pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+};
+
+/** @brief std-compatible allocator allocating through a pinnedMemoryResource
+ *  @see pinnedMemoryResource
+ **/
+template <class T>
+class pinned_allocator
+{
+public:
+    typedef T value_type;
+
+    pinned_allocator() noexcept : resource ( pinnedMemoryResource::defaultResource() ) {}
+    explicit pinned_allocator ( pinnedMemoryResource *resource ) noexcept : resource ( resource ) {}
+    template <class U>
+    pinned_allocator ( const pinned_allocator<U> &ref ) noexcept : resource ( ref.resource ) {}
+
+    T *allocate ( size_t n ) {
+        return ( T * ) resource->allocate ( n * sizeof ( T ), alignof ( T ) );
+    }
+    void deallocate ( T *p, size_t n ) {
+        resource->deallocate ( p, n * sizeof ( T ), alignof ( T ) );
+    }
+
+    pinnedMemoryResource *resource;
+};
+
+template <class T, class U>
+bool operator== ( const pinned_allocator<T> &a, const pinned_allocator<U> &b )
+{
+    return a.resource == b.resource;
+}
+
+template <class T, class U>
+bool operator!= ( const pinned_allocator<T> &a, const pinned_allocator<U> &b )
+{
+    return a.resource != b.resource;
+}
+
+}
+
+#endif
@@ -75,14 +75,28 @@ void rambrainConfig::init ()
     if ( c.swap.value == "managedDummySwap" ) {
         swap = new managedDummySwap ( c.swapMemory.value );
     } else if ( c.swap.value == "managedFileSwap" ) {
-        swap = new managedFileSwap ( c.swapMemory.value, c.swapfiles.value.c_str(), 0, c.enableDMA.value );
-        swap->setSwapPolicy ( c.policy.value );
+        managedFileSwap *fileSwap = new managedFileSwap ( c.swapMemory.value, c.swapfiles.value.c_str(), 0, c.enableDMA.value );
+        fileSwap->setSwapPolicy ( c.policy.value );
+        fileSwap->setDirtyTracking ( c.dirtyTracking.value );
+        swap = fileSwap;
     }
 
     if ( c.memoryManager.value == "dummyManagedMemory" ) {
         manager = new dummyManagedMemory ( );
     } else if ( c.memoryManager.value == "cyclicManagedMemory" ) {
-        manager = new cyclicManagedMemory ( swap, c.memory.value );
+        cyclicManagedMemory *cyclic = new cyclicManagedMemory ( swap, c.memory.value );
+        cyclic->setSwapFractionBounds ( c.swapInFracMin.value, c.swapInFracMax.value, c.swapOutFracMin.value, c.swapOutFracMax.value );
+        cyclic->setPreemptiveTurnoffFraction ( c.preemptiveTurnoffFraction.value );
+        cyclic->setAdaptivePreemption ( c.adaptivePreemption.value );
+        cyclic->setReclaimWatermarks ( c.reclaimLowWatermark.value, c.reclaimHighWatermark.value );
+        cyclic->setWriteBackRate ( c.writeBackRate.value );
+        cyclic->setSegmentSize ( c.segmentSize.value );
+        cyclic->setBackgroundReclaim ( c.backgroundReclaim.value );
+        manager = cyclic;
+    }
+    manager->setPinFraction ( c.pinFraction.value );
+    for ( const labelPolicyConfig &policy : c.labelPolicies.value ) {
+        manager->setLabelPolicy ( policy.label.c_str(), policy.budget, policy.priority );
     }
 }
 
@@ -73,6 +73,9 @@ string regexMatcher::createRegexMatching ( int type ) const
     if ( type & swapfilename ) {
         string ant = "[\\/\\.0-9a-zA-Z-_\\\\]";
         ss << "~?" << ant << "+\\%d" << ant << "*\\%d" << ant << "*";
+    } else if ( type & labelpolicies ) {
+        string policy = "[0-9a-zA-Z_\\.-]+:[0-9]+\\.?\\d*\\s*[a-zA-Z]*:-?\\d+";
+        ss << policy << "(?:\\s*,\\s*" << policy << ")*";
     } else {
         if ( type & boolean ) {
             ss  << "true|True|TRUE|false|False|FALSE";
@@ -48,7 +48,8 @@ public:
         text = 1 << 3,
         alphanumtext = 1 << 4,
         boolean = 1 << 5,
-        swapfilename = 1 << 6 /// @note not flaggy
+        swapfilename = 1 << 6, /// @note not flaggy
+        labelpolicies = 1 << 7 /// @note not flaggy
     };
 
     /**
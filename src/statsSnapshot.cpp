@@ -0,0 +1,425 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "statsSnapshot.h"
+#include "managedSwap.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <stdio.h>
+
+namespace rambrain
+{
+
+///Names of the stalls in serialized snapshots, indexed by managedMemory::latencyStat
+static const char *latencyKeys[managedMemory::LATENCY_STATS] = {"swapin_wait", "swapout_wait", "ensure_space", "aio", "state_lock"};
+
+rambrainStats statsSnapshot ( managedMemory *manager )
+{
+    rambrainStats stats;
+    stats.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::system_clock::now().time_since_epoch() ).count();
+    if ( manager == NULL ) {
+        return stats;
+    }
+#ifdef SWAPSTATS
+    stats.swapstats = true;
+#endif
+
+    managedMemory::lockStateChangeMutex();
+    stats.memory.limit = manager->memory_max;
+    stats.memory.used = manager->memory_used;
+    stats.memory.swapped = manager->memory_swapped;
+    stats.memory.tobefreed = manager->memory_tobefreed;
+    stats.memory.chunks = manager->memChunks.size();
+    stats.memory.pinned = manager->pinned_bytes;
+#ifdef SWAPSTATS
+    stats.counters.swapouts = manager->n_swap_out;
+    stats.counters.swapins = manager->n_swap_in;
+    stats.counters.swapout_scheduled_bytes = manager->swap_out_scheduled_bytes;
+    stats.counters.swapin_scheduled_bytes = manager->swap_in_scheduled_bytes;
+    stats.counters.swapout_bytes = manager->swap_out_bytes;
+    stats.counters.swapin_bytes = manager->swap_in_bytes;
+    stats.counters.hits = manager->swap_hits;
+    stats.counters.misses = manager->swap_misses;
+    stats.counters.background_reclaims = manager->n_background_reclaim;
+    stats.counters.background_reclaim_bytes = manager->background_reclaim_bytes;
+    stats.counters.writeback_bytes = manager->writeback_bytes;
+    stats.counters.writeback_wasted_bytes = manager->writeback_wasted_bytes;
+    stats.counters.clean_evictions = manager->n_clean_evictions;
+    stats.counters.clean_eviction_bytes = manager->clean_eviction_bytes;
+    stats.counters.partial_swapout_saved_bytes = manager->partial_swapout_saved_bytes;
+    stats.counters.swapped_reallocs = manager->n_swapped_reallocs;
+    stats.counters.resident_reallocs = manager->n_resident_reallocs;
+#endif
+    manager->reportSchedulerStats ( stats );
+    if ( manager->swap ) {
+        stats.swap.size = manager->swap->getSwapSize();
+        stats.swap.used = manager->swap->getUsedSwap();
+        stats.swap.free = manager->swap->getFreeSwap();
+        stats.swap.pending_transfers = manager->swap->getPendingSwapActions();
+    }
+    rambrain_pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
+
+#ifdef SWAPSTATS
+    for ( int l = 0; l < managedMemory::LATENCY_STATS; ++l ) {
+        stats.latencies[l] = manager->getLatency ( ( managedMemory::latencyStat ) l );
+    }
+#endif
+    return stats;
+}
+
+///Appends JSON members, keeping track of the separating commas
+class jsonWriter
+{
+public:
+    void open ( const char *key ) {
+        separate();
+        if ( key ) {
+            out += "\"";
+            out += key;
+            out += "\":";
+        }
+        out += "{";
+        first = true;
+    }
+    void close() {
+        out += "}";
+        first = false;
+    }
+    void field ( const char *key, uint64_t value ) {
+        char tmp[32];
+        snprintf ( tmp, 32, "%llu", ( unsigned long long ) value );
+        raw ( key, tmp );
+    }
+    void field ( const char *key, int64_t value ) {
+        char tmp[32];
+        snprintf ( tmp, 32, "%lld", ( long long ) value );
+        raw ( key, tmp );
+    }
+    void field ( const char *key, double value ) {
+        char tmp[32];
+        snprintf ( tmp, 32, "%.9g", value );
+        raw ( key, tmp );
+    }
+    void field ( const char *key, bool value ) {
+        raw ( key, value ? "true" : "false" );
+    }
+
+    std::string out;
+
+private:
+    void separate() {
+        if ( !first ) {
+            out += ",";
+        }
+        first = false;
+    }
+    void raw ( const char *key, const char *value ) {
+        separate();
+        out += "\"";
+        out += key;
+        out += "\":";
+        out += value;
+    }
+
+    bool first = true;
+};
+
+std::string statsToJson ( const rambrainStats &stats )
+{
+    jsonWriter json;
+    json.open ( NULL );
+    json.field ( "version", ( uint64_t ) stats.version );
+    json.field ( "timestamp", stats.timestamp );
+    json.field ( "swapstats", stats.swapstats );
+
+    json.open ( "memory" );
+    json.field ( "limit", stats.memory.limit );
+    json.field ( "used", stats.memory.used );
+    json.field ( "swapped", stats.memory.swapped );
+    json.field ( "tobefreed", stats.memory.tobefreed );
+    json.field ( "chunks", stats.memory.chunks );
+    json.field ( "pinned", stats.memory.pinned );
+    json.close();
+
+    json.open ( "counters" );
+    json.field ( "swapouts", stats.counters.swapouts );
+    json.field ( "swapins", stats.counters.swapins );
+    json.field ( "swapout_scheduled_bytes", stats.counters.swapout_scheduled_bytes );
+    json.field ( "swapin_scheduled_bytes", stats.counters.swapin_scheduled_bytes );
+    json.field ( "swapout_bytes", stats.counters.swapout_bytes );
+    json.field ( "swapin_bytes", stats.counters.swapin_bytes );
+    json.field ( "hits", stats.counters.hits );
+    json.field ( "misses", stats.counters.misses );
+    json.field ( "background_reclaims", stats.counters.background_reclaims );
+    json.field ( "background_reclaim_bytes", stats.counters.background_reclaim_bytes );
+    json.field ( "writeback_bytes", stats.counters.writeback_bytes );
+    json.field ( "writeback_wasted_bytes", stats.counters.writeback_wasted_bytes );
+    json.field ( "clean_evictions", stats.counters.clean_evictions );
+    json.field ( "clean_eviction_bytes", stats.counters.clean_eviction_bytes );
+    json.field ( "partial_swapout_saved_bytes", stats.counters.partial_swapout_saved_bytes );
+    json.field ( "swapped_reallocs", stats.counters.swapped_reallocs );
+    json.field ( "resident_reallocs", stats.counters.resident_reallocs );
+    json.close();
+
+    json.open ( "scheduler" );
+    json.field ( "preemptive_bytes", stats.scheduler.preemptive_bytes );
+    json.field ( "preemptive_hit_bytes", stats.scheduler.preemptive_hit_bytes );
+    json.field ( "preemptive_waste_bytes", stats.scheduler.preemptive_waste_bytes );
+    json.field ( "misses", stats.scheduler.misses );
+    json.field ( "miss_latency", stats.scheduler.miss_latency );
+    json.field ( "swapin_frac", stats.scheduler.swapin_frac );
+    json.field ( "swapout_frac", stats.scheduler.swapout_frac );
+    json.field ( "adaptations", stats.scheduler.adaptations );
+    json.close();
+
+    json.open ( "swap" );
+    json.field ( "size", stats.swap.size );
+    json.field ( "used", stats.swap.used );
+    json.field ( "free", stats.swap.free );
+    json.field ( "pending_transfers", stats.swap.pending_transfers );
+    json.close();
+
+    json.open ( "latencies" );
+    for ( int l = 0; l < managedMemory::LATENCY_STATS; ++l ) {
+        json.open ( latencyKeys[l] );
+        json.field ( "count", stats.latencies[l].count );
+        json.field ( "sum", stats.latencies[l].sum );
+        json.field ( "p50", stats.latencies[l].p50 );
+        json.field ( "p90", stats.latencies[l].p90 );
+        json.field ( "p99", stats.latencies[l].p99 );
+        json.field ( "max", stats.latencies[l].max );
+        json.close();
+    }
+    json.close();
+
+    json.close();
+    return json.out;
+}
+
+///Appends a metric in text exposition format, with its type line if type is given
+static void metric ( std::string &out, const char *type, const char *name, const char *labels, double value )
+{
+    char tmp[256];
+    if ( type ) {
+        snprintf ( tmp, 256, "# TYPE rambrain_%s %s\n", name, type );
+        out += tmp;
+    }
+    snprintf ( tmp, 256, "rambrain_%s%s %.17g\n", name, labels, value );
+    out += tmp;
+}
+
+std::string statsToText ( const rambrainStats &stats )
+{
+    std::string out;
+    metric ( out, "gauge", "stats_version", "", stats.version );
+    metric ( out, "gauge", "memory_limit_bytes", "", stats.memory.limit );
+    metric ( out, "gauge", "memory_used_bytes", "", stats.memory.used );
+    metric ( out, "gauge", "memory_swapped_bytes", "", stats.memory.swapped );
+    metric ( out, "gauge", "memory_tobefreed_bytes", "", stats.memory.tobefreed );
+    metric ( out, "gauge", "memory_chunks", "", stats.memory.chunks );
+    metric ( out, "gauge", "memory_pinned_bytes", "", stats.memory.pinned );
+
+    if ( stats.swapstats ) {
+        metric ( out, "counter", "swapouts_total", "", stats.counters.swapouts );
+        metric ( out, "counter", "swapins_total", "", stats.counters.swapins );
+        metric ( out, "counter", "swapout_scheduled_bytes_total", "", stats.counters.swapout_scheduled_bytes );
+        metric ( out, "counter", "swapin_scheduled_bytes_total", "", stats.counters.swapin_scheduled_bytes );
+        metric ( out, "counter", "swapout_bytes_total", "", stats.counters.swapout_bytes );
+        metric ( out, "counter", "swapin_bytes_total", "", stats.counters.swapin_bytes );
+        metric ( out, "counter", "hits_total", "", stats.counters.hits );
+        metric ( out, "counter", "misses_total", "", stats.counters.misses );
+        metric ( out, "counter", "background_reclaims_total", "", stats.counters.background_reclaims );
+        metric ( out, "counter", "background_reclaim_bytes_total", "", stats.counters.background_reclaim_bytes );
+        metric ( out, "counter", "writeback_bytes_total", "", stats.counters.writeback_bytes );
+        metric ( out, "counter", "writeback_wasted_bytes_total", "", stats.counters.writeback_wasted_bytes );
+        metric ( out, "counter", "clean_evictions_total", "", stats.counters.clean_evictions );
+        metric ( out, "counter", "clean_eviction_bytes_total", "", stats.counters.clean_eviction_bytes );
+        metric ( out, "counter", "partial_swapout_saved_bytes_total", "", stats.counters.partial_swapout_saved_bytes );
+        metric ( out, "counter", "swapped_reallocs_total", "", stats.counters.swapped_reallocs );
+        metric ( out, "counter", "resident_reallocs_total", "", stats.counters.resident_reallocs );
+    }
+
+    metric ( out, "gauge", "preemptive_bytes", "", stats.scheduler.preemptive_bytes );
+    metric ( out, "counter", "preemptive_hit_bytes_total", "", stats.scheduler.preemptive_hit_bytes );
+    metric ( out, "counter", "preemptive_waste_bytes_total", "", stats.scheduler.preemptive_waste_bytes );
+    metric ( out, "counter", "scheduler_misses_total", "", stats.scheduler.misses );
+    metric ( out, "counter", "scheduler_miss_seconds_total", "", stats.scheduler.miss_latency );
+    metric ( out, "gauge", "swapin_frac", "", stats.scheduler.swapin_frac );
+    metric ( out, "gauge", "swapout_frac", "", stats.scheduler.swapout_frac );
+    metric ( out, "counter", "adaptations_total", "", stats.scheduler.adaptations );
+
+    metric ( out, "gauge", "swap_size_bytes", "", stats.swap.size );
+    metric ( out, "gauge", "swap_used_bytes", "", stats.swap.used );
+    metric ( out, "gauge", "swap_free_bytes", "", stats.swap.free );
+    metric ( out, "gauge", "swap_pending_transfers", "", stats.swap.pending_transfers );
+
+    if ( stats.swapstats ) {
+        out += "# TYPE rambrain_stall_seconds summary\n";
+        for ( int l = 0; l < managedMemory::LATENCY_STATS; ++l ) {
+            const latencySummary &lat = stats.latencies[l];
+            char labels[64];
+            const uint64_t quantiles[4] = {lat.p50, lat.p90, lat.p99, lat.max};
+            const char *names[4] = {"0.5", "0.9", "0.99", "1"};
+            for ( int q = 0; q < 4; ++q ) {
+                snprintf ( labels, 64, "{stall=\"%s\",quantile=\"%s\"}", latencyKeys[l], names[q] );
+                metric ( out, NULL, "stall_seconds", labels, quantiles[q] * 1e-9 );
+            }
+            snprintf ( labels, 64, "{stall=\"%s\"}", latencyKeys[l] );
+            metric ( out, NULL, "stall_seconds_sum", labels, lat.sum * 1e-9 );
+            metric ( out, NULL, "stall_seconds_count", labels, lat.count );
+        }
+    }
+    return out;
+}
+
+bool writeStatsFile ( const char *path, bool json )
+{
+    std::string content = json ? statsToJson ( statsSnapshot() ) + "\n" : statsToText ( statsSnapshot() );
+    std::string tmpPath = std::string ( path ) + ".tmp";
+    FILE *file = fopen ( tmpPath.c_str(), "w" );
+    if ( !file ) {
+        return false;
+    }
+    bool written = fwrite ( content.data(), 1, content.size(), file ) == content.size();
+    written = fclose ( file ) == 0 && written;
+    std::error_code err;
+    if ( written ) {
+        //Renaming replaces the file at once, readers see either the old or the new snapshot
+        std::filesystem::rename ( tmpPath, path, err );
+    }
+    if ( !written || err ) {
+        remove ( tmpPath.c_str() );
+        return false;
+    }
+    return true;
+}
+
+static inline global_bytesize swapTraffic ( const chunkCounters &counters )
+{
+    return counters.swapin_bytes + counters.swapout_bytes;
+}
+
+std::vector<chunkReportEntry> topChunks ( unsigned int n, managedMemory *manager )
+{
+    std::vector<chunkReportEntry> entries;
+    if ( manager == NULL ) {
+        return entries;
+    }
+    managedMemory::lockStateChangeMutex();
+    entries.reserve ( manager->memChunks.size() );
+    for ( const auto &idChunk : manager->memChunks ) {
+        const managedMemoryChunk &chunk = *idChunk.second;
+#ifdef SWAPSTATS
+        entries.push_back ( {chunk.id, chunk.label, chunk.size, chunk.status, chunk.counters} );
+#else
+        entries.push_back ( {chunk.id, chunk.label, chunk.size, chunk.status, chunkCounters() } );
+#endif
+    }
+    rambrain_pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
+
+    auto moreTraffic = [] ( const chunkReportEntry & a, const chunkReportEntry & b ) {
+        const global_bytesize ta = swapTraffic ( a.counters ), tb = swapTraffic ( b.counters );
+        return ta != tb ? ta > tb : a.counters.accesses > b.counters.accesses;
+    };
+    if ( n == 0 || n >= entries.size() ) {
+        std::sort ( entries.begin(), entries.end(), moreTraffic );
+    } else {
+        std::partial_sort ( entries.begin(), entries.begin() + n, entries.end(), moreTraffic );
+        entries.resize ( n );
+    }
+    return entries;
+}
+
+std::vector<labelReportEntry> labelReport ( managedMemory *manager )
+{
+    std::map<std::string, labelReportEntry> byLabel;
+    if ( manager != NULL ) {
+        managedMemory::lockStateChangeMutex();
+        for ( const auto &idChunk : manager->memChunks ) {
+            const managedMemoryChunk &chunk = *idChunk.second;
+            labelReportEntry &entry = byLabel[chunk.label ? chunk.label : ""];
+            ++entry.chunks;
+            if ( chunk.policy ) {
+                entry.budget = chunk.policy->budget;
+                entry.priority = chunk.policy->priority;
+            }
+            if ( chunk.status & MEM_ALLOCATED ) {
+                entry.resident_bytes += chunk.size;
+            } else {
+                entry.swapped_bytes += chunk.size;
+            }
+#ifdef SWAPSTATS
+            entry.counters.accesses += chunk.counters.accesses;
+            entry.counters.swapins += chunk.counters.swapins;
+            entry.counters.swapouts += chunk.counters.swapouts;
+            entry.counters.swapin_bytes += chunk.counters.swapin_bytes;
+            entry.counters.swapout_bytes += chunk.counters.swapout_bytes;
+            entry.counters.last_access = std::max ( entry.counters.last_access, chunk.counters.last_access );
+#endif
+        }
+        rambrain_pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
+    }
+
+    std::vector<labelReportEntry> entries;
+    for ( auto &labelEntry : byLabel ) {
+        labelEntry.second.label = labelEntry.first;
+        entries.push_back ( labelEntry.second );
+    }
+    std::stable_sort ( entries.begin(), entries.end(), [] ( const labelReportEntry & a, const labelReportEntry & b ) {
+        return swapTraffic ( a.counters ) > swapTraffic ( b.counters );
+    } );
+    return entries;
+}
+
+std::string hotnessReport ( unsigned int n, managedMemory *manager )
+{
+    const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds> ( std::chrono::system_clock::now().time_since_epoch() ).count();
+    std::string out;
+    char line[256];
+#ifndef SWAPSTATS
+    out += "#Counters are only kept if rambrain is built with SWAPSTATS\n";
+#endif
+    snprintf ( line, 256, "#%-23s %8s %14s %14s %14s %8s %10s %10s %10s %14s %14s\n", "Label", "Chunks", "Resident [B]", "Swapped [B]",
+               "Budget [B]", "Priority", "Accesses", "Swapins", "Swapouts", "Swapin [B]", "Swapout [B]" );
+    out += line;
+    for ( const labelReportEntry &entry : labelReport ( manager ) ) {
+        snprintf ( line, 256, "%-24s %8lu %14lu %14lu %14lu %8d %10lu %10lu %10lu %14lu %14lu\n", entry.label.empty() ? "-" : entry.label.c_str(),
+                   ( unsigned long ) entry.chunks, ( unsigned long ) entry.resident_bytes, ( unsigned long ) entry.swapped_bytes,
+                   ( unsigned long ) entry.budget, entry.priority,
+                   ( unsigned long ) entry.counters.accesses, ( unsigned long ) entry.counters.swapins, ( unsigned long ) entry.counters.swapouts,
+                   ( unsigned long ) entry.counters.swapin_bytes, ( unsigned long ) entry.counters.swapout_bytes );
+        out += line;
+    }
+    snprintf ( line, 256, "\n#%-11s %-24s %12s %9s %10s %10s %10s %14s %14s %12s\n", "Chunk", "Label", "Size [B]", "Resident",
+               "Accesses", "Swapins", "Swapouts", "Swapin [B]", "Swapout [B]", "Idle [s]" );
+    out += line;
+    for ( const chunkReportEntry &entry : topChunks ( n, manager ) ) {
+        const double idle = entry.counters.last_access ? ( now - entry.counters.last_access ) * 1e-9 : -1.;
+        snprintf ( line, 256, "%-12lu %-24s %12lu %9s %10lu %10lu %10lu %14lu %14lu %12.3f\n", ( unsigned long ) entry.id, entry.label ? entry.label : "-",
+                   ( unsigned long ) entry.size, entry.status & MEM_ALLOCATED ? "yes" : "no", ( unsigned long ) entry.counters.accesses,
+                   ( unsigned long ) entry.counters.swapins, ( unsigned long ) entry.counters.swapouts, ( unsigned long ) entry.counters.swapin_bytes,
+                   ( unsigned long ) entry.counters.swapout_bytes, idle );
+        out += line;
+    }
+    return out;
+}
+
+}
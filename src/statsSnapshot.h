@@ -0,0 +1,162 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATSSNAPSHOT_H
+#define STATSSNAPSHOT_H
+
+#include "managedMemory.h"
+#include "latencyHistogram.h"
+#include <string>
+#include <vector>
+
+namespace rambrain
+{
+
+/** @brief Counters of a manager, its scheduler and its swap, taken at one point in time
+ *
+ *  Fields are only ever added at the end of their group. Whenever a field is removed or changes its meaning, currentVersion is increased.
+ *  Counters are totals since the manager was created or managedMemory::resetSwapstats() was called.
+ **/
+struct RAMBRAINAPI rambrainStats {
+    static constexpr unsigned int currentVersion = 1;
+    ///Layout version of this snapshot, compare to currentVersion
+    unsigned int version = currentVersion;
+    ///Nanoseconds since the epoch at which the snapshot was taken
+    int64_t timestamp = 0;
+    ///Whether the library was built with SWAPSTATS. Otherwise, swapping counters and latencies stay zero
+    bool swapstats = false;
+
+    ///Bytes managed in ram
+    struct {
+        global_bytesize limit = 0;
+        global_bytesize used = 0;
+        global_bytesize swapped = 0;
+        ///Bytes of pending swapouts, already counted as free
+        global_bytesize tobefreed = 0;
+        global_bytesize chunks = 0;
+        ///Bytes of pinned chunks
+        global_bytesize pinned = 0;
+    } memory;
+
+    ///Swapping activity of the manager, see managedMemory::printSwapstats()
+    struct {
+        global_bytesize swapouts = 0;
+        global_bytesize swapins = 0;
+        global_bytesize swapout_scheduled_bytes = 0;
+        global_bytesize swapin_scheduled_bytes = 0;
+        global_bytesize swapout_bytes = 0;
+        global_bytesize swapin_bytes = 0;
+        global_bytesize hits = 0;
+        global_bytesize misses = 0;
+        global_bytesize background_reclaims = 0;
+        global_bytesize background_reclaim_bytes = 0;
+        global_bytesize writeback_bytes = 0;
+        global_bytesize writeback_wasted_bytes = 0;
+        global_bytesize clean_evictions = 0;
+        global_bytesize clean_eviction_bytes = 0;
+        global_bytesize partial_swapout_saved_bytes = 0;
+        global_bytesize swapped_reallocs = 0;
+        global_bytesize resident_reallocs = 0;
+    } counters;
+
+    ///Filled in by the scheduler, zero for schedulers not reporting
+    struct {
+        global_bytesize preemptive_bytes = 0;
+        global_bytesize preemptive_hit_bytes = 0;
+        global_bytesize preemptive_waste_bytes = 0;
+        global_bytesize misses = 0;
+        ///Seconds users were blocked by misses
+        double miss_latency = 0.;
+        double swapin_frac = 0.;
+        double swapout_frac = 0.;
+        global_bytesize adaptations = 0;
+    } scheduler;
+
+    ///Bytes managed by the swap
+    struct {
+        global_bytesize size = 0;
+        global_bytesize used = 0;
+        global_bytesize free = 0;
+        ///Transfers submitted and not yet arrived
+        global_bytesize pending_transfers = 0;
+    } swap;
+
+    ///Stall latencies in nanoseconds, indexed by managedMemory::latencyStat
+    latencySummary latencies[managedMemory::LATENCY_STATS] = {};
+};
+
+/** @brief takes a snapshot of the counters of manager
+ *
+ *  The counters are copied while holding stateChangeMutex, which every change to them holds as well. Thus the snapshot is consistent,
+ *  while other threads are only held up for the copy, not for pending swapping. Latencies are read without locking.
+ *  @note must not be called having stateChangeMutex acquired, nor from a signal handler
+ **/
+RAMBRAINAPI rambrainStats statsSnapshot ( managedMemory *manager = managedMemory::defaultManager );
+
+///@brief returns the snapshot as JSON object, keys as the names of rambrainStats' fields
+RAMBRAINAPI std::string statsToJson ( const rambrainStats &stats );
+///@brief returns the snapshot in the Prometheus text exposition format, metrics are prefixed by rambrain_
+RAMBRAINAPI std::string statsToText ( const rambrainStats &stats );
+/** @brief writes a snapshot of the default manager to path, replacing the file at once so that readers never see a partial one
+ *  @param json JSON if true, text exposition format otherwise
+ *  @return success
+ **/
+RAMBRAINAPI bool writeStatsFile ( const char *path, bool json = true );
+
+///@brief a chunk and what happened to it, see topChunks()
+struct chunkReportEntry {
+    memoryID id;
+    ///Allocation label, NULL if none was given
+    const char *label;
+    global_bytesize size;
+    memoryStatus status;
+    ///All zero if the library was built without SWAPSTATS
+    chunkCounters counters;
+};
+
+///@brief chunks sharing an allocation label, see labelReport()
+struct labelReportEntry {
+    ///Empty for chunks without label
+    std::string label;
+    global_bytesize chunks = 0;
+    global_bytesize resident_bytes = 0;
+    ///Bytes swapped out or on their way to or from swap
+    global_bytesize swapped_bytes = 0;
+    ///Budget and priority of the label's policy, see managedMemory::setLabelPolicy()
+    global_bytesize budget = 0;
+    int priority = 0;
+    ///Sums over the chunks, last_access is the latest one. All zero if the library was built without SWAPSTATS
+    chunkCounters counters;
+};
+
+/** @brief returns the n chunks that caused most swap traffic, most first
+ *
+ *  Chunks are ranked by the bytes they moved from and to swap, ties by their accesses.
+ *  @param n number of chunks to return, 0 for all of them
+ *  @note chunks are listed while holding stateChangeMutex, thus listing many chunks holds up other threads accordingly
+ **/
+RAMBRAINAPI std::vector<chunkReportEntry> topChunks ( unsigned int n, managedMemory *manager = managedMemory::defaultManager );
+///@brief returns the chunks of manager summed up by allocation label, most swap traffic first
+RAMBRAINAPI std::vector<labelReportEntry> labelReport ( managedMemory *manager = managedMemory::defaultManager );
+///@brief returns labelReport() and the n chunks of topChunks() as human readable tables
+RAMBRAINAPI std::string hotnessReport ( unsigned int n = 20, managedMemory *manager = managedMemory::defaultManager );
+
+}
+
+#endif
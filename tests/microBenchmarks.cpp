@@ -0,0 +1,240 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "managedPtr.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+#include "managedFileSwap.h"
+
+using namespace rambrain;
+
+#ifdef WIN32
+static const char *swapMask = "rambrainbench-%d-%d";
+#else
+///tmpfs, so that io measures our overhead rather than the disk
+static const char *swapMask = "/dev/shm/rambrainbench-%d-%d";
+#endif
+
+///@brief reaches into the manager and swap for what is not public
+class microBenchmarkAccess
+{
+public:
+    static managedMemoryChunk *mmalloc ( managedMemory &manager, global_bytesize size ) {
+        return manager.mmalloc ( size );
+    }
+    static void mfree ( managedMemory &manager, managedMemoryChunk *chunk ) {
+        manager.mfree ( chunk->id );
+    }
+    static void touchUntouch ( managedMemory &manager, managedMemoryChunk &chunk ) {
+        managedMemory::lockStateChangeMutex();
+        manager.touch ( chunk );
+        manager.untouch ( chunk );
+        rambrain_pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
+    }
+    static void lockStateChangeMutex() {
+        managedMemory::lockStateChangeMutex();
+    }
+    static void unlockStateChangeMutex() {
+        rambrain_pthread_mutex_unlock ( &managedMemory::stateChangeMutex );
+    }
+    static pageFileLocation *pfmalloc ( managedFileSwap &swap, global_bytesize size ) {
+        return swap.pfmalloc ( size, NULL );
+    }
+    static void pffree ( managedFileSwap &swap, pageFileLocation *location ) {
+        swap.pffree ( location );
+    }
+};
+
+///@brief mmalloc and mfree of a chunk of state.range(0) bytes, with plenty of ram
+static void BM_MallocFree ( benchmark::State &state )
+{
+    managedDummySwap swap ( gig );
+    cyclicManagedMemory manager ( &swap, gig );
+    for ( auto _ : state ) {
+        managedMemoryChunk *chunk = microBenchmarkAccess::mmalloc ( manager, state.range ( 0 ) );
+        microBenchmarkAccess::mfree ( manager, chunk );
+    }
+    state.SetItemsProcessed ( state.iterations() );
+}
+BENCHMARK ( BM_MallocFree )->RangeMultiplier ( 16 )->Range ( 64, 4 * mib );
+
+static managedDummySwap *residentSwap;
+static cyclicManagedMemory *residentManager;
+static std::vector<managedPtr<char> *> residentPtrs;
+
+///@brief adhereTo on chunks that stay resident, from state.threads() threads working on different chunks
+static void BM_AdhereToResident ( benchmark::State &state )
+{
+    const unsigned int nptrs = 64;
+    if ( state.thread_index() == 0 ) {
+        residentSwap = new managedDummySwap ( 64 * mib );
+        residentManager = new cyclicManagedMemory ( residentSwap, 64 * mib );
+        for ( unsigned int p = 0; p < nptrs; ++p ) {
+            residentPtrs.push_back ( new managedPtr<char> ( kib ) );
+        }
+    }
+    unsigned int p = state.thread_index();
+    for ( auto _ : state ) {
+        adhereTo<char> glue ( *residentPtrs[p] );
+        const char *loc = glue;
+        benchmark::DoNotOptimize ( loc );
+        p = ( p + state.threads() ) % nptrs;
+    }
+    state.SetItemsProcessed ( state.iterations() );
+    if ( state.thread_index() == 0 ) {
+        for ( managedPtr<char> *ptr : residentPtrs ) {
+            delete ptr;
+        }
+        residentPtrs.clear();
+        delete residentManager;
+        delete residentSwap;
+    }
+}
+BENCHMARK ( BM_AdhereToResident )->ThreadRange ( 1, 8 )->UseRealTime();
+
+///@brief the scheduler's bookkeeping of a use, without the status changes around it
+static void BM_TouchUntouch ( benchmark::State &state )
+{
+    managedDummySwap swap ( 64 * mib );
+    cyclicManagedMemory manager ( &swap, 64 * mib );
+    std::vector<managedMemoryChunk *> chunks;
+    for ( unsigned int c = 0; c < 1024; ++c ) {
+        chunks.push_back ( microBenchmarkAccess::mmalloc ( manager, kib ) );
+    }
+    unsigned int c = 0;
+    for ( auto _ : state ) {
+        microBenchmarkAccess::touchUntouch ( manager, *chunks[c] );
+        c = ( c + 1 ) % chunks.size();
+    }
+    state.SetItemsProcessed ( state.iterations() );
+    for ( managedMemoryChunk *chunk : chunks ) {
+        microBenchmarkAccess::mfree ( manager, chunk );
+    }
+}
+BENCHMARK ( BM_TouchUntouch );
+
+/** @brief pfmalloc and pffree of state.range(0) bytes in a swap with a hole of 4KiB after each allocated 4KiB
+ *  Requests larger than the holes have to look past all of them
+ **/
+static void BM_PfmallocFragmented ( benchmark::State &state )
+{
+    const unsigned int nlocations = 2048;
+    managedFileSwap swap ( 64 * mib, swapMask, 64 * mib );
+    std::vector<pageFileLocation *> locations;
+    for ( unsigned int l = 0; l < nlocations; ++l ) {
+        locations.push_back ( microBenchmarkAccess::pfmalloc ( swap, 4 * kib ) );
+    }
+    for ( unsigned int l = 0; l < nlocations; l += 2 ) {
+        microBenchmarkAccess::pffree ( swap, locations[l] );
+    }
+    for ( auto _ : state ) {
+        pageFileLocation *location = microBenchmarkAccess::pfmalloc ( swap, state.range ( 0 ) );
+        benchmark::DoNotOptimize ( location );
+        microBenchmarkAccess::pffree ( swap, location );
+    }
+    state.SetItemsProcessed ( state.iterations() );
+    for ( unsigned int l = 1; l < nlocations; l += 2 ) {
+        microBenchmarkAccess::pffree ( swap, locations[l] );
+    }
+}
+BENCHMARK ( BM_PfmallocFragmented )->Arg ( kib )->Arg ( 16 * kib );
+
+///@brief swapping a chunk of state.range(0) bytes out and in again through managedFileSwap, waiting for both transfers
+static void BM_SwapRoundTrip ( benchmark::State &state )
+{
+    const global_bytesize size = state.range ( 0 );
+    managedFileSwap swap ( 16 * size, swapMask );
+    //Byte accounting of the transfers goes to the default manager, so it has to be one of our own:
+    managedDummySwap dummyswap ( gig );
+    cyclicManagedMemory dummymanager ( &dummyswap, gig );
+
+#ifdef PARENTAL_CONTROL
+    managedMemoryChunk chunk ( 0, 1 );
+#else
+    managedMemoryChunk chunk ( 1 );
+#endif
+    chunk.status = MEM_ALLOCATED;
+    chunk.size = size;
+    chunk.locPtr = _mm_malloc ( size, 4096 );
+    memset ( chunk.locPtr, 1, size );
+    microBenchmarkAccess::lockStateChangeMutex();
+    for ( auto _ : state ) {
+        swap.swapOut ( &chunk );
+        swap.waitForCleanExit ( true );
+        swap.swapIn ( &chunk );
+        swap.waitForCleanExit ( true );
+    }
+    microBenchmarkAccess::unlockStateChangeMutex();
+    state.SetBytesProcessed ( 2 * state.iterations() * size );
+    _mm_free ( chunk.locPtr );
+}
+BENCHMARK ( BM_SwapRoundTrip )->RangeMultiplier ( 16 )->Range ( 4 * kib, mib );
+
+///@brief copy construction and assignment of managedPtrs, which count references to the shared chunk
+static void BM_ManagedPtrCopy ( benchmark::State &state )
+{
+    managedDummySwap swap ( 64 * mib );
+    cyclicManagedMemory manager ( &swap, 64 * mib );
+    managedPtr<char> first ( 64 ), second ( 64 );
+    managedPtr<char> copy ( first );
+    for ( auto _ : state ) {
+        managedPtr<char> local ( first );
+        copy = second;
+        copy = local;
+        benchmark::DoNotOptimize ( copy );
+    }
+    state.SetItemsProcessed ( 3 * state.iterations() );
+}
+BENCHMARK ( BM_ManagedPtrCopy );
+
+/**
+ * @brief Runs the microbenchmarks of hot paths, google benchmark's command line options apply
+ * @note Unless --benchmark_out is given, results are written to rambrain-microbenchmarks.json in google benchmark's JSON format as well,
+ *       so that they can be compared from commit to commit, e.g. by google benchmark's compare.py
+ */
+int main ( int argc, char **argv )
+{
+    std::vector<char *> args ( argv, argv + argc );
+    std::string out = "--benchmark_out=rambrain-microbenchmarks.json", format = "--benchmark_out_format=json";
+    bool outGiven = false;
+    for ( int a = 1; a < argc; ++a ) {
+        outGiven |= strncmp ( argv[a], "--benchmark_out=", 16 ) == 0;
+    }
+    if ( !outGiven ) {
+        args.push_back ( &out[0] );
+        args.push_back ( &format[0] );
+    }
+    int nargs = args.size();
+    benchmark::Initialize ( &nargs, args.data() );
+    if ( benchmark::ReportUnrecognizedArguments ( nargs, args.data() ) ) {
+        return 1;
+    }
+#ifdef SWAPSTATS
+    benchmark::AddCustomContext ( "rambrain_swapstats", "on" );
+#else
+    benchmark::AddCustomContext ( "rambrain_swapstats", "off" );
+#endif
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,610 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "managedPtr.h"
+#include "cyclicManagedMemory.h"
+#include "managedFileSwap.h"
+
+using namespace rambrain;
+using namespace std::chrono;
+
+///@brief what a benchmark run is judged by
+struct perfSample {
+    ///Uses (or allocations) per second
+    double throughput;
+    ///99th percentile of the latency of a single use in seconds
+    double p99;
+};
+
+///@brief how the benchmarks are set up
+struct perfSetup {
+    ///Bytes all chunks of a benchmark add up to
+    global_bytesize workingSet;
+    const char *mask;
+};
+
+///@brief collects the latencies of single operations and the time of the whole run
+class perfTimer
+{
+public:
+    perfTimer() : start ( steady_clock::now() ) {}
+
+    inline void opBegin() {
+        opStart = steady_clock::now();
+    }
+    inline void opEnd() {
+        latencies.push_back ( duration_cast<duration<double>> ( steady_clock::now() - opStart ).count() );
+    }
+
+    perfSample sample() {
+        perfSample result;
+        const double seconds = duration_cast<duration<double>> ( steady_clock::now() - start ).count();
+        result.throughput = latencies.size() / seconds;
+        std::vector<double>::iterator p99 = latencies.begin() + ( latencies.size() * 99 ) / 100;
+        std::nth_element ( latencies.begin(), p99, latencies.end() );
+        result.p99 = *p99;
+        return result;
+    }
+
+private:
+    steady_clock::time_point start, opStart;
+    std::vector<double> latencies;
+};
+
+///@brief uses chunks of a quarter of the ram one after another, four times around; every use writes the whole chunk
+static perfSample cyclicBenchmark ( const perfSetup &setup )
+{
+    const unsigned int nptrs = 64, rounds = 4;
+    const global_bytesize size = setup.workingSet / nptrs;
+    managedFileSwap swap ( 2 * setup.workingSet, setup.mask );
+    cyclicManagedMemory manager ( &swap, setup.workingSet / 4 );
+    std::vector<managedPtr<char> *> ptrs;
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs.push_back ( new managedPtr<char> ( size ) );
+    }
+    perfTimer timer;
+    for ( unsigned int r = 0; r < rounds; ++r ) {
+        for ( managedPtr<char> *ptr : ptrs ) {
+            timer.opBegin();
+            adhereTo<char> glue ( *ptr );
+            char *loc = glue;
+            timer.opEnd();
+            memset ( loc, r, size );
+        }
+    }
+    perfSample result = timer.sample();
+    for ( managedPtr<char> *ptr : ptrs ) {
+        delete ptr;
+    }
+    return result;
+}
+
+///Keeps reads from being optimized away
+static volatile unsigned int perfSink;
+
+///@brief reads chunks in random order with half of them fitting into ram
+static perfSample randomBenchmark ( const perfSetup &setup )
+{
+    const unsigned int nptrs = 64, uses = 256;
+    const global_bytesize size = setup.workingSet / nptrs;
+    managedFileSwap swap ( 2 * setup.workingSet, setup.mask );
+    cyclicManagedMemory manager ( &swap, setup.workingSet / 2 );
+    std::vector<managedPtr<char> *> ptrs;
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs.push_back ( new managedPtr<char> ( size ) );
+    }
+    std::mt19937 rng ( 42 );
+    perfTimer timer;
+    unsigned int sum = 0;
+    for ( unsigned int u = 0; u < uses; ++u ) {
+        timer.opBegin();
+        adhereTo<char> glue ( ptrs[rng() % nptrs] );
+        const char *loc = glue;
+        timer.opEnd();
+        for ( global_bytesize b = 0; b < size; b += 4096 ) {
+            sum += loc[b];
+        }
+    }
+    perfSample result = timer.sample();
+    for ( managedPtr<char> *ptr : ptrs ) {
+        delete ptr;
+    }
+    perfSink = sum;
+    return result;
+}
+
+///@brief as cyclicBenchmark, but the next chunk is requested before the current one is worked on
+static perfSample preparedBenchmark ( const perfSetup &setup )
+{
+    const unsigned int nptrs = 64, rounds = 4;
+    const global_bytesize size = setup.workingSet / nptrs;
+    managedFileSwap swap ( 2 * setup.workingSet, setup.mask );
+    cyclicManagedMemory manager ( &swap, setup.workingSet / 4 );
+    std::vector<managedPtr<char> *> ptrs;
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs.push_back ( new managedPtr<char> ( size ) );
+    }
+    perfTimer timer;
+    adhereTo<char> *current = new adhereTo<char> ( ptrs[0] );
+    for ( unsigned int u = 0; u < rounds * nptrs; ++u ) {
+        adhereTo<char> *next = new adhereTo<char> ( ptrs[ ( u + 1 ) % nptrs] );
+        timer.opBegin();
+        char *loc = *current;
+        timer.opEnd();
+        memset ( loc, u, size );
+        delete current;
+        current = next;
+    }
+    delete current;
+    perfSample result = timer.sample();
+    for ( managedPtr<char> *ptr : ptrs ) {
+        delete ptr;
+    }
+    return result;
+}
+
+///@brief uses small chunks that all stay in ram, measuring the bookkeeping of a use
+static perfSample residentBenchmark ( const perfSetup &setup )
+{
+    const unsigned int nptrs = 256, uses = 100000;
+    managedFileSwap swap ( setup.workingSet, setup.mask );
+    cyclicManagedMemory manager ( &swap, setup.workingSet );
+    std::vector<managedPtr<char> *> ptrs;
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs.push_back ( new managedPtr<char> ( 64 ) );
+    }
+    perfTimer timer;
+    for ( unsigned int u = 0; u < uses; ++u ) {
+        timer.opBegin();
+        adhereTo<char> glue ( ptrs[u % nptrs] );
+        char *loc = glue;
+        timer.opEnd();
+        ++loc[0];
+    }
+    perfSample result = timer.sample();
+    for ( managedPtr<char> *ptr : ptrs ) {
+        delete ptr;
+    }
+    return result;
+}
+
+///@brief allocates four times the ram in chunks, forcing swapouts to make room, then frees them
+static perfSample allocationBenchmark ( const perfSetup &setup )
+{
+    const unsigned int nptrs = 256;
+    const global_bytesize size = setup.workingSet / nptrs;
+    managedFileSwap swap ( 2 * setup.workingSet, setup.mask );
+    cyclicManagedMemory manager ( &swap, setup.workingSet / 4 );
+    std::vector<managedPtr<char> *> ptrs;
+    perfTimer timer;
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        timer.opBegin();
+        ptrs.push_back ( new managedPtr<char> ( size ) );
+        timer.opEnd();
+    }
+    perfSample result = timer.sample();
+    for ( managedPtr<char> *ptr : ptrs ) {
+        delete ptr;
+    }
+    return result;
+}
+
+struct perfBenchmark {
+    const char *name;
+    const char *description;
+    perfSample ( *run ) ( const perfSetup &setup );
+};
+
+static const perfBenchmark benchmarks[] = {
+    {"cyclic", "Sequential writing uses of four times the ram", cyclicBenchmark},
+    {"random", "Random reading uses of twice the ram", randomBenchmark},
+    {"prepared", "Sequential writing uses of four times the ram, the next chunk requested ahead", preparedBenchmark},
+    {"resident", "Uses of small chunks staying in ram", residentBenchmark},
+    {"allocation", "Allocations of four times the ram", allocationBenchmark}
+};
+
+static const char *metricNames[] = {"throughput", "p99"};
+
+///@brief a results file, values of all repetitions by benchmark and metric
+typedef std::map<std::string, std::map<std::string, std::vector<double>>> perfResults;
+
+static bool writeResults ( const char *path, const perfResults &results, unsigned int repetitions, const perfSetup &setup )
+{
+    std::ofstream out ( path );
+    out.precision ( 9 );
+    out << "{\n  \"version\": 1,\n  \"repetitions\": " << repetitions << ",\n  \"working_set\": " << setup.workingSet << ",\n";
+#ifdef SWAPSTATS
+    out << "  \"swapstats\": true,\n";
+#else
+    out << "  \"swapstats\": false,\n";
+#endif
+    out << "  \"benchmarks\": {";
+    bool firstBenchmark = true;
+    for ( const auto &benchmark : results ) {
+        out << ( firstBenchmark ? "\n" : ",\n" ) << "    \"" << benchmark.first << "\": {";
+        bool firstMetric = true;
+        for ( const auto &metric : benchmark.second ) {
+            out << ( firstMetric ? "\n" : ",\n" ) << "      \"" << metric.first << "\": [";
+            for ( unsigned int v = 0; v < metric.second.size(); ++v ) {
+                out << ( v ? ", " : "" ) << metric.second[v];
+            }
+            out << "]";
+            firstMetric = false;
+        }
+        out << "\n    }";
+        firstBenchmark = false;
+    }
+    out << "\n  }\n}\n";
+    return out.good();
+}
+
+/** @brief reads the JSON written by writeResults()
+ *
+ *  This is no general JSON parser, but skips everything besides numbers below "benchmarks". Those are collected by the names of the
+ *  two objects they are nested in.
+ **/
+class perfResultsReader
+{
+public:
+    perfResultsReader ( const std::string &text ) : text ( text ), pos ( 0 ) {}
+
+    bool read ( perfResults &results ) {
+        std::vector<std::string> path;
+        return value ( path, results ) && ( skipSpace(), pos == text.size() );
+    }
+
+private:
+    void skipSpace() {
+        while ( pos < text.size() && isspace ( text[pos] ) ) {
+            ++pos;
+        }
+    }
+
+    bool readString ( std::string &out ) {
+        if ( text[pos] != '"' ) {
+            return false;
+        }
+        size_t end = text.find ( '"', pos + 1 );
+        if ( end == std::string::npos ) {
+            return false;
+        }
+        out = text.substr ( pos + 1, end - pos - 1 );
+        pos = end + 1;
+        return true;
+    }
+
+    bool value ( std::vector<std::string> &path, perfResults &results ) {
+        skipSpace();
+        if ( pos >= text.size() ) {
+            return false;
+        }
+        std::string key;
+        switch ( text[pos] ) {
+        case '{':
+            ++pos;
+            skipSpace();
+            if ( text[pos] == '}' ) {
+                ++pos;
+                return true;
+            }
+            do {
+                skipSpace();
+                if ( !readString ( key ) ) {
+                    return false;
+                }
+                skipSpace();
+                if ( text[pos++] != ':' ) {
+                    return false;
+                }
+                path.push_back ( key );
+                if ( !value ( path, results ) ) {
+                    return false;
+                }
+                path.pop_back();
+                skipSpace();
+            } while ( pos < text.size() && text[pos++] == ',' );
+            return text[pos - 1] == '}';
+        case '[':
+            ++pos;
+            skipSpace();
+            if ( text[pos] == ']' ) {
+                ++pos;
+                return true;
+            }
+            do {
+                if ( !value ( path, results ) ) {
+                    return false;
+                }
+                skipSpace();
+            } while ( pos < text.size() && text[pos++] == ',' );
+            return text[pos - 1] == ']';
+        case '"':
+            return readString ( key );
+        default:
+            const char *begin = text.c_str() + pos;
+            char *end;
+            double number = strtod ( begin, &end );
+            if ( end == begin ) {
+                //true, false or null
+                while ( pos < text.size() && isalpha ( text[pos] ) ) {
+                    ++pos;
+                }
+                return text.c_str() + pos != begin;
+            }
+            pos += end - begin;
+            if ( path.size() == 3 && path[0] == "benchmarks" ) {
+                results[path[1]][path[2]].push_back ( number );
+            }
+            return true;
+        }
+    }
+
+    const std::string &text;
+    size_t pos;
+};
+
+static bool readResults ( const char *path, perfResults &results )
+{
+    std::ifstream in ( path );
+    if ( !in ) {
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string contents = text.str();
+    perfResultsReader reader ( contents );
+    return reader.read ( results );
+}
+
+static double median ( std::vector<double> values )
+{
+    std::sort ( values.begin(), values.end() );
+    const size_t n = values.size();
+    return n % 2 ? values[n / 2] : ( values[n / 2 - 1] + values[n / 2] ) / 2.;
+}
+
+/** @brief one sided Mann-Whitney U test
+ *  @return probability of seeing values of a at least as small compared to b as observed, if both were drawn from the same distribution
+ *  @note the p-value is exact for samples of up to 20 values without ties, normal approximated with tie and continuity correction otherwise
+ **/
+static double mannWhitneyLess ( const std::vector<double> &a, const std::vector<double> &b )
+{
+    const unsigned int na = a.size(), nb = b.size(), n = na + nb;
+    std::vector<std::pair<double, bool>> all;
+    for ( double v : a ) {
+        all.push_back ( {v, true} );
+    }
+    for ( double v : b ) {
+        all.push_back ( {v, false} );
+    }
+    std::sort ( all.begin(), all.end() );
+
+    //Sum of the ranks of a, tied values getting the average of their ranks:
+    double ranksum = 0., tieterm = 0.;
+    for ( unsigned int i = 0; i < n; ) {
+        unsigned int j = i;
+        while ( j < n && all[j].first == all[i].first ) {
+            ++j;
+        }
+        const double rank = ( i + j + 1 ) / 2., t = j - i;
+        for ( unsigned int k = i; k < j; ++k ) {
+            ranksum += all[k].second ? rank : 0.;
+        }
+        tieterm += t * t * t - t;
+        i = j;
+    }
+    const double u = ranksum - na * ( na + 1 ) / 2.;
+
+    if ( tieterm == 0. && na <= 20 && nb <= 20 ) {
+        //ways[i][j][k]: number of orderings of i values of a and j values of b with U = k
+        std::vector<std::vector<std::vector<double>>> ways ( na + 1, std::vector<std::vector<double>> ( nb + 1 ) );
+        for ( unsigned int i = 0; i <= na; ++i ) {
+            for ( unsigned int j = 0; j <= nb; ++j ) {
+                ways[i][j].assign ( i * j + 1, 0. );
+                if ( i == 0 || j == 0 ) {
+                    ways[i][j][0] = 1.;
+                    continue;
+                }
+                for ( unsigned int k = 0; k <= i * j; ++k ) {
+                    //The largest value is either of a, exceeding all j values of b, or of b:
+                    ways[i][j][k] = ( k >= j ? ways[i - 1][j][k - j] : 0. ) + ( k <= i * ( j - 1 ) ? ways[i][j - 1][k] : 0. );
+                }
+            }
+        }
+        double below = 0., total = 0.;
+        for ( unsigned int k = 0; k <= na * nb; ++k ) {
+            below += k <= u ? ways[na][nb][k] : 0.;
+            total += ways[na][nb][k];
+        }
+        return below / total;
+    }
+
+    const double sigma = sqrt ( na * nb / 12. * ( ( n + 1 ) - tieterm / ( n * ( n - 1. ) ) ) );
+    if ( sigma == 0. ) {
+        return 1.;
+    }
+    const double z = ( u - na * nb / 2. + .5 ) / sigma;
+    return .5 * erfc ( -z / sqrt ( 2. ) );
+}
+
+/** @brief compares current against baseline and prints a line for every metric
+ *  @return number of regressions
+ **/
+static unsigned int compareResults ( const perfResults &baseline, const perfResults &current, double threshold, double alpha )
+{
+    unsigned int regressions = 0;
+    printf ( "%-12s %-11s %14s %14s %9s %9s  %s\n", "#Benchmark", "Metric", "Baseline", "Current", "Change", "p", "Verdict" );
+    for ( const auto &benchmark : current ) {
+        auto base = baseline.find ( benchmark.first );
+        for ( const auto &metric : benchmark.second ) {
+            if ( base == baseline.end() || base->second.count ( metric.first ) == 0 || base->second.at ( metric.first ).empty() || metric.second.empty() ) {
+                printf ( "%-12s %-11s %14s %14g %9s %9s  %s\n", benchmark.first.c_str(), metric.first.c_str(), "-", median ( metric.second ), "-", "-", "not in baseline" );
+                continue;
+            }
+            const std::vector<double> &before = base->second.at ( metric.first ), &after = metric.second;
+            //Throughput is better when higher, latencies are better when lower:
+            const bool higherIsBetter = metric.first == "throughput";
+            const double change = median ( after ) / median ( before ) - 1.;
+            const double pWorse = higherIsBetter ? mannWhitneyLess ( after, before ) : mannWhitneyLess ( before, after );
+            const double pBetter = higherIsBetter ? mannWhitneyLess ( before, after ) : mannWhitneyLess ( after, before );
+            const double worse = higherIsBetter ? -change : change;
+            const char *verdict = "unchanged";
+            double p = pWorse < pBetter ? pWorse : pBetter;
+            if ( worse > threshold && pWorse < alpha ) {
+                verdict = "REGRESSION";
+                ++regressions;
+            } else if ( -worse > threshold && pBetter < alpha ) {
+                verdict = "improvement";
+            }
+            printf ( "%-12s %-11s %14g %14g %+8.1f%% %9.3g  %s\n", benchmark.first.c_str(), metric.first.c_str(), median ( before ), median ( after ), 100. * change, p, verdict );
+        }
+    }
+    return regressions;
+}
+
+static void usage()
+{
+    printf ( "Usage: ./rambrain-perfcompare [options]\n"
+             "\t-r <n>\trepetitions of every benchmark, default: 10\n"
+             "\t-o <file>\twrite results to file, default: rambrain-perf.json\n"
+             "\t-i <file>\tread results from file instead of running the benchmarks\n"
+             "\t-b <file>\tcompare results to the baseline in file, exiting with 1 on regressions\n"
+             "\t-t <percent>\tchange of a median that counts as regression or improvement, default: 5\n"
+             "\t-a <alpha>\tsignificance level of the Mann-Whitney U test, default: 0.05\n"
+             "\t-m <MB>\tworking set of every benchmark, default: 16\n"
+             "\t-f <mask>\tswap file mask, default: rambrainperf-%%d-%%d\n"
+             "\t-s <name>\trun only the named benchmark, may be given several times\n"
+             "\t-l\tlist benchmarks\n" );
+}
+
+/**
+ * @brief Runs a fixed set of benchmarks repeatedly and compares their throughput and p99 latency of single uses to a baseline
+ * @param argc Arbitrary
+ * @param argv Options as printed by usage()
+ * @return 0 on success, 1 if a metric regressed, 2 on errors
+ * @note A metric counts as regressed if its median got worse by more than the threshold and the Mann-Whitney U test of the
+ *       repetitions finds the change significant. Repetitions of different benchmarks are interleaved, so that drifts of the machine
+ *       affect all benchmarks alike. Every benchmark runs once untimed beforehand.
+ */
+int main ( int argc, char **argv )
+{
+    unsigned int repetitions = 10;
+    const char *outPath = "rambrain-perf.json", *inPath = NULL, *baselinePath = NULL;
+    double threshold = 5., alpha = .05;
+    perfSetup setup = {16 * mib, "rambrainperf-%d-%d"};
+    std::vector<std::string> selected;
+    for ( int a = 1; a < argc; ++a ) {
+        const bool hasValue = a + 1 < argc;
+        if ( !strcmp ( argv[a], "-r" ) && hasValue ) {
+            repetitions = atoi ( argv[++a] );
+        } else if ( !strcmp ( argv[a], "-o" ) && hasValue ) {
+            outPath = argv[++a];
+        } else if ( !strcmp ( argv[a], "-i" ) && hasValue ) {
+            inPath = argv[++a];
+        } else if ( !strcmp ( argv[a], "-b" ) && hasValue ) {
+            baselinePath = argv[++a];
+        } else if ( !strcmp ( argv[a], "-t" ) && hasValue ) {
+            threshold = atof ( argv[++a] );
+        } else if ( !strcmp ( argv[a], "-a" ) && hasValue ) {
+            alpha = atof ( argv[++a] );
+        } else if ( !strcmp ( argv[a], "-m" ) && hasValue ) {
+            setup.workingSet = atof ( argv[++a] ) * mib;
+        } else if ( !strcmp ( argv[a], "-f" ) && hasValue ) {
+            setup.mask = argv[++a];
+        } else if ( !strcmp ( argv[a], "-s" ) && hasValue ) {
+            selected.push_back ( argv[++a] );
+        } else if ( !strcmp ( argv[a], "-l" ) ) {
+            for ( const perfBenchmark &benchmark : benchmarks ) {
+                printf ( "%s\t%s\n", benchmark.name, benchmark.description );
+            }
+            return 0;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    perfResults results;
+    if ( inPath ) {
+        if ( !readResults ( inPath, results ) ) {
+            fprintf ( stderr, "Could not read results from %s\n", inPath );
+            return 2;
+        }
+    } else {
+        if ( repetitions == 0 ) {
+            usage();
+            return 2;
+        }
+        std::vector<const perfBenchmark *> toRun;
+        for ( const perfBenchmark &benchmark : benchmarks ) {
+            if ( selected.empty() || std::find ( selected.begin(), selected.end(), benchmark.name ) != selected.end() ) {
+                toRun.push_back ( &benchmark );
+            }
+        }
+        if ( toRun.size() != ( selected.empty() ? sizeof ( benchmarks ) / sizeof ( benchmarks[0] ) : selected.size() ) ) {
+            fprintf ( stderr, "Unknown benchmark selected, see -l\n" );
+            return 2;
+        }
+        for ( const perfBenchmark *benchmark : toRun ) {
+            benchmark->run ( setup );
+        }
+        for ( unsigned int r = 0; r < repetitions; ++r ) {
+            for ( const perfBenchmark *benchmark : toRun ) {
+                perfSample sample = benchmark->run ( setup );
+                results[benchmark->name][metricNames[0]].push_back ( sample.throughput );
+                results[benchmark->name][metricNames[1]].push_back ( sample.p99 );
+            }
+            fprintf ( stderr, "Repetition %u of %u done\n", r + 1, repetitions );
+        }
+        if ( !writeResults ( outPath, results, repetitions, setup ) ) {
+            fprintf ( stderr, "Could not write results to %s\n", outPath );
+            return 2;
+        }
+        printf ( "#Results\t%s\n", outPath );
+    }
+
+    if ( !baselinePath ) {
+        for ( const auto &benchmark : results ) {
+            for ( const auto &metric : benchmark.second ) {
+                printf ( "#%s %s\t%g\n", benchmark.first.c_str(), metric.first.c_str(), median ( metric.second ) );
+            }
+        }
+        return 0;
+    }
+    perfResults baseline;
+    if ( !readResults ( baselinePath, baseline ) ) {
+        fprintf ( stderr, "Could not read baseline from %s\n", baselinePath );
+        return 2;
+    }
+    const unsigned int regressions = compareResults ( baseline, results, threshold / 100., alpha );
+    printf ( "#Regressions\t%u\n", regressions );
+    return regressions > 0 ? 1 : 0;
+}
@@ -19,6 +19,9 @@
 
 #include "performanceTestClasses.h"
 #include <chrono>
+#include <thread>
+#include <random>
+#include <algorithm>
 
 #ifndef OpenMP_NOT_FOUND
 #include <omp.h>
@@ -494,6 +497,10 @@ void matrixTransposeTest::actualTestMethod ( tester &test, int param1, int param
     }
 
     test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    double swappedIn = -managedMemory::defaultManager->getTotalSwappedInBytes();
+    double swappedOut = -managedMemory::defaultManager->getTotalSwappedOutBytes();
+#endif
 
     // Transpose
     for ( unsigned int i = 0; i < size; ++i ) {
@@ -510,6 +517,13 @@ void matrixTransposeTest::actualTestMethod ( tester &test, int param1, int param
     }
 
     test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    swappedIn += managedMemory::defaultManager->getTotalSwappedInBytes();
+    swappedOut += managedMemory::defaultManager->getTotalSwappedOutBytes();
+    char comment[256];
+    snprintf ( comment, 256, "swapped bytes while transposing: %.0f in, %.0f out", swappedIn, swappedOut );
+    test.addComment ( comment );
+#endif
 
 #ifdef PTEST_CHECKS
     for ( unsigned int i = 0; i < size; ++i ) {
@@ -542,6 +556,120 @@ string matrixTransposeTest::generateMyGnuplotPlotPart ( const string &file , int
 }
 
 
+TESTSTATICS ( matrixTileTransposeTest, "Same as matrixTranspose, but with the matrix being stored in square tiles of a managedTensor" );
+
+matrixTileTransposeTest::matrixTileTransposeTest() : performanceTest<int, int> ( "MatrixTileTranspose" )
+{
+    TESTPARAM ( 1, 10, 8000, 20, true, 4000, "Matrix size per dimension" );
+    TESTPARAM ( 2, 1000, 10000, 20, true, 2000, "Matrix rows in main memory" );
+    plotParts = vector<string> ( {"Allocation \\\\& Definition", "Transposition", "Deletion"} );
+}
+
+void matrixTileTransposeTest::actualTestMethod ( tester &test, int param1, int param2 )
+{
+    typedef managedTensor<double, 2>::index index;
+    const global_bytesize size = param1;
+    const global_bytesize memlines = param2;
+    const global_bytesize mem = size * sizeof ( double ) *  memlines;
+    const global_bytesize swapmem = size * size * sizeof ( double ) * 2;
+
+    rambrainglobals::config.resizeMemory ( mem );
+    rambrainglobals::config.resizeSwap ( swapmem );
+
+    test.addTimeMeasurement();
+
+    // Allocate and set, tiles are square so that the transposed counterpart of a tile is a tile as well
+    const index extents = {( unsigned int ) size, ( unsigned int ) size};
+    const index shape = managedTensor<double, 2>::chooseTileShape ( extents );
+    const unsigned int side = shape[0] < shape[1] ? shape[0] : shape[1];
+    managedTensor<double, 2> *matrix = new managedTensor<double, 2> ( extents, {side, side} );
+    matrix->forEachTile ( [size] ( double * data, const index & origin, const index & ext ) {
+        for ( unsigned int i = 0; i < ext[0]; ++i ) {
+            for ( unsigned int j = 0; j < ext[1]; ++j ) {
+                data[i * ext[1] + j] = ( origin[0] + i ) * size + origin[1] + j;
+            }
+        }
+    } );
+
+    test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    double swappedIn = -managedMemory::defaultManager->getTotalSwappedInBytes();
+    double swappedOut = -managedMemory::defaultManager->getTotalSwappedOutBytes();
+#endif
+
+    // Transpose, swapping each tile above the diagonal with its counterpart below
+    const unsigned int tiles = matrix->tileGrid() [0];
+    for ( unsigned int ti = 0; ti < tiles; ++ti ) {
+        for ( unsigned int tj = ti; tj < tiles; ++tj ) {
+            const unsigned int upper = matrix->tileAt ( {ti, tj} );
+            const unsigned int lower = matrix->tileAt ( {tj, ti} );
+            const index ext = matrix->tileExtents ( upper );
+            if ( tj + 1 < tiles ) {
+                matrix->tile ( matrix->tileAt ( {ti, tj + 1} ) ).prepareUse();
+                matrix->tile ( matrix->tileAt ( {tj + 1, ti} ) ).prepareUse();
+            }
+            adhereTo<double> uploc ( matrix->tile ( upper ) );
+            double *updbl = uploc;
+            if ( upper == lower ) {
+                for ( unsigned int i = 0; i < ext[0]; ++i ) {
+                    for ( unsigned int j = i + 1; j < ext[1]; ++j ) {
+                        double buffer = updbl[i * ext[1] + j];
+                        updbl[i * ext[1] + j] = updbl[j * ext[0] + i];
+                        updbl[j * ext[0] + i] = buffer;
+                    }
+                }
+                continue;
+            }
+            adhereTo<double> lowloc ( matrix->tile ( lower ) );
+            double *lowdbl = lowloc;
+            for ( unsigned int i = 0; i < ext[0]; ++i ) {
+                for ( unsigned int j = 0; j < ext[1]; ++j ) {
+                    double buffer = updbl[i * ext[1] + j];
+                    updbl[i * ext[1] + j] = lowdbl[j * ext[0] + i];
+                    lowdbl[j * ext[0] + i] = buffer;
+                }
+            }
+        }
+    }
+
+    test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    swappedIn += managedMemory::defaultManager->getTotalSwappedInBytes();
+    swappedOut += managedMemory::defaultManager->getTotalSwappedOutBytes();
+    char comment[256];
+    snprintf ( comment, 256, "swapped bytes while transposing: %.0f in, %.0f out; tiles of %u x %u", swappedIn, swappedOut, side, side );
+    test.addComment ( comment );
+#endif
+
+#ifdef PTEST_CHECKS
+    matrix->forEachTile ( [size] ( const double * data, const index & origin, const index & ext ) {
+        for ( unsigned int i = 0; i < ext[0]; ++i ) {
+            for ( unsigned int j = 0; j < ext[1]; ++j ) {
+                if ( data[i * ext[1] + j] != ( origin[1] + j ) * size + origin[0] + i ) {
+                    printf ( "Failed check!\n" );
+                }
+            }
+        }
+    } );
+#endif
+
+    // Delete
+    delete matrix;
+
+    test.addTimeMeasurement();
+}
+
+string matrixTileTransposeTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines title \"Allocation \\\\& Definition\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines title \"Transposition\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":5 with lines title \"Deletion\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":($3+$4+$5) with lines title \"Total\"" << endl;
+    return ss.str();
+}
+
+
 TESTSTATICS ( matrixCleverTransposeTest, "Measurements of allocation and definition, transposition, deletion times, but with a clever transposition algorithm" );
 
 matrixCleverTransposeTest::matrixCleverTransposeTest() : performanceTest<int, int> ( "MatrixCleverTranspose" )
@@ -1171,13 +1299,11 @@ void matrixMultiplyTest::actualTestMethod ( tester &test, int param1, int param2
         colsB[i] = new managedPtr<double> ( size );
         rowsC[i] = new managedPtr<double> ( size );
 
-        adhereTo<double> adhRowA ( *rowsA[i] );
-        adhereTo<double> adhColB ( *colsB[i] );
-        adhereTo<double> adhRowC ( *rowsC[i] );
+        adhereToMany<double> adhRows ( {rowsA[i], colsB[i], rowsC[i]} );
 
-        double *rowA = adhRowA;
-        double *colB = adhColB;
-        double *rowC = adhRowC;
+        double *rowA = adhRows[0];
+        double *colB = adhRows[1];
+        double *rowC = adhRows[2];
 
         for ( global_bytesize j = 0; j < size; ++j ) {
             rowA[j] = j;
@@ -1188,6 +1314,10 @@ void matrixMultiplyTest::actualTestMethod ( tester &test, int param1, int param2
     }
 
     test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    double swappedIn = -managedMemory::defaultManager->getTotalSwappedInBytes();
+    double swappedOut = -managedMemory::defaultManager->getTotalSwappedOutBytes();
+#endif
 
     // Calculate C = A * B
     for ( global_bytesize i = 0; i < size; ++i ) {
@@ -1208,6 +1338,13 @@ void matrixMultiplyTest::actualTestMethod ( tester &test, int param1, int param2
     }
 
     test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    swappedIn += managedMemory::defaultManager->getTotalSwappedInBytes();
+    swappedOut += managedMemory::defaultManager->getTotalSwappedOutBytes();
+    char comment[256];
+    snprintf ( comment, 256, "swapped bytes while multiplying: %.0f in, %.0f out", swappedIn, swappedOut );
+    test.addComment ( comment );
+#endif
 
 #ifdef PTEST_CHECKS
     double val = 0.0;
@@ -1247,6 +1384,135 @@ string matrixMultiplyTest::generateMyGnuplotPlotPart ( const string &file , int
     return ss.str();
 }
 
+TESTSTATICS ( matrixTileMultiplyTest, "Same as matrixMultiply, but with the matrices being stored in square tiles of a managedTensor" );
+
+matrixTileMultiplyTest::matrixTileMultiplyTest() : performanceTest<int, int> ( "MatrixTileMultiply" )
+{
+    TESTPARAM ( 1, 10, 6000, 20, true, 4000, "Matrix size per dimension" );
+    TESTPARAM ( 2, 4000, 15000, 20, true, 6000, "Matrix rows in main memory" );
+    plotParts = vector<string> ( {"Allocation \\\\& Definition", "Multiplication", "Deletion"} );
+}
+
+void matrixTileMultiplyTest::actualTestMethod ( tester &test, int param1, int param2 )
+{
+    typedef managedTensor<double, 2>::index index;
+    const global_bytesize size = param1;
+    const global_bytesize memlines = param2;
+    const global_bytesize mem = size * sizeof ( double ) *  memlines;
+    const global_bytesize swapmem = size * size * sizeof ( double ) * 4;
+
+    rambrainglobals::config.resizeMemory ( mem );
+    rambrainglobals::config.resizeSwap ( swapmem );
+
+
+    test.addTimeMeasurement();
+
+    // Allocate and set matrixes A, B and C
+    const index extents = {( unsigned int ) size, ( unsigned int ) size};
+    const index shape = managedTensor<double, 2>::chooseTileShape ( extents );
+    const unsigned int side = shape[0] < shape[1] ? shape[0] : shape[1];
+    managedTensor<double, 2> *A = new managedTensor<double, 2> ( extents, {side, side} );
+    managedTensor<double, 2> *B = new managedTensor<double, 2> ( extents, {side, side} );
+    managedTensor<double, 2> *C = new managedTensor<double, 2> ( extents, {side, side} );
+    A->forEachTile ( [] ( double * data, const index & origin, const index & ext ) {
+        for ( unsigned int i = 0; i < ext[0]; ++i ) {
+            for ( unsigned int j = 0; j < ext[1]; ++j ) {
+                data[i * ext[1] + j] = origin[1] + j;
+            }
+        }
+    } );
+    // B = transpose(A)
+    B->forEachTile ( [] ( double * data, const index & origin, const index & ext ) {
+        for ( unsigned int i = 0; i < ext[0]; ++i ) {
+            for ( unsigned int j = 0; j < ext[1]; ++j ) {
+                data[i * ext[1] + j] = origin[0] + i;
+            }
+        }
+    } );
+    C->forEachTile ( [] ( double * data, const index &, const index & ext ) {
+        for ( unsigned int i = 0; i < ext[0] * ext[1]; ++i ) {
+            data[i] = 0.0;
+        }
+    } );
+
+    test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    double swappedIn = -managedMemory::defaultManager->getTotalSwappedInBytes();
+    double swappedOut = -managedMemory::defaultManager->getTotalSwappedOutBytes();
+#endif
+
+    // Calculate C = A * B tile-wise, C_IJ += A_IK * B_KJ
+    const unsigned int tiles = A->tileGrid() [0];
+    for ( unsigned int ti = 0; ti < tiles; ++ti ) {
+        for ( unsigned int tj = 0; tj < tiles; ++tj ) {
+            const unsigned int tc = C->tileAt ( {ti, tj} );
+            const index extC = C->tileExtents ( tc );
+            adhereTo<double> adhC ( C->tile ( tc ) );
+            double *tileC = adhC;
+            for ( unsigned int tk = 0; tk < tiles; ++tk ) {
+                if ( tk + 1 < tiles ) {
+                    A->tile ( A->tileAt ( {ti, tk + 1} ) ).prepareUse();
+                    B->tile ( B->tileAt ( {tk + 1, tj} ) ).prepareUse();
+                }
+                const unsigned int ta = A->tileAt ( {ti, tk} );
+                const unsigned int inner = A->tileExtents ( ta ) [1];
+                const adhereTo<double> adhA ( A->tile ( ta ) );
+                const adhereTo<double> adhB ( B->tile ( B->tileAt ( {tk, tj} ) ) );
+                const double *tileA = adhA;
+                const double *tileB = adhB;
+                for ( unsigned int i = 0; i < extC[0]; ++i ) {
+                    for ( unsigned int k = 0; k < inner; ++k ) {
+                        const double a = tileA[i * inner + k];
+                        for ( unsigned int j = 0; j < extC[1]; ++j ) {
+                            tileC[i * extC[1] + j] += a * tileB[k * extC[1] + j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    swappedIn += managedMemory::defaultManager->getTotalSwappedInBytes();
+    swappedOut += managedMemory::defaultManager->getTotalSwappedOutBytes();
+    char comment[256];
+    snprintf ( comment, 256, "swapped bytes while multiplying: %.0f in, %.0f out; tiles of %u x %u", swappedIn, swappedOut, side, side );
+    test.addComment ( comment );
+#endif
+
+#ifdef PTEST_CHECKS
+    double val = 0.0;
+    for ( global_bytesize k = 0; k < size; ++k ) {
+        val += k * k;
+    }
+    C->forEachTile ( [val] ( const double * data, const index &, const index & ext ) {
+        for ( unsigned int i = 0; i < ext[0] * ext[1]; ++i ) {
+            if ( data[i] != val ) {
+                printf ( "Failed check!\n" );
+            }
+        }
+    } );
+#endif
+
+    // Delete
+    delete A;
+    delete B;
+    delete C;
+
+    test.addTimeMeasurement();
+}
+
+string matrixTileMultiplyTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines title \"Allocation \\\\& Definition\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines title \"Multiplication\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":5 with lines title \"Deletion\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":($3+$4+$5) with lines title \"Total\"";
+    return ss.str();
+}
+
 
 #ifndef OpenMP_NOT_FOUND
 TESTSTATICS ( matrixMultiplyOpenMPTest, "Matrix multiplication with matrices being stored in columns / rows" );
@@ -1866,7 +2132,8 @@ measurePreemptiveSpeedupTest::measurePreemptiveSpeedupTest() : performanceTest<i
     TESTPARAM ( 1, 1024, 1024000, 20, true, 10240, "Byte size per used chunk" );
     TESTPARAM ( 2, 1, 200, 20, true, 100, "percentage of array that will be written to" );
     plotParts = vector<string> ( {"Set Use", "Prepare", "Calculation", \
-                                  "Set Use *", "Prepare *", "Calculation *"
+                                  "Set Use *", "Prepare *", "Calculation *", \
+                                  "Set Use (adaptive)", "Prepare (adaptive)", "Calculation (adaptive)"
                                  } );
     plotTimingStats = false;
 }
@@ -1983,6 +2250,42 @@ void measurePreemptiveSpeedupTest::actualTestMethod ( tester &test, int bytesize
     test.addExternalTime ( allPrepare2 );
     test.addExternalTime ( allCalc2 );
 
+    //Third run: preemptive, but let the scheduler adapt its fractions to the access pattern
+    std::chrono::duration<double> allSetuse3 ( 0 );
+    std::chrono::duration<double> allPrepare3 ( 0 );
+    std::chrono::duration<double> allCalc3 ( 0 );
+
+    cyclicManagedMemory *manager = ( cyclicManagedMemory * ) managedMemory::defaultManager;
+    manager->setPreemptiveLoading ( true );
+    manager->setPreemptiveUnloading ( true );
+    manager->setAdaptivePreemption ( true );
+    for ( int i = 0; i < iterations; ++i ) {
+        unsigned int use = ( i % numel );
+
+        high_resolution_clock::time_point t0 = high_resolution_clock::now();
+        adhereTo<char> glue ( ptr[use] );
+        high_resolution_clock::time_point t1 = high_resolution_clock::now();
+        char *loc = glue; //Actually use the stuff.
+        high_resolution_clock::time_point t2 = high_resolution_clock::now();
+
+        for ( int r = 0; r < rewritetimes * bytesize; r++ ) {
+            loc[r % bytesize] = r * i;
+        }
+        high_resolution_clock::time_point t3 = high_resolution_clock::now();
+
+        allSetuse3 += duration_cast<duration<double>> ( t1 - t0 );
+        allPrepare3 += duration_cast<duration<double>> ( t2 - t1 );
+        allCalc3 += duration_cast<duration<double>> ( t3 - t2 );
+    }
+    manager->setAdaptivePreemption ( false );
+    char comment[256];
+    snprintf ( comment, 256, "adaptive swapOutFrac = %.3f swapInFrac = %.3f preemptive hit rate = %.3f", manager->getSwapOutFrac(), manager->getSwapInFrac(), manager->getPreemptiveHitRate() );
+    test.addComment ( comment );
+
+    test.addExternalTime ( allSetuse3 );
+    test.addExternalTime ( allPrepare3 );
+    test.addExternalTime ( allCalc3 );
+
     for ( unsigned int n = 0; n < numel; ++n ) {
         delete ptr[n];
     }
@@ -2000,7 +2303,11 @@ string measurePreemptiveSpeedupTest::generateMyGnuplotPlotPart ( const string &f
     ss << "'" << file << "' using " << paramColumn << ":7 with lines lt 2 lc 2 title \"type *ptr = glue *\", \\" << endl;
     ss << "'" << file << "' using " << paramColumn << ":8 with lines lt 2 lc 3 title \"Calculation *\", \\" << endl;
     ss << "'" << file << "' using " << paramColumn << ":(100-($8*100/($6+$7+$8))) with lines lt 2 lc 4 title \"idle time * in \%\", \\" << endl;
-    ss << "'" << file << "' using " << paramColumn << ":($6+$7+$8) with lines lt 2 lc 5 title \"Total *\"";
+    ss << "'" << file << "' using " << paramColumn << ":($6+$7+$8) with lines lt 2 lc 5 title \"Total *\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":9 with lines lt 3 lc 1 title \"adhereTo<> (adaptive)\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":10 with lines lt 3 lc 2 title \"type *ptr = glue (adaptive)\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":11 with lines lt 3 lc 3 title \"Calculation (adaptive)\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":($9+$10+$11) with lines lt 3 lc 5 title \"Total (adaptive)\"";
     return ss.str();
 }
 
@@ -2286,7 +2593,9 @@ TESTSTATICS ( demonstrateDecayTest, "Should plot regeneration of hits over misse
 demonstrateDecayTest::demonstrateDecayTest() : performanceTest<int> ( "DemonstrateDecay" )
 {
     TESTPARAM ( 1, 1024, 1024, 1, true, 1024, "Dummy pararameter" );
-    plotParts = vector<string> ( {"Element allocation", "Consecutive Access", "Random Access", "Regenerating Access"} );
+    plotParts = vector<string> ( {"Element allocation", "Consecutive Access", "Random Access", "Regenerating Access", \
+                                  "Random Access (adaptive)", "Regenerating Access (adaptive)"
+                                 } );
     plotTimingStats = true;
 }
 
@@ -2330,9 +2639,841 @@ void demonstrateDecayTest::actualTestMethod ( tester &test, int kbytesize )
     }
     //And see if we recovered from preemptives:
     test.addTimeMeasurement();
+
+    //Repeat random and regenerating phase with the scheduler adapting its preemptive window:
+    cyclicManagedMemory *manager = ( cyclicManagedMemory * ) managedMemory::defaultManager;
+    manager->setAdaptivePreemption ( true );
+    for (  unsigned int n = 0; n < n_el * efac; ++n ) {
+        unsigned int idx = test.random ( ( int ) n_el - 1 );
+        adhereTo<char> glue ( randomAccess[idx] );
+        char *loc = glue;
+        *loc = n % 256;
+    }
+    test.addTimeMeasurement();
+    char comment[256];
+    snprintf ( comment, 256, "after random access: swapOutFrac = %.3f swapInFrac = %.3f; ", manager->getSwapOutFrac(), manager->getSwapInFrac() );
+    string fractions ( comment );
+
+    for ( unsigned int n = 0; n < n_el * efac; ++n ) {
+        adhereTo<char> glue ( consecutiveAccess[n % n_el] );
+        char *loc = glue;
+        *loc = n % 256;
+    }
+    test.addTimeMeasurement();
+    snprintf ( comment, 256, "after regenerating access: swapOutFrac = %.3f swapInFrac = %.3f", manager->getSwapOutFrac(), manager->getSwapInFrac() );
+    fractions += comment;
+    test.addComment ( fractions.c_str() );
+    manager->setAdaptivePreemption ( false );
 }
 
 string demonstrateDecayTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
 {
     return "";
-}
\ No newline at end of file
+}
+
+
+TESTSTATICS ( measureDirtyTrackingTest, "Measures runtime and swapped out bytes of sparse updates to large chunks with and without dirty page tracking" );
+
+measureDirtyTrackingTest::measureDirtyTrackingTest() : performanceTest<int, int> ( "MeasureDirtyTracking" )
+{
+    TESTPARAM ( 1, 64, 65536, 11, true, 4096, "Kilobyte size per chunk" );
+    TESTPARAM ( 2, 1, 64, 7, true, 4, "Elements written per access" );
+    plotParts = vector<string> ( {"Preparation", "Sparse updates", "Preparation (tracked)", "Sparse updates (tracked)"} );
+    plotTimingStats = false;
+}
+
+void measureDirtyTrackingTest::actualTestMethod ( tester &test, int kbytesize, int writes )
+{
+    const unsigned int numel = 16;
+    const unsigned int iterations = 4 * numel;
+    const global_bytesize bytesize = kbytesize * kib;
+    const unsigned int n_doubles = bytesize / sizeof ( double );
+    global_bytesize swappedOut[2] = {0, 0};
+
+    test.setSeed();
+    test.addTimeMeasurement();
+    for ( int tracked = 0; tracked < 2; ++tracked ) {
+        //We need a file swap, whatever the configuration says:
+        managedFileSwap swap ( 2 * numel * bytesize, "./rambrainswap-%d-%d" );
+        cyclicManagedMemory manager ( &swap, numel / 4 * bytesize );
+        manager.setPreemptiveLoading ( false );
+        manager.setPreemptiveUnloading ( false );
+        swap.setDirtyTracking ( tracked == 1 );
+
+        managedPtr<double> *ptr[numel];
+        for ( unsigned int n = 0; n < numel; ++n ) {
+            ptr[n] = new managedPtr<double> ( n_doubles );
+            adhereTo<double> glue ( ptr[n] );
+            double *loc = glue;
+            for ( unsigned int j = 0; j < n_doubles; ++j ) {
+                loc[j] = j;
+            }
+        }
+        //A reading pass leaves every chunk with a copy on disk
+        for ( unsigned int n = 0; n < numel; ++n ) {
+            adhereTo<double> glue ( ptr[n] );
+            const double *loc = glue;
+            if ( loc[0] != 0. ) {
+                errmsg ( "Failed check!" );
+            }
+        }
+        test.addTimeMeasurement();
+#ifdef SWAPSTATS
+        manager.resetSwapstats();
+#endif
+
+        for ( unsigned int i = 0; i < iterations; ++i ) {
+            adhereTo<double> glue ( ptr[i % numel] );
+            double *loc = glue;
+            for ( int w = 0; w < writes; ++w ) {
+                loc[test.random ( ( int ) n_doubles - 1 )] += 1.;
+            }
+        }
+        test.addTimeMeasurement();
+#ifdef SWAPSTATS
+        swappedOut[tracked] = manager.getTotalSwappedOutBytes();
+#endif
+
+        for ( unsigned int n = 0; n < numel; ++n ) {
+            delete ptr[n];
+        }
+    }
+
+    char comment[256];
+    snprintf ( comment, 256, "swapped out bytes during sparse updates: %lu without, %lu with dirty tracking", swappedOut[0], swappedOut[1] );
+    test.addComment ( comment );
+}
+
+string measureDirtyTrackingTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":4 with lines lt 1 lc 1 title \"Sparse updates\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":6 with lines lt 1 lc 2 title \"Sparse updates (tracked)\"";
+    return ss.str();
+}
+
+
+TESTSTATICS ( measureAppendGrowthTest, "Measures runtime and swapped in bytes of arrays growing by appends, copying into a new array vs. resizing with mrealloc" );
+
+measureAppendGrowthTest::measureAppendGrowthTest() : performanceTest<int, int> ( "MeasureAppendGrowth" )
+{
+    TESTPARAM ( 1, 16, 4096, 9, true, 256, "Kilobytes appended per step" );
+    TESTPARAM ( 2, 1, 16, 5, true, 4, "Arrays grown in turn" );
+    plotParts = vector<string> ( {"Copying growth", "Resizing growth"} );
+    plotTimingStats = false;
+}
+
+void measureAppendGrowthTest::actualTestMethod ( tester &test, int kbytestep, int arrays )
+{
+    const unsigned int steps = 16;
+    const unsigned int stepDoubles = kbytestep * kib / sizeof ( double );
+    const global_bytesize finalBytes = steps * stepDoubles * sizeof ( double );
+    global_bytesize swappedIn[2] = {0, 0};
+
+    test.addTimeMeasurement();
+    for ( int resize = 0; resize < 2; ++resize ) {
+        //We need a file swap, whatever the configuration says:
+        managedFileSwap swap ( 2 * arrays * finalBytes, "./rambrainswap-%d-%d" );
+        cyclicManagedMemory manager ( &swap, ( arrays / 2 + 2 ) * finalBytes );
+
+        managedPtr<double> **ptr = new managedPtr<double>*[arrays];
+        for ( int a = 0; a < arrays; ++a ) {
+            ptr[a] = new managedPtr<double> ( stepDoubles );
+            adhereTo<double> glue ( ptr[a] );
+            double *loc = glue;
+            for ( unsigned int j = 0; j < stepDoubles; ++j ) {
+                loc[j] = j;
+            }
+        }
+        for ( unsigned int s = 1; s < steps; ++s ) {
+            for ( int a = 0; a < arrays; ++a ) {
+                unsigned int old = ptr[a]->size();
+                if ( resize ) {
+                    ptr[a]->mrealloc ( old + stepDoubles );
+                } else {
+                    managedPtr<double> *grown = new managedPtr<double> ( old + stepDoubles );
+                    {
+                        adhereTo<double> fromGlue ( ptr[a] );
+                        adhereTo<double> toGlue ( grown );
+                        const double *from = fromGlue;
+                        double *to = toGlue;
+                        memcpy ( to, from, old * sizeof ( double ) );
+                    }
+                    delete ptr[a];
+                    ptr[a] = grown;
+                }
+                adhereTo<double> glue ( ptr[a], old, old + stepDoubles );
+                double *loc = glue;
+                for ( unsigned int j = 0; j < stepDoubles; ++j ) {
+                    loc[j] = old + j;
+                }
+            }
+        }
+        test.addTimeMeasurement();
+#ifdef SWAPSTATS
+        swappedIn[resize] = manager.getTotalSwappedInBytes();
+#endif
+
+        for ( int a = 0; a < arrays; ++a ) {
+            delete ptr[a];
+        }
+        delete[] ptr;
+    }
+
+    char comment[256];
+    snprintf ( comment, 256, "swapped in bytes during growth: %lu copying, %lu resizing", swappedIn[0], swappedIn[1] );
+    test.addComment ( comment );
+}
+
+string measureAppendGrowthTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines lt 1 lc 1 title \"Copying growth\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines lt 1 lc 2 title \"Resizing growth\"";
+    return ss.str();
+}
+
+
+TESTSTATICS ( measureManagedVectorTest, "Measures runtime of filling containers by push_back under memory pressure, std::vector vs. managedVector vs. managedPtr regrown by copy" );
+
+measureManagedVectorTest::measureManagedVectorTest() : performanceTest<int, int> ( "MeasureManagedVector" )
+{
+    TESTPARAM ( 1, 1, 64, 7, true, 16, "Megabytes appended in total" );
+    TESTPARAM ( 2, 4, 1024, 9, true, 64, "Kilobytes per segment" );
+    plotParts = vector<string> ( {"std::vector", "managedVector", "Copying managedPtr"} );
+    plotTimingStats = false;
+}
+
+void measureManagedVectorTest::actualTestMethod ( tester &test, int mbytes, int kbytesegment )
+{
+    //Containers are filled in turn by blocks, each one fits into memory on its own, all together do not:
+    const unsigned int containers = 4;
+    const unsigned int block = 4 * kib / sizeof ( double );
+    const global_bytesize total = mbytes * mib;
+    const global_bytesize limit = total / 2;
+    const unsigned int count = total / containers / sizeof ( double ) / block * block;
+    global_bytesize segBytes = kbytesegment * kib;
+    segBytes = segBytes > limit / 16 ? limit / 16 : segBytes;
+    global_bytesize swappedIn[2] = {0, 0};
+
+    test.addTimeMeasurement();
+    {
+        vector<double> vec[containers];
+        for ( unsigned int i = 0; i < count; i += block ) {
+            for ( unsigned int c = 0; c < containers; ++c ) {
+                for ( unsigned int j = i; j < i + block; ++j ) {
+                    vec[c].push_back ( j );
+                }
+            }
+        }
+    }
+    test.addTimeMeasurement();
+
+    for ( int copying = 0; copying < 2; ++copying ) {
+        //We need a file swap, whatever the configuration says:
+        managedFileSwap swap ( 4 * total, "./rambrainswap-%d-%d" );
+        cyclicManagedMemory manager ( &swap, limit );
+
+        if ( !copying ) {
+            managedVector<double> *vec[containers];
+            for ( unsigned int c = 0; c < containers; ++c ) {
+                vec[c] = new managedVector<double> ( segBytes / sizeof ( double ) );
+            }
+            for ( unsigned int i = 0; i < count; i += block ) {
+                for ( unsigned int c = 0; c < containers; ++c ) {
+                    for ( unsigned int j = i; j < i + block; ++j ) {
+                        vec[c]->push_back ( j );
+                    }
+                }
+            }
+            for ( unsigned int c = 0; c < containers; ++c ) {
+                delete vec[c];
+            }
+        } else {
+            managedPtr<double> *ptr[containers];
+            for ( unsigned int c = 0; c < containers; ++c ) {
+                ptr[c] = new managedPtr<double> ( block );
+            }
+            for ( unsigned int i = 0; i < count; i += block ) {
+                for ( unsigned int c = 0; c < containers; ++c ) {
+                    if ( i == ptr[c]->size() ) {
+                        managedPtr<double> *grown = new managedPtr<double> ( 2 * i );
+                        {
+                            adhereTo<double> fromGlue ( ptr[c] );
+                            adhereTo<double> toGlue ( grown );
+                            const double *from = fromGlue;
+                            double *to = toGlue;
+                            memcpy ( to, from, i * sizeof ( double ) );
+                        }
+                        delete ptr[c];
+                        ptr[c] = grown;
+                    }
+                    adhereTo<double> glue ( ptr[c] );
+                    double *loc = glue;
+                    for ( unsigned int j = i; j < i + block; ++j ) {
+                        loc[j] = j;
+                    }
+                }
+            }
+            for ( unsigned int c = 0; c < containers; ++c ) {
+                delete ptr[c];
+            }
+        }
+        test.addTimeMeasurement();
+#ifdef SWAPSTATS
+        swappedIn[copying] = manager.getTotalSwappedInBytes();
+#endif
+    }
+
+    char comment[256];
+    snprintf ( comment, 256, "swapped in bytes: %lu managedVector, %lu copying managedPtr", swappedIn[0], swappedIn[1] );
+    test.addComment ( comment );
+}
+
+string measureManagedVectorTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines lt 1 lc 1 title \"std::vector\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines lt 1 lc 2 title \"managedVector\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":5 with lines lt 1 lc 3 title \"Copying managedPtr\"";
+    return ss.str();
+}
+
+
+TESTSTATICS ( measureHashMapTest, "Measures lookups in a managedHashMap four times larger than the memory limit, single and batched, vs. random access to plain managedPtrs" );
+
+measureHashMapTest::measureHashMapTest() : performanceTest<int, int> ( "MeasureHashMap" )
+{
+    TESTPARAM ( 1, 1, 64, 7, true, 4, "Memory limit [MB]" );
+    TESTPARAM ( 2, 16, 16384, 11, true, 1024, "Keys per batched lookup" );
+    plotParts = vector<string> ( {"Bulk load", "Single lookups", "Batched lookups", "Random managedPtr access"} );
+    plotTimingStats = false;
+}
+
+void measureHashMapTest::actualTestMethod ( tester &test, int mbytes, int batch )
+{
+    const global_bytesize limit = mbytes * mib;
+    //Entries take 24 bytes each in chunks filled between three eighths and three quarters, this makes for about four times the limit:
+    const unsigned int n = limit / 10;
+    const unsigned int lookups = 1 << 16;
+    double lookupRate[3];
+    double swappedIn[4] = {0, 0, 0, 0};
+
+    //We need a file swap, whatever the configuration says:
+    managedFileSwap swap ( 16 * limit, "./rambrainswap-%d-%d" );
+    cyclicManagedMemory manager ( &swap, limit );
+
+    unsigned int *queries = new unsigned int[lookups];
+    for ( unsigned int q = 0; q < lookups; ++q ) {
+        queries[q] = test.random ( ( int ) n - 1 );
+    }
+
+    test.addTimeMeasurement();
+    managedHashMap<uint64_t, uint64_t> *map = new managedHashMap<uint64_t, uint64_t>;
+    {
+        const unsigned int block = 1 << 16;
+        uint64_t *keys = new uint64_t[block];
+        uint64_t *values = new uint64_t[block];
+        for ( unsigned int first = 0; first < n; first += block ) {
+            unsigned int count = n - first < block ? n - first : block;
+            for ( unsigned int k = 0; k < count; ++k ) {
+                keys[k] = first + k;
+                values[k] = 3 * ( first + k );
+            }
+            map->bulkLoad ( keys, values, count );
+        }
+        delete[] keys;
+        delete[] values;
+    }
+    test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    swappedIn[0] = manager.getTotalSwappedInBytes();
+#endif
+    const global_bytesize tableBytes = ( global_bytesize ) map->chunkCount() * map->slotsPerChunk() * 3 * sizeof ( uint64_t );
+
+    uint64_t sum = 0;
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    for ( unsigned int q = 0; q < lookups; ++q ) {
+        uint64_t value = 0;
+        map->get ( queries[q], value );
+        sum += value;
+    }
+    lookupRate[0] = lookups / chrono::duration<double> ( chrono::high_resolution_clock::now() - start ).count();
+    test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    swappedIn[1] = manager.getTotalSwappedInBytes();
+#endif
+
+    {
+        uint64_t *keys = new uint64_t[batch];
+        uint64_t *values = new uint64_t[batch];
+        start = chrono::high_resolution_clock::now();
+        for ( unsigned int first = 0; first < lookups; first += batch ) {
+            unsigned int count = lookups - first < ( unsigned int ) batch ? lookups - first : batch;
+            for ( unsigned int k = 0; k < count; ++k ) {
+                keys[k] = queries[first + k];
+            }
+            map->getMany ( keys, values, NULL, count );
+            for ( unsigned int k = 0; k < count; ++k ) {
+                sum -= values[k];
+            }
+        }
+        lookupRate[1] = lookups / chrono::duration<double> ( chrono::high_resolution_clock::now() - start ).count();
+        delete[] keys;
+        delete[] values;
+    }
+    test.addTimeMeasurement();
+#ifdef SWAPSTATS
+    swappedIn[2] = manager.getTotalSwappedInBytes();
+#endif
+    delete map;
+
+    {
+        //Plain managedPtrs of the same size and granularity as the table's chunks:
+        const unsigned int perChunk = 4 * kib / sizeof ( uint64_t );
+        const unsigned int nChunks = tableBytes / ( 4 * kib );
+        managedPtr<uint64_t> **ptrs = new managedPtr<uint64_t>*[nChunks];
+        for ( unsigned int c = 0; c < nChunks; ++c ) {
+            ptrs[c] = new managedPtr<uint64_t> ( perChunk );
+        }
+        start = chrono::high_resolution_clock::now();
+        for ( unsigned int q = 0; q < lookups; ++q ) {
+            const adhereTo<uint64_t> glue ( ptrs[queries[q] % nChunks] );
+            const uint64_t *loc = glue;
+            sum += loc[queries[q] % perChunk];
+        }
+        lookupRate[2] = lookups / chrono::duration<double> ( chrono::high_resolution_clock::now() - start ).count();
+        test.addTimeMeasurement();
+#ifdef SWAPSTATS
+        swappedIn[3] = manager.getTotalSwappedInBytes();
+#endif
+        for ( unsigned int c = 0; c < nChunks; ++c ) {
+            delete ptrs[c];
+        }
+        delete[] ptrs;
+    }
+    delete[] queries;
+
+    char comment[512];
+    snprintf ( comment, 512, "table %lu bytes, checksum %lu; lookups/s: %.0f single, %.0f batched, %.0f managedPtr; swapped in bytes: %.0f single, %.0f batched, %.0f managedPtr",
+               tableBytes, sum, lookupRate[0], lookupRate[1], lookupRate[2], swappedIn[1] - swappedIn[0], swappedIn[2] - swappedIn[1], swappedIn[3] - swappedIn[2] );
+    test.addComment ( comment );
+}
+
+string measureHashMapTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines lt 1 lc 1 title \"Bulk load\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines lt 1 lc 2 title \"Single lookups\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":5 with lines lt 1 lc 3 title \"Batched lookups\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":6 with lines lt 1 lc 4 title \"Random managedPtr access\"";
+    return ss.str();
+}
+
+
+TESTSTATICS ( measurePinnedPhasesTest, "Measures runtime of phase-wise work on std::pmr::vectors unpinned in between vs. the same with managedPtrs" );
+
+measurePinnedPhasesTest::measurePinnedPhasesTest() : performanceTest<int, int> ( "MeasurePinnedPhases" )
+{
+    TESTPARAM ( 1, 1, 64, 7, true, 8, "Megabytes per vector" );
+    TESTPARAM ( 2, 2, 16, 4, true, 4, "Vectors" );
+    plotParts = vector<string> ( {"std::pmr::vector", "managedPtr"} );
+    plotTimingStats = false;
+}
+
+void measurePinnedPhasesTest::actualTestMethod ( tester &test, int mbytes, int vectors )
+{
+    //Each phase works on one vector, memory holds two and a half of them:
+    const unsigned int n = mbytes * mib / sizeof ( double );
+    const unsigned int phases = 4 * vectors;
+    double swappedIn[2] = {0, 0};
+
+    test.addTimeMeasurement();
+    for ( int managed = 0; managed < 2; ++managed ) {
+        //We need a file swap, whatever the configuration says:
+        managedFileSwap swap ( 2 * vectors * mbytes * mib, "./rambrainswap-%d-%d" );
+        cyclicManagedMemory manager ( &swap, 5 * mbytes * mib / 2 );
+
+        if ( !managed ) {
+            pinnedMemoryResource resource;
+            std::pmr::vector<double> **vecs = new std::pmr::vector<double>*[vectors];
+            for ( int v = 0; v < vectors; ++v ) {
+                vecs[v] = new std::pmr::vector<double> ( n, v, &resource );
+                resource.unpin ( vecs[v]->data() );
+            }
+            for ( unsigned int p = 0; p < phases; ++p ) {
+                std::pmr::vector<double> &vec = *vecs[p % vectors];
+                resource.pin ( vec.data() );
+                for ( unsigned int i = 0; i < n; ++i ) {
+                    vec[i] += 1.;
+                }
+                resource.unpin ( vec.data() );
+            }
+            for ( int v = 0; v < vectors; ++v ) {
+                delete vecs[v];
+            }
+            delete[] vecs;
+        } else {
+            managedPtr<double> **ptrs = new managedPtr<double>*[vectors];
+            for ( int v = 0; v < vectors; ++v ) {
+                ptrs[v] = new managedPtr<double> ( n, v );
+            }
+            for ( unsigned int p = 0; p < phases; ++p ) {
+                adhereTo<double> glue ( ptrs[p % vectors] );
+                double *loc = glue;
+                for ( unsigned int i = 0; i < n; ++i ) {
+                    loc[i] += 1.;
+                }
+            }
+            for ( int v = 0; v < vectors; ++v ) {
+                delete ptrs[v];
+            }
+            delete[] ptrs;
+        }
+        test.addTimeMeasurement();
+#ifdef SWAPSTATS
+        swappedIn[managed] = manager.getTotalSwappedInBytes();
+#endif
+    }
+
+    char comment[256];
+    snprintf ( comment, 256, "swapped in bytes: %.0f std::pmr::vector, %.0f managedPtr", swappedIn[0], swappedIn[1] );
+    test.addComment ( comment );
+}
+
+string measurePinnedPhasesTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines lt 1 lc 1 title \"std::pmr::vector\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines lt 1 lc 2 title \"managedPtr\"";
+    return ss.str();
+}
+
+TESTSTATICS ( measureCoroutineTasksTest, "Measures runtime of working on many managedPtrs one after the other vs. as tasks of a coroutineExecutor" );
+
+measureCoroutineTasksTest::measureCoroutineTasksTest() : performanceTest<int, int> ( "MeasureCoroutineTasks" )
+{
+    TESTPARAM ( 1, 16, 4096, 9, true, 256, "Kilobytes per managedPtr" );
+    TESTPARAM ( 2, 1, 8, 4, true, 2, "Threads running tasks" );
+    plotParts = vector<string> ( {"adhereTo", "coroutineExecutor"} );
+    plotTimingStats = false;
+}
+
+static task incrementTask ( const managedPtr<double> &ptr, unsigned int n )
+{
+    auto glue = co_await use ( ptr );
+    double *loc = glue;
+    for ( unsigned int i = 0; i < n; ++i ) {
+        loc[i] += 1.;
+    }
+}
+
+void measureCoroutineTasksTest::actualTestMethod ( tester &test, int kbytes, int threads )
+{
+    //64MB of data in total, a quarter of which fits into memory:
+    const global_bytesize total = 64 * mib;
+    const unsigned int n = kbytes * kib / sizeof ( double );
+    const unsigned int nptrs = total / ( kbytes * kib );
+
+    test.addTimeMeasurement();
+    for ( int coroutines = 0; coroutines < 2; ++coroutines ) {
+        //We need a file swap, whatever the configuration says:
+        managedFileSwap swap ( 2 * total, "./rambrainswap-%d-%d" );
+        cyclicManagedMemory manager ( &swap, total / 4 );
+        managedPtr<double> **ptrs = new managedPtr<double>*[nptrs];
+        for ( unsigned int p = 0; p < nptrs; ++p ) {
+            ptrs[p] = new managedPtr<double> ( n, p );
+        }
+
+        if ( !coroutines ) {
+            for ( unsigned int p = 0; p < nptrs; ++p ) {
+                adhereTo<double> glue ( ptrs[p] );
+                double *loc = glue;
+                for ( unsigned int i = 0; i < n; ++i ) {
+                    loc[i] += 1.;
+                }
+            }
+        } else {
+            coroutineExecutor executor;
+            for ( unsigned int p = 0; p < nptrs; ++p ) {
+                executor.spawn ( incrementTask ( *ptrs[p], n ) );
+            }
+            std::vector<std::thread> runners;
+            for ( int t = 1; t < threads; ++t ) {
+                runners.emplace_back ( [&executor]() {
+                    executor.run();
+                } );
+            }
+            executor.run();
+            for ( std::thread &runner : runners ) {
+                runner.join();
+            }
+        }
+        test.addTimeMeasurement();
+
+        for ( unsigned int p = 0; p < nptrs; ++p ) {
+            delete ptrs[p];
+        }
+        delete[] ptrs;
+    }
+}
+
+string measureCoroutineTasksTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines lt 1 lc 1 title \"adhereTo\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines lt 1 lc 2 title \"coroutineExecutor\"";
+    return ss.str();
+}
+
+TESTSTATICS ( measureReadMostlyTest, "Measures runtime and bytes written to swap of reading data through the C interface referenced for writing vs. read-only" );
+
+measureReadMostlyTest::measureReadMostlyTest() : performanceTest<int, int> ( "MeasureReadMostly" )
+{
+    TESTPARAM ( 1, 16, 4096, 9, true, 256, "Kilobytes per allocation" );
+    TESTPARAM ( 2, 1, 16, 5, true, 4, "Read passes" );
+    plotParts = vector<string> ( {"rambrain_reference", "rambrain_reference_const"} );
+    plotTimingStats = false;
+}
+
+void measureReadMostlyTest::actualTestMethod ( tester &test, int kbytes, int passes )
+{
+    //Data is written once and read afterwards, a quarter of it fits into memory:
+    const global_bytesize total = 64 * mib;
+    const size_t size = kbytes * kib;
+    const unsigned int nptrs = total / size;
+    double swappedOut[2] = {0, 0};
+
+    test.addTimeMeasurement();
+    for ( int readOnly = 0; readOnly < 2; ++readOnly ) {
+        //We need a file swap, whatever the configuration says:
+        managedFileSwap swap ( 2 * total, "./rambrainswap-%d-%d" );
+        cyclicManagedMemory manager ( &swap, total / 4 );
+        rambrain_ptr *ptrs = new rambrain_ptr[nptrs];
+        for ( unsigned int p = 0; p < nptrs; ++p ) {
+            ptrs[p] = rambrain_allocate ( size );
+            rambrain_reference ( ptrs[p] );
+            memset ( rambrain_ptr_to_data ( ptrs[p] ), p, size );
+            rambrain_dereference ( ptrs[p] );
+        }
+#ifdef SWAPSTATS
+        swappedOut[readOnly] = -manager.getTotalSwappedOutBytes();
+#endif
+
+        long long int sum = 0;
+        for ( int pass = 0; pass < passes; ++pass ) {
+            for ( unsigned int p = 0; p < nptrs; ++p ) {
+                if ( readOnly ) {
+                    rambrain_reference_const ( ptrs[p] );
+                } else {
+                    rambrain_reference ( ptrs[p] );
+                }
+                const char *data = ( const char * ) rambrain_ptr_to_data ( ptrs[p] );
+                for ( size_t i = 0; i < size; i += 4 * kib ) {
+                    sum += data[i];
+                }
+                rambrain_dereference ( ptrs[p] );
+            }
+        }
+        swap.waitForCleanExit();
+        test.addTimeMeasurement();
+#ifdef SWAPSTATS
+        swappedOut[readOnly] += manager.getTotalSwappedOutBytes();
+#endif
+
+        for ( unsigned int p = 0; p < nptrs; ++p ) {
+            rambrain_free ( ptrs[p] );
+        }
+        delete[] ptrs;
+    }
+
+    char comment[256];
+    snprintf ( comment, 256, "swapped out bytes while reading: %.0f rambrain_reference, %.0f rambrain_reference_const", swappedOut[0], swappedOut[1] );
+    test.addComment ( comment );
+}
+
+string measureReadMostlyTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines lt 1 lc 1 title \"rambrain\\_reference\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines lt 1 lc 2 title \"rambrain\\_reference\\_const\"";
+    return ss.str();
+}
+
+double syntheticWorkload::run ( tester &test ) const
+{
+    //We need a file swap, whatever the configuration says:
+    managedFileSwap swap ( 2 * workingSet, "./rambrainswap-%d-%d" );
+    cyclicManagedMemory manager ( &swap, workingSet * memoryPercent / 100 );
+
+    std::mt19937 rng ( seed );
+    std::uniform_real_distribution<double> unit ( 0., 1. );
+    vector<double> weights ( objects );
+    double weightSum = 0.;
+    for ( unsigned int o = 0; o < objects; ++o ) {
+        weights[o] = sizes == SIZES_LOGUNIFORM ? pow ( 64., unit ( rng ) ) : 1.;
+        weightSum += weights[o];
+    }
+    vector<managedPtr<char> *> ptrs ( objects );
+    for ( unsigned int o = 0; o < objects; ++o ) {
+        const global_bytesize size = workingSet * weights[o] / weightSum;
+        ptrs[o] = new managedPtr<char> ( size > 0 ? size : 1, 0 );
+    }
+
+    //Popularity of the object of rank k and the object having that rank:
+    vector<double> cdf ( objects );
+    double popularity = 0.;
+    for ( unsigned int k = 0; k < objects; ++k ) {
+        popularity += 1. / pow ( k + 1., zipfExponent );
+        cdf[k] = popularity;
+    }
+    for ( double &c : cdf ) {
+        c /= popularity;
+    }
+    vector<unsigned int> ranks ( objects );
+    for ( unsigned int o = 0; o < objects; ++o ) {
+        ranks[o] = o;
+    }
+    std::shuffle ( ranks.begin(), ranks.end(), rng );
+
+#ifdef SWAPSTATS
+    double swappedIn = -manager.getTotalSwappedInBytes();
+#else
+    double swappedIn = 0.;
+#endif
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    vector<std::thread> runners;
+    for ( unsigned int t = 1; t < threads; ++t ) {
+        runners.emplace_back ( [&, t]() {
+            runThread ( ptrs, cdf, ranks, t );
+        } );
+    }
+    runThread ( ptrs, cdf, ranks, 0 );
+    for ( std::thread &runner : runners ) {
+        runner.join();
+    }
+    test.addExternalTime ( std::chrono::high_resolution_clock::now() - start );
+#ifdef SWAPSTATS
+    swappedIn += manager.getTotalSwappedInBytes();
+#endif
+
+    for ( managedPtr<char> *ptr : ptrs ) {
+        delete ptr;
+    }
+    return swappedIn;
+}
+
+void syntheticWorkload::runThread ( vector<managedPtr<char> *> &ptrs, const vector<double> &cdf, const vector<unsigned int> &ranks, unsigned int thread ) const
+{
+    std::mt19937 rng ( seed + 1 + thread );
+    std::uniform_real_distribution<double> unit ( 0., 1. );
+    const unsigned int hotObjects = objects * hotPercent / 100 > 0 ? objects * hotPercent / 100 : 1;
+    long long int sum = 0;
+
+    for ( unsigned int u = 0; u < usesPerThread; ++u ) {
+        unsigned int o;
+        switch ( pattern ) {
+        case PATTERN_UNIFORM:
+            o = rng() % objects;
+            break;
+        case PATTERN_ZIPF:
+            o = ranks[std::lower_bound ( cdf.begin(), cdf.end(), unit ( rng ) ) - cdf.begin()];
+            break;
+        case PATTERN_SEQUENTIAL:
+            o = ( thread * objects / threads + u ) % objects;
+            break;
+        case PATTERN_HOTSETSHIFT:
+        default:
+            if ( rng() % 100 < hotAccessPercent ) {
+                o = ( u / phaseUses * hotObjects + rng() % hotObjects ) % objects;
+            } else {
+                o = rng() % objects;
+            }
+            break;
+        }
+
+        managedPtr<char> &ptr = *ptrs[o];
+        if ( rng() % 100 < writePercent ) {
+            adhereTo<char> glue ( ptr );
+            char *loc = glue;
+            for ( unsigned int i = 0; i < ptr.size(); i += 4 * kib ) {
+                loc[i] = u;
+            }
+        } else {
+            const adhereTo<char> glue ( ptr );
+            const char *loc = glue;
+            for ( unsigned int i = 0; i < ptr.size(); i += 4 * kib ) {
+                sum += loc[i];
+            }
+        }
+    }
+}
+
+TESTSTATICS ( measureWorkloadPatternsTest, "Measures runtime of synthetic workloads with uniform, Zipf, sequential and shifting hot set access patterns" );
+
+measureWorkloadPatternsTest::measureWorkloadPatternsTest() : performanceTest<int, int> ( "MeasureWorkloadPatterns" )
+{
+    TESTPARAM ( 1, 10, 100, 10, false, 25, "Ram in percent of the working set" );
+    TESTPARAM ( 2, 1, 8, 4, true, 2, "Threads" );
+    plotParts = vector<string> ( {"uniform", "Zipf", "sequential", "hot set shift"} );
+    plotTimingStats = false;
+}
+
+void measureWorkloadPatternsTest::actualTestMethod ( tester &test, int memoryPercent, int threads )
+{
+    syntheticWorkload workload;
+    workload.memoryPercent = memoryPercent;
+    workload.threads = threads;
+    const syntheticWorkload::accessPattern patterns[] = {syntheticWorkload::PATTERN_UNIFORM, syntheticWorkload::PATTERN_ZIPF,
+                                                          syntheticWorkload::PATTERN_SEQUENTIAL, syntheticWorkload::PATTERN_HOTSETSHIFT
+                                                         };
+    stringstream comment;
+    comment << "swapped in bytes:";
+    for ( syntheticWorkload::accessPattern pattern : patterns ) {
+        workload.pattern = pattern;
+        comment << " " << workload.run ( test );
+    }
+    test.addComment ( comment.str().c_str() );
+}
+
+string measureWorkloadPatternsTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines lt 1 lc 1 title \"uniform\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines lt 1 lc 2 title \"Zipf\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":5 with lines lt 1 lc 3 title \"sequential\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":6 with lines lt 1 lc 4 title \"hot set shift\"";
+    return ss.str();
+}
+
+TESTSTATICS ( measureWorkloadMixTest, "Measures runtime of a Zipf distributed synthetic workload with fixed vs. mixed object sizes" );
+
+measureWorkloadMixTest::measureWorkloadMixTest() : performanceTest<int, int> ( "MeasureWorkloadMix" )
+{
+    TESTPARAM ( 1, 64, 16384, 9, true, 1024, "Objects" );
+    TESTPARAM ( 2, 0, 100, 5, false, 20, "Uses writing in percent" );
+    plotParts = vector<string> ( {"fixed sizes", "mixed sizes"} );
+    plotTimingStats = false;
+}
+
+void measureWorkloadMixTest::actualTestMethod ( tester &test, int objects, int writePercent )
+{
+    syntheticWorkload workload;
+    workload.objects = objects;
+    workload.writePercent = writePercent;
+    stringstream comment;
+    comment << "swapped in bytes:";
+    workload.sizes = syntheticWorkload::SIZES_FIXED;
+    comment << " " << workload.run ( test );
+    workload.sizes = syntheticWorkload::SIZES_LOGUNIFORM;
+    comment << " " << workload.run ( test );
+    test.addComment ( comment.str().c_str() );
+}
+
+string measureWorkloadMixTest::generateMyGnuplotPlotPart ( const string &file , int paramColumn )
+{
+    stringstream ss;
+    ss << "plot '" << file << "' using " << paramColumn << ":3 with lines lt 1 lc 1 title \"fixed sizes\", \\" << endl;
+    ss << "'" << file << "' using " << paramColumn << ":4 with lines lt 1 lc 2 title \"mixed sizes\"";
+    return ss.str();
+}
@@ -35,6 +35,12 @@
 #include "managedFileSwap.h"
 #include "cyclicManagedMemory.h"
 #include "managedPtr.h"
+#include "managedVector.h"
+#include "managedHashMap.h"
+#include "managedTensor.h"
+#include "pinnedAllocator.h"
+#include "coroutineExecutor.h"
+#include "c_interface.h"
 #include "rambrainconfig.h"
 
 using namespace std;
@@ -420,9 +426,62 @@ protected:
 #define THREEPARAMTEST(name, param1, param2, param3) TESTCLASS(name, THREEPARAMS(param1, param2, param3), THREECONVERT(param1, param2, param3), param1, param2, param3)
 
 
+/**
+ * @brief Generates a configurable load of uses on a set of managedPtrs, resembling applications rather than linear algebra kernels
+ *
+ * Objects are allocated once with their sizes drawn from the size distribution, adding up to workingSet bytes. Afterwards, threads
+ * use them one at a time as picked by the access pattern, each use touching every 4KiB of the object for reading or writing.
+ */
+class syntheticWorkload
+{
+public:
+    enum accessPattern {
+        ///Every object equally likely
+        PATTERN_UNIFORM,
+        ///Object of popularity rank k picked with probability proportional to 1/k^zipfExponent, ranks shuffled over the objects
+        PATTERN_ZIPF,
+        ///Objects in order of allocation, every thread starting at a different object
+        PATTERN_SEQUENTIAL,
+        ///hotAccessPercent of the uses go to hotPercent of the objects, the hot set moving on after every phaseUses uses of a thread
+        PATTERN_HOTSETSHIFT
+    };
+    enum sizeDistribution {
+        SIZES_FIXED,
+        ///Sizes log-uniformly distributed over a factor of 64
+        SIZES_LOGUNIFORM
+    };
+
+    unsigned int objects = 1024;
+    global_bytesize workingSet = 64 * mib;
+    sizeDistribution sizes = SIZES_FIXED;
+    accessPattern pattern = PATTERN_ZIPF;
+    double zipfExponent = 0.99;
+    unsigned int hotPercent = 10;
+    unsigned int hotAccessPercent = 90;
+    unsigned int phaseUses = 1024;
+    unsigned int writePercent = 20;
+    unsigned int threads = 1;
+    ///Ram of the manager over workingSet
+    unsigned int memoryPercent = 25;
+    unsigned int usesPerThread = 4096;
+    unsigned int seed = 42;
+
+    /**
+     * @brief Sets up a file swap and a manager, allocates the objects and runs the uses
+     * @param test Receives the time the uses took, allocation excluded
+     * @return Bytes swapped in during the uses, 0 without SWAPSTATS
+     */
+    double run ( tester &test ) const;
+
+private:
+    void runThread ( vector<managedPtr<char> *> &ptrs, const vector<double> &cdf, const vector<unsigned int> &ranks, unsigned int thread ) const;
+};
+
+
 // Actual performance test classes come here
 
 TWOPARAMTEST ( matrixTransposeTest, int, int );
+TWOPARAMTEST ( matrixTileTransposeTest, int, int );
 TWOPARAMTEST ( matrixCleverTransposeTest, int, int );
 TWOPARAMTEST ( matrixCleverTranspose2Test, int, int );
 #ifndef OpenMP_NOT_FOUND
@@ -433,6 +492,7 @@ TWOPARAMTEST ( matrixCleverBlockTransposeTest, int, int );
 TWOPARAMTEST ( matrixCleverBlockTransposeOpenMPTest, int, int );
 #endif
 TWOPARAMTEST ( matrixMultiplyTest, int, int );
+TWOPARAMTEST ( matrixTileMultiplyTest, int, int );
 #ifndef OpenMP_NOT_FOUND
 TWOPARAMTEST ( matrixMultiplyOpenMPTest, int, int );
 #endif
@@ -449,5 +509,14 @@ TWOPARAMTEST ( measurePreemptiveSpeedupTest, int, int );
 TWOPARAMTEST ( measureExplicitAsyncSpeedupTest, int, int );
 ONEPARAMTEST ( measureConstSpeedupTest, int );
 ONEPARAMTEST ( demonstrateDecayTest, int );
+TWOPARAMTEST ( measureDirtyTrackingTest, int, int );
+TWOPARAMTEST ( measureAppendGrowthTest, int, int );
+TWOPARAMTEST ( measureManagedVectorTest, int, int );
+TWOPARAMTEST ( measureHashMapTest, int, int );
+TWOPARAMTEST ( measurePinnedPhasesTest, int, int );
+TWOPARAMTEST ( measureCoroutineTasksTest, int, int );
+TWOPARAMTEST ( measureReadMostlyTest, int, int );
+TWOPARAMTEST ( measureWorkloadPatternsTest, int, int );
+TWOPARAMTEST ( measureWorkloadMixTest, int, int );
 #endif // PERFORMANCETESTCLASSES_H
 
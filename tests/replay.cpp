@@ -0,0 +1,130 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+#include "accessTrace.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+#include "managedFileSwap.h"
+
+using namespace rambrain;
+
+static void usage()
+{
+    printf ( "Usage: ./rambrain-replay <trace> [options]\n"
+             "\t-m <MB>\tram the manager may use, default: half of the trace's peak\n"
+             "\t-s <MB>\tswap size, default: twice the trace's peak\n"
+             "\t-f <mask>\tswap to files named by mask (e.g. /tmp/rambrainswap-%%d-%%d) instead of swapping to ram\n"
+             "\t-b <MB/s>\tbandwidth of the modelled swap device, default: 500\n"
+             "\t-l <us>\tlatency of a miss on the modelled swap device, default: 100\n"
+             "\t-n\tdisable preemptive loading\n" );
+}
+
+/**
+ * @brief Replays an access trace recorded by accessTrace against cyclicManagedMemory and reports how the scheduler did
+ * @param argc Expects at least one argument
+ * @param argv First argument: trace file, options as printed by usage()
+ * @note Without -f, chunks are swapped to a managedDummySwap, which evaluates the scheduling policy without any io
+ */
+int main ( int argc, char **argv )
+{
+    if ( argc < 2 ) {
+        usage();
+        return -1;
+    }
+    std::vector<accessRecord> records;
+    if ( !accessTrace::read ( argv[1], records ) ) {
+        fprintf ( stderr, "Could not read access trace %s\n", argv[1] );
+        return -1;
+    }
+
+    //Peak of allocated bytes, chunks allocated before recording counted from their first record:
+    global_bytesize live = 0, peak = 0;
+    std::unordered_map<memoryID, global_bytesize> sizes;
+    for ( const accessRecord &record : records ) {
+        if ( record.op == ACCESS_FREE ) {
+            auto found = sizes.find ( record.id );
+            if ( found != sizes.end() ) {
+                live -= found->second;
+                sizes.erase ( found );
+            }
+        } else if ( sizes.insert ( {record.id, record.size} ).second ) {
+            live += record.size;
+            peak = live > peak ? live : peak;
+        }
+    }
+
+    global_bytesize memory = peak / 2, swapSize = 2 * peak;
+    const char *mask = NULL;
+    double bandwidth = 500., latency = 100.;
+    bool preemptive = true;
+    for ( int a = 2; a < argc; ++a ) {
+        const bool hasValue = a + 1 < argc;
+        if ( !strcmp ( argv[a], "-m" ) && hasValue ) {
+            memory = atof ( argv[++a] ) * mib;
+        } else if ( !strcmp ( argv[a], "-s" ) && hasValue ) {
+            swapSize = atof ( argv[++a] ) * mib;
+        } else if ( !strcmp ( argv[a], "-f" ) && hasValue ) {
+            mask = argv[++a];
+        } else if ( !strcmp ( argv[a], "-b" ) && hasValue ) {
+            bandwidth = atof ( argv[++a] );
+        } else if ( !strcmp ( argv[a], "-l" ) && hasValue ) {
+            latency = atof ( argv[++a] );
+        } else if ( !strcmp ( argv[a], "-n" ) ) {
+            preemptive = false;
+        } else {
+            usage();
+            return -1;
+        }
+    }
+
+    managedSwap *swap;
+    if ( mask ) {
+        swap = new managedFileSwap ( swapSize, mask );
+    } else {
+        swap = new managedDummySwap ( swapSize );
+    }
+    accessReplayResult result;
+    {
+        cyclicManagedMemory manager ( swap, memory );
+        manager.setPreemptiveLoading ( preemptive );
+        result = replayAccessTrace ( records, &manager, bandwidth * mib, latency * 1e-6 );
+    }
+    delete swap;
+
+    printf ( "#Trace\t%s\n", argv[1] );
+    printf ( "#Records\t%llu\n", ( unsigned long long ) result.records );
+    printf ( "#Peak [B]\t%llu\n", ( unsigned long long ) peak );
+    printf ( "#Memory [B]\t%llu\n", ( unsigned long long ) memory );
+    printf ( "#Allocations\t%llu\n", ( unsigned long long ) result.allocations );
+    printf ( "#Uses\t%llu\n", ( unsigned long long ) result.uses );
+    printf ( "#Hits\t%llu\n", ( unsigned long long ) result.hits );
+    printf ( "#Misses\t%llu\n", ( unsigned long long ) result.misses );
+    printf ( "#Failed uses\t%llu\n", ( unsigned long long ) result.failed );
+    printf ( "#Hit rate\t%g\n", result.uses > 0 ? ( double ) result.hits / result.uses : 1. );
+    printf ( "#Swapped out [B]\t%llu\n", ( unsigned long long ) result.swapout_bytes );
+    printf ( "#Swapped in [B]\t%llu\n", ( unsigned long long ) result.swapin_bytes );
+    printf ( "#Replay time [s]\t%g\n", result.seconds );
+    printf ( "#Simulated time [s]\t%g\n", result.simulated_seconds );
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "accessTrace.h"
+#include "managedPtr.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+
+using namespace rambrain;
+
+/**
+ * @test Records a cyclic access pattern, reads it back and replays it against managers with too little and with enough ram
+ */
+TEST ( accessTrace, Unit_RecordAndReplay )
+{
+#ifdef WIN32
+    const char *path = "rambrain-access-test.trace";
+#else
+    const char *path = "/tmp/rambrain-access-test.trace";
+#endif
+    const unsigned int nptrs = 16, size = 4 * kib, rounds = 4;
+    {
+        managedDummySwap swap ( 2 * nptrs * size );
+        cyclicManagedMemory managedMemory ( &swap, nptrs * size / 4 );
+
+        ASSERT_TRUE ( accessTrace::start ( path ) );
+        EXPECT_FALSE ( accessTrace::start ( path ) );
+        std::vector<managedPtr<char> *> ptrs;
+        for ( unsigned int p = 0; p < nptrs; ++p ) {
+            ptrs.push_back ( new managedPtr<char> ( size ) );
+        }
+        for ( unsigned int r = 0; r < rounds; ++r ) {
+            for ( managedPtr<char> *ptr : ptrs ) {
+                adhereTo<char> glue ( *ptr );
+                char *loc = glue;
+                ++loc[0];
+            }
+        }
+        for ( managedPtr<char> *ptr : ptrs ) {
+            delete ptr;
+        }
+        ASSERT_TRUE ( accessTrace::stop() );
+        EXPECT_FALSE ( accessTrace::stop() );
+    }
+
+    std::vector<accessRecord> records;
+    ASSERT_TRUE ( accessTrace::read ( path, records ) );
+    remove ( path );
+    unsigned int counts[ACCESS_UNUSE + 1] = {0};
+    for ( const accessRecord &record : records ) {
+        ASSERT_LE ( record.op, ( uint8_t ) ACCESS_UNUSE );
+        EXPECT_EQ ( size, record.size );
+        EXPECT_EQ ( records[0].thread, record.thread );
+        ++counts[record.op];
+    }
+    EXPECT_EQ ( nptrs, counts[ACCESS_ALLOC] );
+    EXPECT_EQ ( nptrs, counts[ACCESS_FREE] );
+    EXPECT_LE ( nptrs * rounds, counts[ACCESS_USE] );
+    EXPECT_EQ ( counts[ACCESS_USE], counts[ACCESS_UNUSE] );
+
+    {
+        managedDummySwap swap ( 2 * nptrs * size );
+        cyclicManagedMemory managedMemory ( &swap, nptrs * size / 4 );
+        managedMemory.setPreemptiveLoading ( false );
+        accessReplayResult result = replayAccessTrace ( records, &managedMemory );
+        EXPECT_EQ ( records.size(), result.records );
+        EXPECT_EQ ( nptrs, result.allocations );
+        EXPECT_EQ ( counts[ACCESS_USE], result.uses );
+        EXPECT_EQ ( result.uses, result.hits + result.misses );
+        //Cycling through four times the ram misses every chunk after the first round:
+        EXPECT_LE ( nptrs * ( rounds - 1 ), result.misses );
+#ifdef SWAPSTATS
+        EXPECT_LE ( nptrs * ( rounds - 1 ) * size, result.swapin_bytes );
+        EXPECT_LT ( 0u, result.swapout_bytes );
+#endif
+        EXPECT_LE ( result.seconds, result.simulated_seconds );
+        EXPECT_EQ ( 0u, managedMemory.getUsedMemory() + managedMemory.getSwappedMemory() );
+    }
+    {
+        managedDummySwap swap ( 2 * nptrs * size );
+        cyclicManagedMemory managedMemory ( &swap, 2 * nptrs * size );
+        accessReplayResult result = replayAccessTrace ( records, &managedMemory );
+        EXPECT_EQ ( 0u, result.misses );
+        EXPECT_EQ ( 0u, result.swapout_bytes + result.swapin_bytes );
+    }
+}
+
+/**
+ * @test Replays uses of two threads that do not fit into the replay's memory together, the replay goes on and counts the failure
+ */
+TEST ( accessTrace, Unit_ReplayFailedUses )
+{
+    const global_bytesize size = 3 * kib;
+    const accessRecord records[] = {
+        {1, size, 0, ACCESS_ALLOC, 0, 0}, {2, size, 1, ACCESS_ALLOC, 0, 0},
+        {1, size, 0, ACCESS_USE, 1, 0}, {2, size, 1, ACCESS_USE, 1, 0},
+        {1, size, 0, ACCESS_UNUSE, 0, 0}, {2, size, 1, ACCESS_UNUSE, 0, 0},
+        {2, size, 1, ACCESS_USE, 0, 0}, {2, size, 1, ACCESS_UNUSE, 0, 0}
+    };
+
+    managedDummySwap swap ( 4 * size );
+    cyclicManagedMemory managedMemory ( &swap, 4 * kib );
+    accessReplayResult result;
+    ASSERT_NO_THROW ( result = replayAccessTrace ( std::vector<accessRecord> ( records, records + 8 ), &managedMemory ) );
+    EXPECT_EQ ( 3u, result.uses );
+    EXPECT_EQ ( 1u, result.failed );
+    EXPECT_EQ ( result.uses, result.hits + result.misses + result.failed );
+    EXPECT_EQ ( 0u, managedMemory.getUsedMemory() + managedMemory.getSwappedMemory() );
+}
+
+RESTORE_WARNINGS;
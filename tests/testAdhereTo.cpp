@@ -24,6 +24,9 @@ IGNORE_TEST_WARNINGS;
 #include "managedPtr.h"
 #include "cyclicManagedMemory.h"
 #include "managedDummySwap.h"
+#include "managedFileSwap.h"
+#include <atomic>
+#include <thread>
 
 #ifndef OpenMP_NOT_FOUND
 #include <omp.h>
@@ -310,5 +313,263 @@ TEST ( adhereTo, Unit_CopyCorrectness )
     } );
 }
 
-RESTORE_WARNINGS;
+/**
+ * @test Checks that range adherence points to the first element of the range and is written back correctly
+ */
+TEST ( adhereTo, Unit_RangeAccess )
+{
+    const unsigned int count = 10;
+    managedDummySwap swap ( kib );
+    cyclicManagedMemory managedMemory ( &swap, kib );
+    managedPtr<double> ptr ( count );
+    ASSERT_FALSE ( ptr.isSegmented() );
+    ASSERT_EQ ( count, ptr.segmentLength() );
+
+    {
+        adhereTo<double> glue ( ptr, 3, 7 );
+        double *loc = glue;
+        for ( unsigned int i = 0; i < 4; ++i ) {
+            loc[i] = i + 3;
+        }
+    }
+
+    ADHERETOLOC ( double, ptr, loc );
+    for ( unsigned int i = 3; i < 7; ++i ) {
+        EXPECT_EQ ( i, loc[i] );
+    }
+
+    EXPECT_THROW ( adhereTo<double> ( ptr, 5, 5 ), memoryException );
+    EXPECT_THROW ( adhereTo<double> ( ptr, 5, count + 1 ), memoryException );
+}
+
+/**
+ * @test Checks that segmented arrays may only be adhered to within one segment
+ */
+TEST ( adhereTo, Unit_RangeSegmentBoundaries )
+{
+    managedDummySwap swap ( 10 * kib );
+    cyclicManagedMemory managedMemory ( &swap, kib );
+    managedMemory.setSegmentSize ( 64 * sizeof ( double ) );
+    managedPtr<double> ptr ( 200 );
+
+    ASSERT_TRUE ( ptr.isSegmented() );
+    ASSERT_EQ ( 64u, ptr.segmentLength() );
+
+    EXPECT_THROW ( adhereTo<double> glue ( ptr ), memoryException );
+    EXPECT_THROW ( adhereTo<double> glue ( ptr, 60, 70 ), memoryException );
+    EXPECT_NO_THROW ( adhereTo<double> glue ( ptr, 64, 128 ) );
+    //The last segment is shorter:
+    EXPECT_NO_THROW ( adhereTo<double> glue ( ptr, 192, 200 ) );
+}
 
+/**
+ * @test Streams through an array larger than the memory limit range by range, only touched segments are resident
+ */
+TEST ( adhereTo, Unit_RangeLargerThanMemory )
+{
+    const unsigned int count = 4 * kib / sizeof ( double );
+    managedDummySwap swap ( 16 * kib );
+    cyclicManagedMemory managedMemory ( &swap, kib );
+    managedMemory.setSegmentSize ( kib / 4 );
+    managedPtr<double> ptr ( count );
+
+    ASSERT_TRUE ( ptr.isSegmented() );
+    const unsigned int segment = ptr.segmentLength();
+    ASSERT_LT ( segment * sizeof ( double ), kib );
+
+    for ( unsigned int begin = 0; begin < count; begin += segment ) {
+        unsigned int end = std::min ( count, begin + segment );
+        adhereTo<double> glue ( ptr, begin, end );
+        double *loc = glue;
+        for ( unsigned int i = begin; i < end; ++i ) {
+            loc[i - begin] = i;
+        }
+        ASSERT_LE ( managedMemory.getUsedMemory(), kib );
+    }
+
+    for ( unsigned int begin = 0; begin < count; begin += segment ) {
+        unsigned int end = std::min ( count, begin + segment );
+        adhereTo<double> glue ( ptr, begin, end );
+        const double *loc = glue;
+        for ( unsigned int i = begin; i < end; ++i ) {
+            ASSERT_EQ ( i, loc[i - begin] );
+        }
+    }
+}
+
+/**
+ * @test Adheres to changing sets of managedPtrs that fit into memory only set by set, checks that all of a set are resident at once
+ */
+TEST ( adhereTo, Unit_ManyLoadsAllAtOnce )
+{
+    const unsigned int count = 128;
+    managedDummySwap swap ( 16 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 3 * count * sizeof ( double ) );
+    managedPtr<double> *ptrs[6];
+    for ( unsigned int p = 0; p < 6; ++p ) {
+        ptrs[p] = new managedPtr<double> ( count, p );
+    }
+    ASSERT_LT ( 0u, managedMemory.getSwappedMemory() );
+
+    for ( unsigned int round = 0; round < 4; ++round ) {
+        for ( unsigned int first = 0; first < 6; first += 3 ) {
+            adhereToMany<double> glue ( ptrs + first, 3 );
+            ASSERT_EQ ( 3u, glue.size() );
+            ASSERT_LE ( managedMemory.getUsedMemory(), managedMemory.getMemoryLimit() );
+            for ( unsigned int p = 0; p < 3; ++p ) {
+                ASSERT_EQ ( MEM_ALLOCATED_INUSE_WRITE, ptrs[first + p]->chunk->status );
+            }
+            for ( unsigned int p = 0; p < 3; ++p ) {
+                double *loc = glue[p];
+                for ( unsigned int i = 0; i < count; ++i ) {
+                    ASSERT_EQ ( first + p + round, loc[i] );
+                    ++loc[i];
+                }
+            }
+        }
+    }
+
+    for ( unsigned int p = 0; p < 6; ++p ) {
+        ASSERT_EQ ( 0u, ptrs[p]->chunk->useCnt );
+        delete ptrs[p];
+    }
+}
+
+/**
+ * @test Checks read-only adhering, listing a managedPtr twice and adhering to all segments of a segmented managedPtr
+ */
+TEST ( adhereTo, Unit_ManyReadOnlyDuplicatesAndSegments )
+{
+    managedDummySwap swap ( 16 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 2 * kib );
+    managedMemory.setSegmentSize ( 64 * sizeof ( double ) );
+    managedPtr<double> segmented ( 200, 1. ), small ( 16, 2. ), empty ( 0 );
+    ASSERT_TRUE ( segmented.isSegmented() );
+
+    {
+        const adhereToMany<double> glue ( {&small, &segmented, &small, &empty}, false );
+        EXPECT_EQ ( 2u, small.chunk->useCnt );
+        EXPECT_EQ ( MEM_ALLOCATED_INUSE_READ, small.chunk->status );
+        EXPECT_EQ ( 2., glue.getConst ( 2 ) [15] );
+        EXPECT_EQ ( NULL, glue.getConst ( 3 ) );
+        for ( unsigned int s = 0; s < 4; ++s ) {
+            EXPECT_EQ ( 1., glue.getConst ( 1, s ) [0] );
+        }
+        EXPECT_THROW ( const_cast<adhereToMany<double> &> ( glue ).get ( 0 ), memoryException );
+    }
+    EXPECT_EQ ( 0u, small.chunk->useCnt );
+    EXPECT_EQ ( MEM_ALLOCATED, small.chunk->status );
+}
+
+/**
+ * @test Checks that adhering to more than fits into memory throws instead of pinning chunk after chunk
+ */
+TEST ( adhereTo, Unit_ManyTooLarge )
+{
+    managedDummySwap swap ( 16 * kib );
+    cyclicManagedMemory managedMemory ( &swap, kib );
+    managedPtr<char> ptr1 ( kib / 2 ), ptr2 ( kib / 2 ), ptr3 ( kib / 2 );
+
+    EXPECT_THROW ( adhereToMany<char> glue ( {&ptr1, &ptr2, &ptr3} ), memoryException );
+    EXPECT_EQ ( 0u, ptr1.chunk->useCnt );
+
+    adhereToMany<char> glue ( {&ptr3, &ptr1} );
+    glue[0][0] = 3;
+    glue[1][0] = 1;
+    EXPECT_EQ ( kib, managedMemory.getUsedMemory() );
+}
+
+/**
+ * @test Checks that asynchronous adhering signals at once when the swap reads synchronously and gives back its use when destroyed
+ */
+TEST ( adhereTo, Unit_AsyncDummySwap )
+{
+    managedDummySwap swap ( 16 * kib );
+    cyclicManagedMemory managedMemory ( &swap, kib );
+    managedPtr<double> ptr1 ( 96, 1. ), ptr2 ( 96, 2. ), empty ( 0 );
+    ASSERT_EQ ( MEM_SWAPPED, ptr1.chunk->status );
+
+    int called = 0;
+    {
+        asyncAdhereTo<double> glue ( ptr1, true, [&called]() {
+            ++called;
+        } );
+        EXPECT_TRUE ( glue.ready() );
+        EXPECT_EQ ( 1, called );
+        EXPECT_EQ ( MEM_ALLOCATED_INUSE_WRITE, ptr1.chunk->status );
+        double *loc = glue;
+        EXPECT_EQ ( 1., loc[95] );
+        loc[95] = 3.;
+
+        asyncAdhereTo<double> glueEmpty ( empty, false, [&called]() {
+            ++called;
+        } );
+        EXPECT_TRUE ( glueEmpty.ready() );
+        EXPECT_EQ ( 2, called );
+        const double *locEmpty = glueEmpty;
+        EXPECT_EQ ( NULL, locEmpty );
+        EXPECT_THROW ( double *loc = glueEmpty, memoryException );
+    }
+    EXPECT_EQ ( 0u, ptr1.chunk->useCnt );
+    EXPECT_EQ ( MEM_ALLOCATED, ptr1.chunk->status );
+
+    {
+        adhereTo<double> glue ( ptr2 );
+        const double *loc = glue;
+        EXPECT_EQ ( 2., loc[0] );
+    }
+    EXPECT_EQ ( MEM_SWAPPED, ptr1.chunk->status );
+    adhereTo<double> glue ( ptr1 );
+    const double *loc = glue;
+    EXPECT_EQ ( 3., loc[95] );
+}
+
+/**
+ * @test Requests several swapped out managedPtrs asynchronously from a file swap, polls for their arrival and withdraws one request
+ */
+TEST ( adhereTo, Unit_AsyncFileSwap )
+{
+    const global_bytesize mem = 256 * kib;
+#ifdef WIN32
+    managedFileSwap swap ( 8 * mem, "rambrainswap-tmp-%d-%d" );
+#else
+    managedFileSwap swap ( 8 * mem, "/tmp/rambrainswap-%d-%d" );
+#endif
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    const unsigned int count = 16 * kib / sizeof ( int ), nptrs = 48;
+    managedPtr<int> *ptrs[nptrs];
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs[p] = new managedPtr<int> ( count, p );
+    }
+
+    std::atomic<unsigned int> arrived ( 0 );
+    asyncAdhereTo<int> *glues[8];
+    for ( unsigned int g = 0; g < 8; ++g ) {
+        glues[g] = new asyncAdhereTo<int> ( *ptrs[g], g % 2 == 0, [&arrived]() {
+            ++arrived;
+        } );
+    }
+    //Withdrawing a request must neither leak its use nor disturb the others:
+    delete new asyncAdhereTo<int> ( *ptrs[8] );
+
+    for ( unsigned int g = 0; g < 8; ++g ) {
+        glues[g]->wait();
+        ASSERT_TRUE ( glues[g]->ready() );
+    }
+    //Callbacks are called right after their request became ready:
+    while ( arrived < 8 ) {
+        std::this_thread::yield();
+    }
+    for ( unsigned int g = 0; g < 8; ++g ) {
+        const int *loc = *glues[g];
+        ASSERT_EQ ( ( int ) g, loc[count - 1] );
+        delete glues[g];
+    }
+
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ASSERT_EQ ( 0u, ptrs[p]->chunk->useCnt );
+        delete ptrs[p];
+    }
+}
+
+RESTORE_WARNINGS;
@@ -0,0 +1,270 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include "c_interface.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+#include "managedFileSwap.h"
+#include <atomic>
+#include <thread>
+
+using namespace rambrain;
+
+/**
+ * @test Writes and reads back more handles than fit into memory, one and several at a time
+ */
+TEST ( cInterface, Unit_HandleReferenceMany )
+{
+    const unsigned int count = 64, nhandles = 32, batch = 4;
+    managedDummySwap swap ( nhandles * count * sizeof ( int ) * 2 );
+    cyclicManagedMemory managedMemory ( &swap, 8 * count * sizeof ( int ) );
+
+    rambrain_handle handles[nhandles];
+    for ( unsigned int h = 0; h < nhandles; ++h ) {
+        handles[h] = rambrain_handle_allocate ( count * sizeof ( int ) );
+        ASSERT_NE ( RAMBRAIN_NULL_HANDLE, handles[h] );
+        int *data = ( int * ) rambrain_handle_reference ( handles[h] );
+        ASSERT_TRUE ( data != NULL );
+        for ( unsigned int i = 0; i < count; ++i ) {
+            data[i] = h;
+        }
+        rambrain_handle_dereference ( handles[h] );
+    }
+    EXPECT_LT ( 0u, managedMemory.getSwappedMemory() );
+
+    for ( unsigned int h = 0; h < nhandles; h += batch ) {
+        void *data[batch];
+        rambrain_prefetch_many ( handles + h, batch );
+        ASSERT_TRUE ( rambrain_reference_many ( handles + h, batch, 1, data ) );
+        for ( unsigned int b = 0; b < batch; ++b ) {
+            ( ( int * ) data[b] ) [count - 1] += 1;
+        }
+        ASSERT_TRUE ( rambrain_dereference_many ( handles + h, batch ) );
+    }
+
+    for ( unsigned int h = 0; h < nhandles; ++h ) {
+        const int *data = ( const int * ) rambrain_handle_reference_const ( handles[h] );
+        ASSERT_TRUE ( data != NULL );
+        EXPECT_EQ ( ( int ) h, data[0] );
+        EXPECT_EQ ( ( int ) h + 1, data[count - 1] );
+        rambrain_handle_dereference ( handles[h] );
+    }
+
+    rambrain_free_many ( handles, nhandles );
+    EXPECT_EQ ( 0u, managedMemory.getUsedMemory() );
+    EXPECT_EQ ( 0u, managedMemory.getSwappedMemory() );
+}
+
+/**
+ * @test Checks that freed and made up handles are rejected, also after their slot was reused
+ */
+TEST ( cInterface, Unit_HandleStale )
+{
+    managedDummySwap swap ( 16 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 4 * kib );
+
+    rambrain_handle first = rambrain_handle_allocate ( 100 );
+    rambrain_handle_free ( first );
+    rambrain_handle second = rambrain_handle_allocate ( 100 );
+    ASSERT_NE ( first, second );
+
+    EXPECT_TRUE ( rambrain_handle_reference ( first ) == NULL );
+    EXPECT_TRUE ( rambrain_handle_reference_const ( RAMBRAIN_NULL_HANDLE ) == NULL );
+    EXPECT_TRUE ( rambrain_handle_reference ( second + 1 ) == NULL );
+
+    //A batch with an invalid handle references nothing:
+    rambrain_handle batch[3] = {second, first, second};
+    void *data[3];
+    EXPECT_FALSE ( rambrain_reference_many ( batch, 3, 0, data ) );
+    EXPECT_FALSE ( rambrain_dereference_many ( batch, 3 ) );
+
+    //The same handle may be referenced several times in a batch:
+    batch[1] = second;
+    ASSERT_TRUE ( rambrain_reference_many ( batch, 3, 0, data ) );
+    EXPECT_EQ ( data[0], data[2] );
+    ASSERT_TRUE ( rambrain_dereference_many ( batch, 3 ) );
+
+    //Handles not fitting into memory at once are refused instead of throwing into C:
+    rambrain_handle large[2] = {rambrain_handle_allocate ( 3 * kib ), rambrain_handle_allocate ( 3 * kib )};
+    EXPECT_FALSE ( rambrain_reference_many ( large, 2, 1, data ) );
+    rambrain_free_many ( large, 2 );
+
+    //Freeing skips invalid handles:
+    batch[0] = first;
+    rambrain_free_many ( batch, 2 );
+    EXPECT_TRUE ( rambrain_handle_reference ( second ) == NULL );
+    EXPECT_EQ ( 0u, managedMemory.getUsedMemory() );
+}
+
+/// Dummy swap holding up swapping in until it is let through
+class gatedDummySwap : public managedDummySwap
+{
+public:
+    gatedDummySwap ( global_bytesize size ) : managedDummySwap ( size ) {}
+
+    virtual global_bytesize swapIn ( managedMemoryChunk *chunk ) {
+        if ( gated ) {
+            entered = true;
+            while ( gated ) {
+                std::this_thread::yield();
+            }
+        }
+        return managedDummySwap::swapIn ( chunk );
+    }
+
+    std::atomic<bool> gated {false}, entered {false};
+};
+
+/**
+ * @test Frees a handle while another thread is inside rambrain_handle_reference on it and frees a handle that is still referenced
+ */
+TEST ( cInterface, Unit_HandleFreedWhileReferenced )
+{
+    gatedDummySwap swap ( 16 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 4 * kib );
+    managedMemory.setPreemptiveLoading ( false );
+
+    rambrain_handle first = rambrain_handle_allocate ( 3 * kib );
+    ASSERT_TRUE ( rambrain_handle_reference ( first ) != NULL );
+    rambrain_handle_dereference ( first );
+    //Makes room by swapping out the first one:
+    rambrain_handle second = rambrain_handle_allocate ( 3 * kib );
+    ASSERT_EQ ( 3 * kib, managedMemory.getSwappedMemory() );
+
+    swap.gated = true;
+    void *data = &data;
+    std::thread referencing ( [&]() {
+        data = rambrain_handle_reference ( first );
+    } );
+    while ( !swap.entered ) {
+        std::this_thread::yield();
+    }
+    //The referencing call holds the handle, it frees the chunk after giving back its use:
+    rambrain_handle_free ( first );
+    swap.gated = false;
+    referencing.join();
+    EXPECT_TRUE ( data == NULL );
+    EXPECT_TRUE ( rambrain_handle_reference ( first ) == NULL );
+    EXPECT_EQ ( 3 * kib, managedMemory.getUsedMemory() + managedMemory.getSwappedMemory() );
+
+    //Referenced data is not freed and its handle stays valid:
+    char *referenced = ( char * ) rambrain_handle_reference ( second );
+    ASSERT_TRUE ( referenced != NULL );
+    rambrain_handle_free ( second );
+    EXPECT_EQ ( referenced, rambrain_handle_reference_const ( second ) );
+    rambrain_handle batch[2] = {second, second};
+    EXPECT_TRUE ( rambrain_dereference_many ( batch, 2 ) );
+    rambrain_handle_free ( second );
+    EXPECT_TRUE ( rambrain_handle_reference ( second ) == NULL );
+    EXPECT_EQ ( 0u, managedMemory.getUsedMemory() );
+}
+
+/**
+ * @test Prefetches handles from a file swap and references them after their arrival
+ */
+TEST ( cInterface, Unit_HandlePrefetchFileSwap )
+{
+    const global_bytesize mem = 256 * kib;
+#ifdef WIN32
+    managedFileSwap swap ( 8 * mem, "rambrainswap-tmp-%d-%d" );
+#else
+    managedFileSwap swap ( 8 * mem, "/tmp/rambrainswap-%d-%d" );
+#endif
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    const unsigned int nhandles = 64, size = 16 * kib;
+
+    rambrain_handle handles[nhandles];
+    for ( unsigned int h = 0; h < nhandles; ++h ) {
+        handles[h] = rambrain_handle_allocate ( size );
+        char *data = ( char * ) rambrain_handle_reference ( handles[h] );
+        data[0] = data[size - 1] = h;
+        rambrain_handle_dereference ( handles[h] );
+    }
+    ASSERT_LT ( 0u, managedMemory.getSwappedMemory() );
+
+    rambrain_prefetch_many ( handles, 4 );
+    void *data[4];
+    ASSERT_TRUE ( rambrain_reference_many ( handles, 4, 0, data ) );
+    for ( unsigned int h = 0; h < 4; ++h ) {
+        EXPECT_EQ ( ( char ) h, ( ( char * ) data[h] ) [0] );
+        EXPECT_EQ ( ( char ) h, ( ( char * ) data[h] ) [size - 1] );
+    }
+    ASSERT_TRUE ( rambrain_dereference_many ( handles, 4 ) );
+
+    rambrain_free_many ( handles, nhandles );
+}
+
+/**
+ * @test Checks that data referenced read-only through rambrain_ptr is evicted without writing it out again
+ */
+TEST ( cInterface, Unit_ReferenceConstKeepsSwapCopy )
+{
+    const global_bytesize mem = 256 * kib;
+#ifdef WIN32
+    managedFileSwap swap ( 8 * mem, "rambrainswap-tmp-%d-%d" );
+#else
+    managedFileSwap swap ( 8 * mem, "/tmp/rambrainswap-%d-%d" );
+#endif
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    const unsigned int nptrs = 8, size = 64 * kib;
+
+    rambrain_ptr ptrs[nptrs];
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs[p] = rambrain_allocate ( size );
+        rambrain_reference ( ptrs[p] );
+        char *data = ( char * ) rambrain_ptr_to_data ( ptrs[p] );
+        data[0] = data[size - 1] = p;
+        rambrain_dereference ( ptrs[p] );
+    }
+    ASSERT_LT ( 0u, managedMemory.getSwappedMemory() );
+
+    for ( unsigned int pass = 0; pass < 3; ++pass ) {
+        //After the first pass, all data has a clean copy in swap:
+        swap.waitForCleanExit();
+#ifdef SWAPSTATS
+        double written = managedMemory.getTotalSwappedOutBytes();
+#endif
+        for ( unsigned int p = 0; p < nptrs; ++p ) {
+            rambrain_reference_const ( ptrs[p] );
+            const char *data = ( const char * ) rambrain_ptr_to_data ( ptrs[p] );
+            ASSERT_EQ ( ( char ) p, data[0] );
+            ASSERT_EQ ( ( char ) p, data[size - 1] );
+            rambrain_dereference ( ptrs[p] );
+        }
+        swap.waitForCleanExit();
+#ifdef SWAPSTATS
+        if ( pass > 0 ) {
+            EXPECT_EQ ( written, managedMemory.getTotalSwappedOutBytes() );
+        }
+#endif
+    }
+#ifdef SWAPSTATS
+    EXPECT_LT ( 0u, managedMemory.getCleanEvictionBytes() );
+#endif
+
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        rambrain_free ( ptrs[p] );
+    }
+}
+
+RESTORE_WARNINGS;
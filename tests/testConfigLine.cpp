@@ -55,3 +55,16 @@ TEST ( configLine, Unit_SetValueMissingUnit )
     EXPECT_EQ ( 123uLL, cl.value );
 }
 
+
+/**
+* @test Checks if floating point values can be set
+*/
+TEST ( configLine, Unit_SetValueDouble )
+{
+    configLine<double> cl ( "cl", .5, regexMatcher::floating );
+    EXPECT_DOUBLE_EQ ( .5, cl.value );
+    cl.setValue ( "0.85" );
+    EXPECT_DOUBLE_EQ ( .85, cl.value );
+    cl.setValue ( "2" );
+    EXPECT_DOUBLE_EQ ( 2., cl.value );
+}
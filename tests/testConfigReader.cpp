@@ -39,7 +39,33 @@ TEST ( configuration, Unit_DefaultValues )
     ASSERT_GT ( config.swapMemory.value, 0.0 );
     ASSERT_FALSE ( config.enableDMA.value );
     ASSERT_EQ ( swapPolicy::autoextendable, config.policy.value );
-    ASSERT_EQ ( 7u, config.configOptions.size() );
+    ASSERT_FALSE ( config.adaptivePreemption.value );
+    ASSERT_FALSE ( config.backgroundReclaim.value );
+    ASSERT_EQ ( 0u, config.writeBackRate.value );
+    ASSERT_FALSE ( config.dirtyTracking.value );
+    ASSERT_EQ ( 0u, config.segmentSize.value );
+    ASSERT_TRUE ( config.labelPolicies.value.empty() );
+    ASSERT_GT ( config.pinFraction.value, 0. );
+    ASSERT_LT ( config.reclaimLowWatermark.value, config.reclaimHighWatermark.value );
+    ASSERT_LT ( config.swapOutFracMin.value, config.swapInFracMax.value );
+    ASSERT_EQ ( 21u, config.configOptions.size() );
+}
+
+/**
+ * @test Checks parsing of label budgets and priorities
+ */
+TEST ( configuration, Unit_ParseLabelPolicies )
+{
+    configuration config;
+    config.labelPolicies.setValue ( "mesh:64MB:2, scratch_2:0:-1" );
+
+    ASSERT_EQ ( 2u, config.labelPolicies.value.size() );
+    EXPECT_EQ ( "mesh", config.labelPolicies.value[0].label );
+    EXPECT_EQ ( 64 * mib, config.labelPolicies.value[0].budget );
+    EXPECT_EQ ( 2, config.labelPolicies.value[0].priority );
+    EXPECT_EQ ( "scratch_2", config.labelPolicies.value[1].label );
+    EXPECT_EQ ( 0u, config.labelPolicies.value[1].budget );
+    EXPECT_EQ ( -1, config.labelPolicies.value[1].priority );
 }
 
 /**
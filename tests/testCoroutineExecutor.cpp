@@ -0,0 +1,170 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include <thread>
+#include "coroutineExecutor.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+#include "managedFileSwap.h"
+#include "exceptions.h"
+
+using namespace rambrain;
+
+static task incrementAll ( const managedPtr<int> &ptr, unsigned int count )
+{
+    auto glue = co_await use ( ptr );
+    int *loc = glue;
+    for ( unsigned int i = 0; i < count; ++i ) {
+        ++loc[i];
+    }
+}
+
+static task copyFirst ( const managedPtr<int> &from, const managedPtr<int> &to, unsigned int count )
+{
+    int first;
+    {
+        auto glue = co_await use ( from, false );
+        const int *loc = glue;
+        first = loc[0];
+    }
+    auto glue = co_await use ( to );
+    int *loc = glue;
+    for ( unsigned int i = 0; i < count; ++i ) {
+        loc[i] += first;
+    }
+}
+
+static task throwAfterUse ( const managedPtr<int> &ptr )
+{
+    auto glue = co_await use ( ptr, false );
+    const int *loc = glue;
+    if ( loc[0] >= 0 ) {
+        throw memoryException ( "Thrown by task" );
+    }
+}
+
+/**
+ * @test Runs a task per managedPtr on a single thread, with many more managedPtrs than fit into memory
+ */
+TEST ( coroutineExecutor, Unit_TasksOverDummySwap )
+{
+    const unsigned int count = 256, nptrs = 64;
+    managedDummySwap swap ( nptrs * count * sizeof ( int ) * 2 );
+    cyclicManagedMemory managedMemory ( &swap, 8 * count * sizeof ( int ) );
+    managedPtr<int> *ptrs[nptrs];
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs[p] = new managedPtr<int> ( count, p );
+    }
+
+    coroutineExecutor executor;
+    for ( unsigned int round = 0; round < 2; ++round ) {
+        for ( unsigned int p = 0; p < nptrs; ++p ) {
+            executor.spawn ( incrementAll ( *ptrs[p], count ) );
+        }
+        EXPECT_EQ ( nptrs, executor.tasksAlive() );
+        executor.run();
+        EXPECT_EQ ( 0u, executor.tasksAlive() );
+    }
+
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        adhereTo<int> glue ( *ptrs[p] );
+        const int *loc = glue;
+        ASSERT_EQ ( ( int ) p + 2, loc[0] );
+        ASSERT_EQ ( ( int ) p + 2, loc[count - 1] );
+    }
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        delete ptrs[p];
+    }
+}
+
+/**
+ * @test Runs tasks awaiting two managedPtrs each from a file swap on two threads, with a bounded number of bytes in flight
+ */
+TEST ( coroutineExecutor, Unit_TasksOverFileSwap )
+{
+    const global_bytesize mem = 512 * kib;
+#ifdef WIN32
+    managedFileSwap swap ( 16 * mem, "rambrainswap-tmp-%d-%d" );
+#else
+    managedFileSwap swap ( 16 * mem, "/tmp/rambrainswap-%d-%d" );
+#endif
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    const unsigned int count = 4 * kib / sizeof ( int ), nptrs = 512;
+    managedPtr<int> *sources[nptrs];
+    managedPtr<int> *ptrs[nptrs];
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        sources[p] = new managedPtr<int> ( count, 2 * p );
+        ptrs[p] = new managedPtr<int> ( count, p );
+    }
+    ASSERT_LT ( 0u, managedMemory.getSwappedMemory() );
+
+    coroutineExecutor executor ( mem / 4 );
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        executor.spawn ( copyFirst ( *sources[ ( p + 1 ) % nptrs], *ptrs[p], count ) );
+    }
+    std::thread second ( [&executor]() {
+        executor.run();
+    } );
+    executor.run();
+    second.join();
+    EXPECT_EQ ( 0u, executor.tasksAlive() );
+
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        adhereTo<int> glue ( *ptrs[p] );
+        const int *loc = glue;
+        ASSERT_EQ ( ( int ) ( p + 2 * ( ( p + 1 ) % nptrs ) ), loc[0] );
+        ASSERT_EQ ( loc[0], loc[count - 1] );
+    }
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        delete sources[p];
+        delete ptrs[p];
+    }
+}
+
+/**
+ * @test Checks that an exception escaping a task is rethrown by run after all tasks finished and the task's use is given back
+ */
+TEST ( coroutineExecutor, Unit_ExceptionsAreRethrown )
+{
+    managedDummySwap swap ( 16 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 4 * kib );
+    managedPtr<int> ptr1 ( 16, 1 ), ptr2 ( 16, 2 );
+
+    coroutineExecutor executor;
+    executor.spawn ( throwAfterUse ( ptr1 ) );
+    executor.spawn ( incrementAll ( ptr2, 16 ) );
+    EXPECT_THROW ( executor.run(), memoryException );
+    EXPECT_EQ ( 0u, executor.tasksAlive() );
+
+    adhereTo<int> glue1 ( ptr1 );
+    adhereTo<int> glue2 ( ptr2 );
+    const int *loc1 = glue1;
+    const int *loc2 = glue2;
+    EXPECT_EQ ( 1, loc1[0] );
+    EXPECT_EQ ( 3, loc2[15] );
+
+    //Unspawned tasks are destroyed with their handle:
+    task unspawned = incrementAll ( ptr2, 16 );
+}
+
+RESTORE_WARNINGS;
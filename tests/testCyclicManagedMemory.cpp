@@ -28,6 +28,7 @@
 #include <configreader.h>
 #include "tester.h"
 #include "rambrainconfig.h"
+#include "statsSnapshot.h"
 
 using namespace rambrain;
 
@@ -714,3 +715,173 @@ TEST ( cyclicManagedMemory, Unit_RecoveryFromRandomAccess )
 
 
 
+
+/**
+* @test Checks that the adaptive preemption controller keeps swapInFrac / swapOutFrac within their bounds and does not break the cycle
+* */
+TEST ( cyclicManagedMemory, Unit_AdaptivePreemptionStaysInBounds )
+{
+    const unsigned int n_el = 1024;
+    const unsigned int memsize = n_el * sizeof ( char ) / 2;
+    const unsigned int swapsize = 10 * memsize;
+
+    managedDummySwap swap ( swapsize );
+    cyclicManagedMemory manager ( &swap, memsize );
+
+    EXPECT_FALSE ( manager.setSwapFractionBounds ( .9, .8, .6, .9 ) );
+    ASSERT_TRUE ( manager.setSwapFractionBounds ( .85, .95, .6, .84 ) );
+    EXPECT_FALSE ( manager.setAdaptivePreemption ( true ) );
+
+    managedPtr<char> randomAccess[n_el];
+    managedPtr<char> consecutiveAccess[n_el];
+
+    tester test;
+    test.setSeed();
+
+    const float initialWindow = manager.getSwapInFrac() - manager.getSwapOutFrac();
+    for ( unsigned int n = 0; n < n_el * 10; ++n ) {
+        adhereTo<char> glue ( consecutiveAccess[n % n_el] );
+        char *loc = glue;
+        *loc = n % 256;
+    }
+    //Consecutive access is guessed right, so the preemptive window has to open:
+    const float consecutiveWindow = manager.getSwapInFrac() - manager.getSwapOutFrac();
+    const global_bytesize consecutiveAdaptations = statsSnapshot ( &manager ).scheduler.adaptations;
+    EXPECT_LT ( 0u, consecutiveAdaptations );
+    EXPECT_LT ( initialWindow, consecutiveWindow );
+    for (  unsigned int n = 0; n < n_el * 10; ++n ) {
+        unsigned int idx = test.random ( ( int ) n_el - 1 );
+        adhereTo<char> glue ( randomAccess[idx] );
+        char *loc = glue;
+        *loc = n % 256;
+
+        EXPECT_LE ( .85f, manager.getSwapInFrac() );
+        EXPECT_GE ( .95f, manager.getSwapInFrac() );
+        EXPECT_LE ( .6f, manager.getSwapOutFrac() );
+        EXPECT_GE ( .84f, manager.getSwapOutFrac() );
+    }
+    //Random access wastes most guesses, so the window has to close again:
+    EXPECT_LT ( consecutiveAdaptations, statsSnapshot ( &manager ).scheduler.adaptations );
+    EXPECT_GT ( consecutiveWindow, manager.getSwapInFrac() - manager.getSwapOutFrac() );
+    EXPECT_TRUE ( manager.checkCycle() );
+    EXPECT_LE ( 0., manager.getPreemptiveHitRate() );
+    EXPECT_GE ( 1., manager.getPreemptiveHitRate() );
+}
+
+/**
+* @test Checks that chunks of a label with higher priority stay resident while cycling through others, and that a label's budget is enforced
+* */
+TEST ( cyclicManagedMemory, Unit_LabelPolicies )
+{
+    const unsigned int size = 4 * kib, ntables = 2, nmesh = 6, nscratch = 16;
+    managedDummySwap swap ( 2 * ( ntables + nmesh + nscratch ) * size );
+    cyclicManagedMemory manager ( &swap, 12 * size );
+    manager.setPreemptiveLoading ( false );
+    manager.setLabelPolicy ( "tables", 0, 1 );
+    manager.setLabelPolicy ( "mesh", 2 * size, 1 );
+
+    //Allocated first, thus least recently used:
+    std::vector<managedPtr<char> *> ptrs;
+    for ( unsigned int p = 0; p < ntables; ++p ) {
+        ptrs.push_back ( new managedPtr<char> ( allocationLabel ( "tables" ), size ) );
+    }
+    for ( unsigned int p = 0; p < nmesh; ++p ) {
+        ptrs.push_back ( new managedPtr<char> ( allocationLabel ( "mesh" ), size ) );
+    }
+    std::vector<managedPtr<char> *> scratch;
+    for ( unsigned int p = 0; p < nscratch; ++p ) {
+        scratch.push_back ( new managedPtr<char> ( size ) );
+    }
+    for ( unsigned int r = 0; r < 3; ++r ) {
+        for ( managedPtr<char> *ptr : scratch ) {
+            adhereTo<char> glue ( *ptr );
+            char *loc = glue;
+            ++loc[0];
+        }
+    }
+
+    unsigned int found = 0;
+    for ( const labelReportEntry &entry : labelReport ( &manager ) ) {
+        if ( entry.label == "tables" ) {
+            ++found;
+            EXPECT_EQ ( ntables * size, entry.resident_bytes );
+            EXPECT_EQ ( 0u, entry.swapped_bytes );
+            EXPECT_EQ ( 1, entry.priority );
+        } else if ( entry.label == "mesh" ) {
+            ++found;
+            EXPECT_GE ( 2u * size, entry.resident_bytes );
+            EXPECT_EQ ( nmesh * size, entry.resident_bytes + entry.swapped_bytes );
+            EXPECT_EQ ( 2u * size, entry.budget );
+        } else {
+            EXPECT_EQ ( nscratch * size, entry.resident_bytes + entry.swapped_bytes );
+        }
+    }
+    EXPECT_EQ ( 2u, found );
+    EXPECT_TRUE ( manager.checkCycle() );
+
+    for ( managedPtr<char> *ptr : scratch ) {
+        delete ptr;
+    }
+    for ( managedPtr<char> *ptr : ptrs ) {
+        delete ptr;
+    }
+}
+
+/**
+ * @test Checks that a budget is enforced even if the label has the default priority and was used more recently than anything else
+ */
+TEST ( cyclicManagedMemory, Unit_LabelBudgetWithoutPriority )
+{
+    const unsigned int size = 4 * kib, nmesh = 6, nscratch = 16;
+    managedDummySwap swap ( 2 * ( nmesh + nscratch ) * size );
+    cyclicManagedMemory manager ( &swap, 12 * size );
+    manager.setPreemptiveLoading ( false );
+    manager.setLabelPolicy ( "mesh", 2 * size, 0 );
+
+    std::vector<managedPtr<char> *> scratch, mesh;
+    for ( unsigned int p = 0; p < nscratch; ++p ) {
+        scratch.push_back ( new managedPtr<char> ( size ) );
+    }
+    for ( unsigned int p = 0; p < nmesh; ++p ) {
+        mesh.push_back ( new managedPtr<char> ( allocationLabel ( "mesh" ), size ) );
+    }
+    const auto touch = [] ( managedPtr<char> *ptr ) {
+        adhereTo<char> glue ( *ptr );
+        char *loc = glue;
+        ++loc[0];
+    };
+    //The mesh is used between every scratch access, least recently used order alone would keep all of it resident:
+    for ( managedPtr<char> *ptr : scratch ) {
+        touch ( ptr );
+        for ( managedPtr<char> *meshPtr : mesh ) {
+            touch ( meshPtr );
+        }
+    }
+    //Bringing back a few scratch chunks makes room by swapping out:
+    unsigned int swappedIn = 0;
+    for ( managedPtr<char> *ptr : scratch ) {
+        if ( swappedIn < 4 && ptr->chunk->status == MEM_SWAPPED ) {
+            touch ( ptr );
+            ++swappedIn;
+        }
+    }
+    ASSERT_EQ ( 4u, swappedIn );
+
+    bool found = false;
+    for ( const labelReportEntry &entry : labelReport ( &manager ) ) {
+        if ( entry.label == "mesh" ) {
+            found = true;
+            EXPECT_GE ( 2u * size, entry.resident_bytes );
+            EXPECT_EQ ( nmesh * size, entry.resident_bytes + entry.swapped_bytes );
+        }
+    }
+    EXPECT_TRUE ( found );
+    EXPECT_TRUE ( manager.checkCycle() );
+
+    for ( managedPtr<char> *ptr : scratch ) {
+        delete ptr;
+    }
+    for ( managedPtr<char> *ptr : mesh ) {
+        delete ptr;
+    }
+}
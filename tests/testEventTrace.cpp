@@ -0,0 +1,149 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "eventTrace.h"
+#include "managedPtr.h"
+#include "cyclicManagedMemory.h"
+#include "managedFileSwap.h"
+
+using namespace rambrain;
+
+/**
+ * @test Checks that nothing is recorded while tracing is stopped and that full rings keep the latest events of each thread
+ */
+TEST ( eventTrace, Unit_RingsPerThread )
+{
+    ASSERT_TRUE ( eventTrace::start ( 16 ) );
+    EXPECT_FALSE ( eventTrace::start ( 16 ) );
+    eventTrace::stop();
+    eventTrace::record ( TRACE_TOUCH, 1 );
+    EXPECT_EQ ( 0u, eventTrace::collect().size() );
+
+    const unsigned int nthreads = 4, perThread = 100;
+    ASSERT_TRUE ( eventTrace::start ( 16 ) );
+    std::atomic<unsigned int> done ( 0 );
+    std::vector<std::thread> threads;
+    for ( unsigned int t = 0; t < nthreads; ++t ) {
+        threads.emplace_back ( [t, &done]() {
+            for ( unsigned int i = 0; i < perThread; ++i ) {
+                eventTrace::record ( TRACE_TOUCH, i, t );
+            }
+            //Threads finishing early would hand their buffer to the next one:
+            ++done;
+            while ( done < nthreads ) {
+                std::this_thread::yield();
+            }
+        } );
+    }
+    for ( std::thread &thread : threads ) {
+        thread.join();
+    }
+    eventTrace::stop();
+
+    std::vector<tracedEvent> events = eventTrace::collect();
+    ASSERT_EQ ( 16u * nthreads, events.size() );
+    for ( unsigned int e = 0; e < events.size(); ++e ) {
+        //Each thread's buffer holds its last 16 events in order:
+        EXPECT_EQ ( TRACE_TOUCH, events[e].type );
+        EXPECT_EQ ( perThread - 16 + e % 16, events[e].value );
+        EXPECT_EQ ( events[e - e % 16].arg, events[e].arg );
+        if ( e % 16 ) {
+            EXPECT_LE ( events[e - 1].time, events[e].time );
+        }
+    }
+
+    ASSERT_TRUE ( eventTrace::start ( 16 ) );
+    eventTrace::stop();
+    EXPECT_EQ ( 0u, eventTrace::collect().size() );
+}
+
+/**
+ * @test Swaps through a file swap while tracing and checks that scheduler, io and wait events make it to the Chrome trace
+ */
+TEST ( eventTrace, Unit_TraceSwapping )
+{
+    const global_bytesize mem = 256 * kib;
+#ifdef WIN32
+    managedFileSwap swap ( 8 * mem, "rambrainswap-tmp-%d-%d" );
+#else
+    managedFileSwap swap ( 8 * mem, "/tmp/rambrainswap-%d-%d" );
+#endif
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    const unsigned int nptrs = 32, size = 32 * kib;
+
+    ASSERT_TRUE ( eventTrace::start() );
+    managedPtr<char> *ptrs[nptrs];
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs[p] = new managedPtr<char> ( size, p );
+    }
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        adhereTo<char> glue ( *ptrs[p] );
+        const char *loc = glue;
+        ASSERT_EQ ( ( char ) p, loc[size - 1] );
+    }
+    swap.waitForCleanExit();
+    eventTrace::stop();
+
+    unsigned int counts[TRACE_WAIT_END + 1] = {0};
+    for ( const tracedEvent &event : eventTrace::collect() ) {
+        ASSERT_LE ( event.type, ( uint32_t ) TRACE_WAIT_END );
+        ++counts[event.type];
+    }
+    EXPECT_EQ ( nptrs, counts[TRACE_REGISTER] );
+    EXPECT_LE ( 2 * nptrs, counts[TRACE_TOUCH] );
+    EXPECT_LT ( 0u, counts[TRACE_SWAPOUT_SELECT] );
+    EXPECT_LT ( 0u, counts[TRACE_AIO_SUBMIT] );
+    EXPECT_EQ ( counts[TRACE_AIO_SUBMIT], counts[TRACE_AIO_COMPLETE] );
+    EXPECT_LT ( 0u, counts[TRACE_WAIT_BEGIN] );
+    EXPECT_EQ ( counts[TRACE_WAIT_BEGIN], counts[TRACE_WAIT_END] );
+
+    std::string trace = eventTrace::chromeTrace();
+    EXPECT_EQ ( 0u, trace.find ( "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[{\"name\":\"thread_name\",\"ph\":\"M\"," ) );
+    EXPECT_EQ ( "]}\n", trace.substr ( trace.size() - 3 ) );
+    EXPECT_NE ( std::string::npos, trace.find ( "{\"name\":\"register\",\"cat\":\"scheduler\",\"ph\":\"i\"," ) );
+    EXPECT_NE ( std::string::npos, trace.find ( "{\"name\":\"aio write\",\"cat\":\"aio\",\"ph\":\"b\",\"id\":\"0x" ) );
+    EXPECT_NE ( std::string::npos, trace.find ( "{\"name\":\"aio read\",\"cat\":\"aio\",\"ph\":\"e\",\"id\":\"0x" ) );
+    EXPECT_NE ( std::string::npos, trace.find ( "\"cat\":\"wait\",\"ph\":\"B\"," ) );
+
+#ifdef WIN32
+    const char *path = "rambrain-trace-test.json";
+#else
+    const char *path = "/tmp/rambrain-trace-test.json";
+#endif
+    ASSERT_TRUE ( eventTrace::writeChromeTrace ( path ) );
+    FILE *file = fopen ( path, "r" );
+    ASSERT_TRUE ( file != NULL );
+    fseek ( file, 0, SEEK_END );
+    EXPECT_EQ ( ( long ) trace.size(), ftell ( file ) );
+    fclose ( file );
+    remove ( path );
+
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        delete ptrs[p];
+    }
+}
+
+RESTORE_WARNINGS;
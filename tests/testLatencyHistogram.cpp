@@ -0,0 +1,133 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "latencyHistogram.h"
+#include "managedPtr.h"
+#include "cyclicManagedMemory.h"
+#include "managedFileSwap.h"
+
+using namespace rambrain;
+
+/**
+ * @test Checks that buckets cover all values without gaps and percentiles are within the bucket precision
+ */
+TEST ( latencyHistogram, Unit_BucketsAndPercentiles )
+{
+    for ( unsigned int b = 1; b < latencyHistogram::buckets; ++b ) {
+        ASSERT_EQ ( b, latencyHistogram::bucketOf ( latencyHistogram::bucketUpperBound ( b - 1 ) + 1 ) );
+        ASSERT_EQ ( b - 1, latencyHistogram::bucketOf ( latencyHistogram::bucketUpperBound ( b - 1 ) ) );
+    }
+    EXPECT_EQ ( latencyHistogram::buckets - 1, latencyHistogram::bucketOf ( UINT64_MAX ) );
+
+    latencyHistogram histogram;
+    EXPECT_EQ ( 0u, histogram.percentile ( 0.5 ) );
+    for ( uint64_t v = 1; v <= 1000; ++v ) {
+        histogram.record ( v * 1000 );
+    }
+    EXPECT_EQ ( 1000u, histogram.count() );
+    EXPECT_EQ ( 1000000u, histogram.max() );
+
+    latencySummary summary = histogram.summary();
+    EXPECT_EQ ( 1000u, summary.count );
+    EXPECT_EQ ( 500500000u, summary.sum );
+    EXPECT_NEAR ( 500000., summary.p50, 500000. / latencyHistogram::subBuckets );
+    EXPECT_NEAR ( 900000., summary.p90, 900000. / latencyHistogram::subBuckets );
+    EXPECT_NEAR ( 990000., summary.p99, 990000. / latencyHistogram::subBuckets );
+    EXPECT_LE ( summary.p99, summary.max );
+    EXPECT_EQ ( summary.p90, histogram.percentile ( 0.9 ) );
+
+    histogram.reset();
+    EXPECT_EQ ( 0u, histogram.count() );
+    EXPECT_EQ ( 0u, histogram.summary().max );
+}
+
+/**
+ * @test Records from several threads at once and checks that no value is lost when shards are merged
+ */
+TEST ( latencyHistogram, Unit_RecordFromThreads )
+{
+    const unsigned int nthreads = 2 * latencyHistogram::shards + 1, perThread = 10000;
+    latencyHistogram histogram;
+    std::vector<std::thread> threads;
+    for ( unsigned int t = 0; t < nthreads; ++t ) {
+        threads.emplace_back ( [&histogram, t]() {
+            for ( unsigned int i = 0; i < perThread; ++i ) {
+                histogram.record ( t * perThread + i );
+            }
+        } );
+    }
+    for ( std::thread &thread : threads ) {
+        thread.join();
+    }
+    EXPECT_EQ ( nthreads * perThread, histogram.count() );
+    EXPECT_EQ ( nthreads * perThread - 1, histogram.max() );
+}
+
+#ifdef SWAPSTATS
+/**
+ * @test Swaps through a file swap and checks that waiting for chunks and their io is recorded
+ */
+TEST ( latencyHistogram, Unit_ManagerRecordsStalls )
+{
+    const global_bytesize mem = 256 * kib;
+#ifdef WIN32
+    managedFileSwap swap ( 8 * mem, "rambrainswap-tmp-%d-%d" );
+#else
+    managedFileSwap swap ( 8 * mem, "/tmp/rambrainswap-%d-%d" );
+#endif
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    const unsigned int nptrs = 32, size = 32 * kib;
+
+    managedPtr<char> *ptrs[nptrs];
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs[p] = new managedPtr<char> ( size, p );
+    }
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        adhereTo<char> glue ( *ptrs[p] );
+        const char *loc = glue;
+        ASSERT_EQ ( ( char ) p, loc[size - 1] );
+    }
+
+    latencySummary aio = managedMemory.getLatency ( managedMemory::LATENCY_AIO );
+    EXPECT_LT ( 0u, aio.count );
+    EXPECT_LT ( 0u, aio.max );
+    EXPECT_LE ( aio.p50, aio.p99 );
+    EXPECT_LT ( 0u, managedMemory.getLatency ( managedMemory::LATENCY_SWAPIN_WAIT ).count );
+    EXPECT_LT ( 0u, managedMemory.getLatency ( managedMemory::LATENCY_ENSURE_SPACE ).count );
+    managedMemory.printSwapstats();
+
+    swap.waitForCleanExit();
+    managedMemory.resetSwapstats();
+    for ( int l = 0; l < managedMemory::LATENCY_STATS; ++l ) {
+        EXPECT_EQ ( 0u, managedMemory.getLatency ( ( managedMemory::latencyStat ) l ).count );
+    }
+
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        delete ptrs[p];
+    }
+}
+#endif
+
+RESTORE_WARNINGS;
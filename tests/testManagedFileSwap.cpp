@@ -29,6 +29,7 @@ IGNORE_TEST_WARNINGS;
 #include <sys/stat.h>
 #include "common.h"
 #include <chrono>
+#include <thread>
 
 #if !defined(S_ISREG) && defined(S_IFMT) && defined(S_IFREG)
 #define S_ISREG(m) (((m) & S_IFMT) == S_IFREG)
@@ -125,12 +126,12 @@ TEST ( managedFileSwap, Unit_ManualSwapping ) //This screws default manager, as
     pthread_mutex_lock ( & ( managedMemory::stateChangeMutex ) );
     EXPECT_TRUE ( swap.swapOut ( chunk ) );
 
-    swap.waitForCleanExit();
+    swap.waitForCleanExit ( true );
     ASSERT_EQ ( mib, swap.getSwapSize() );
     ASSERT_EQ ( dblsize, swap.getUsedSwap() );
 
     EXPECT_TRUE ( swap.swapIn ( chunk ) ) ;
-    swap.waitForCleanExit();
+    swap.waitForCleanExit ( true );
     ASSERT_EQ ( mib, swap.getSwapSize() );
     ASSERT_EQ ( 0u, swap.getUsedSwap() );
 
@@ -175,11 +176,11 @@ TEST ( managedFileSwap, Unit_ManualMultiSwapping )
     }
 
     swap.swapOut ( chunks, 2 );
-    swap.waitForCleanExit();
+    swap.waitForCleanExit ( true );
     ASSERT_EQ ( mib, swap.getSwapSize() );
     ASSERT_EQ ( 2 * dblsize, swap.getUsedSwap() );
     swap.swapIn ( chunks, 2 );
-    swap.waitForCleanExit();
+    swap.waitForCleanExit ( true );
     ASSERT_EQ ( mib, swap.getSwapSize() );
     ASSERT_EQ ( 0u, swap.getUsedSwap() );
 
@@ -225,13 +226,13 @@ TEST ( managedFileSwap, Unit_ManualSwappingDelete )
     chunk->size = dblsize;
 
     swap.swapOut ( chunk );
-    swap.waitForCleanExit();
+    swap.waitForCleanExit ( true );
 
     ASSERT_EQ ( mib, swap.getSwapSize() );
     ASSERT_EQ ( dblsize, swap.getUsedSwap() );
 
     swap.swapDelete ( chunk );
-    swap.waitForCleanExit();
+    swap.waitForCleanExit ( true );
 
     ASSERT_EQ ( mib, swap.getSwapSize() );
     ASSERT_EQ ( 0u, swap.getUsedSwap() );
@@ -944,5 +945,178 @@ TEST ( managedFileSwap, Unit_EmptySizeFillsUp )
     }
 }
 
-RESTORE_WARNINGS;
+/**
+ * @test Checks that chunks written back by the background reclaimer keep their data and are evicted without writing again
+ */
+TEST ( managedFileSwap, Unit_WriteBackGivesCleanCopies )
+{
+    const unsigned int amount = 1E3;
+    const unsigned int countMem = 10;
+    const unsigned int count = 3 * countMem;
+    const global_bytesize mem = amount * countMem * sizeof ( double );
+
+    managedFileSwap swap ( 10 * mem, "./rambrainswap-%d-%d" );
+    cyclicManagedMemory manager ( &swap, mem );
+    manager.setPreemptiveUnloading ( false );
+    manager.setPreemptiveLoading ( false );
+
+    EXPECT_EQ ( 0u, manager.setWriteBackRate ( 1024 * mib ) );
+    manager.setBackgroundReclaim ( true );
+
+    managedPtr<double> *ptrs[count];
+    for ( unsigned int i = 0; i < countMem - 2; ++i ) {
+        ptrs[i] = new managedPtr<double> ( amount );
+        managedPtr<double> *dat = ptrs[i];
+        ADHERETOLOC ( double, dat, loc );
+        for ( unsigned int j = 0; j < amount; ++j ) {
+            loc[j] = i * amount + j;
+        }
+    }
+
+    //Give the reclaimer some rounds to find the cold chunks
+    std::this_thread::sleep_for ( std::chrono::milliseconds ( 500 ) );
+    manager.setBackgroundReclaim ( false );
+    swap.waitForCleanExit();
+#ifdef SWAPSTATS
+    EXPECT_LT ( 0u, manager.getWriteBackBytes() );
+#endif
+
+    //Push out the cold chunks:
+    for ( unsigned int i = countMem - 2; i < count; ++i ) {
+        ptrs[i] = new managedPtr<double> ( amount );
+        managedPtr<double> *dat = ptrs[i];
+        ADHERETOLOC ( double, dat, loc );
+        for ( unsigned int j = 0; j < amount; ++j ) {
+            loc[j] = i * amount + j;
+        }
+    }
+#ifdef SWAPSTATS
+    EXPECT_LT ( 0u, manager.getCleanEvictionBytes() );
+#endif
+
+    for ( unsigned int i = 0; i < count; ++i ) {
+        managedPtr<double> *dat = ptrs[i];
+        ADHERETOLOCCONST ( double, dat, loc );
+        for ( unsigned int j = 0; j < amount; ++j ) {
+            ASSERT_EQ ( i * amount + j, loc[j] );
+        }
+    }
+    for ( unsigned int i = 0; i < count; ++i ) {
+        delete ptrs[i];
+    }
+}
+
+#ifndef _WIN32
+/**
+ * @test Checks that sparse writes to chunks having a copy on disk keep the copy and only rewrite modified pages
+ */
+TEST ( managedFileSwap, Unit_DirtyTrackingRewritesModifiedPages )
+{
+    const unsigned int amount = 64 * 1024;
+    const unsigned int countMem = 4;
+    const unsigned int count = 2 * countMem;
+    const global_bytesize mem = amount * countMem * sizeof ( double );
 
+    managedFileSwap swap ( 4 * mem, "./rambrainswap-%d-%d" );
+    cyclicManagedMemory manager ( &swap, mem );
+    manager.setPreemptiveUnloading ( false );
+    manager.setPreemptiveLoading ( false );
+    ASSERT_FALSE ( swap.setDirtyTracking ( true ) );
+    ASSERT_TRUE ( swap.getDirtyTracking() );
+
+    managedPtr<double> *ptrs[count];
+    for ( unsigned int i = 0; i < count; ++i ) {
+        ptrs[i] = new managedPtr<double> ( amount );
+        managedPtr<double> *dat = ptrs[i];
+        ADHERETOLOC ( double, dat, loc );
+        for ( unsigned int j = 0; j < amount; ++j ) {
+            loc[j] = i * amount + j;
+        }
+    }
+
+    //Each chunk is read in again, changed in a single element and pushed out by the next ones.
+    //Chunks last written at creation have no copy yet, so the first round does not count.
+    const unsigned int rounds = 3;
+    for ( unsigned int r = 0; r < rounds; ++r ) {
+#ifdef SWAPSTATS
+        if ( r == 1 ) {
+            manager.resetSwapstats();
+        }
+#endif
+        for ( unsigned int i = 0; i < count; ++i ) {
+            managedPtr<double> *dat = ptrs[i];
+            ADHERETOLOC ( double, dat, loc );
+            loc[r * ( amount / rounds ) + i] += .5;
+        }
+    }
+#ifdef SWAPSTATS
+    EXPECT_LT ( 0u, manager.getPartialSwapOutSavedBytes() );
+    EXPECT_GT ( count * amount * sizeof ( double ) / 4, manager.getTotalSwappedOutBytes() );
+#endif
+
+    //Switching off has to drop the copies outdated by now
+    EXPECT_TRUE ( swap.setDirtyTracking ( false ) );
+    for ( unsigned int i = 0; i < count; ++i ) {
+        managedPtr<double> *dat = ptrs[i];
+        ADHERETOLOCCONST ( double, dat, loc );
+        for ( unsigned int j = 0; j < amount; ++j ) {
+            bool changed = j % ( amount / rounds ) == i && j < rounds * ( amount / rounds );
+            ASSERT_EQ ( i * amount + j + ( changed ? .5 : 0. ), loc[j] );
+        }
+    }
+    for ( unsigned int i = 0; i < count; ++i ) {
+        delete ptrs[i];
+    }
+}
+#endif
+
+/**
+ * @test Checks that swapped out chunks are grown and shrunk on disk without reading them back
+ */
+TEST ( managedFileSwap, Unit_ReallocSwappedChunk )
+{
+    const unsigned int amount = 16 * 1024;
+    const global_bytesize size = amount * sizeof ( double );
+
+    managedFileSwap swap ( 16 * size, "./rambrainswap-%d-%d" );
+    cyclicManagedMemory manager ( &swap, 2 * size );
+    manager.setPreemptiveUnloading ( false );
+    manager.setPreemptiveLoading ( false );
+
+    managedPtr<double> ptr ( amount );
+    {
+        ADHERETOLOC ( double, ptr, loc );
+        for ( unsigned int j = 0; j < amount; ++j ) {
+            loc[j] = j;
+        }
+    }
+    //Pushes out ptr, the other ones are kept in between its parts on disk to prevent growing in place:
+    managedPtr<double> *others[4];
+    for ( unsigned int i = 0; i < 4; ++i ) {
+        others[i] = new managedPtr<double> ( amount );
+    }
+    ASSERT_LE ( 3 * size, swap.getUsedSwap() );
+
+    global_bytesize used = swap.getUsedSwap();
+    ASSERT_TRUE ( ptr.mrealloc ( 3 * amount ) );
+    EXPECT_EQ ( used + 2 * size, swap.getUsedSwap() );
+    ASSERT_TRUE ( ptr.mrealloc ( amount / 2 + 3 ) );
+    EXPECT_EQ ( used - size / 2 + 3 * sizeof ( double ), swap.getUsedSwap() );
+#ifdef SWAPSTATS
+    EXPECT_EQ ( 2u, manager.getSwappedReallocs() );
+    EXPECT_EQ ( 0u, manager.getResidentReallocs() );
+    EXPECT_EQ ( 0., manager.getTotalSwappedInBytes() );
+#endif
+    {
+        ADHERETOLOCCONST ( double, ptr, loc );
+        for ( unsigned int j = 0; j < amount / 2 + 3; ++j ) {
+            ASSERT_EQ ( j, loc[j] );
+        }
+    }
+    for ( unsigned int i = 0; i < 4; ++i ) {
+        delete others[i];
+    }
+    EXPECT_EQ ( swap.getSwapSize(), swap.getFreeSwap() + swap.getUsedSwap() );
+}
+
+RESTORE_WARNINGS;
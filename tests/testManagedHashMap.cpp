@@ -0,0 +1,153 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include "managedHashMap.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+#include "exceptions.h"
+
+using namespace rambrain;
+
+/**
+ * @test Checks inserting, assigning, looking up and erasing keys while chunks are split
+ */
+TEST ( managedHashMap, Unit_SetGetErase )
+{
+    managedDummySwap swap ( 100 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 100 * kib );
+    managedHashMap<int, double> map ( 16 );
+
+    ASSERT_TRUE ( map.empty() );
+    for ( int i = 0; i < 1000; ++i ) {
+        ASSERT_TRUE ( map.set ( i, i * 0.5 ) );
+    }
+    EXPECT_EQ ( 1000u, map.size() );
+    EXPECT_LT ( 1000u / 16, map.chunkCount() );
+    EXPECT_FALSE ( map.set ( 7, -1. ) );
+    EXPECT_EQ ( 1000u, map.size() );
+
+    double value;
+    for ( int i = 0; i < 1000; ++i ) {
+        ASSERT_TRUE ( map.get ( i, value ) );
+        ASSERT_EQ ( i == 7 ? -1. : i * 0.5, value );
+    }
+    EXPECT_FALSE ( map.contains ( 1000 ) );
+    EXPECT_FALSE ( map.contains ( -1 ) );
+
+    for ( int i = 0; i < 1000; i += 2 ) {
+        ASSERT_TRUE ( map.erase ( i ) );
+    }
+    EXPECT_FALSE ( map.erase ( 0 ) );
+    EXPECT_EQ ( 500u, map.size() );
+    for ( int i = 0; i < 1000; ++i ) {
+        ASSERT_EQ ( i % 2 == 1, map.contains ( i ) );
+    }
+}
+
+/**
+ * @test Checks batched lookups against single ones, including missing keys
+ */
+TEST ( managedHashMap, Unit_BatchedLookup )
+{
+    managedDummySwap swap ( 100 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 100 * kib );
+    managedHashMap<unsigned int, unsigned int> map;
+    for ( unsigned int i = 0; i < 5000; ++i ) {
+        map.set ( 3 * i, i );
+    }
+
+    const unsigned int n = 2000;
+    unsigned int keys[n];
+    unsigned int values[n];
+    bool found[n];
+    for ( unsigned int k = 0; k < n; ++k ) {
+        keys[k] = ( 7919 * k ) % 16000;
+        values[k] = 0;
+    }
+    unsigned int hits = map.getMany ( keys, values, found, n );
+
+    unsigned int expectedHits = 0;
+    for ( unsigned int k = 0; k < n; ++k ) {
+        bool present = keys[k] % 3 == 0 && keys[k] < 15000;
+        ASSERT_EQ ( present, found[k] );
+        if ( present ) {
+            ASSERT_EQ ( keys[k] / 3, values[k] );
+            ++expectedHits;
+        }
+    }
+    EXPECT_EQ ( expectedHits, hits );
+}
+
+/**
+ * @test Checks that bulk loading matches inserting one by one and handles keys already present
+ */
+TEST ( managedHashMap, Unit_BulkLoad )
+{
+    managedDummySwap swap ( 200 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 200 * kib );
+    managedHashMap<long, long> map;
+    map.set ( 5, 0 );
+
+    const unsigned int n = 4000;
+    long keys[n];
+    long values[n];
+    for ( unsigned int k = 0; k < n; ++k ) {
+        keys[k] = k;
+        values[k] = -( long ) k;
+    }
+    EXPECT_EQ ( n - 1, map.bulkLoad ( keys, values, n ) );
+    EXPECT_EQ ( n, map.size() );
+
+    long value;
+    for ( unsigned int k = 0; k < n; ++k ) {
+        ASSERT_TRUE ( map.get ( k, value ) );
+        ASSERT_EQ ( - ( long ) k, value );
+    }
+}
+
+/**
+ * @test Fills a map several times larger than the memory limit, only some chunks are resident at a time
+ */
+TEST ( managedHashMap, Unit_LargerThanMemory )
+{
+    const global_bytesize mem = 32 * kib;
+    managedDummySwap swap ( 64 * mem );
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    managedHashMap<unsigned int, double> map ( 64 );
+
+    const unsigned int n = 4 * mem / sizeof ( double );
+    for ( unsigned int i = 0; i < n; ++i ) {
+        map.set ( i, i );
+        ASSERT_LE ( managedMemory.getUsedMemory(), mem );
+    }
+    EXPECT_LT ( 0u, managedMemory.getSwappedMemory() );
+    EXPECT_LT ( 4 * mem, ( global_bytesize ) map.chunkCount() * map.slotsPerChunk() * ( sizeof ( unsigned int ) + sizeof ( double ) ) );
+
+    double value;
+    for ( unsigned int i = 0; i < n; i += 7 ) {
+        ASSERT_TRUE ( map.get ( i, value ) );
+        ASSERT_EQ ( i, value );
+    }
+}
+
+RESTORE_WARNINGS;
@@ -21,6 +21,9 @@
 #include "managedMemory.h"
 #include "dummyManagedMemory.h"
 #include "cyclicManagedMemory.h"
+#include "managedPtr.h"
+#include <thread>
+#include <chrono>
 
 using namespace rambrain;
 /**
@@ -114,3 +117,52 @@ TEST ( managedMemory, DISABLED_Unit_FallbackToDefaultManagerChainWrongOrder )
 
     // The state of the system is now broken, since man1 does not exist anymore; Can never fall back to fallbackManager
 }
+
+/**
+ * @test Checks that the background reclaimer keeps ram usage below the high watermark without the user asking for space
+ */
+TEST ( managedMemory, Unit_BackgroundReclaimKeepsWatermark )
+{
+    const unsigned int n_el = 90;
+    const global_bytesize memsize = 1000;
+
+    managedDummySwap swap ( 10 * memsize );
+    cyclicManagedMemory manager ( &swap, memsize );
+
+    EXPECT_FALSE ( manager.setReclaimWatermarks ( .7, .5 ) );
+    ASSERT_TRUE ( manager.setReclaimWatermarks ( .5, .7 ) );
+    EXPECT_FALSE ( manager.setBackgroundReclaim ( true ) );
+    manager.setPreemptiveUnloading ( false ); // Otherwise the scheduler keeps ram free on our thread
+
+    managedPtr<char> *ptrs[n_el];
+    for ( unsigned int n = 0; n < n_el; ++n ) {
+        ptrs[n] = new managedPtr<char> ( 10 );
+    }
+
+    // Allocations alone never exceeded the limit, so any swapout has to come from the reclaimer
+    for ( unsigned int n = 0; n < 100 && manager.getUsedMemory() > .7 * memsize; ++n ) {
+        std::this_thread::sleep_for ( std::chrono::milliseconds ( 10 ) );
+    }
+    EXPECT_GE ( .7 * memsize, manager.getUsedMemory() );
+#ifdef SWAPSTATS
+    EXPECT_LT ( 0u, manager.getBackgroundReclaimBytes() );
+    EXPECT_EQ ( 0u, manager.getDirectReclaimBytes() );
+#endif
+
+    // Data survives reclaim:
+    for ( unsigned int n = 0; n < n_el; ++n ) {
+        adhereTo<char> glue ( *ptrs[n] );
+        char *loc = glue;
+        loc[0] = n;
+    }
+    for ( unsigned int n = 0; n < n_el; ++n ) {
+        adhereTo<char> glue ( *ptrs[n] );
+        const char *loc = glue;
+        EXPECT_EQ ( ( char ) n, loc[0] );
+    }
+
+    EXPECT_TRUE ( manager.setBackgroundReclaim ( false ) );
+    for ( unsigned int n = 0; n < n_el; ++n ) {
+        delete ptrs[n];
+    }
+}
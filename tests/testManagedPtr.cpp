@@ -26,6 +26,7 @@ IGNORE_TEST_WARNINGS;
 #include "managedDummySwap.h"
 #include "dummyManagedMemory.h"
 #include "exceptions.h"
+#include "statsSnapshot.h"
 
 #ifndef OpenMP_NOT_FOUND
 #include <omp.h>
@@ -949,5 +950,133 @@ TEST ( managedPtr, Unit_ThreeDimensionalPtr )
     } );
 }
 
-RESTORE_WARNINGS;
+/**
+ * @test Checks that resizing keeps the contents of resident and swapped out arrays
+ */
+TEST ( managedPtr, Unit_Realloc )
+{
+    const unsigned int alloc = 100u;
+    const global_bytesize memsize = 2.5 * alloc * sizeof ( double );
+
+    managedDummySwap swap ( 10 * memsize );
+    cyclicManagedMemory managedMemory ( &swap, memsize );
+    managedMemory.setPreemptiveUnloading ( false );
+    managedMemory.setPreemptiveLoading ( false );
+
+    managedPtr<double> ptr ( alloc );
+    {
+        ADHERETOLOC ( double, ptr, loc );
+        for ( unsigned int n = 0; n < alloc; n++ ) {
+            loc[n] = n;
+        }
+        EXPECT_THROW ( ptr.mrealloc ( 2 * alloc ), memoryException );
+    }
+    {
+        managedPtr<double> copy ( ptr );
+        EXPECT_THROW ( ptr.mrealloc ( 2 * alloc ), memoryException );
+    }
+
+    //Resident:
+    ASSERT_TRUE ( ptr.mrealloc ( 2 * alloc ) );
+    ASSERT_EQ ( 2 * alloc, ptr.size() );
+    EXPECT_EQ ( 2 * alloc * sizeof ( double ), managedMemory.getUsedMemory() );
+    {
+        ADHERETOLOC ( double, ptr, loc );
+        for ( unsigned int n = 0; n < alloc; n++ ) {
+            ASSERT_EQ ( n, loc[n] );
+            loc[n + alloc] = n + alloc;
+        }
+    }
+
+    //Swapped out by the next allocation:
+    managedPtr<double> other ( alloc );
+    ASSERT_EQ ( 2 * alloc * sizeof ( double ), managedMemory.getSwappedMemory() );
+    ASSERT_TRUE ( ptr.mrealloc ( alloc / 2 ) );
+    EXPECT_EQ ( alloc / 2 * sizeof ( double ), managedMemory.getSwappedMemory() );
+#ifdef SWAPSTATS
+    EXPECT_EQ ( 1u, managedMemory.getSwappedReallocs() );
+    EXPECT_EQ ( 1u, managedMemory.getResidentReallocs() );
+#endif
+    {
+        ADHERETOLOCCONST ( double, ptr, loc );
+        for ( unsigned int n = 0; n < alloc / 2; n++ ) {
+            ASSERT_EQ ( n, loc[n] );
+        }
+    }
+}
+
+///@brief returns resident and swapped bytes of the chunks allocated under label
+static std::pair<global_bytesize, global_bytesize> labelBytes ( managedMemory *manager, const char *label )
+{
+    for ( const labelReportEntry &entry : labelReport ( manager ) ) {
+        if ( entry.label == label ) {
+            return {entry.resident_bytes, entry.swapped_bytes};
+        }
+    }
+    return {0, 0};
+}
+
+/**
+ * @test Checks that pinned and high priority arrays stay resident while cycling through others, and that pins beyond the pin fraction are refused
+ */
+TEST ( managedPtr, Unit_PinAndPriority )
+{
+    const unsigned int size = 4 * kib, nscratch = 32;
+    managedDummySwap swap ( 2 * ( nscratch + 16 ) * size );
+    cyclicManagedMemory managedMemory ( &swap, 16 * size );
+    managedMemory.setPreemptiveLoading ( false );
+    EXPECT_FALSE ( managedMemory.setPinFraction ( 1.5 ) );
+    ASSERT_TRUE ( managedMemory.setPinFraction ( .5 ) );
+
+    managedPtr<char> table ( allocationLabel ( "table" ), size );
+    managedPtr<char> hot ( allocationLabel ( "hot" ), size );
+    managedPtr<char> big ( 8 * size );
+    ASSERT_TRUE ( table.pin() );
+    EXPECT_EQ ( size, managedMemory.getPinnedMemory() );
+    //Would take 9 of the 8 pinnable chunks:
+    EXPECT_FALSE ( big.pin() );
+    EXPECT_EQ ( size, managedMemory.getPinnedMemory() );
+    hot.setEvictionPriority ( PRIORITY_HIGH );
+
+    std::vector<managedPtr<char> *> scratch;
+    for ( unsigned int p = 0; p < nscratch; ++p ) {
+        scratch.push_back ( new managedPtr<char> ( size ) );
+    }
+    auto cycle = [&scratch]() {
+        for ( unsigned int r = 0; r < 2; ++r ) {
+            for ( managedPtr<char> *ptr : scratch ) {
+                adhereTo<char> glue ( *ptr );
+                char *loc = glue;
+                ++loc[0];
+            }
+        }
+    };
+    cycle();
+    EXPECT_EQ ( size, labelBytes ( &managedMemory, "table" ).first );
+    EXPECT_EQ ( size, labelBytes ( &managedMemory, "hot" ).first );
+
+    //Unpinned and back to normal priority, both are old enough to be swapped out:
+    ASSERT_TRUE ( table.unpin() );
+    EXPECT_FALSE ( table.unpin() );
+    EXPECT_EQ ( 0u, managedMemory.getPinnedMemory() );
+    hot.resetEvictionPriority();
+    cycle();
+    EXPECT_EQ ( size, labelBytes ( &managedMemory, "table" ).second );
+    EXPECT_EQ ( size, labelBytes ( &managedMemory, "hot" ).second );
+
+    //Pinning swaps in, freeing releases the pin:
+    ASSERT_TRUE ( table.pin() );
+    EXPECT_EQ ( 0u, labelBytes ( &managedMemory, "table" ).second );
+    {
+        managedPtr<char> pinned ( size );
+        ASSERT_TRUE ( pinned.pin() );
+        EXPECT_EQ ( 2 * size, managedMemory.getPinnedMemory() );
+    }
+    EXPECT_EQ ( size, managedMemory.getPinnedMemory() );
 
+    for ( managedPtr<char> *ptr : scratch ) {
+        delete ptr;
+    }
+}
+
+RESTORE_WARNINGS;
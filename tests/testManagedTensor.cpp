@@ -0,0 +1,156 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include "managedTensor.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+#include "exceptions.h"
+
+using namespace rambrain;
+
+/**
+ * @test Checks tile numbering, clipped border tiles and element access of a three dimensional tensor
+ */
+TEST ( managedTensor, Unit_TileLayout )
+{
+    managedDummySwap swap ( 10 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 10 * kib );
+    typedef managedTensor<int, 3>::index index;
+    managedTensor<int, 3> tensor ( {5, 7, 3}, {2, 3, 2} );
+
+    EXPECT_EQ ( 18u, tensor.tiles() );
+    EXPECT_EQ ( ( index {3, 3, 2} ), tensor.tileGrid() );
+    EXPECT_EQ ( 105u, tensor.size() );
+    EXPECT_EQ ( ( index {2, 3, 2} ), tensor.tileExtents ( 0 ) );
+    EXPECT_EQ ( ( index {1, 1, 1} ), tensor.tileExtents ( 17 ) );
+    EXPECT_EQ ( ( index {4, 6, 2} ), tensor.tileOrigin ( 17 ) );
+    EXPECT_EQ ( 17u, tensor.tileOf ( {4, 6, 2} ) );
+
+    for ( unsigned int i = 0; i < 5; ++i ) {
+        for ( unsigned int j = 0; j < 7; ++j ) {
+            for ( unsigned int k = 0; k < 3; ++k ) {
+                tensor.set ( {i, j, k}, ( i * 7 + j ) * 3 + k );
+            }
+        }
+    }
+    EXPECT_EQ ( 52, tensor.at ( {2, 3, 1} ) );
+    EXPECT_THROW ( tensor.at ( {5, 0, 0} ), memoryException );
+    EXPECT_THROW ( tensor.set ( {0, 0, 3}, 0 ), memoryException );
+
+    //Every element is visited once, in the layout given by its tile:
+    unsigned int visited = 0, tiles = 0;
+    tensor.forEachTile ( [&] ( const int *data, const index & origin, const index & ext ) {
+        ASSERT_EQ ( tensor.tileOrigin ( tiles++ ), origin );
+        for ( unsigned int i = 0; i < ext[0]; ++i ) {
+            for ( unsigned int j = 0; j < ext[1]; ++j ) {
+                for ( unsigned int k = 0; k < ext[2]; ++k ) {
+                    const int expect = ( ( origin[0] + i ) * 7 + origin[1] + j ) * 3 + origin[2] + k;
+                    ASSERT_EQ ( expect, data[ ( i * ext[1] + j ) * ext[2] + k] );
+                    ++visited;
+                }
+            }
+        }
+    } );
+    EXPECT_EQ ( 18u, tiles );
+    EXPECT_EQ ( 105u, visited );
+
+    EXPECT_EQ ( 4u, tensor.prefetch ( {1, 2, 0}, {3, 4, 1} ) );
+    EXPECT_EQ ( 1u, tensor.prefetch ( {4, 6, 2}, {9, 9, 9} ) );
+    EXPECT_EQ ( 0u, tensor.prefetch ( {1, 2, 0}, {1, 4, 1} ) );
+
+    EXPECT_THROW ( ( managedTensor<int, 2> ( {4, 4}, {5, 1} ) ), memoryException );
+    EXPECT_THROW ( ( managedTensor<int, 2> ( {0, 4} ) ), memoryException );
+}
+
+/**
+ * @test Checks that chosen tiles are as square as the extents allow and fill the requested size
+ */
+TEST ( managedTensor, Unit_ChooseTileShape )
+{
+    managedDummySwap swap ( mib );
+    cyclicManagedMemory managedMemory ( &swap, 512 * kib );
+    typedef managedTensor<double, 2>::index index2;
+    typedef managedTensor<double, 3>::index index3;
+
+    EXPECT_EQ ( ( index2 {100, 100} ), ( managedTensor<double, 2>::chooseTileShape ( {1000, 1000}, 10000 * sizeof ( double ) ) ) );
+    EXPECT_EQ ( ( index2 {4, 2500} ), ( managedTensor<double, 2>::chooseTileShape ( {4, 100000}, 10000 * sizeof ( double ) ) ) );
+    EXPECT_EQ ( ( index2 {50, 30} ), ( managedTensor<double, 2>::chooseTileShape ( {50, 30}, 10000 * sizeof ( double ) ) ) );
+    EXPECT_EQ ( ( index3 {16, 16, 16} ), ( managedTensor<double, 3>::chooseTileShape ( {64, 64, 64}, 4096 * sizeof ( double ) ) ) );
+    EXPECT_EQ ( ( index3 {45, 2, 45} ), ( managedTensor<double, 3>::chooseTileShape ( {1000, 2, 1000}, 4096 * sizeof ( double ) ) ) );
+
+    //Without a size, tiles take 1/16 of the memory limit:
+    managedTensor<double, 2> tensor ( {100, 100} );
+    EXPECT_EQ ( ( index2 {64, 64} ), tensor.tileShape() );
+}
+
+/**
+ * @test Walks a column of a matrix larger than memory, which swaps in few tiles instead of every row
+ */
+TEST ( managedTensor, Unit_ColumnWalkLargerThanMemory )
+{
+    const unsigned int n = 256;
+    managedDummySwap swap ( 4 * mib );
+    cyclicManagedMemory managedMemory ( &swap, 128 * kib );
+
+    managedTensor<double, 2> tensor ( {n, n} );
+    managedPtr<double, 2> rows ( n, n );
+    tensor.forEachTile ( [] ( double * data, const managedTensor<double, 2>::index & origin, const managedTensor<double, 2>::index & ext ) {
+        for ( unsigned int i = 0; i < ext[0]; ++i ) {
+            for ( unsigned int j = 0; j < ext[1]; ++j ) {
+                data[i * ext[1] + j] = ( origin[0] + i ) * n + origin[1] + j;
+            }
+        }
+    } );
+    for ( unsigned int i = 0; i < n; ++i ) {
+        adhereTo<double> glue ( rows[i] );
+        double *row = glue;
+        for ( unsigned int j = 0; j < n; ++j ) {
+            row[j] = i * n + j;
+        }
+    }
+    ASSERT_LT ( 0u, managedMemory.getSwappedMemory() );
+
+#ifdef SWAPSTATS
+    double before = managedMemory.getTotalSwappedInBytes();
+#endif
+    tensor.prefetch ( {0, n / 2}, {n, n / 2 + 1} );
+    for ( unsigned int i = 0; i < n; ++i ) {
+        ASSERT_EQ ( i * n + n / 2, tensor.at ( {i, n / 2} ) );
+    }
+#ifdef SWAPSTATS
+    double tiled = managedMemory.getTotalSwappedInBytes() - before;
+    before = managedMemory.getTotalSwappedInBytes();
+#endif
+    for ( unsigned int i = 0; i < n; ++i ) {
+        const adhereTo<double> glue ( rows[i] );
+        const double *row = glue;
+        ASSERT_EQ ( i * n + n / 2, row[n / 2] );
+    }
+#ifdef SWAPSTATS
+    double rowwise = managedMemory.getTotalSwappedInBytes() - before;
+    //The column lies in n / 32 tiles, rows are swapped in almost all:
+    EXPECT_LT ( 4 * tiled, rowwise );
+#endif
+}
+
+RESTORE_WARNINGS;
@@ -0,0 +1,145 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include "managedVector.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+#include "exceptions.h"
+
+using namespace rambrain;
+
+/**
+ * @test Checks appending, element access and removal across segment boundaries
+ */
+TEST ( managedVector, Unit_PushBackAndAccess )
+{
+    managedDummySwap swap ( 10 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 10 * kib );
+    managedVector<int> vec ( 10 );
+
+    ASSERT_TRUE ( vec.empty() );
+    for ( int i = 0; i < 95; ++i ) {
+        vec.push_back ( i );
+    }
+    vec.emplace_back ( 95 );
+
+    ASSERT_EQ ( 96u, vec.size() );
+    ASSERT_EQ ( 100u, vec.capacity() );
+    ASSERT_EQ ( 10u, vec.usedSegments() );
+    for ( int i = 0; i < 96; ++i ) {
+        ASSERT_EQ ( i, vec.at ( i ) );
+    }
+    EXPECT_THROW ( vec.at ( 96 ), memoryException );
+
+    vec.set ( 3, -3 );
+    vec.set ( 93, -93 );
+    EXPECT_EQ ( -3, vec.at ( 3 ) );
+    EXPECT_EQ ( -93, vec.at ( 93 ) );
+
+    for ( int i = 0; i < 7; ++i ) {
+        vec.pop_back();
+    }
+    EXPECT_EQ ( 89u, vec.size() );
+    EXPECT_EQ ( 88, vec.at ( 88 ) );
+    vec.shrink_to_fit();
+    EXPECT_EQ ( 90u, vec.capacity() );
+
+    vec.clear();
+    EXPECT_TRUE ( vec.empty() );
+    EXPECT_EQ ( 0u, vec.capacity() );
+    EXPECT_THROW ( vec.pop_back(), memoryException );
+}
+
+/**
+ * @test Checks that segment-wise iteration visits every element once and in order
+ */
+TEST ( managedVector, Unit_ForEachSegment )
+{
+    managedDummySwap swap ( 10 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 10 * kib );
+    managedVector<double> vec ( 16 );
+    for ( unsigned int i = 0; i < 100; ++i ) {
+        vec.push_back ( i );
+    }
+
+    vec.forEachSegment ( [] ( double * data, unsigned int count, size_t first ) {
+        for ( unsigned int n = 0; n < count; ++n ) {
+            data[n] *= 2;
+        }
+    } );
+
+    size_t expectedFirst = 0;
+    const managedVector<double> &cvec = vec;
+    cvec.forEachSegment ( [&] ( const double * data, unsigned int count, size_t first ) {
+        ASSERT_EQ ( expectedFirst, first );
+        for ( unsigned int n = 0; n < count; ++n ) {
+            ASSERT_EQ ( 2. * ( first + n ), data[n] );
+        }
+        expectedFirst += count;
+    } );
+    EXPECT_EQ ( 100u, expectedFirst );
+}
+
+/**
+ * @test Fills a vector several times larger than the memory limit, only the tail has to stay resident
+ */
+TEST ( managedVector, Unit_LargerThanMemory )
+{
+    const global_bytesize mem = 16 * kib;
+    const unsigned int count = 8 * mem / sizeof ( double );
+    managedDummySwap swap ( 16 * mem );
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    managedVector<double> vec;
+
+    ASSERT_GE ( mem / 16, vec.segmentLength() * sizeof ( double ) );
+    for ( unsigned int i = 0; i < count; ++i ) {
+        vec.push_back ( i );
+        ASSERT_LE ( managedMemory.getUsedMemory(), mem );
+    }
+    EXPECT_LT ( 0u, managedMemory.getSwappedMemory() );
+
+    vec.releaseTail();
+    const managedVector<double> &cvec = vec;
+    size_t visited = 0;
+    cvec.forEachSegment ( [&] ( const double * data, unsigned int n, size_t first ) {
+        for ( unsigned int j = 0; j < n; ++j ) {
+            ASSERT_EQ ( first + j, data[j] );
+        }
+        visited += n;
+    } );
+    EXPECT_EQ ( count, visited );
+}
+
+/**
+ * @test Checks that segments the memory manager would split are refused
+ */
+TEST ( managedVector, Unit_SegmentTooLarge )
+{
+    managedDummySwap swap ( 10 * kib );
+    cyclicManagedMemory managedMemory ( &swap, kib );
+    managedMemory.setSegmentSize ( kib / 2 );
+    EXPECT_THROW ( managedVector<double> vec ( kib ), memoryException );
+    EXPECT_NO_THROW ( managedVector<double> vec ( 16 ) );
+}
+
+RESTORE_WARNINGS;
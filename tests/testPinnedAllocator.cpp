@@ -0,0 +1,128 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "pinnedAllocator.h"
+#include "managedPtr.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+#include "managedFileSwap.h"
+#include "exceptions.h"
+
+using namespace rambrain;
+
+/**
+ * @test Checks that the buffer of a std::vector keeps its address and contents when swapped out while unpinned
+ */
+TEST ( pinnedAllocator, Unit_StdVector )
+{
+    const global_bytesize mem = 512 * kib;
+    managedDummySwap swap ( 4 * mem );
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    pinnedMemoryResource resource ( 16 * kib );
+
+    pinned_allocator<double> alloc ( &resource );
+    std::vector<double, pinned_allocator<double> > vec ( alloc );
+    vec.resize ( mem / 2 / sizeof ( double ) );
+    for ( size_t i = 0; i < vec.size(); ++i ) {
+        vec[i] = i;
+    }
+    const double *data = vec.data();
+    ASSERT_EQ ( 1u, resource.managedBuffers() );
+    ASSERT_TRUE ( resource.isPinned ( data + 10 ) );
+
+    EXPECT_TRUE ( resource.unpin ( data ) );
+    EXPECT_FALSE ( resource.unpin ( data ) );
+    {
+        managedPtr<char> other ( 3 * mem / 4 );
+        adhereTo<char> glue ( other );
+        char *loc = glue;
+        loc[0] = 1;
+        EXPECT_LT ( 0u, managedMemory.getSwappedMemory() );
+    }
+    EXPECT_TRUE ( resource.pin ( data + vec.size() - 1 ) );
+    EXPECT_FALSE ( resource.pin ( data ) );
+
+    ASSERT_EQ ( data, vec.data() );
+    for ( size_t i = 0; i < vec.size(); ++i ) {
+        ASSERT_EQ ( i, vec[i] );
+    }
+
+    int foreign;
+    EXPECT_FALSE ( resource.unpin ( &foreign ) );
+    EXPECT_FALSE ( resource.isPinned ( &foreign ) );
+    vec.clear();
+    vec.shrink_to_fit();
+    EXPECT_EQ ( 0u, resource.managedBuffers() );
+}
+
+/**
+ * @test Grows std::pmr::vectors through small and large buffers and swaps them phase-wise through a file swap
+ */
+TEST ( pinnedAllocator, Unit_PmrVectorPhases )
+{
+    const global_bytesize mem = 1024 * kib;
+#ifdef WIN32
+    managedFileSwap swap ( 8 * mem, "rambrainswap-tmp-%d-%d" );
+#else
+    managedFileSwap swap ( 8 * mem, "/tmp/rambrainswap-%d-%d" );
+#endif
+    cyclicManagedMemory managedMemory ( &swap, mem );
+    pinnedMemoryResource resource ( 16 * kib );
+
+    //Three vectors of 3/8 of the limit each, only two fit at a time:
+    const unsigned int n = 3 * mem / 8 / sizeof ( int );
+    std::pmr::vector<int> vecs[3] = {std::pmr::vector<int> ( &resource ), std::pmr::vector<int> ( &resource ), std::pmr::vector<int> ( &resource ) };
+    for ( unsigned int v = 0; v < 3; ++v ) {
+        vecs[v].reserve ( n );
+        for ( unsigned int i = 0; i < n; ++i ) {
+            vecs[v].push_back ( v * n + i );
+        }
+        resource.unpin ( vecs[v].data() );
+    }
+    EXPECT_EQ ( 3u, resource.managedBuffers() );
+
+    for ( unsigned int phase = 0; phase < 6; ++phase ) {
+        std::pmr::vector<int> &vec = vecs[phase % 3];
+        ASSERT_TRUE ( resource.pin ( vec.data() ) );
+        for ( unsigned int i = 0; i < n; ++i ) {
+            ASSERT_EQ ( ( int ) ( ( phase % 3 ) * n + i + phase / 3 ), vec[i] );
+            ++vec[i];
+        }
+        resource.unpin ( vec.data() );
+    }
+    EXPECT_LT ( 0u, managedMemory.getSwappedMemory() );
+
+    //Unpinned buffers may be freed, as long as the elements' destructors do not touch them:
+    vecs[2] = std::pmr::vector<int> ( &resource );
+    EXPECT_EQ ( 2u, resource.managedBuffers() );
+    resource.pinAll();
+    for ( unsigned int v = 0; v < 2; ++v ) {
+        EXPECT_TRUE ( resource.isPinned ( vecs[v].data() ) );
+        EXPECT_EQ ( ( int ) ( v * n + 2 ), vecs[v][0] );
+        vecs[v] = std::pmr::vector<int> ( &resource );
+    }
+    EXPECT_EQ ( 0u, resource.managedBuffers() );
+}
+
+RESTORE_WARNINGS;
@@ -261,6 +261,14 @@ TEST ( regexMatcher, Unit_KeyEqualsSpecialValue )
     kv = regex.matchKeyEqualsValue ( "key = /bla/~/blup/.swap_%d-%d", regexMatcher::swapfilename );
     EXPECT_EQ ( "", kv.first );
     EXPECT_EQ ( "", kv.second );
+
+    kv = regex.matchKeyEqualsValue ( "key = mesh:64MB:2, scratch_2:0:-1", regexMatcher::labelpolicies );
+    EXPECT_EQ ( "key", kv.first );
+    EXPECT_EQ ( "mesh:64MB:2, scratch_2:0:-1", kv.second );
+
+    kv = regex.matchKeyEqualsValue ( "key = mesh:64MB", regexMatcher::labelpolicies );
+    EXPECT_EQ ( "", kv.first );
+    EXPECT_EQ ( "", kv.second );
 }
 
 /**
@@ -0,0 +1,246 @@
+/*   rambrain - a dynamical physical memory extender
+ *   Copyright (C) 2015 M. Imgrund, A. Arth
+ *   mimgrund (at) mpifr-bonn.mpg.de
+ *   arth (at) usm.uni-muenchen.de
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tester.h"
+IGNORE_TEST_WARNINGS;
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "statsSnapshot.h"
+#include "managedPtr.h"
+#include "cyclicManagedMemory.h"
+#include "managedDummySwap.h"
+
+using namespace rambrain;
+
+/**
+ * @test Checks that a snapshot agrees with the manager's getters and is serialized completely
+ */
+TEST ( statsSnapshot, Unit_SnapshotAndSerialize )
+{
+    managedDummySwap swap ( 64 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 16 * kib );
+    std::vector<managedPtr<char> *> ptrs;
+    for ( unsigned int p = 0; p < 16; ++p ) {
+        ptrs.push_back ( new managedPtr<char> ( 2 * kib, p ) );
+    }
+    for ( managedPtr<char> *ptr : ptrs ) {
+        adhereTo<char> glue ( *ptr );
+        char *loc = glue;
+        ++loc[0];
+    }
+
+    rambrainStats stats = statsSnapshot();
+    EXPECT_EQ ( rambrainStats::currentVersion, stats.version );
+    EXPECT_LT ( 0, stats.timestamp );
+    EXPECT_EQ ( managedMemory.getMemoryLimit(), stats.memory.limit );
+    EXPECT_EQ ( managedMemory.getUsedMemory(), stats.memory.used );
+    EXPECT_EQ ( managedMemory.getSwappedMemory(), stats.memory.swapped );
+    EXPECT_EQ ( 32 * kib, stats.memory.used + stats.memory.swapped );
+    EXPECT_EQ ( swap.getUsedSwap(), stats.swap.used );
+    EXPECT_EQ ( swap.getSwapSize(), stats.swap.size );
+    EXPECT_EQ ( managedMemory.getSwapInFrac(), stats.scheduler.swapin_frac );
+#ifdef SWAPSTATS
+    EXPECT_TRUE ( stats.swapstats );
+    EXPECT_LT ( 0u, stats.counters.swapouts );
+    EXPECT_LT ( 0u, stats.counters.misses );
+    EXPECT_DOUBLE_EQ ( managedMemory.getHitsOverMisses(), ( double ) stats.counters.hits / stats.counters.misses );
+#endif
+
+    std::string json = statsToJson ( stats );
+    EXPECT_EQ ( 0u, json.find ( "{\"version\":1,\"timestamp\":" ) );
+    EXPECT_EQ ( '}', json.back() );
+    char expect[64];
+    snprintf ( expect, 64, "\"memory\":{\"limit\":%lu,", ( unsigned long ) stats.memory.limit );
+    EXPECT_NE ( std::string::npos, json.find ( expect ) );
+    EXPECT_NE ( std::string::npos, json.find ( "\"latencies\":{\"swapin_wait\":{\"count\":" ) );
+
+    std::string text = statsToText ( stats );
+    snprintf ( expect, 64, "\nrambrain_memory_used_bytes %lu\n", ( unsigned long ) stats.memory.used );
+    EXPECT_NE ( std::string::npos, text.find ( expect ) );
+    EXPECT_NE ( std::string::npos, text.find ( "# TYPE rambrain_memory_used_bytes gauge\n" ) );
+#ifdef SWAPSTATS
+    EXPECT_NE ( std::string::npos, text.find ( "rambrain_stall_seconds_count{stall=\"state_lock\"}" ) );
+#endif
+
+#ifdef WIN32
+    const char *path = "rambrain-stats-test.json";
+#else
+    const char *path = "/tmp/rambrain-stats-test.json";
+#endif
+    ASSERT_TRUE ( writeStatsFile ( path ) );
+    FILE *file = fopen ( path, "r" );
+    ASSERT_TRUE ( file != NULL );
+    char head[16] = {0};
+    EXPECT_EQ ( 14u, fread ( head, 1, 14, file ) );
+    fclose ( file );
+    remove ( path );
+    EXPECT_STREQ ( "{\"version\":1,\"", head );
+
+    for ( managedPtr<char> *ptr : ptrs ) {
+        delete ptr;
+    }
+}
+
+/**
+ * @test Takes snapshots from a sidecar thread while several threads swap, checking that no snapshot catches a change half done
+ */
+TEST ( statsSnapshot, Unit_ConsistentUnderLoad )
+{
+    const unsigned int nthreads = 4, nptrs = 64, size = kib, rounds = 200;
+    managedDummySwap swap ( 2 * nptrs * size );
+    cyclicManagedMemory managedMemory ( &swap, nptrs * size / 4 );
+    std::vector<managedPtr<int> *> ptrs;
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        ptrs.push_back ( new managedPtr<int> ( size / sizeof ( int ), 0 ) );
+    }
+    const global_bytesize total = managedMemory.getUsedMemory() + managedMemory.getSwappedMemory();
+    const rambrainStats before = statsSnapshot();
+
+    std::atomic<bool> running ( true );
+    unsigned int snapshots = 0, inconsistent = 0, backwards = 0;
+    std::thread sidecar ( [&]() {
+        rambrainStats last = statsSnapshot();
+        while ( running ) {
+            rambrainStats stats = statsSnapshot();
+            ++snapshots;
+            //The dummy swap moves bytes between ram and swap in one locked step:
+            if ( stats.memory.used + stats.memory.swapped != total || stats.memory.used > stats.memory.limit ) {
+                ++inconsistent;
+            }
+            if ( stats.counters.hits + stats.counters.misses < last.counters.hits + last.counters.misses
+                    || stats.counters.swapouts < last.counters.swapouts || stats.counters.swapins < last.counters.swapins
+                    || stats.scheduler.misses < last.scheduler.misses || stats.timestamp < last.timestamp ) {
+                ++backwards;
+            }
+            last = stats;
+        }
+    } );
+
+    std::vector<std::thread> workers;
+    for ( unsigned int t = 0; t < nthreads; ++t ) {
+        workers.emplace_back ( [&ptrs, t]() {
+            for ( unsigned int r = 0; r < rounds; ++r ) {
+                for ( unsigned int p = t; p < nptrs; p += nthreads ) {
+                    adhereTo<int> glue ( *ptrs[p] );
+                    int *loc = glue;
+                    ++loc[0];
+                }
+            }
+        } );
+    }
+    for ( std::thread &worker : workers ) {
+        worker.join();
+    }
+    running = false;
+    sidecar.join();
+
+    EXPECT_LT ( 0u, snapshots );
+    EXPECT_EQ ( 0u, inconsistent );
+    EXPECT_EQ ( 0u, backwards );
+#ifdef SWAPSTATS
+    rambrainStats stats = statsSnapshot();
+    EXPECT_EQ ( ( global_bytesize ) nptrs * rounds, stats.counters.hits + stats.counters.misses - before.counters.hits - before.counters.misses );
+#endif
+    for ( unsigned int p = 0; p < nptrs; ++p ) {
+        adhereTo<int> glue ( *ptrs[p] );
+        const int *loc = glue;
+        ASSERT_EQ ( ( int ) rounds, loc[0] );
+    }
+    for ( managedPtr<int> *ptr : ptrs ) {
+        delete ptr;
+    }
+}
+
+/**
+ * @test Checks that chunks get the labels they were allocated with, and that the ones thrashing the swap are reported on top
+ */
+TEST ( statsSnapshot, Unit_HotnessReport )
+{
+    managedDummySwap swap ( 64 * kib );
+    cyclicManagedMemory managedMemory ( &swap, 16 * kib );
+    const unsigned int nthrash = 12, rounds = 3;
+
+    managedPtr<char> cold[2] = {managedPtr<char> ( allocationLabel ( "cold" ), 2 * kib ), managedPtr<char> ( allocationLabel ( "cold" ), 2 * kib ) };
+    EXPECT_EQ ( NULL, managedMemory::getAllocationLabel() );
+    std::vector<managedPtr<char> *> thrash;
+    {
+        allocationLabel label ( "thrash" );
+        EXPECT_STREQ ( "thrash", managedMemory::getAllocationLabel() );
+        for ( unsigned int p = 0; p < nthrash; ++p ) {
+            thrash.push_back ( new managedPtr<char> ( 2 * kib ) );
+        }
+    }
+    EXPECT_EQ ( NULL, managedMemory::getAllocationLabel() );
+    managedPtr<char> unlabelled ( 2 * kib );
+    for ( unsigned int r = 0; r < rounds; ++r ) {
+        for ( managedPtr<char> *ptr : thrash ) {
+            adhereTo<char> glue ( *ptr );
+            char *loc = glue;
+            ++loc[0];
+        }
+    }
+
+    std::vector<labelReportEntry> labels = labelReport();
+    ASSERT_EQ ( 3u, labels.size() );
+    global_bytesize chunks = 0, bytes = 0;
+    for ( const labelReportEntry &entry : labels ) {
+        chunks += entry.chunks;
+        bytes += entry.resident_bytes + entry.swapped_bytes;
+        if ( entry.label == "cold" ) {
+            EXPECT_EQ ( 2u, entry.chunks );
+        } else if ( entry.label == "thrash" ) {
+            EXPECT_EQ ( nthrash, entry.chunks );
+        } else {
+            EXPECT_EQ ( "", entry.label );
+            EXPECT_EQ ( 1u, entry.chunks );
+        }
+    }
+    EXPECT_EQ ( nthrash + 3, chunks );
+    EXPECT_EQ ( ( nthrash + 3 ) * 2 * kib, bytes );
+
+    std::vector<chunkReportEntry> top = topChunks ( 4 );
+    ASSERT_EQ ( 4u, top.size() );
+    EXPECT_EQ ( nthrash + 3, topChunks ( 0 ).size() );
+#ifdef SWAPSTATS
+    EXPECT_EQ ( "thrash", labels[0].label );
+    EXPECT_LE ( nthrash * rounds, labels[0].counters.accesses );
+    EXPECT_LT ( 0u, labels[0].counters.swapins );
+    EXPECT_EQ ( labels[0].counters.swapin_bytes, labels[0].counters.swapins * 2 * kib );
+    for ( unsigned int t = 0; t < top.size(); ++t ) {
+        EXPECT_STREQ ( "thrash", top[t].label );
+        EXPECT_LE ( rounds, top[t].counters.accesses );
+        EXPECT_LT ( 0, top[t].counters.last_access );
+        if ( t > 0 ) {
+            EXPECT_GE ( top[t - 1].counters.swapin_bytes + top[t - 1].counters.swapout_bytes, top[t].counters.swapin_bytes + top[t].counters.swapout_bytes );
+        }
+    }
+#endif
+    std::string report = hotnessReport ( 4 );
+    EXPECT_NE ( std::string::npos, report.find ( "\nthrash " ) );
+    EXPECT_NE ( std::string::npos, report.find ( "\ncold " ) );
+
+    for ( managedPtr<char> *ptr : thrash ) {
+        delete ptr;
+    }
+}
+
+RESTORE_WARNINGS;
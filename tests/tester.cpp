@@ -164,10 +164,11 @@ void tester::writeToFile()
     }
 
     const int timesCount = timeMeasures.front().size() - 1;
-    int64_t** durations = (int64_t**)malloc(sizeof(int64_t) * timesCount * cyclesCount);
-    int64_t** starts = (int64_t**)malloc(sizeof(int64_t) * timesCount * cyclesCount);
-    int64_t** ends = (int64_t**)malloc(sizeof(int64_t) * timesCount * cyclesCount);
-    double** percentages = (double**)malloc(sizeof(double) * timesCount * cyclesCount);
+    //Stored row-wise, [time][cycle] is at time * cyclesCount + cycle:
+    int64_t* durations = (int64_t*)malloc(sizeof(int64_t) * timesCount * cyclesCount);
+    int64_t* starts = (int64_t*)malloc(sizeof(int64_t) * timesCount * cyclesCount);
+    int64_t* ends = (int64_t*)malloc(sizeof(int64_t) * timesCount * cyclesCount);
+    double* percentages = (double*)malloc(sizeof(double) * timesCount * cyclesCount);
 
     int cycle = 0, time;
     for ( auto repIt = timeMeasures.begin(); repIt != timeMeasures.end(); ++repIt, ++cycle ) {
@@ -175,10 +176,10 @@ void tester::writeToFile()
 
         time = 0;
         for ( auto it = repIt->begin(), jt = repIt->begin() + 1; it != repIt->end() && jt != repIt->end(); ++it, ++jt, ++time ) {
-            starts[time][cycle] = std::chrono::duration_cast<std::chrono::milliseconds> ( it->time_since_epoch() ).count();
-            ends[time][cycle] = std::chrono::duration_cast<std::chrono::milliseconds> ( jt->time_since_epoch() ).count();
-            durations[time][cycle] = std::chrono::duration_cast<std::chrono::milliseconds> ( ( *jt ) - ( *it ) ).count();
-            percentages[time][cycle] = 100.0 * durations[time][cycle] / totms;
+            starts[time * cyclesCount + cycle] = std::chrono::duration_cast<std::chrono::milliseconds> ( it->time_since_epoch() ).count();
+            ends[time * cyclesCount + cycle] = std::chrono::duration_cast<std::chrono::milliseconds> ( jt->time_since_epoch() ).count();
+            durations[time * cyclesCount + cycle] = std::chrono::duration_cast<std::chrono::milliseconds> ( ( *jt ) - ( *it ) ).count();
+            percentages[time * cyclesCount + cycle] = 100.0 * durations[time * cyclesCount + cycle] / totms;
         }
     }
 
@@ -190,10 +191,10 @@ void tester::writeToFile()
         avgPercentage = 0.0;
 
         for ( cycle = 0; cycle < cyclesCount; ++cycle ) {
-            avgTime += durations[time][cycle];
-            avgPercentage += percentages[time][cycle];
+            avgTime += durations[time * cyclesCount + cycle];
+            avgPercentage += percentages[time * cyclesCount + cycle];
 
-            out << durations[time][cycle] << "\t" << starts[time][cycle] << "\t" << ends[time][cycle] << "\t" << percentages[time][cycle] << "\t";
+            out << durations[time * cyclesCount + cycle] << "\t" << starts[time * cyclesCount + cycle] << "\t" << ends[time * cyclesCount + cycle] << "\t" << percentages[time * cyclesCount + cycle] << "\t";
         }
         avgTime /= cyclesCount;
         avgPercentage /= cyclesCount;